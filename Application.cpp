@@ -1,5 +1,7 @@
 #include "Globals.h"
 #include "Application.h"
+#include "JobSystem.h"
+#include "ModuleScheduler.h"
 #include "ModuleInput.h"
 #include "EditorModule.h"
 #include "ModuleResources.h"
@@ -7,6 +9,10 @@
 #include "D3D12Module.h"
 #include "ModuleShaderDescriptors.h"
 #include "ModuleSampler.h"
+#include "ModuleScene.h"
+#include "ModuleCulling.h"
+#include "ModulePipelines.h"
+#include "ModuleShaders.h"
 
 //#include "Exercise1.h"
 //#include "Exercise2.h"
@@ -15,29 +21,127 @@
 
 Application::Application(int argc, wchar_t** argv, void* hWnd)
 {
+    // Command line options (-framesInFlight N, -noLatencyWait)
+    unsigned int framesInFlight = FRAMES_IN_FLIGHT;
+    bool latencyWaitable = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (wcscmp(argv[i], L"-framesInFlight") == 0 and i + 1 < argc)
+            framesInFlight = unsigned(_wtoi(argv[++i]));
+        else if (wcscmp(argv[i], L"-noLatencyWait") == 0)
+            latencyWaitable = false;
+    }
+
+    jobSystem = new JobSystem();
+
     editorModule = new EditorModule((HWND)hWnd);
     modules.push_back(editorModule);
 
-    d3d12Module = new D3D12Module((HWND)hWnd);
+    d3d12Module = new D3D12Module((HWND)hWnd, framesInFlight, latencyWaitable);
     modules.push_back(d3d12Module);
     //modules.push_back(new Exercise1());
 
-    modules.push_back(new ModuleInput((HWND)hWnd)); // we may want to change this in the future
+    pipelinesModule = new ModulePipelines();
+    modules.push_back(pipelinesModule);
+
+    inputModule = new ModuleInput((HWND)hWnd); // we may want to change this in the future
+    modules.push_back(inputModule);
+
+    shadersModule = new ModuleShaders();
+    modules.push_back(shadersModule);
+
     resourcesModule = new ModuleResources();
     modules.push_back(resourcesModule);
 
     cameraModule = new ModuleCamera();
     modules.push_back(cameraModule);
 
+    cullingModule = new ModuleCulling();
+    modules.push_back(cullingModule);
+
     shaderDescModule = new ModuleShaderDescriptors();
     modules.push_back(shaderDescModule);
 
     samplerModule = new ModuleSampler();
     modules.push_back(samplerModule);
 
+    sceneModule = new ModuleScene();
+    modules.push_back(sceneModule);
+
     //modules.push_back(new Exercise2());
     //modules.push_back(new Exercise3());
-    modules.push_back(new Exercise4());
+    Exercise4* exercise = new Exercise4();
+    modules.push_back(exercise);
+
+    // Scheduling: what each module needs before it and what it touches on every phase (anything not set here
+    // conflicts with everything, so it runs alone and in registration order). Phases a module does nothing in are
+    // declared one by one, so a phase that starts doing something has to declare what it touches.
+    typedef Module::Phase Phase;
+    const unsigned int NONE = Module::ACCESS_NONE, ALL = Module::ACCESS_ALL;
+
+    auto setIdle = [](Module* module, std::initializer_list<Phase> phases) {
+        for (Phase phase : phases) module->setAccess(phase, Module::ACCESS_NONE, Module::ACCESS_NONE);
+    };
+
+    d3d12Module->setAccess(Module::PHASE_INIT, NONE, Module::ACCESS_DEVICE | Module::ACCESS_FRAME, true);
+    d3d12Module->setAccess(Module::PHASE_PRE_RENDER, NONE, Module::ACCESS_FRAME, true);
+    d3d12Module->setAccess(Module::PHASE_POST_RENDER, ALL, ALL, true); // submits and presents what the others recorded
+    setIdle(d3d12Module, { Module::PHASE_UPDATE, Module::PHASE_RENDER });
+    for (Module* module : modules)
+        if (module != d3d12Module) d3d12Module->dependsOn(module, Module::PHASE_POST_RENDER);
+
+    editorModule->dependsOn(d3d12Module, Module::PHASE_INIT);
+    editorModule->setAccess(Module::PHASE_INIT, Module::ACCESS_DEVICE, Module::ACCESS_IMGUI, true);
+    editorModule->setAccess(Module::PHASE_PRE_RENDER, NONE, Module::ACCESS_IMGUI, true); // (win32 cursor/input)
+    editorModule->setAccess(Module::PHASE_POST_RENDER, Module::ACCESS_IMGUI, Module::ACCESS_FRAME);
+    setIdle(editorModule, { Module::PHASE_UPDATE, Module::PHASE_RENDER });
+
+    setIdle(inputModule, { Module::PHASE_INIT, Module::PHASE_UPDATE, Module::PHASE_PRE_RENDER, Module::PHASE_RENDER, Module::PHASE_POST_RENDER }); // (created in the constructor, polled by the others)
+
+    pipelinesModule->dependsOn(d3d12Module, Module::PHASE_INIT);
+    pipelinesModule->setAccess(Module::PHASE_INIT, Module::ACCESS_DEVICE, Module::ACCESS_PIPELINES);
+    setIdle(pipelinesModule, { Module::PHASE_UPDATE, Module::PHASE_PRE_RENDER, Module::PHASE_RENDER, Module::PHASE_POST_RENDER }); // (compiles in its own jobs)
+
+    shadersModule->dependsOn(pipelinesModule, Module::PHASE_INIT); // (cleaned up first: its reload job rebuilds pipelines)
+    shadersModule->setAccess(Module::PHASE_INIT, NONE, Module::ACCESS_SHADERS); // (no device needed)
+    shadersModule->setAccess(Module::PHASE_PRE_RENDER, NONE, Module::ACCESS_SHADERS | Module::ACCESS_PIPELINES); // (hot reload swaps pipelines)
+    setIdle(shadersModule, { Module::PHASE_UPDATE, Module::PHASE_RENDER, Module::PHASE_POST_RENDER });
+
+    resourcesModule->dependsOn(d3d12Module, Module::PHASE_INIT);
+    resourcesModule->setAccess(Module::PHASE_INIT, Module::ACCESS_DEVICE, Module::ACCESS_RESOURCES);
+    resourcesModule->setAccess(Module::PHASE_PRE_RENDER, Module::ACCESS_FRAME, Module::ACCESS_RESOURCES | Module::ACCESS_DESCRIPTORS); // (texture streaming)
+    setIdle(resourcesModule, { Module::PHASE_UPDATE, Module::PHASE_RENDER, Module::PHASE_POST_RENDER });
+
+    cameraModule->dependsOn(d3d12Module, Module::PHASE_INIT);
+    cameraModule->setAccess(Module::PHASE_INIT, Module::ACCESS_DEVICE | Module::ACCESS_INPUT, Module::ACCESS_CAMERA);
+    cameraModule->setAccess(Module::PHASE_UPDATE, Module::ACCESS_FRAME | Module::ACCESS_INPUT, Module::ACCESS_CAMERA);
+    setIdle(cameraModule, { Module::PHASE_PRE_RENDER, Module::PHASE_RENDER, Module::PHASE_POST_RENDER });
+
+    cullingModule->dependsOn(cameraModule, Module::PHASE_UPDATE); // (frustum of this frame's camera)
+    cullingModule->setAccess(Module::PHASE_UPDATE, Module::ACCESS_CAMERA, Module::ACCESS_CULLING);
+    setIdle(cullingModule, { Module::PHASE_INIT, Module::PHASE_PRE_RENDER, Module::PHASE_RENDER, Module::PHASE_POST_RENDER });
+
+    shaderDescModule->dependsOn(d3d12Module, Module::PHASE_INIT);
+    shaderDescModule->setAccess(Module::PHASE_INIT, Module::ACCESS_DEVICE, Module::ACCESS_DESCRIPTORS);
+    shaderDescModule->setAccess(Module::PHASE_PRE_RENDER, NONE, Module::ACCESS_DESCRIPTORS);
+    setIdle(shaderDescModule, { Module::PHASE_UPDATE, Module::PHASE_RENDER, Module::PHASE_POST_RENDER });
+
+    samplerModule->dependsOn(d3d12Module, Module::PHASE_INIT);
+    samplerModule->setAccess(Module::PHASE_INIT, Module::ACCESS_DEVICE, Module::ACCESS_DESCRIPTORS);
+    setIdle(samplerModule, { Module::PHASE_UPDATE, Module::PHASE_PRE_RENDER, Module::PHASE_RENDER, Module::PHASE_POST_RENDER });
+
+    sceneModule->setAccess(Module::PHASE_PRE_RENDER, NONE, Module::ACCESS_SCENE);
+    setIdle(sceneModule, { Module::PHASE_INIT, Module::PHASE_UPDATE, Module::PHASE_RENDER, Module::PHASE_POST_RENDER });
+
+    for (Module* module : std::initializer_list<Module*>{ d3d12Module, editorModule, pipelinesModule, shadersModule, resourcesModule, cameraModule, shaderDescModule, samplerModule, sceneModule })
+        exercise->dependsOn(module, Module::PHASE_INIT);
+    exercise->setAccess(Module::PHASE_INIT, Module::ACCESS_DEVICE | Module::ACCESS_PIPELINES | Module::ACCESS_SHADERS, Module::ACCESS_RESOURCES | Module::ACCESS_DESCRIPTORS | Module::ACCESS_DEBUG_DRAW | Module::ACCESS_SCENE);
+    exercise->setAccess(Module::PHASE_RENDER, Module::ACCESS_CAMERA | Module::ACCESS_IMGUI | Module::ACCESS_DESCRIPTORS | Module::ACCESS_SCENE | Module::ACCESS_CULLING,
+                        Module::ACCESS_FRAME | Module::ACCESS_DEBUG_DRAW | Module::ACCESS_RESOURCES); // (texture detail requests)
+    setIdle(exercise, { Module::PHASE_UPDATE, Module::PHASE_PRE_RENDER, Module::PHASE_POST_RENDER });
+
+    scheduler = new ModuleScheduler(jobSystem);
 }
 
 Application::~Application()
@@ -48,17 +152,16 @@ Application::~Application()
     {
         delete *it;
     }
+
+    delete scheduler;
+    delete jobSystem;
 }
  
 bool Application::init()
 {
-
-    // forced inverse execution (not the most optimal way, but it will work)
-    bool ret = modules[1]->init();
-    if (ret) ret = modules[0]->init();
-
-	for(auto it = modules.begin() + 2; it != modules.end() && ret; ++it)
-		ret = (*it)->init();
+    // Dependency order (e.g. the editor needs the device), independent modules are initialized at the same time
+    bool ret = scheduler->build(modules);
+    if (ret) ret = scheduler->init();
 
     lastMilis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
@@ -81,17 +184,10 @@ void Application::update()
 
     if (!app->paused)
     {
-        for (auto it = modules.begin(); it != modules.end(); ++it)
-            (*it)->update();
-
-        for (auto it = modules.begin(); it != modules.end(); ++it)
-            (*it)->preRender();
-
-        for (auto it = modules.begin(); it != modules.end(); ++it)
-            (*it)->render();
-
-        for (auto it = modules.begin(); it != modules.end(); ++it)
-            (*it)->postRender();
+        scheduler->run(Module::PHASE_UPDATE);
+        scheduler->run(Module::PHASE_PRE_RENDER);
+        scheduler->run(Module::PHASE_RENDER);
+        scheduler->run(Module::PHASE_POST_RENDER);
     }
 }
 
@@ -99,7 +195,10 @@ bool Application::cleanUp()
 {
 	bool ret = true;
 
-	for(auto it = modules.rbegin(); it != modules.rend() && ret; ++it)
+	// Reverse init order (registration order if the scheduler was never built)
+	const std::vector<Module*>& initOrder = scheduler->getOrder(Module::PHASE_INIT).empty() ? modules : scheduler->getOrder(Module::PHASE_INIT);
+
+	for(auto it = initOrder.rbegin(); it != initOrder.rend() && ret; ++it)
 		ret = (*it)->cleanUp();
 
 	return ret;
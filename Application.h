@@ -7,12 +7,19 @@
 #include <chrono>
 
 class Module;
+class JobSystem;
+class ModuleScheduler;
 class D3D12Module;
 class EditorModule;
 class ModuleResources;
 class ModuleCamera;
 class ModuleShaderDescriptors;
 class ModuleSampler;
+class ModuleScene;
+class ModuleCulling;
+class ModulePipelines;
+class ModuleShaders;
+class ModuleInput;
 
 class Application
 {
@@ -33,12 +40,18 @@ public:
     bool                        isPaused() const { return paused; }
     bool                        setPaused(bool p) { paused = p; return paused; }
 
+    inline JobSystem* getJobSystem() const { return jobSystem; };
     inline D3D12Module* getD3D12Module() const { return d3d12Module; };
     inline EditorModule* getEditorModule() const { return editorModule; };
     inline ModuleResources* getModuleResources() const { return resourcesModule; };
     inline ModuleCamera* getModuleCamera() const { return cameraModule; };
     inline ModuleShaderDescriptors* getModuleShaderDesc() const { return shaderDescModule; };
     inline ModuleSampler* getModuleSampler() const { return samplerModule; };
+    inline ModuleScene* getModuleScene() const { return sceneModule; };
+    inline ModuleCulling* getModuleCulling() const { return cullingModule; };
+    inline ModulePipelines* getModulePipelines() const { return pipelinesModule; };
+    inline ModuleShaders* getModuleShaders() const { return shadersModule; };
+    inline ModuleInput* getModuleInput() const { return inputModule; };
 
 private:
     enum { MAX_FPS_TICKS = 30 };
@@ -46,12 +59,19 @@ private:
 
     std::vector<Module*> modules;
 	
+    JobSystem* jobSystem;
+    ModuleScheduler* scheduler;
     D3D12Module* d3d12Module;
     EditorModule* editorModule;
     ModuleResources* resourcesModule;
     ModuleCamera* cameraModule;
     ModuleShaderDescriptors* shaderDescModule;
     ModuleSampler* samplerModule;
+    ModuleScene* sceneModule;
+    ModuleCulling* cullingModule;
+    ModulePipelines* pipelinesModule;
+    ModuleShaders* shadersModule;
+    ModuleInput* inputModule;
 
     uint64_t  lastMilis = 0;
     TickList  tickList;
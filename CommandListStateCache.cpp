@@ -0,0 +1,143 @@
+#include "Globals.h"
+
+#include "CommandListStateCache.h"
+
+#include <cstring>
+
+void CommandListStateCache::reset(ID3D12GraphicsCommandList* newCommandList)
+{
+	commandList = newCommandList;
+
+	pso = nullptr;
+	signature = nullptr;
+	topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	viewportKnown = scissorKnown = false;
+
+	for (bool& known : vertexBufferKnown) known = false;
+
+	for (RootArgument& argument : rootArguments) argument.known = false;
+}
+
+void CommandListStateCache::setPipelineState(ID3D12PipelineState* newPSO)
+{
+	if (filter(newPSO == pso)) return;
+
+	pso = newPSO;
+	if (commandList) commandList->SetPipelineState(pso);
+}
+
+void CommandListStateCache::setGraphicsRootSignature(ID3D12RootSignature* newSignature)
+{
+	if (filter(newSignature == signature)) return;
+
+	signature = newSignature;
+	for (RootArgument& argument : rootArguments) argument.known = false;
+
+	if (commandList) commandList->SetGraphicsRootSignature(signature);
+}
+
+void CommandListStateCache::setViewport(const D3D12_VIEWPORT& newViewport)
+{
+	if (filter(viewportKnown and memcmp(&newViewport, &viewport, sizeof(viewport)) == 0)) return;
+
+	viewport = newViewport;
+	viewportKnown = true;
+	if (commandList) commandList->RSSetViewports(1, &viewport);
+}
+
+void CommandListStateCache::setScissorRect(const D3D12_RECT& newScissor)
+{
+	if (filter(scissorKnown and memcmp(&newScissor, &scissor, sizeof(scissor)) == 0)) return;
+
+	scissor = newScissor;
+	scissorKnown = true;
+	if (commandList) commandList->RSSetScissorRects(1, &scissor);
+}
+
+void CommandListStateCache::setVertexBuffer(UINT slot, const D3D12_VERTEX_BUFFER_VIEW& view)
+{
+	if (slot >= MAX_VERTEX_BUFFERS)
+	{
+		filter(false);
+		if (commandList) commandList->IASetVertexBuffers(slot, 1, &view);
+		return;
+	}
+
+	if (filter(vertexBufferKnown[slot] and memcmp(&view, &vertexBuffers[slot], sizeof(view)) == 0)) return;
+
+	vertexBuffers[slot] = view;
+	vertexBufferKnown[slot] = true;
+	if (commandList) commandList->IASetVertexBuffers(slot, 1, &view);
+}
+
+void CommandListStateCache::setPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY newTopology)
+{
+	if (filter(newTopology == topology)) return;
+
+	topology = newTopology;
+	if (commandList) commandList->IASetPrimitiveTopology(topology);
+}
+
+void CommandListStateCache::setGraphicsRoot32BitConstants(UINT parameter, UINT count, const void* data)
+{
+	if (parameter >= MAX_ROOT_PARAMETERS or count > MAX_ROOT_CONSTANTS)
+	{
+		filter(false);
+		if (commandList) commandList->SetGraphicsRoot32BitConstants(parameter, count, data, 0);
+		return;
+	}
+
+	RootArgument& argument = rootArguments[parameter];
+	if (filter(argument.known and argument.constantCount == count and memcmp(argument.constants, data, count * sizeof(uint32_t)) == 0)) return;
+
+	argument.known = true;
+	argument.constantCount = count;
+	memcpy(argument.constants, data, count * sizeof(uint32_t));
+
+	if (commandList) commandList->SetGraphicsRoot32BitConstants(parameter, count, data, 0);
+}
+
+void CommandListStateCache::setGraphicsRootDescriptorTable(UINT parameter, D3D12_GPU_DESCRIPTOR_HANDLE table)
+{
+	if (parameter >= MAX_ROOT_PARAMETERS)
+	{
+		filter(false);
+		if (commandList) commandList->SetGraphicsRootDescriptorTable(parameter, table);
+		return;
+	}
+
+	RootArgument& argument = rootArguments[parameter];
+	if (filter(argument.known and argument.constantCount == 0 and argument.table.ptr == table.ptr)) return;
+
+	argument.known = true;
+	argument.constantCount = 0;
+	argument.table = table;
+
+	if (commandList) commandList->SetGraphicsRootDescriptorTable(parameter, table);
+}
+
+void CommandListStateCache::setGraphicsRootConstantBufferView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	if (parameter >= MAX_ROOT_PARAMETERS)
+	{
+		filter(false);
+		if (commandList) commandList->SetGraphicsRootConstantBufferView(parameter, address);
+		return;
+	}
+
+	RootArgument& argument = rootArguments[parameter];
+	if (filter(argument.known and argument.constantCount == 0 and argument.view == address)) return;
+
+	argument.known = true;
+	argument.constantCount = 0;
+	argument.view = address;
+
+	if (commandList) commandList->SetGraphicsRootConstantBufferView(parameter, address);
+}
+
+void CommandListStateCache::drawInstanced(UINT vertexCount, UINT instanceCount, UINT firstVertex, UINT firstInstance)
+{
+	++counters.draws;
+
+	if (commandList) commandList->DrawInstanced(vertexCount, instanceCount, firstVertex, firstInstance);
+}
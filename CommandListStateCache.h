@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+// Filters redundant state changes before they reach a command list. Only the state set through the cache is known, so
+// reset() it whenever the list is reset or something else sets state on it. With a null command list nothing is recorded
+// and it only counts (draws and state changes of a pass can be measured without a GPU).
+class CommandListStateCache
+{
+public:
+
+	struct Counters
+	{
+		uint32_t draws = 0;
+		uint32_t stateChanges = 0; // (reached the command list)
+		uint32_t filtered = 0;	   // redundant, not recorded
+	};
+
+	void reset(ID3D12GraphicsCommandList* commandList); // forgets the state (counters keep going)
+
+	inline void resetCounters() { counters = Counters(); };
+	inline const Counters& getCounters() const { return counters; };
+
+	void setPipelineState(ID3D12PipelineState* pso);
+	void setGraphicsRootSignature(ID3D12RootSignature* signature); // (root arguments are undefined after a change)
+	void setViewport(const D3D12_VIEWPORT& viewport);
+	void setScissorRect(const D3D12_RECT& rect);
+	void setVertexBuffer(UINT slot, const D3D12_VERTEX_BUFFER_VIEW& view);
+	void setPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology);
+	void setGraphicsRoot32BitConstants(UINT parameter, UINT count, const void* data);
+	void setGraphicsRootDescriptorTable(UINT parameter, D3D12_GPU_DESCRIPTOR_HANDLE table);
+	void setGraphicsRootConstantBufferView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address);
+
+	void drawInstanced(UINT vertexCount, UINT instanceCount, UINT firstVertex, UINT firstInstance);
+
+private:
+
+	enum { MAX_ROOT_PARAMETERS = 4, MAX_ROOT_CONSTANTS = 16, MAX_VERTEX_BUFFERS = 2 }; // (arguments and slots out of these are always recorded)
+
+	struct RootArgument
+	{
+		bool known = false;
+		UINT constantCount = 0;					// 0 if it is a descriptor table or a root view
+		uint32_t constants[MAX_ROOT_CONSTANTS];
+		D3D12_GPU_DESCRIPTOR_HANDLE table;
+		D3D12_GPU_VIRTUAL_ADDRESS view = 0;		// (a parameter is always the same kind for a root signature)
+	};
+
+	ID3D12GraphicsCommandList* commandList = nullptr;
+	Counters counters;
+
+	ID3D12PipelineState* pso = nullptr;
+	ID3D12RootSignature* signature = nullptr;
+	D3D12_VIEWPORT viewport = {};
+	D3D12_RECT scissor = {};
+	D3D12_VERTEX_BUFFER_VIEW vertexBuffers[MAX_VERTEX_BUFFERS] = {};
+	D3D_PRIMITIVE_TOPOLOGY topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	bool viewportKnown = false, scissorKnown = false;
+	bool vertexBufferKnown[MAX_VERTEX_BUFFERS] = {};
+
+	RootArgument rootArguments[MAX_ROOT_PARAMETERS];
+
+	inline bool filter(bool redundant) // counts the change, true if it is redundant (the state is kept without a command list too)
+	{
+		if (redundant) ++counters.filtered;
+		else ++counters.stateChanges;
+
+		return redundant;
+	}
+};
@@ -0,0 +1,368 @@
+#include "Globals.h"
+
+#include "CookedScene.h"
+#include "FileUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CookedScene
+{
+	static_assert(sizeof(FileHeader) == 24 and sizeof(Section) == 24 and sizeof(Meshlet) == 32, "Cooked scene structs changed (update VERSION)");
+	static_assert(sizeof(MeshInfo) == 88 and sizeof(MaterialInfo) == 24 and sizeof(InstanceInfo) == 68 and sizeof(ImageInfo) == 16, "Cooked scene structs changed (update VERSION)");
+
+	inline uint64_t alignBlob(uint64_t offset) { return (offset + BLOB_ALIGNMENT - 1) & ~uint64_t(BLOB_ALIGNMENT - 1); }
+
+	// Writer //
+
+	void Writer::addMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, int32_t material)
+	{
+		Mesh mesh = {};
+		mesh.vertices.assign(static_cast<const uint8_t*>(vertices), static_cast<const uint8_t*>(vertices) + size_t(vertexCount) * vertexStride);
+		mesh.indices.assign(indices, indices + indexCount);
+
+		mesh.info.vertexCount = vertexCount;
+		mesh.info.indexCount = indexCount;
+		mesh.info.material = material;
+
+		// Bounds (positions are the first 3 floats of every vertex)
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			mesh.info.boundsMin[axis] = vertexCount > 0 ? INFINITY : 0.0f;
+			mesh.info.boundsMax[axis] = vertexCount > 0 ? -INFINITY : 0.0f;
+		}
+
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			float position[3];
+			memcpy(position, mesh.vertices.data() + size_t(i) * vertexStride, sizeof(position));
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				mesh.info.boundsMin[axis] = std::min(mesh.info.boundsMin[axis], position[axis]);
+				mesh.info.boundsMax[axis] = std::max(mesh.info.boundsMax[axis], position[axis]);
+			}
+		}
+
+		buildMeshlets(mesh);
+		meshes.push_back(std::move(mesh));
+	}
+
+	void Writer::buildMeshlets(Mesh& mesh) const
+	{
+		// Greedy, in index order: a meshlet is closed when the next triangle doesn't fit
+		std::vector<int32_t> localIndex(mesh.info.vertexCount, -1);
+		Meshlet meshlet = {};
+
+		auto position = [&mesh, this](uint32_t vertex) {
+			return reinterpret_cast<const float*>(mesh.vertices.data() + size_t(vertex) * vertexStride);
+		};
+
+		auto finish = [&]() {
+			if (meshlet.triangleCount == 0) return;
+
+			// Bounding sphere (around the center of the box)
+			float min[3] = { INFINITY, INFINITY, INFINITY }, max[3] = { -INFINITY, -INFINITY, -INFINITY };
+			for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+			{
+				const float* p = position(mesh.meshletVertices[meshlet.vertexOffset + i]);
+				for (int axis = 0; axis < 3; ++axis) { min[axis] = std::min(min[axis], p[axis]); max[axis] = std::max(max[axis], p[axis]); }
+			}
+
+			for (int axis = 0; axis < 3; ++axis) meshlet.center[axis] = 0.5f * (min[axis] + max[axis]);
+
+			float radiusSq = 0.0f;
+			for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+			{
+				uint32_t vertex = mesh.meshletVertices[meshlet.vertexOffset + i];
+				const float* p = position(vertex);
+				float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+				radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+
+				localIndex[vertex] = -1;
+			}
+			meshlet.radius = std::sqrt(radiusSq);
+
+			mesh.meshlets.push_back(meshlet);
+
+			meshlet = {};
+			meshlet.vertexOffset = uint32_t(mesh.meshletVertices.size());
+			meshlet.triangleOffset = uint32_t(mesh.meshletTriangles.size());
+		};
+
+		for (uint32_t i = 0; i + 2 < mesh.info.indexCount; i += 3)
+		{
+			const uint32_t* triangle = &mesh.indices[i];
+			if (triangle[0] >= mesh.info.vertexCount or triangle[1] >= mesh.info.vertexCount or triangle[2] >= mesh.info.vertexCount) continue;
+
+			// (degenerate triangles repeat vertices, those only count once)
+			uint32_t newVertices = 0;
+			for (int corner = 0; corner < 3; ++corner)
+				if (localIndex[triangle[corner]] < 0 and (corner == 0 or triangle[corner] != triangle[0]) and (corner < 2 or triangle[2] != triangle[1])) ++newVertices;
+
+			if (meshlet.vertexCount + newVertices > MAX_MESHLET_VERTICES or meshlet.triangleCount == MAX_MESHLET_TRIANGLES) finish();
+
+			uint32_t packed = 0;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				if (localIndex[triangle[corner]] < 0)
+				{
+					localIndex[triangle[corner]] = int32_t(meshlet.vertexCount++);
+					mesh.meshletVertices.push_back(triangle[corner]);
+				}
+				packed |= uint32_t(localIndex[triangle[corner]]) << (8 * corner);
+			}
+
+			mesh.meshletTriangles.push_back(packed);
+			++meshlet.triangleCount;
+		}
+
+		finish();
+
+		mesh.info.meshletCount = uint32_t(mesh.meshlets.size());
+		mesh.info.meshletVertexCount = uint32_t(mesh.meshletVertices.size());
+		mesh.info.meshletTriangleCount = uint32_t(mesh.meshletTriangles.size());
+	}
+
+	void Writer::addMaterial(const float baseColor[4], int32_t image)
+	{
+		MaterialInfo material = {};
+		memcpy(material.baseColor, baseColor, sizeof(material.baseColor));
+		material.image = image;
+
+		materials.push_back(material);
+	}
+
+	void Writer::addInstance(uint32_t mesh, const float world[16])
+	{
+		InstanceInfo instance = {};
+		instance.mesh = mesh;
+		memcpy(instance.world, world, sizeof(instance.world));
+
+		instances.push_back(instance);
+	}
+
+	void Writer::addImage(const void* encoded, size_t size)
+	{
+		images.emplace_back(static_cast<const uint8_t*>(encoded), static_cast<const uint8_t*>(encoded) + size);
+	}
+
+	void Writer::write(std::vector<uint8_t>& file) const
+	{
+		// 1. Layout: header, TOC, section tables, then the blobs
+		uint64_t offset = sizeof(FileHeader) + MAX_SECTIONS * sizeof(Section);
+
+		Section sections[MAX_SECTIONS] = {};
+		const uint64_t elementSizes[MAX_SECTIONS] = { sizeof(MeshInfo), sizeof(MaterialInfo), sizeof(InstanceInfo), sizeof(ImageInfo) };
+		const size_t elementCounts[MAX_SECTIONS] = { meshes.size(), materials.size(), instances.size(), images.size() };
+
+		for (uint32_t type = 0; type < MAX_SECTIONS; ++type)
+		{
+			offset = alignBlob(offset);
+			sections[type] = { type, uint32_t(elementCounts[type]), offset, elementSizes[type] * elementCounts[type] };
+			offset += sections[type].size;
+		}
+
+		auto place = [&offset](uint64_t bytes) {
+			offset = alignBlob(offset);
+			uint64_t placed = offset;
+			offset += bytes;
+			return placed;
+		};
+
+		std::vector<MeshInfo> meshInfos;
+		for (const Mesh& mesh : meshes)
+		{
+			MeshInfo info = mesh.info;
+			info.vertexOffset = place(mesh.vertices.size());
+			info.indexOffset = place(mesh.indices.size() * sizeof(uint32_t));
+			info.meshletOffset = place(mesh.meshlets.size() * sizeof(Meshlet));
+			info.meshletVertexOffset = place(mesh.meshletVertices.size() * sizeof(uint32_t));
+			info.meshletTriangleOffset = place(mesh.meshletTriangles.size() * sizeof(uint32_t));
+			meshInfos.push_back(info);
+		}
+
+		std::vector<ImageInfo> imageInfos;
+		for (const std::vector<uint8_t>& image : images)
+			imageInfos.push_back({ place(image.size()), image.size() });
+
+		// 2. Copy everything
+		file.assign(size_t(alignBlob(offset)), 0);
+
+		FileHeader header = { MAGIC, VERSION, vertexStride, MAX_SECTIONS, file.size() };
+		memcpy(file.data(), &header, sizeof(header));
+		memcpy(file.data() + sizeof(header), sections, sizeof(sections));
+
+		auto copy = [&file](uint64_t to, const void* from, size_t bytes) { if (bytes > 0) memcpy(file.data() + to, from, bytes); };
+
+		copy(sections[SECTION_MESHES].offset, meshInfos.data(), meshInfos.size() * sizeof(MeshInfo));
+		copy(sections[SECTION_MATERIALS].offset, materials.data(), materials.size() * sizeof(MaterialInfo));
+		copy(sections[SECTION_INSTANCES].offset, instances.data(), instances.size() * sizeof(InstanceInfo));
+		copy(sections[SECTION_IMAGES].offset, imageInfos.data(), imageInfos.size() * sizeof(ImageInfo));
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			copy(meshInfos[i].vertexOffset, meshes[i].vertices.data(), meshes[i].vertices.size());
+			copy(meshInfos[i].indexOffset, meshes[i].indices.data(), meshes[i].indices.size() * sizeof(uint32_t));
+			copy(meshInfos[i].meshletOffset, meshes[i].meshlets.data(), meshes[i].meshlets.size() * sizeof(Meshlet));
+			copy(meshInfos[i].meshletVertexOffset, meshes[i].meshletVertices.data(), meshes[i].meshletVertices.size() * sizeof(uint32_t));
+			copy(meshInfos[i].meshletTriangleOffset, meshes[i].meshletTriangles.data(), meshes[i].meshletTriangles.size() * sizeof(uint32_t));
+		}
+
+		for (size_t i = 0; i < images.size(); ++i)
+			copy(imageInfos[i].offset, images[i].data(), images[i].size());
+	}
+
+	bool Writer::write(const std::filesystem::path& path) const
+	{
+		std::vector<uint8_t> file;
+		write(file);
+
+		return FileUtils::writeFile(path, file);
+	}
+
+	// Reader //
+
+	bool Reader::open(const std::filesystem::path& path)
+	{
+		close();
+
+#ifdef _WIN32
+		HANDLE fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE) return false;
+		file = fileHandle;
+
+		LARGE_INTEGER fileSize;
+		bool ok = GetFileSizeEx(fileHandle, &fileSize) and fileSize.QuadPart > 0;
+
+		if (ok) mapping = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+		size = ok ? uint64_t(fileSize.QuadPart) : 0;
+#else
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) return false;
+
+		struct stat info;
+		bool ok = fstat(descriptor, &info) == 0 and info.st_size > 0;
+
+		if (ok)
+		{
+			void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (view != MAP_FAILED)
+			{
+				madvise(view, size_t(info.st_size), MADV_WILLNEED);
+				data = static_cast<const uint8_t*>(view);
+				size = uint64_t(info.st_size);
+			}
+		}
+
+		::close(descriptor); // (the mapping keeps the file alive)
+#endif
+
+		if (data == nullptr or not validate())
+		{
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Reader::open(std::vector<uint8_t>&& file)
+	{
+		close();
+
+		memory = std::move(file);
+		data = memory.data();
+		size = memory.size();
+
+		if (memory.empty() or not validate())
+		{
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Reader::close()
+	{
+		if (data != nullptr and memory.empty())
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+#else
+			munmap(const_cast<uint8_t*>(data), size_t(size));
+#endif
+		}
+
+#ifdef _WIN32
+		if (mapping != nullptr) CloseHandle(mapping);
+		if (file != nullptr) CloseHandle(file);
+#endif
+
+		mapping = file = nullptr;
+		data = nullptr;
+		size = 0;
+		memory.clear();
+
+		for (uint32_t type = 0; type < MAX_SECTIONS; ++type) offsets[type] = counts[type] = 0;
+	}
+
+	bool Reader::validate()
+	{
+		if (size < sizeof(FileHeader)) return false;
+
+		const FileHeader* fileHeader = header();
+		if (fileHeader->magic != MAGIC or fileHeader->version != VERSION or fileHeader->fileSize != size) return false;
+		if (fileHeader->vertexStride < 3 * sizeof(float) or not inFile(sizeof(FileHeader), uint64_t(fileHeader->sectionCount) * sizeof(Section))) return false;
+
+		const uint64_t elementSizes[MAX_SECTIONS] = { sizeof(MeshInfo), sizeof(MaterialInfo), sizeof(InstanceInfo), sizeof(ImageInfo) };
+		const Section* sections = reinterpret_cast<const Section*>(data + sizeof(FileHeader));
+
+		for (uint32_t i = 0; i < fileHeader->sectionCount; ++i)
+		{
+			if (sections[i].type >= MAX_SECTIONS) continue; // (unknown sections are skipped)
+
+			if (sections[i].size != elementSizes[sections[i].type] * sections[i].count or not inFile(sections[i].offset, sections[i].size)) return false;
+			if (sections[i].offset % BLOB_ALIGNMENT != 0) return false;
+
+			offsets[sections[i].type] = sections[i].offset;
+			counts[sections[i].type] = sections[i].count;
+		}
+
+		// Everything referenced has to be inside the file (so nobody reads past the mapping)
+		for (uint32_t i = 0; i < getMeshCount(); ++i)
+		{
+			const MeshInfo& mesh = getMesh(i);
+
+			bool ok = inFile(mesh.vertexOffset, uint64_t(mesh.vertexCount) * fileHeader->vertexStride) and
+					  inFile(mesh.indexOffset, uint64_t(mesh.indexCount) * sizeof(uint32_t)) and
+					  inFile(mesh.meshletOffset, uint64_t(mesh.meshletCount) * sizeof(Meshlet)) and
+					  inFile(mesh.meshletVertexOffset, uint64_t(mesh.meshletVertexCount) * sizeof(uint32_t)) and
+					  inFile(mesh.meshletTriangleOffset, uint64_t(mesh.meshletTriangleCount) * sizeof(uint32_t));
+
+			if (not ok or (mesh.material >= 0 and uint32_t(mesh.material) >= getMaterialCount())) return false;
+		}
+
+		for (uint32_t i = 0; i < getInstanceCount(); ++i)
+			if (getInstance(i).mesh >= getMeshCount()) return false;
+
+		for (uint32_t i = 0; i < getImageCount(); ++i)
+			if (not inFile(getImage(i).offset, getImage(i).size)) return false;
+
+		for (uint32_t i = 0; i < getMaterialCount(); ++i)
+			if (getMaterial(i).image >= 0 and uint32_t(getMaterial(i).image) >= getImageCount()) return false;
+
+		return true;
+	}
+}
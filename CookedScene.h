@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+// Binary container for cooked scenes (no GPU or glTF code here): header + table of contents + aligned blobs, so the
+// runtime maps the file and copies vertices/indices straight from it to the upload memory. Layout (little endian):
+//   FileHeader | Section[sectionCount] | ... blobs (each one aligned to BLOB_ALIGNMENT), referenced by absolute offsets
+namespace CookedScene
+{
+	const uint32_t MAGIC = 0x4E435343; // "CSCN"
+	const uint32_t VERSION = 1;		   // (change it whenever any of the structs below changes)
+	const uint32_t BLOB_ALIGNMENT = 64;
+
+	const uint32_t MAX_MESHLET_VERTICES = 64;
+	const uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+	enum SectionType : uint32_t
+	{
+		SECTION_MESHES,		// MeshInfo[]
+		SECTION_MATERIALS,	// MaterialInfo[]
+		SECTION_INSTANCES,	// InstanceInfo[]
+		SECTION_IMAGES,		// ImageInfo[] (encoded images: png, jpg...)
+		MAX_SECTIONS
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexStride; // bytes per vertex (position has to be the first 3 floats)
+		uint32_t sectionCount;
+		uint64_t fileSize;
+	};
+
+	struct Section
+	{
+		uint32_t type;
+		uint32_t count;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct Meshlet
+	{
+		uint32_t vertexOffset;	 // in the mesh meshlet vertices (indices to the mesh vertices)
+		uint32_t vertexCount;
+		uint32_t triangleOffset; // in the mesh meshlet triangles (3 local 8 bit indices packed in 32 bits)
+		uint32_t triangleCount;
+		float center[3];		 // bounding sphere
+		float radius;
+	};
+
+	struct MeshInfo
+	{
+		uint64_t vertexOffset;
+		uint64_t indexOffset;			// 32 bit indices
+		uint64_t meshletOffset;
+		uint64_t meshletVertexOffset;	// uint32_t[]
+		uint64_t meshletTriangleOffset; // uint32_t[]
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t meshletCount;
+		uint32_t meshletVertexCount;
+		uint32_t meshletTriangleCount;
+		int32_t material;
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	struct MaterialInfo
+	{
+		float baseColor[4];
+		int32_t image; // -1 if none
+		uint32_t padding;
+	};
+
+	struct InstanceInfo
+	{
+		uint32_t mesh;
+		float world[16]; // row major (row vectors)
+	};
+
+	struct ImageInfo
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// Builds the file in memory (meshlets and bounds are computed here)
+	class Writer
+	{
+	public:
+
+		Writer(uint32_t vertexStride) : vertexStride(vertexStride) {}
+
+		void addMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, int32_t material);
+		void addMaterial(const float baseColor[4], int32_t image);
+		void addInstance(uint32_t mesh, const float world[16]);
+		void addImage(const void* encoded, size_t size);
+
+		void write(std::vector<uint8_t>& file) const;
+		bool write(const std::filesystem::path& path) const;
+
+	private:
+
+		struct Mesh
+		{
+			MeshInfo info;
+			std::vector<uint8_t> vertices;
+			std::vector<uint32_t> indices;
+			std::vector<Meshlet> meshlets;
+			std::vector<uint32_t> meshletVertices;
+			std::vector<uint32_t> meshletTriangles;
+		};
+
+		uint32_t vertexStride;
+
+		std::vector<Mesh> meshes;
+		std::vector<MaterialInfo> materials;
+		std::vector<InstanceInfo> instances;
+		std::vector<std::vector<uint8_t>> images;
+
+		void buildMeshlets(Mesh& mesh) const;
+	};
+
+	// Maps a cooked file (or takes one already in memory) and validates it; pointers stay valid until close()
+	class Reader
+	{
+	public:
+
+		~Reader() { close(); }
+
+		bool open(const std::filesystem::path& path);
+		bool open(std::vector<uint8_t>&& file);
+		void close();
+
+		inline bool isOpen() const { return data != nullptr; };
+		inline uint32_t getVertexStride() const { return header()->vertexStride; };
+
+		inline uint32_t getMeshCount() const { return counts[SECTION_MESHES]; };
+		inline uint32_t getMaterialCount() const { return counts[SECTION_MATERIALS]; };
+		inline uint32_t getInstanceCount() const { return counts[SECTION_INSTANCES]; };
+		inline uint32_t getImageCount() const { return counts[SECTION_IMAGES]; };
+
+		inline const MeshInfo& getMesh(uint32_t index) const { return section<MeshInfo>(SECTION_MESHES)[index]; };
+		inline const MaterialInfo& getMaterial(uint32_t index) const { return section<MaterialInfo>(SECTION_MATERIALS)[index]; };
+		inline const InstanceInfo& getInstance(uint32_t index) const { return section<InstanceInfo>(SECTION_INSTANCES)[index]; };
+		inline const ImageInfo& getImage(uint32_t index) const { return section<ImageInfo>(SECTION_IMAGES)[index]; };
+
+		inline const void* at(uint64_t offset) const { return data + offset; };
+
+	private:
+
+		const uint8_t* data = nullptr;
+		uint64_t size = 0;
+		uint64_t offsets[MAX_SECTIONS] = {};
+		uint32_t counts[MAX_SECTIONS] = {};
+
+		std::vector<uint8_t> memory; // (when opened from memory)
+		void* file = nullptr;		 // platform handles (when mapped)
+		void* mapping = nullptr;
+
+		inline const FileHeader* header() const { return reinterpret_cast<const FileHeader*>(data); };
+
+		template<typename T>
+		inline const T* section(SectionType type) const { return reinterpret_cast<const T*>(data + offsets[type]); };
+
+		bool validate();
+		bool inFile(uint64_t offset, uint64_t bytes) const { return offset <= size and bytes <= size - offset; };
+	};
+}
@@ -3,8 +3,12 @@
 #include "ModuleResources.h"
 #include "D3D12Module.h"
 
-D3D12Module::D3D12Module(HWND hwnd): hWnd (hwnd), currentExecution(0)
+#include <algorithm>
+
+D3D12Module::D3D12Module(HWND hwnd, unsigned int framesInFlight, bool latencyWaitable): hWnd (hwnd), currentExecution(0), latencyWaitable(latencyWaitable)
 {
+    // at least double buffering (a single frame in flight would be the old flush-every-frame)
+    this->framesInFlight = std::clamp(framesInFlight, 2u, unsigned(MAX_FRAMES_IN_FLIGHT));
 }
 
 D3D12Module::~D3D12Module() // REMEMBER THAT WE HAVE A CLEANUP() FUNCTION!
@@ -19,6 +23,9 @@ bool D3D12Module::cleanUp()
 	if (drawEvent != nullptr)
 		ok = CloseHandle(drawEvent);
 
+	if (frameLatencyWaitable != nullptr)
+		ok = CloseHandle(frameLatencyWaitable) and ok;
+
 	return ok;
 }
 
@@ -170,21 +177,32 @@ bool D3D12Module::createSwapChain()
     swapChainDesc.Stereo = FALSE;
     swapChainDesc.SampleDesc = { 1, 0 };
     swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    swapChainDesc.BufferCount = FRAMES_IN_FLIGHT;
+    swapChainDesc.BufferCount = framesInFlight;
     swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
     swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
     swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
     // It is recommended to always allow tearing if tearing support is available.
     swapChainDesc.Flags = allowTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+    if (latencyWaitable) swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
     ComPtr<IDXGISwapChain1>     swapChain1;
     bool ok = SUCCEEDED(factory->CreateSwapChainForHwnd(queue.Get(), hWnd, &swapChainDesc, nullptr, nullptr, &swapChain1));
 
     ok = ok && SUCCEEDED(swapChain1.As(&swapChain));
 
+    if (ok and latencyWaitable)
+    {
+        // Don't let the CPU queue more frames than the back buffers we have (minus the one being shown), so that
+        // when the swap chain lets us start a frame, the fence of the back buffer we reuse is (almost always) already passed
+        ok = SUCCEEDED(swapChain->SetMaximumFrameLatency(framesInFlight - 1));
+
+        frameLatencyWaitable = swapChain->GetFrameLatencyWaitableObject();
+        ok = ok && frameLatencyWaitable != nullptr;
+    }
+
     // Disable the Alt+Enter fullscreen toggle feature. Switching to fullscreen
     // will be handled manually.
-    ok = SUCCEEDED(factory->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER));
+    ok = ok && SUCCEEDED(factory->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER));
 
     return ok;
 }
@@ -192,7 +210,7 @@ bool D3D12Module::createSwapChain()
 bool D3D12Module::createRenderTargets()
 {
     D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-    desc.NumDescriptors = FRAMES_IN_FLIGHT;
+    desc.NumDescriptors = framesInFlight;
     desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
 
     bool ok = SUCCEEDED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&rtvDescriptorHeap)));
@@ -203,7 +221,7 @@ bool D3D12Module::createRenderTargets()
 
         D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle(rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
-        for (int i = 0; ok && i < FRAMES_IN_FLIGHT; ++i)
+        for (unsigned i = 0; ok && i < framesInFlight; ++i)
         {
             ok = SUCCEEDED(swapChain->GetBuffer(i, IID_PPV_ARGS(&frameBuffers[i])));
 
@@ -263,7 +281,7 @@ bool D3D12Module::createCommandList()
 {
     bool ok = true;
 
-    for (unsigned i = 0; ok && i < FRAMES_IN_FLIGHT; ++i)
+    for (unsigned i = 0; ok && i < framesInFlight; ++i)
     {
         ok = SUCCEEDED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocators[i])));
     }
@@ -271,6 +289,18 @@ bool D3D12Module::createCommandList()
     ok = ok && SUCCEEDED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocators[0].Get(), nullptr, IID_PPV_ARGS(&commandList)));
     ok = ok && SUCCEEDED(commandList->Close());
 
+    // Lists for parallel recording (allocators per frame too, each job resets its own)
+    for (unsigned slot = 0; ok && slot < MAX_RECORD_SLOTS; ++slot)
+    {
+        for (unsigned i = 0; ok && i < framesInFlight; ++i)
+        {
+            ok = SUCCEEDED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&recordAllocators[i][slot])));
+        }
+
+        ok = ok && SUCCEEDED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, recordAllocators[0][slot].Get(), nullptr, IID_PPV_ARGS(&recordLists[slot])));
+        ok = ok && SUCCEEDED(recordLists[slot]->Close());
+    }
+
     return ok;
 }
 
@@ -303,9 +333,13 @@ inline bool D3D12Module::getWindowSize(unsigned int& width, unsigned int& height
 
 void D3D12Module::preRender()
 {
+    // Block until the swap chain can take another frame (keeps the CPU at most framesInFlight - 1 frames ahead)
+    if (frameLatencyWaitable != nullptr)
+        WaitForSingleObjectEx(frameLatencyWaitable, 1000, TRUE);
 
     currentFrameBuffIndex = swapChain->GetCurrentBackBufferIndex();
 
+    // The only GPU wait of the frame: the commands that last used this back buffer (and its allocator) must be done
     if (fenceValues[currentFrameBuffIndex] != 0)
         WaitForFence(fenceValues[currentFrameBuffIndex]);
 
@@ -320,24 +354,42 @@ void D3D12Module::render()
 
 void D3D12Module::postRender()
 {
-    // Set frame buffer to present state
+    // Wait for the lists that are being recorded by jobs
+    app->getJobSystem()->waitAll(recordingJobs);
+    recordingJobs.clear();
+
+    // Main list first, then the parallel ones in slot order
+    ID3D12GraphicsCommandList4* frameLists[1 + MAX_RECORD_SLOTS] = { commandList.Get() };
+    UINT numLists = 1;
+
+    for (unsigned slot = 0; slot < MAX_RECORD_SLOTS; ++slot)
+    {
+        if (recordUsed[slot]) frameLists[numLists++] = recordLists[slot].Get();
+        recordUsed[slot] = false;
+    }
+
+    // Set frame buffer to present state (in the last list to be executed)
     CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(frameBuffers[currentFrameBuffIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    commandList->ResourceBarrier(1, &barrier);
+    frameLists[numLists - 1]->ResourceBarrier(1, &barrier);
 
-    // Close command list (=> ready) and execute it	
-    if (SUCCEEDED(commandList->Close())) {
+    // Close command lists (=> ready) and execute them in a single call
+    bool ok = true;
+    ID3D12CommandList* listsToExecute[1 + MAX_RECORD_SLOTS];
+    for (UINT i = 0; i < numLists; ++i)
+    {
+        ok = SUCCEEDED(frameLists[i]->Close()) and ok;
+        listsToExecute[i] = frameLists[i];
+    }
 
-        ID3D12CommandList* listsToExecute[] = { commandList.Get() };
-        queue->ExecuteCommandLists(UINT(std::size(listsToExecute)), listsToExecute);
+    if (ok) {
+        queue->ExecuteCommandLists(numLists, listsToExecute);
     }
 
     // Present the frame (should change current back buffer)
     swapChain->Present(0, allowTearing ? DXGI_PRESENT_ALLOW_TEARING : 0);
 
     queue->Signal(queueFence.Get(), ++currentExecution); // new fence value from the GPU side (not done until queue finishes previous commands)
-    fenceValues[currentFrameBuffIndex] = currentExecution; // Store the fence for the dispatched buffer
-
-    flush();
+    fenceValues[currentFrameBuffIndex] = currentExecution; // Store the fence for the dispatched buffer (waited for when the buffer is reused, on preRender())
 }
 
 void D3D12Module::resize()
@@ -354,7 +406,7 @@ void D3D12Module::resize()
             flush(); // wait so that we can touch the buffers
             
             // 1. Clear frame buffer references (since frame sizes will change)
-            for (unsigned i = 0; i < FRAMES_IN_FLIGHT; ++i)
+            for (unsigned i = 0; i < framesInFlight; ++i)
             {
                 frameBuffers[i].Reset();
                 fenceValues[i] = 0; // so that we don't wait on next render() calls
@@ -375,10 +427,35 @@ void D3D12Module::resize()
     }
 }
 
+ID3D12GraphicsCommandList4* D3D12Module::beginRecording(RecordSlot slot)
+{
+    ID3D12CommandAllocator* allocator = recordAllocators[currentFrameBuffIndex][slot].Get();
+    ID3D12GraphicsCommandList4* list = recordLists[slot].Get();
+
+    allocator->Reset(); // (the fence of this frame was already waited for on preRender())
+    list->Reset(allocator, nullptr);
+
+    // Same targets as the main list (the frame buffer is already in render target state when this list is executed)
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = getRenderTargetDescriptor();
+    D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = getDepthStencilDescriptor();
+    list->OMSetRenderTargets(1, &rtvHandle, false, &dsvHandle);
+
+    recordUsed[slot] = true;
+
+    return list;
+}
+
+void D3D12Module::addRecordingJob(const JobSystem::JobHandle& job)
+{
+    recordingJobs.push_back(job);
+}
+
 // Auxiliary functions //
 
 inline void D3D12Module::WaitForFence(UINT64 value)
 {
+    if (queueFence->GetCompletedValue() >= value) return; // already there, no need to go through the event
+
 	HRESULT hr = queueFence->SetEventOnCompletion(value, drawEvent);
 	DWORD waitResult = WaitForSingleObject(drawEvent, INFINITE);
 }
@@ -1,13 +1,22 @@
 #pragma once
 
 #include "Module.h"
+#include "JobSystem.h"
 #include "dxgi1_6.h" // para el factory
 
 class D3D12Module : public Module
 {
 public:
 
-    D3D12Module(HWND hwnd);
+    // Command lists recorded in parallel (by jobs), executed after the main command list in this order
+    enum RecordSlot
+    {
+        SLOT_DEBUG_DRAW,
+        SLOT_EDITOR,
+        MAX_RECORD_SLOTS
+    };
+
+    D3D12Module(HWND hwnd, unsigned int framesInFlight = FRAMES_IN_FLIGHT, bool latencyWaitable = true);
     ~D3D12Module();
     bool cleanUp() override;
 
@@ -37,8 +46,16 @@ public:
     inline unsigned int getWindowWidth() const { return winWidth; };
     inline unsigned int getWindowHeight() const { return winHeight; };
 
+    inline unsigned int getFramesInFlight() const { return framesInFlight; };
+
+    inline UINT64 getCurrentFenceValue() const { return currentExecution + 1; };             // reached when the frame being recorded is done on the GPU
+    inline UINT64 getCompletedFenceValue() const { return queueFence->GetCompletedValue(); }; // (last frame the GPU finished)
+
     inline void flush(); // active wait for GPU things to finish
 
+    ID3D12GraphicsCommandList4* beginRecording(RecordSlot slot); // resets the slot list for this frame, with the render targets set (any thread, once per frame)
+    void addRecordingJob(const JobSystem::JobHandle& job);       // postRender() waits for it before submitting the frame
+
 
 private:
 
@@ -58,7 +75,12 @@ private:
     ComPtr<ID3D12CommandQueue> queue;
     ComPtr<ID3D12GraphicsCommandList4> commandList; // for the queue
 
-    ComPtr <ID3D12CommandAllocator> commandAllocators [FRAMES_IN_FLIGHT]; // so that we can handle each frame separately
+    ComPtr <ID3D12CommandAllocator> commandAllocators [MAX_FRAMES_IN_FLIGHT]; // so that we can handle each frame separately
+
+    ComPtr<ID3D12GraphicsCommandList4> recordLists[MAX_RECORD_SLOTS]; // for parallel recording (one per slot, so that the execution order is known)
+    ComPtr<ID3D12CommandAllocator> recordAllocators[MAX_FRAMES_IN_FLIGHT][MAX_RECORD_SLOTS];
+    bool recordUsed[MAX_RECORD_SLOTS] = {false}; // slots recorded this frame
+    std::vector<JobSystem::JobHandle> recordingJobs;
 
     // Screen //
     unsigned int winWidth = 0;  // 0 means
@@ -67,8 +89,9 @@ private:
     ComPtr<IDXGIFactory6> factory;
 
     ComPtr<IDXGISwapChain4> swapChain;  // contains frame buffers
-    ComPtr<ID3D12Resource> frameBuffers [FRAMES_IN_FLIGHT]; // (for quicker 
+    ComPtr<ID3D12Resource> frameBuffers [MAX_FRAMES_IN_FLIGHT]; // (for quicker 
     unsigned int currentFrameBuffIndex;                 // access) <- this one has to be updated accordingly
+    unsigned int framesInFlight;                        // frame buffers actually used (<= MAX_FRAMES_IN_FLIGHT)
 
     ComPtr<ID3D12DescriptorHeap> rtvDescriptorHeap; // for passing frame buffers
 
@@ -77,11 +100,14 @@ private:
 
     // Synchronization //
     ComPtr<ID3D12Fence> queueFence; // will increase value when queue done executing
-    UINT64 fenceValues [FRAMES_IN_FLIGHT] = {0}; // one per frame
+    UINT64 fenceValues [MAX_FRAMES_IN_FLIGHT] = {0}; // one per frame
     UINT64 currentExecution;
     
     HANDLE drawEvent = nullptr; // to associate fence values (and cause waiting until them)
 
+    bool latencyWaitable;                   // if true, the CPU waits for the swap chain to accept a new frame (instead of on fences)
+    HANDLE frameLatencyWaitable = nullptr;  // (signaled by the swap chain when it's ready for it)
+
     // Other options //
     bool supportsRT = false;
     bool allowTearing = false;
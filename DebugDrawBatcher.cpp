@@ -0,0 +1,225 @@
+#include "Globals.h"
+
+#include "DebugDrawBatcher.h"
+
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	template<typename T>
+	void copyBatches(const std::vector<T>* batches, size_t batchCount, void* data)
+	{
+		uint8_t* destination = reinterpret_cast<uint8_t*>(data);
+		for (size_t i = 0; i < batchCount; ++i)
+		{
+			if (batches[i].empty()) continue;
+
+			memcpy(destination, batches[i].data(), batches[i].size() * sizeof(T));
+			destination += batches[i].size() * sizeof(T);
+		}
+	}
+
+	template<typename T>
+	size_t getSize(const std::vector<T>* batches, size_t batchCount)
+	{
+		size_t size = 0;
+		for (size_t i = 0; i < batchCount; ++i) size += batches[i].size();
+		return size;
+	}
+}
+
+DebugDrawBatcher::DebugDrawBatcher()
+{
+	for (int shape = 0; shape < dd::ShapeCount; ++shape)
+	{
+		shapeFirstVertex[shape] = shapeMeshVertexCount;
+		shapeVertexCount[shape] = UINT(dd::getShapeMesh(dd::ShapeType(shape), nullptr));
+		shapeMeshVertexCount += shapeVertexCount[shape];
+	}
+
+	dd::getGlyphRects(nullptr, glyphSize);
+}
+
+void DebugDrawBatcher::getShapeMeshes(float* positions) const
+{
+	for (int shape = 0; shape < dd::ShapeCount; ++shape) dd::getShapeMesh(dd::ShapeType(shape), positions + shapeFirstVertex[shape] * 3);
+}
+
+// dd hands the vertices in chunks (DEBUG_DRAW_VERTEX_BUFFER_SIZE each), they are gathered per pipeline
+void DebugDrawBatcher::drawPointList(const dd::DrawVertex* points, int count, bool depthEnabled)
+{
+	std::vector<dd::DrawVertex>& batch = batches[depthEnabled ? BATCH_POINTS : BATCH_POINTS_NO_DEPTH];
+	batch.insert(batch.end(), points, points + count);
+}
+
+void DebugDrawBatcher::drawLineList(const dd::DrawVertex* lines, int count, bool depthEnabled)
+{
+	std::vector<dd::DrawVertex>& batch = batches[depthEnabled ? BATCH_LINES : BATCH_LINES_NO_DEPTH];
+	batch.insert(batch.end(), lines, lines + count);
+}
+
+// Sphere, box, cone and circle instances (instead of their lines): one instanced draw per shape and depth mode
+void DebugDrawBatcher::drawShapeList(dd::ShapeType shape, const dd::ShapeInstance* instances, int count, bool depthEnabled)
+{
+	std::vector<dd::ShapeInstance>& batch = shapeBatches[getShapeBatchIndex(shape, depthEnabled)];
+	batch.insert(batch.end(), instances, instances + count);
+}
+
+// A 16 byte instance per glyph (instead of 6 vertices), all of them in a single instanced draw
+void DebugDrawBatcher::drawGlyphInstances(const dd::GlyphInstance* glyphs, int count, dd::GlyphTextureHandle)
+{
+	if (textEnabled) glyphBatch.insert(glyphBatch.end(), glyphs, glyphs + count);
+}
+
+bool DebugDrawBatcher::uploadBatches(D3D12_VERTEX_BUFFER_VIEW&, D3D12_VERTEX_BUFFER_VIEW&, D3D12_VERTEX_BUFFER_VIEW&)
+{
+	return false; // (nowhere to copy them)
+}
+
+void DebugDrawBatcher::copyVertices(void* data) const
+{
+	copyBatches(batches, MAX_BATCHES, data);
+}
+
+void DebugDrawBatcher::copyInstances(void* data) const
+{
+	copyBatches(shapeBatches, std::size(shapeBatches), data);
+}
+
+void DebugDrawBatcher::copyGlyphs(void* data) const
+{
+	copyBatches(&glyphBatch, 1, data);
+}
+
+// All the vertices of the frame go to a single upload (one copy per pipeline, one vertex buffer view), and so do the shape
+// instances and the glyph instances. The state cache drops what the previous draw already set.
+void DebugDrawBatcher::recordFrame(ID3D12GraphicsCommandList* commandList, const Pipelines& pipelines, const Bindings& bindings, const float mvp[16],
+								   uint32_t width, uint32_t height, FrameStats& stats)
+{
+	size_t vertexCount = getSize(batches, MAX_BATCHES), instanceCount = getSize(shapeBatches, std::size(shapeBatches)), glyphCount = glyphBatch.size();
+
+	stateCache.reset(commandList);
+	stateCache.resetCounters();
+
+	stats.vertices = uint32_t(vertexCount);
+	stats.instances = uint32_t(instanceCount);
+	stats.glyphs = uint32_t(glyphCount);
+	stats.draws = stats.stateChanges = stats.filteredStateChanges = 0;
+
+	if (vertexCount + instanceCount + glyphCount == 0) return;
+
+	D3D12_VERTEX_BUFFER_VIEW view = { 0, UINT(vertexCount * sizeof(dd::DrawVertex)), sizeof(dd::DrawVertex) };
+	D3D12_VERTEX_BUFFER_VIEW instanceView = { 0, UINT(instanceCount * sizeof(dd::ShapeInstance)), sizeof(dd::ShapeInstance) };
+	D3D12_VERTEX_BUFFER_VIEW glyphView = { 0, UINT(glyphCount * sizeof(dd::GlyphInstance)), sizeof(dd::GlyphInstance) };
+
+	if (commandList and not uploadBatches(view, instanceView, glyphView))
+	{
+		for (std::vector<dd::DrawVertex>& batch : batches) batch.clear();
+		for (std::vector<dd::ShapeInstance>& batch : shapeBatches) batch.clear();
+		glyphBatch.clear();
+		return;
+	}
+
+	bool drop = commandList != nullptr; // (batches of pipelines still compiling, only counted without a command list)
+
+	D3D12_VIEWPORT viewport = { 0.0f, 0.0f, float(width), float(height), 0.0f, 1.0f };
+	D3D12_RECT scissor = { 0, 0, LONG(width), LONG(height) };
+
+	stateCache.setViewport(viewport);
+	stateCache.setScissorRect(scissor);
+	stateCache.setVertexBuffer(0, view);
+
+	// Same order dd uses (lines and shapes, points, text)
+	UINT firstVertex = 0;
+	recordBatch(BATCH_LINES, pipelines.lines, D3D_PRIMITIVE_TOPOLOGY_LINELIST, bindings, mvp, drop, firstVertex);
+	recordBatch(BATCH_LINES_NO_DEPTH, pipelines.linesNoDepth, D3D_PRIMITIVE_TOPOLOGY_LINELIST, bindings, mvp, drop, firstVertex);
+
+	if (instanceCount > 0)
+	{
+		stateCache.setVertexBuffer(0, bindings.shapeMeshes);
+		stateCache.setVertexBuffer(1, instanceView);
+
+		UINT firstInstance = 0;
+		recordShapes(true, pipelines.shapes, bindings, mvp, drop, firstInstance);
+		recordShapes(false, pipelines.shapesNoDepth, bindings, mvp, drop, firstInstance);
+
+		stateCache.setVertexBuffer(0, view);
+	}
+
+	recordBatch(BATCH_POINTS, pipelines.points, D3D_PRIMITIVE_TOPOLOGY_POINTLIST, bindings, mvp, drop, firstVertex);
+	recordBatch(BATCH_POINTS_NO_DEPTH, pipelines.pointsNoDepth, D3D_PRIMITIVE_TOPOLOGY_POINTLIST, bindings, mvp, drop, firstVertex);
+	recordText(pipelines.text, bindings, glyphView, width, height, drop);
+
+	const CommandListStateCache::Counters& counters = stateCache.getCounters();
+	stats.draws = counters.draws;
+	stats.stateChanges = counters.stateChanges;
+	stats.filteredStateChanges = counters.filtered;
+}
+
+void DebugDrawBatcher::recordBatch(Batch index, ID3D12PipelineState* pso, D3D_PRIMITIVE_TOPOLOGY topology, const Bindings& bindings, const float mvp[16], bool drop,
+								   UINT& firstVertex)
+{
+	std::vector<dd::DrawVertex>& batch = batches[index];
+	if (batch.empty()) return;
+
+	if (pso or not drop)
+	{
+		stateCache.setPipelineState(pso);
+		stateCache.setGraphicsRootSignature(bindings.signature);
+		stateCache.setPrimitiveTopology(topology);
+		stateCache.setGraphicsRoot32BitConstants(bindings.constantsParameter, 16, mvp);
+
+		stateCache.drawInstanced(UINT(batch.size()), 1, firstVertex, 0);
+	}
+
+	firstVertex += UINT(batch.size());
+	batch.clear(); // (keeps its capacity for the next frame)
+}
+
+// (same order the instances were copied in: the shapes with depth, then the ones without it)
+void DebugDrawBatcher::recordShapes(bool depthEnabled, ID3D12PipelineState* pso, const Bindings& bindings, const float mvp[16], bool drop, UINT& firstInstance)
+{
+	for (int shape = 0; shape < dd::ShapeCount; ++shape)
+	{
+		std::vector<dd::ShapeInstance>& batch = shapeBatches[getShapeBatchIndex(dd::ShapeType(shape), depthEnabled)];
+		if (batch.empty()) continue;
+
+		if (pso or not drop)
+		{
+			stateCache.setPipelineState(pso);
+			stateCache.setGraphicsRootSignature(bindings.signature);
+			stateCache.setPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
+			stateCache.setGraphicsRoot32BitConstants(bindings.constantsParameter, 16, mvp);
+
+			stateCache.drawInstanced(shapeVertexCount[shape], UINT(batch.size()), shapeFirstVertex[shape], firstInstance);
+		}
+
+		firstInstance += UINT(batch.size());
+		batch.clear();
+	}
+}
+
+// A 4 vertex strip per glyph instance
+void DebugDrawBatcher::recordText(ID3D12PipelineState* pso, const Bindings& bindings, const D3D12_VERTEX_BUFFER_VIEW& glyphView, uint32_t width, uint32_t height,
+								  bool drop)
+{
+	if (glyphBatch.empty()) return;
+
+	if (pso or not drop)
+	{
+		TextConstants constants = { { float(width), float(height) }, { glyphSize[0], glyphSize[1] } };
+
+		stateCache.setVertexBuffer(0, glyphView);
+		stateCache.setPipelineState(pso);
+		stateCache.setGraphicsRootSignature(bindings.textSignature);
+		stateCache.setPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+		stateCache.setGraphicsRoot32BitConstants(0, sizeof(TextConstants) / sizeof(UINT), &constants);
+		stateCache.setGraphicsRootDescriptorTable(1, bindings.glyphTexture);
+		stateCache.setGraphicsRootConstantBufferView(2, bindings.glyphRects);
+
+		stateCache.drawInstanced(4, UINT(glyphBatch.size()), 0, 0);
+	}
+
+	glyphBatch.clear();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "CommandListStateCache.h"
+
+#include <vector>
+
+// The CPU side of DebugDrawPass, without GPU objects (it also builds headless): what dd hands to the renderer is gathered
+// per pipeline over all the contexts, and recordFrame() draws every pipeline once (one per shape for the instanced shapes)
+// through a state cache. With a null command list nothing is recorded and it only counts the draws and state changes.
+class DebugDrawBatcher : public dd::RenderInterface
+{
+public:
+
+	struct FrameStats
+	{
+		uint32_t vertices = 0;
+		uint32_t instances = 0;			   // instanced shapes (spheres, boxes, cones and circles)
+		uint32_t glyphs = 0;			   // text characters (an instance each)
+		uint32_t draws = 0;				   // at most one per pipeline (lines, shapes and points, with and without depth, and text), one per shape
+		uint32_t stateChanges = 0;
+		uint32_t filteredStateChanges = 0; // redundant ones the state cache didn't record
+		uint32_t contexts = 0;			   // threads that have drawn (one dd context each)
+		dd::FrameCounters queues = {};	   // submitted, culled, dropped... of all the contexts
+	};
+
+	// Null pipelines are still compiling: their batches are dropped (only counted without a command list)
+	struct Pipelines
+	{
+		ID3D12PipelineState* lines = nullptr;
+		ID3D12PipelineState* linesNoDepth = nullptr;
+		ID3D12PipelineState* points = nullptr;
+		ID3D12PipelineState* pointsNoDepth = nullptr;
+		ID3D12PipelineState* shapes = nullptr;
+		ID3D12PipelineState* shapesNoDepth = nullptr;
+		ID3D12PipelineState* text = nullptr;
+	};
+
+	// What the pipelines read besides the batches
+	struct Bindings
+	{
+		ID3D12RootSignature* signature = nullptr;	  // lines, points and shapes: the mvp in its root constants
+		UINT constantsParameter = 0;
+		ID3D12RootSignature* textSignature = nullptr; // text constants (b0), glyph texture table (t0), glyph rects (b1)
+		D3D12_GPU_DESCRIPTOR_HANDLE glyphTexture = {};
+		D3D12_GPU_VIRTUAL_ADDRESS glyphRects = 0;
+		D3D12_VERTEX_BUFFER_VIEW shapeMeshes = {};	  // (every unit mesh, see getShapeFirstVertex())
+	};
+
+	enum Batch { BATCH_LINES, BATCH_LINES_NO_DEPTH, BATCH_POINTS, BATCH_POINTS_NO_DEPTH, MAX_BATCHES };
+
+	DebugDrawBatcher();
+
+	// (set before the contexts are created: they ask once)
+	inline void setShapeInstancing(bool enable) { shapeInstancing = enable; };
+	inline void setTextEnabled(bool enable) { textEnabled = enable; }; // (otherwise glyphs are only counted by the queues)
+
+	// mvp as the root constants take it (column vectors). Every batch is recorded (or dropped) and emptied.
+	void recordFrame(ID3D12GraphicsCommandList* commandList, const Pipelines& pipelines, const Bindings& bindings, const float mvp[16], uint32_t width,
+					 uint32_t height, FrameStats& stats);
+
+	inline const std::vector<dd::DrawVertex>& getBatch(Batch batch) const { return batches[batch]; };
+	inline const std::vector<dd::ShapeInstance>& getShapeBatch(dd::ShapeType shape, bool depthEnabled) const { return shapeBatches[getShapeBatchIndex(shape, depthEnabled)]; };
+	inline const std::vector<dd::GlyphInstance>& getGlyphBatch() const { return glyphBatch; };
+
+	// Where each unit mesh starts in Bindings::shapeMeshes (all of them one after the other, as getShapeMeshes() writes them)
+	inline UINT getShapeFirstVertex(dd::ShapeType shape) const { return shapeFirstVertex[shape]; };
+	inline UINT getShapeMeshVertexCount() const { return shapeMeshVertexCount; };
+	void getShapeMeshes(float* positions) const;
+
+	// dd::RenderInterface
+	void drawPointList(const dd::DrawVertex* points, int count, bool depthEnabled) override;
+	void drawLineList(const dd::DrawVertex* lines, int count, bool depthEnabled) override;
+	bool supportsShapeInstancing() override { return shapeInstancing; }
+	void drawShapeList(dd::ShapeType shape, const dd::ShapeInstance* instances, int count, bool depthEnabled) override;
+	bool supportsGlyphInstancing() override { return true; }
+	void drawGlyphInstances(const dd::GlyphInstance* glyphs, int count, dd::GlyphTextureHandle glyphTexture) override;
+
+protected:
+
+	// Copies the batches where the GPU reads them and points the views at them (sizes and strides are set). Only called
+	// with a command list: false drops the frame.
+	virtual bool uploadBatches(D3D12_VERTEX_BUFFER_VIEW& vertices, D3D12_VERTEX_BUFFER_VIEW& instances, D3D12_VERTEX_BUFFER_VIEW& glyphs);
+
+	// (in the order of the views: the vertex batches, the shapes with depth then without it, the glyphs)
+	void copyVertices(void* data) const;
+	void copyInstances(void* data) const;
+	void copyGlyphs(void* data) const;
+
+private:
+
+	struct TextConstants
+	{
+		float screenDimensions[2];
+		float glyphSize[2];
+	};
+
+	std::vector<dd::DrawVertex> batches[MAX_BATCHES];
+	std::vector<dd::ShapeInstance> shapeBatches[dd::ShapeCount * 2]; // (all the shapes with depth, then without it)
+	std::vector<dd::GlyphInstance> glyphBatch;
+
+	CommandListStateCache stateCache;
+
+	bool shapeInstancing = true;
+	bool textEnabled = false;
+
+	UINT shapeFirstVertex[dd::ShapeCount] = {};
+	UINT shapeVertexCount[dd::ShapeCount] = {};
+	UINT shapeMeshVertexCount = 0;
+	float glyphSize[2] = {};
+
+	static inline size_t getShapeBatchIndex(dd::ShapeType shape, bool depthEnabled) { return (depthEnabled ? 0 : dd::ShapeCount) + shape; };
+
+	void recordBatch(Batch batch, ID3D12PipelineState* pso, D3D_PRIMITIVE_TOPOLOGY topology, const Bindings& bindings, const float mvp[16], bool drop, UINT& firstVertex);
+	void recordShapes(bool depthEnabled, ID3D12PipelineState* pso, const Bindings& bindings, const float mvp[16], bool drop, UINT& firstInstance);
+	void recordText(ID3D12PipelineState* pso, const Bindings& bindings, const D3D12_VERTEX_BUFFER_VIEW& glyphView, uint32_t width, uint32_t height, bool drop);
+};
@@ -0,0 +1,73 @@
+#include "Globals.h"
+
+#include "DebugDrawContexts.h"
+
+std::atomic<uint32_t> DebugDrawContexts::generations = 0;
+
+DebugDrawContexts::DebugDrawContexts(dd::RenderInterface* _renderer) : renderer(_renderer)
+{
+	generation = ++generations; // (never 0, the generation of a thread without context)
+}
+
+DebugDrawContexts::~DebugDrawContexts()
+{
+	for (dd::ContextHandle context : contexts) dd::shutdown(context);
+}
+
+dd::ContextHandle DebugDrawContexts::getContext()
+{
+	struct ThreadContext
+	{
+		dd::ContextHandle context = nullptr;
+		uint32_t generation = 0;
+	};
+
+	static thread_local ThreadContext threadContext;
+
+	if (threadContext.context == nullptr or threadContext.generation != generation)
+	{
+		threadContext.context = createContext();
+		threadContext.generation = generation;
+	}
+
+	return threadContext.context;
+}
+
+dd::ContextHandle DebugDrawContexts::createContext()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	dd::ContextHandle context = nullptr;
+	if (not dd::initialize(&context, renderer)) return nullptr;
+
+	contexts.push_back(context);
+	return context;
+}
+
+uint32_t DebugDrawContexts::flush(const float* cullMatrix, dd::FrameCounters& counters)
+{
+	std::lock_guard<std::mutex> lock(mutex); // (only against threads getting their first context)
+
+	for (dd::ContextHandle context : contexts)
+	{
+		if (cullMatrix) dd::setCullMatrix(context, cullMatrix);
+		dd::flush(context);
+
+		const dd::FrameCounters& contextCounters = dd::getFrameCounters(context);
+		addQueueCounters(counters.lines, contextCounters.lines);
+		addQueueCounters(counters.points, contextCounters.points);
+		addQueueCounters(counters.strings, contextCounters.strings);
+		addQueueCounters(counters.shapes, contextCounters.shapes);
+		counters.queueBytes += contextCounters.queueBytes;
+	}
+
+	return uint32_t(contexts.size());
+}
+
+void DebugDrawContexts::addQueueCounters(dd::QueueCounters& total, const dd::QueueCounters& counters)
+{
+	total.submitted += counters.submitted;
+	total.dropped += counters.dropped;
+	total.culled += counters.culled;
+	total.queued += counters.queued;
+}
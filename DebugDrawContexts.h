@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// The dd contexts of a renderer: one per thread that draws, created on the thread's first getContext() and all of them
+// flushed together by flush(). Contexts are only destroyed with this. A thread that kept the context of previous
+// DebugDrawContexts (an earlier DebugDrawPass) gets a new one: each of them has its own generation.
+class DebugDrawContexts
+{
+public:
+
+	explicit DebugDrawContexts(dd::RenderInterface* renderer);
+	~DebugDrawContexts();
+
+	DebugDrawContexts(const DebugDrawContexts&) = delete;
+	DebugDrawContexts& operator=(const DebugDrawContexts&) = delete;
+
+	// Context of the calling thread (null if dd can't create it). Draws only push to the thread's own context, no locks;
+	// they can't overlap flush() though, which reads every context.
+	dd::ContextHandle getContext();
+
+	// Flushes every context (culled by cullMatrix, view * projection in row vectors, unless null) and adds up their
+	// counters. Returns the number of contexts.
+	uint32_t flush(const float* cullMatrix, dd::FrameCounters& counters);
+
+private:
+
+	dd::RenderInterface* renderer = nullptr;
+	uint32_t generation = 0;
+
+	std::mutex mutex; // (dd::initialize() asks the renderer for the glyph texture under it too)
+	std::vector<dd::ContextHandle> contexts;
+
+	static std::atomic<uint32_t> generations;
+
+	dd::ContextHandle createContext();
+	static void addQueueCounters(dd::QueueCounters& total, const dd::QueueCounters& counters);
+};
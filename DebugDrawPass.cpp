@@ -2,10 +2,17 @@
 
 #include "Globals.h"
 #include "DebugDrawPass.h"
+#include "Application.h"
+#include "ModuleResources.h"
+#include "ModulePipelines.h"
+#include "ModuleShaders.h"
+#include "TextureCooker.h"
+#include "FrameArena.h"
+#include "DebugDrawBatcher.h"
+#include "DebugDrawContexts.h"
 
 #include "SimpleMath.h"
 
-#include <d3dcompiler.h>
 #include "d3dx12.h"
 
 
@@ -42,17 +49,61 @@ static const char linePointSource[] = R"(
     }
 )";
 
+// Instanced shapes: the unit mesh (slot 0) is placed by the instance axes and origin (slot 1), see dd::ShapeInstance
+static const char shapeSource[] = R"(
+    cbuffer Transforms : register(b0)
+    {
+        float4x4 mvp;
+    };
+
+    struct VertexInput
+    {
+        float3 position : POSITION;
+        float3 axisX    : AXIS0;
+        float3 axisY    : AXIS1;
+        float3 axisZ    : AXIS2;
+        float3 origin   : ORIGIN;
+        float3 color    : COLOR;
+    };
+
+    struct VertexOutput
+    {
+        float4 position : SV_POSITION;
+        float3 color    : COLOR;
+    };
+
+    VertexOutput shapeVS(VertexInput input)
+    {
+        float3 position = input.origin + input.position.x * input.axisX + input.position.y * input.axisY + input.position.z * input.axisZ;
+
+        VertexOutput output;
+        output.position = mul(float4(position, 1.0), mvp);
+        output.color    = input.color;
+
+        return output;
+    }
+)";
+
+// Instanced text: a quad per glyph instance (4 strip vertices from SV_VertexID), its rect in the glyph texture comes from the
+// character code (see dd::GlyphInstance and dd::getGlyphRects())
 static const char textSource[] = R"(
-    cbuffer ScreenDimensions : register(b0)
+    cbuffer TextConstants : register(b0)
     {
         float2 screenDimensions;
+        float2 glyphSize;
+    };
+
+    cbuffer GlyphRects : register(b1)
+    {
+        float4 glyphRects[256];
     };
 
     struct VertexInput
     {
         float2 position : POSITION;
-        float2 texCoord : TEXCOORD;
-        float3 color    : COLOR;
+        uint2  glyph    : GLYPH; // character code, 8.8 scaling
+        float4 color    : COLOR;
+        uint   vertexId : SV_VertexID;
     };
 
     struct VertexOutput
@@ -66,12 +117,17 @@ static const char textSource[] = R"(
     {
         VertexOutput output;
 
-        float x = ((2.0 * (input.position.x - 0.5)) / screenDimensions.x) - 1.0;
-        float y = 2.0*(1.0-((input.position.y-0.5)/screenDimensions.y))-1.0; 
+        float2 corner = float2(input.vertexId >> 1, input.vertexId & 1);
+        float2 position = input.position + corner * glyphSize * (input.glyph.y / 256.0);
+
+        float x = ((2.0 * (position.x - 0.5)) / screenDimensions.x) - 1.0;
+        float y = 2.0*(1.0-((position.y-0.5)/screenDimensions.y))-1.0; 
         
+        float4 rect = glyphRects[input.glyph.x];
+
         output.position = float4(x, y, 0.0, 1.0);
-        output.texCoord = input.texCoord;
-        output.color    = input.color;
+        output.texCoord = lerp(rect.xy, rect.zw, corner);
+        output.color    = input.color.rgb;
 
         return output;
     }
@@ -82,85 +138,78 @@ static const char textSource[] = R"(
     float4 textPS(VertexOutput input) : SV_TARGET
     {
         float alpha = glyphTexture.Sample(glyphSampler, input.texCoord).r;
-        return float4(1.0, 1.0, 1.0, alpha); 
+        return float4(input.color, alpha); 
     }
     
 )";
 
 using namespace DirectX;
 
-class DDRenderInterfaceCoreD3D12 final : public dd::RenderInterface
+static const char* GLYPH_CACHE_DIRECTORY = "Cache/DebugDraw";
+static const dd::GlyphTextureHandle GLYPH_TEXTURE = dd::GlyphTextureHandle(0xFFFFFF); // (there is a single one, dd only checks it isn't null)
+
+class DDRenderInterfaceCoreD3D12 final : public DebugDrawBatcher
 {
 public:
     friend class DebugDrawPass;
 
-    DDRenderInterfaceCoreD3D12(ID3D12Device4* _device, ID3D12CommandQueue* _uploadQueue, D3D12_CPU_DESCRIPTOR_HANDLE cpuText, D3D12_GPU_DESCRIPTOR_HANDLE gpuText)
+    DDRenderInterfaceCoreD3D12(ID3D12Device4* _device, D3D12_CPU_DESCRIPTOR_HANDLE cpuText, D3D12_GPU_DESCRIPTOR_HANDLE gpuText) : contexts(this)
     {
         device = _device;
-        uploadQueue = _uploadQueue;
         cpuTextHandle = cpuText;
         gpuTextHandle = gpuText;
 
-        setupLinePointVertexBuffers();
-        setupUploadCommandBuffer();
+        if (not device) return; // headless: draws are only counted
+
+        pipelines = app->getModulePipelines();
+        shaders = app->getModuleShaders();
         setupLinePointPipeline();
+        setupShapePipeline();
         setupTextPipeline();
-        setupTextVertexBuffers();
-    }
 
-    ~DDRenderInterfaceCoreD3D12()
-    {
-        if (uploadEvent) CloseHandle(uploadEvent);
-    }
+        setShapeInstancing(shapeMeshes != nullptr); // (shapes go back to lines without the meshes)
+        setTextEnabled(cpuTextHandle.ptr != 0 and glyphRects != nullptr);
 
-    void setupUploadCommandBuffer()
-    {
-        device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
-        device->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&commandList));
-
-        device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&uploadFence));
-        uploadEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        vertexArena.reset(3 * DEBUG_DRAW_VERTEX_BUFFER_SIZE * sizeof(dd::DrawVertex)); // (lines, points and text of a frame, it grows if needed)
     }
 
+    // Glyph rects in an upload buffer (4 KB, written once) for a root CBV
     void setupTextPipeline()
     {
-        ComPtr<ID3DBlob> errorBuff;
-
-        unsigned flags = D3DCOMPILE_OPTIMIZATION_LEVEL3 | D3DCOMPILE_ALL_RESOURCES_BOUND;
-
-        D3DCompile(textSource, sizeof(textSource), "TextVS", nullptr, nullptr, "textVS", "vs_5_0", flags, 0, &textVS, nullptr);
-        D3DCompile(textSource, sizeof(textSource), "TextPS", nullptr, nullptr, "textPS", "ps_5_0", flags, 0, &textPS, nullptr);
+        textVS = shaders->getShaderFromSource(textSource, "DebugDraw Text", "textVS", "vs_5_0");
+        textPS = shaders->getShaderFromSource(textSource, "DebugDraw Text", "textPS", "ps_5_0");
 
-        CD3DX12_ROOT_PARAMETER textRootParams[2];
+        CD3DX12_ROOT_PARAMETER textRootParams[3];
         D3D12_DESCRIPTOR_RANGE tableRange{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, 0 };
 
-        CD3DX12_ROOT_PARAMETER::InitAsConstants(textRootParams[0], sizeof(Vector2) / sizeof(UINT32), 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        CD3DX12_ROOT_PARAMETER::InitAsConstants(textRootParams[0], 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX); // (screen dimensions, glyph size)
         CD3DX12_ROOT_PARAMETER::InitAsDescriptorTable(textRootParams[1], 1, &tableRange, D3D12_SHADER_VISIBILITY_PIXEL);
+        CD3DX12_ROOT_PARAMETER::InitAsConstantBufferView(textRootParams[2], 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
         D3D12_STATIC_SAMPLER_DESC sampler = { D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP , D3D12_TEXTURE_ADDRESS_MODE_CLAMP ,
                                               D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 0, D3D12_COMPARISON_FUNC_NEVER, D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK,
                                               0.0f, D3D12_FLOAT32_MAX , 0, 0, D3D12_SHADER_VISIBILITY_PIXEL };
 
         CD3DX12_ROOT_SIGNATURE_DESC textRootDesc;
-        textRootDesc.Init(2, &textRootParams[0], 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT | D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        textRootDesc.Init(3, &textRootParams[0], 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT | D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
                                                               D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS | 
                                                               D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
                                                               D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS | 
                                                               D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS);
-        ComPtr<ID3DBlob> rootSignatureBlob;
 
-        D3D12SerializeRootSignature(&textRootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &rootSignatureBlob, nullptr);
-        device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&textSignature));
+        // Volatile upgrade (the SRV data is static while set at execute): the glyph texture copy may still be running when the
+        // first frames are recorded, only their execution is ordered after it (see record()), so DATA_STATIC would be wrong
+        textSignature = pipelines->getRootSignature(textRootDesc, RootSignatureDesc::UPGRADE_VOLATILE, L"DebugDraw Text");
 
-        D3D12_INPUT_ELEMENT_DESC inputLayout[] = { {"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-                                                   {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}, 
-                                                   {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0} };
+        D3D12_INPUT_ELEMENT_DESC inputLayout[] = { {"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
+                                                   {"GLYPH", 0, DXGI_FORMAT_R16G16_UINT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1}, 
+                                                   {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1} };
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC textPSODesc = {};
         textPSODesc.InputLayout = { inputLayout, sizeof(inputLayout) / sizeof(D3D12_INPUT_ELEMENT_DESC) };
         textPSODesc.pRootSignature = textSignature.Get();
-        textPSODesc.VS = { textVS->GetBufferPointer(),  textVS->GetBufferSize() };
-        textPSODesc.PS = { textPS->GetBufferPointer(), textPS->GetBufferSize() };
+        textPSODesc.VS = ModuleShaders::getBytecode(textVS);
+        textPSODesc.PS = ModuleShaders::getBytecode(textPS);
         textPSODesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
         textPSODesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
         textPSODesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
@@ -182,33 +231,39 @@ public:
 
         textPSODesc.RasterizerState.FrontCounterClockwise = TRUE;
 
-        device->CreateGraphicsPipelineState(&textPSODesc, IID_PPV_ARGS(&textPSO));
-    }
+        textPipeline = pipelines->requestPipeline(textPSODesc, L"DebugDraw Text");
 
-    void setupLinePointPipeline()
-    {
-        ComPtr<ID3DBlob> errorBuff;
+        int glyphCount = dd::getGlyphRects(nullptr, nullptr);
 
-        unsigned flags = D3DCOMPILE_OPTIMIZATION_LEVEL3 | D3DCOMPILE_ALL_RESOURCES_BOUND;
+        CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(glyphCount * sizeof(Vector4));
+
+        if (FAILED(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&glyphRects))))
+            return;
 
-        D3DCompile(linePointSource, sizeof(linePointSource), "LinePointVS", nullptr, nullptr, "linePointVS", "vs_5_0", flags, 0, &linePointVS, &errorBuff);
-        D3DCompile(linePointSource, sizeof(linePointSource), "LinePointPS", nullptr, nullptr, "linePointPS", "ps_5_0", flags, 0, &linePointPS, &errorBuff);
+        glyphRects->SetName(L"DebugDraw Glyph Rects");
 
-        CD3DX12_ROOT_PARAMETER linePointRootParams[1];
+        float* data = nullptr;
+        D3D12_RANGE readRange = { 0, 0 };
+        if (FAILED(glyphRects->Map(0, &readRange, reinterpret_cast<void**>(&data))))
+        {
+            glyphRects.Reset(); // (no text)
+            return;
+        }
 
-        CD3DX12_ROOT_PARAMETER::InitAsConstants(linePointRootParams[0], sizeof(Matrix) / sizeof(UINT32), 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        dd::getGlyphRects(data, nullptr);
+        glyphRects->Unmap(0, nullptr);
+    }
 
-        CD3DX12_ROOT_SIGNATURE_DESC linePointRootDesc;
-        linePointRootDesc.Init(1, &linePointRootParams[0], 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
-                                                                       D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-                                                                       D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-                                                                       D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
-                                                                       D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS |
-                                                                       D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS);
-        ComPtr<ID3DBlob> rootSignatureBlob;
+    void setupLinePointPipeline()
+    {
+        // (plain shader model 5 code: D3DCompile, no DXC needed)
+        linePointVS = shaders->getShaderFromSource(linePointSource, "DebugDraw LinePoint", "linePointVS", "vs_5_0");
+        linePointPS = shaders->getShaderFromSource(linePointSource, "DebugDraw LinePoint", "linePointPS", "ps_5_0");
 
-        D3D12SerializeRootSignature(&linePointRootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &rootSignatureBlob, nullptr);
-        device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&pointLineSignature));
+        // The bindless root signature, shared with the scene passes: only the mvp, in its root constants
+        static_assert(sizeof(Matrix) / sizeof(UINT32) <= ModulePipelines::BINDLESS_CONSTANT_COUNT, "mvp doesn't fit in the root constants");
+        pointLineSignature = pipelines->getBindlessRootSignature();
 
         D3D12_INPUT_ELEMENT_DESC inputLayout[] = { {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
                                                    {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0} };
@@ -216,8 +271,8 @@ public:
         D3D12_GRAPHICS_PIPELINE_STATE_DESC pointPSODesc = {};
         pointPSODesc.InputLayout = { inputLayout, UINT(std::size(inputLayout)) };
         pointPSODesc.pRootSignature = pointLineSignature.Get();
-        pointPSODesc.VS = { linePointVS->GetBufferPointer(),  linePointVS->GetBufferSize() };
-        pointPSODesc.PS = { linePointPS->GetBufferPointer(), linePointPS->GetBufferSize() };
+        pointPSODesc.VS = ModuleShaders::getBytecode(linePointVS);
+        pointPSODesc.PS = ModuleShaders::getBytecode(linePointPS);
         pointPSODesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
         pointPSODesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
         pointPSODesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
@@ -231,8 +286,9 @@ public:
         D3D12_GRAPHICS_PIPELINE_STATE_DESC pointPSODescNoDepth = pointPSODesc;
         pointPSODescNoDepth.DepthStencilState.DepthEnable = FALSE;
 
-        device->CreateGraphicsPipelineState(&pointPSODesc, IID_PPV_ARGS(&pointPSO));
-        device->CreateGraphicsPipelineState(&pointPSODescNoDepth, IID_PPV_ARGS(&pointPSONoDepth));
+        // (until the ones without depth are ready they draw with depth)
+        pointPipeline = pipelines->requestPipeline(pointPSODesc, L"DebugDraw Points");
+        pointNoDepthPipeline = pipelines->requestPipeline(pointPSODescNoDepth, L"DebugDraw Points (no depth)", pointPipeline);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC linePSODesc = pointPSODesc;
         linePSODesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
@@ -240,253 +296,319 @@ public:
         D3D12_GRAPHICS_PIPELINE_STATE_DESC linePSODescNoDepth = linePSODesc;
         linePSODescNoDepth.DepthStencilState.DepthEnable = FALSE;
 
-        device->CreateGraphicsPipelineState(&linePSODesc, IID_PPV_ARGS(&linePSO));
-        device->CreateGraphicsPipelineState(&linePSODescNoDepth, IID_PPV_ARGS(&linePSONoDepth));
+        linePipeline = pipelines->requestPipeline(linePSODesc, L"DebugDraw Lines");
+        lineNoDepthPipeline = pipelines->requestPipeline(linePSODescNoDepth, L"DebugDraw Lines (no depth)", linePipeline);
     }
-     
-    void createBuffer(unsigned bufferSize, ComPtr<ID3D12Resource>& buffer, D3D12_VERTEX_BUFFER_VIEW& view)
+
+    // Same signature as lines and points (so switching between them keeps the root constants), unit meshes in an upload buffer
+    // (a few KB, written once)
+    void setupShapePipeline()
     {
-        // TODO : Test two-step loading in the Graphics queue and UMA NUMA
+        shapeVS = shaders->getShaderFromSource(shapeSource, "DebugDraw Shape", "shapeVS", "vs_5_0");
+
+        D3D12_INPUT_ELEMENT_DESC inputLayout[] = { {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+                                                   {"AXIS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
+                                                   {"AXIS", 1, DXGI_FORMAT_R32G32B32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
+                                                   {"AXIS", 2, DXGI_FORMAT_R32G32B32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
+                                                   {"ORIGIN", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
+                                                   {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1} };
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC shapePSODesc = {};
+        shapePSODesc.InputLayout = { inputLayout, UINT(std::size(inputLayout)) };
+        shapePSODesc.pRootSignature = pointLineSignature.Get();
+        shapePSODesc.VS = ModuleShaders::getBytecode(shapeVS);
+        shapePSODesc.PS = ModuleShaders::getBytecode(linePointPS);
+        shapePSODesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+        shapePSODesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        shapePSODesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+        shapePSODesc.SampleDesc = { 1, 0 };
+        shapePSODesc.SampleMask = 0xffffffff;
+        shapePSODesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        shapePSODesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+        shapePSODesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        shapePSODesc.NumRenderTargets = 1;
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC shapePSODescNoDepth = shapePSODesc;
+        shapePSODescNoDepth.DepthStencilState.DepthEnable = FALSE;
+
+        shapePipeline = pipelines->requestPipeline(shapePSODesc, L"DebugDraw Shapes");
+        shapeNoDepthPipeline = pipelines->requestPipeline(shapePSODescNoDepth, L"DebugDraw Shapes (no depth)", shapePipeline);
+
+        // All the unit meshes in one buffer
+        UINT vertexCount = getShapeMeshVertexCount();
+
         CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexCount * sizeof(Vector3));
+
+        if (FAILED(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&shapeMeshes))))
+            return;
 
-        device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,IID_PPV_ARGS(&buffer));
+        shapeMeshes->SetName(L"DebugDraw Shape Meshes");
 
-        view.BufferLocation = buffer->GetGPUVirtualAddress();
-        view.StrideInBytes = sizeof(dd::DrawVertex);
-        view.SizeInBytes = bufferSize;
+        float* data = nullptr;
+        D3D12_RANGE readRange = { 0, 0 };
+        if (FAILED(shapeMeshes->Map(0, &readRange, reinterpret_cast<void**>(&data))))
+        {
+            shapeMeshes.Reset(); // (shapes go back to lines)
+            return;
+        }
+
+        getShapeMeshes(data);
+        shapeMeshes->Unmap(0, nullptr);
+
+        shapeMeshView.BufferLocation = shapeMeshes->GetGPUVirtualAddress();
+        shapeMeshView.StrideInBytes = sizeof(Vector3);
+        shapeMeshView.SizeInBytes = vertexCount * sizeof(Vector3);
     }
 
-    void setupTextVertexBuffers()
+    // Pages of the vertex arena: upload buffers mapped for their whole life
+    bool createArenaPage(size_t index, size_t size)
     {
-        createBuffer(DEBUG_DRAW_VERTEX_BUFFER_SIZE * sizeof(dd::DrawVertex), textBuffer, textBufferView);
+        CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+        ArenaPage page;
+        if (FAILED(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&page.buffer))))
+            return false;
+
+        page.buffer->SetName(L"DebugDraw Vertex Arena");
+
+        D3D12_RANGE readRange = { 0, 0 }; // (never read)
+        if (FAILED(page.buffer->Map(0, &readRange, reinterpret_cast<void**>(&page.data))))
+            return false;
+
+        if (index >= arenaPages.size()) arenaPages.resize(index + 1);
+        arenaPages[index] = std::move(page);
+        return true;
     }
 
-    void setupLinePointVertexBuffers()
+    // Copies the batches to a single arena allocation per view (the pages stay mapped)
+    bool uploadBatches(D3D12_VERTEX_BUFFER_VIEW& vertices, D3D12_VERTEX_BUFFER_VIEW& instances, D3D12_VERTEX_BUFFER_VIEW& glyphs) override
     {
-        createBuffer(DEBUG_DRAW_VERTEX_BUFFER_SIZE * sizeof(dd::DrawVertex), lineBuffer, lineBufferView);
-        createBuffer(DEBUG_DRAW_VERTEX_BUFFER_SIZE * sizeof(dd::DrawVertex), pointBuffer, pointBufferView);
-        lineBuffer->SetName(L"DebugDraw LineBuffer");
-        pointBuffer->SetName(L"DebugDraw PointBuffer");
+        return (vertices.SizeInBytes == 0 or copyToArena(vertices, &DebugDrawBatcher::copyVertices)) and
+               (instances.SizeInBytes == 0 or copyToArena(instances, &DebugDrawBatcher::copyInstances)) and
+               (glyphs.SizeInBytes == 0 or copyToArena(glyphs, &DebugDrawBatcher::copyGlyphs));
     }
 
-    void beginDraw() override { }    
-    void endDraw()   override { }
+    bool copyToArena(D3D12_VERTEX_BUFFER_VIEW& view, void (DebugDrawBatcher::*copy)(void*) const)
+    {
+        FrameArena::Allocation allocation = vertexArena.allocate(view.SizeInBytes, sizeof(float) * 4);
+
+        bool ok = (allocation.page < arenaPages.size() and arenaPages[allocation.page].buffer) or
+                  createArenaPage(allocation.page, vertexArena.getPageSize(allocation.page)); // (new page)
+        if (not ok) return false;
+
+        const ArenaPage& page = arenaPages[allocation.page];
+        view.BufferLocation = page.buffer->GetGPUVirtualAddress() + allocation.offset;
+        (this->*copy)(page.data + allocation.offset);
 
-    void recordCommands(const dd::DrawVertex* vertices, int count, ID3D12Resource* vertexBuffer, const D3D12_VERTEX_BUFFER_VIEW& vertexBufferView, 
-                        ID3D12PipelineState* pso, ID3D12RootSignature* signature, void* rootConstants, uint32_t rootConstantsSize,
-                        D3D_PRIMITIVE_TOPOLOGY topology, size_t& memoryOffset, bool isText)
+        return true;
+    }
+
+    // What recordFrame() draws with (pipelines still compiling are null)
+    void getPipelines(Pipelines& pso, Bindings& bindings)
     {
-        size_t freeSpace = DEBUG_DRAW_VERTEX_BUFFER_SIZE - memoryOffset;
-        if (freeSpace < count)
+        if (pipelines)
         {
-            memoryOffset = 0;
-            freeSpace = DEBUG_DRAW_VERTEX_BUFFER_SIZE;
+            linePSO = pipelines->getPipeline(linePipeline);
+            linePSONoDepth = pipelines->getPipeline(lineNoDepthPipeline);
+            pointPSO = pipelines->getPipeline(pointPipeline);
+            pointPSONoDepth = pipelines->getPipeline(pointNoDepthPipeline);
+            shapePSO = pipelines->getPipeline(shapePipeline);
+            shapePSONoDepth = pipelines->getPipeline(shapeNoDepthPipeline);
+            textPSO = pipelines->getPipeline(textPipeline);
         }
 
-        if (freeSpace > count)
-        {
-            BYTE* uploadData = nullptr;
-            D3D12_RANGE range = { memoryOffset * sizeof(dd::DrawVertex), memoryOffset * sizeof(dd::DrawVertex) + sizeof(dd::DrawVertex) * count };
-            vertexBuffer->Map(0, &range, (void**)&uploadData);
-            memcpy(uploadData, vertices, sizeof(dd::DrawVertex) * count);
-            vertexBuffer->Unmap(0, nullptr);
-
-            memoryOffset += count;
-
-            D3D12_VIEWPORT viewport;
-            viewport.TopLeftX = viewport.TopLeftY = 0;
-            viewport.MinDepth = 0.0f; 
-            viewport.MaxDepth = 1.0f;
-            viewport.Width    = float(width);
-            viewport.Height   = float(height);
-
-            D3D12_RECT scissor;
-            scissor.left = 0;
-            scissor.top = 0;
-            scissor.right = width;
-            scissor.bottom = height;
-
-            commandList->SetPipelineState(pso);
-            commandList->SetGraphicsRootSignature(signature);
-            commandList->RSSetViewports(1, &viewport);
-            commandList->RSSetScissorRects(1, &scissor);
-            commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-            commandList->IASetPrimitiveTopology(topology);
-            
-            commandList->SetGraphicsRoot32BitConstants(0, rootConstantsSize, rootConstants, 0);
-            if (isText)
-            {
-                commandList->SetGraphicsRootDescriptorTable(1, gpuTextHandle);
-            }
-            commandList->DrawInstanced(count, 1, 0, 0);
-        }
+        pso = { linePSO.Get(), linePSONoDepth.Get(), pointPSO.Get(), pointPSONoDepth.Get(), shapePSO.Get(), shapePSONoDepth.Get(), textPSO.Get() };
+
+        bindings.signature = pointLineSignature.Get();
+        bindings.constantsParameter = ModulePipelines::BINDLESS_CONSTANTS;
+        bindings.textSignature = textSignature.Get();
+        bindings.glyphTexture = gpuTextHandle;
+        bindings.glyphRects = glyphRects ? glyphRects->GetGPUVirtualAddress() : 0;
+        bindings.shapeMeshes = shapeMeshView;
     }
 
-    void drawPointList(const dd::DrawVertex * points, int count, bool depthEnabled) override
+    // Before decompressing the font, dd asks for the texture: the first context looks for the bitmap in the disk cache,
+    // the others get the texture the first one created. Text is only counted if it can't be drawn (headless, no descriptor).
+    dd::GlyphTextureHandle findGlyphTexture(int width, int height, uint32_t bitmapKey) override
     {
-        ID3D12PipelineState* pso = depthEnabled ? pointPSO.Get() : pointPSONoDepth.Get();
+        if (cpuTextHandle.ptr == 0 or glyphTexture) return GLYPH_TEXTURE;
+        if (glyphUploadFailed) return nullptr; // (text is off, don't try again from other threads)
 
-        Matrix mvp = mvpMatrix.Transpose();
-        recordCommands(points, count, pointBuffer.Get(), pointBufferView, pso, pointLineSignature.Get(), &mvp, sizeof(Matrix) / sizeof(UINT32), D3D_PRIMITIVE_TOPOLOGY_POINTLIST, pointOffset, false);
-    }
+        char name[32];
+        snprintf(name, sizeof(name), "glyphs_%08x.dds", bitmapKey);
+        glyphCachePath = std::filesystem::path(GLYPH_CACHE_DIRECTORY) / name;
 
-    void drawLineList(const dd::DrawVertex * lines, int count, bool depthEnabled) override
-    {
-        ID3D12PipelineState* pso = depthEnabled ? linePSO.Get() : linePSONoDepth.Get();
+        ScratchImage bitmap;
+        std::error_code error;
+        bool ok = std::filesystem::exists(glyphCachePath, error) and SUCCEEDED(LoadFromDDSFile(glyphCachePath.native().c_str(), DDS_FLAGS_NONE, nullptr, bitmap));
+        ok = ok and bitmap.GetMetadata().width == size_t(width) and bitmap.GetMetadata().height == size_t(height) and bitmap.GetMetadata().format == DXGI_FORMAT_R8_UNORM;
 
-        Matrix mvp = mvpMatrix.Transpose();
-        recordCommands(lines, count, lineBuffer.Get(), lineBufferView, pso, pointLineSignature.Get(), &mvp, sizeof(Matrix) / sizeof(UINT32), D3D_PRIMITIVE_TOPOLOGY_LINELIST, lineOffset, false);
+        return ok and uploadGlyphTexture(bitmap) ? GLYPH_TEXTURE : nullptr;
     }
 
-    void drawGlyphList(const dd::DrawVertex * glyphs, int count, dd::GlyphTextureHandle glyphTex) override
+    // (only for the first context, when the bitmap wasn't in the cache)
+    dd::GlyphTextureHandle createGlyphTexture(int width, int height, const void * pixels) override
     {
-        Vector2 dim = Vector2(float(width), float(height));
+        if (cpuTextHandle.ptr == 0 or glyphTexture) return GLYPH_TEXTURE;
+        if (glyphUploadFailed) return nullptr;
+
+        ScratchImage bitmap;
+        if (FAILED(bitmap.Initialize2D(DXGI_FORMAT_R8_UNORM, size_t(width), size_t(height), 1, 1))) return nullptr;
 
-        if (cpuTextHandle.ptr)
+        const Image* image = bitmap.GetImage(0, 0, 0);
+        for (size_t row = 0; row < size_t(height); ++row)
         {
-            recordCommands(glyphs, count, textBuffer.Get(), textBufferView, textPSO.Get(), textSignature.Get(), &dim, sizeof(Vector2) / sizeof(UINT32), D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, textOffset, true);
+            memcpy(image->pixels + row * image->rowPitch, reinterpret_cast<const uint8_t*>(pixels) + row * width, size_t(width));
         }
+
+        if (not TextureCooker::save(bitmap, glyphCachePath)) LOG("DebugDraw glyph bitmap could not be saved to the cache"); // (it can still be used)
+
+        return uploadGlyphTexture(bitmap) ? GLYPH_TEXTURE : nullptr;
     }
 
-    dd::GlyphTextureHandle createGlyphTexture(int width, int height, const void * pixels) override
+    // Copy queue submission (no mips), nothing waits here: the first record() makes the draw queue wait for it
+    bool uploadGlyphTexture(const ScratchImage& bitmap)
     {
-        // Create and upload texture
+        ModuleResources* resources = app->getModuleResources();
 
-        if (cpuTextHandle.ptr != 0)
+        if (not glyphRects or not resources->createTextureFromMips(bitmap, 0, glyphTexture, L"Debug Draw glyph texture", &glyphUploadTicket))
         {
-            D3D12_RESOURCE_DESC desc = { D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0, UINT64(width), UINT(height), 1, 1, DXGI_FORMAT_R8_UNORM, {1, 0}, D3D12_TEXTURE_LAYOUT_UNKNOWN, D3D12_RESOURCE_FLAG_NONE };
-
-            CD3DX12_HEAP_PROPERTIES defaultProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-            device->CreateCommittedResource(&defaultProperties, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&glyphTexture));
-            glyphTexture->SetName(L"Debug Draw glyph texture");
-            
-            UINT64 requiredSize = 0;
-            UINT64 rowSize = 0;
-
-            D3D12_PLACED_SUBRESOURCE_FOOTPRINT footPrint;
-            device->GetCopyableFootprints(&desc, 0, 1, 0, &footPrint, nullptr, &rowSize, &requiredSize);
-
-            ComPtr<ID3D12Resource> staging;
-            CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(requiredSize);
-            CD3DX12_HEAP_PROPERTIES uploadProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-            device->CreateCommittedResource(&uploadProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&staging));
-
-            BYTE* uploadData = nullptr;
-            staging->Map(0, nullptr, reinterpret_cast<void**>(&uploadData));
-
-            for (size_t i = 0; i < height; ++i)
-            {
-                memcpy(uploadData + i * footPrint.Footprint.RowPitch, reinterpret_cast<const uint8_t*>(pixels) + i * rowSize, rowSize);
-            }
-            staging->Unmap(0, nullptr);
-
-            CD3DX12_TEXTURE_COPY_LOCATION dst = CD3DX12_TEXTURE_COPY_LOCATION(glyphTexture.Get());
-            CD3DX12_TEXTURE_COPY_LOCATION src = CD3DX12_TEXTURE_COPY_LOCATION(staging.Get(), footPrint);
-            CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(glyphTexture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, 
-                                                                                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-
-            commandList->Reset(commandAllocator.Get(), nullptr);
-            commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-            commandList->ResourceBarrier(1, &barrier);
-            commandList->Close();
-        
-            ID3D12CommandList* const gfxCommandList = commandList.Get();
-            uploadQueue->ExecuteCommandLists(1, &gfxCommandList);
-
-            ++uploadFenceValue;
-            uploadQueue->Signal(uploadFence.Get(), uploadFenceValue);
-
-            uploadFence->SetEventOnCompletion(uploadFenceValue, uploadEvent);
-            WaitForSingleObject(uploadEvent, INFINITE);
-
-            // Create descriptors 
-            device->CreateShaderResourceView(glyphTexture.Get(), nullptr, cpuTextHandle);
+            glyphTexture.Reset();
+            glyphUploadFailed = true;
+            return false;
         }
 
-        return dd::GlyphTextureHandle(0xFFFFFF);
-    }
+        device->CreateShaderResourceView(glyphTexture.Get(), nullptr, cpuTextHandle);
 
+        return true;
+    }
 
 private:
 
     Matrix                  mvpMatrix;
-    uint32_t                width = 1;
-    uint32_t                height = 1;
     ComPtr<ID3D12Device4>   device;
-    ComPtr<ID3DBlob>        linePointVS;
-    ComPtr<ID3DBlob>        linePointPS;
-    ComPtr<ID3DBlob>        textVS;
-    ComPtr<ID3DBlob>        textPS;
-
-    ComPtr<ID3D12GraphicsCommandList> commandList;
-    ComPtr<ID3D12CommandAllocator>    commandAllocator;
-    ComPtr<ID3D12CommandQueue>        uploadQueue;
-    ComPtr<ID3D12CommandAllocator>    uploadCommandAllocator;
-    ComPtr<ID3D12Fence1>              uploadFence;
-    HANDLE                            uploadEvent = NULL;
-    uint32_t                          uploadFenceValue = 0;
+    ModuleShaders::ShaderBlob linePointVS; // (shared with the other passes through ModuleShaders)
+    ModuleShaders::ShaderBlob linePointPS;
+    ModuleShaders::ShaderBlob shapeVS;
+    ModuleShaders::ShaderBlob textVS;
+    ModuleShaders::ShaderBlob textPS;
+
     D3D12_CPU_DESCRIPTOR_HANDLE       cpuTextHandle;
     D3D12_GPU_DESCRIPTOR_HANDLE       gpuTextHandle;
 
 private:
 
-    ComPtr<ID3D12Resource>       lineBuffer;
-    D3D12_VERTEX_BUFFER_VIEW     lineBufferView;
-    void*                        linePtr    = nullptr;
-    size_t                       lineOffset = 0;
+    struct ArenaPage
+    {
+        ComPtr<ID3D12Resource>   buffer;
+        BYTE*                    data = nullptr;
+    };
+
+    FrameArena                   vertexArena; // (pages are recycled when the frame that used them is done on the GPU)
+    std::vector<ArenaPage>       arenaPages;
 
-    ComPtr<ID3D12Resource>       pointBuffer;
-    D3D12_VERTEX_BUFFER_VIEW     pointBufferView;
-    void*                        pointPtr    = nullptr;
-    size_t                       pointOffset = 0;
+    DebugDrawPass::FrameStats    frameStats;
 
-    ComPtr<ID3D12Resource>       textBuffer;
-    D3D12_VERTEX_BUFFER_VIEW     textBufferView;
-    void*                        textPtr    = nullptr;
-    size_t                       textOffset = 0;
+    ModulePipelines*             pipelines = nullptr; // (pipelines are compiled in the background, see recordFrame())
+    ModuleShaders*               shaders = nullptr;
+    typedef ModulePipelines::PipelineHandle PipelineHandle;
 
     ComPtr<ID3D12RootSignature>  pointLineSignature;
-    ComPtr<ID3D12PipelineState>  pointPSO;
-    ComPtr<ID3D12PipelineState>  pointPSONoDepth;
-    ComPtr<ID3D12PipelineState>  linePSO;
-    ComPtr<ID3D12PipelineState>  linePSONoDepth;
+    PipelineHandle               pointPipeline = 0;
+    PipelineHandle               pointNoDepthPipeline = 0;
+    PipelineHandle               linePipeline = 0;
+    PipelineHandle               lineNoDepthPipeline = 0;
+
+    PipelineHandle               shapePipeline = 0;
+    PipelineHandle               shapeNoDepthPipeline = 0;
+    ComPtr<ID3D12Resource>       shapeMeshes;
+    D3D12_VERTEX_BUFFER_VIEW     shapeMeshView = {};
 
     ComPtr<ID3D12RootSignature>  textSignature;
-    ComPtr<ID3D12PipelineState>  textPSO;
+    PipelineHandle               textPipeline = 0;
+    ComPtr<ID3D12Resource>       glyphRects;
+
+    ComPtr<ID3D12PipelineState>  linePSO, linePSONoDepth, pointPSO, pointPSONoDepth, shapePSO, shapePSONoDepth, textPSO; // (of the frame)
 
     ComPtr<ID3D12Resource>       glyphTexture;
+    ModuleResources::UploadTicket glyphUploadTicket = 0; // (0 once the draw queue waits for it)
+    bool                         glyphUploadFailed = false;
+    std::filesystem::path        glyphCachePath;
+
+    DebugDrawContexts            contexts; // (one per thread that draws, shut down before the rest is destroyed)
 
 }; // class DDRenderInterfaceCoreD3D12
 
 DDRenderInterfaceCoreD3D12* DebugDrawPass::implementation = 0;
 
-DebugDrawPass::DebugDrawPass(ID3D12Device4* device, ID3D12CommandQueue* uploadQueue, 
-                             D3D12_CPU_DESCRIPTOR_HANDLE cpuText, D3D12_GPU_DESCRIPTOR_HANDLE gpuText)
+DebugDrawPass::DebugDrawPass(ID3D12Device4* device, D3D12_CPU_DESCRIPTOR_HANDLE cpuText, D3D12_GPU_DESCRIPTOR_HANDLE gpuText)
 {    
-    implementation = new DDRenderInterfaceCoreD3D12(device, uploadQueue, cpuText, gpuText);
-    dd::initialize(implementation);
+    headless = device == nullptr;
+    implementation = new DDRenderInterfaceCoreD3D12(device, cpuText, gpuText);
+
+    getContext(); // (the first context records the glyph texture copy: the thread building the pass needs ACCESS_RESOURCES exclusively)
 }
 
 DebugDrawPass::~DebugDrawPass()
 {
-    dd::shutdown();
-
     delete implementation;
     implementation = 0;
 }
 
-void DebugDrawPass::record(ID3D12GraphicsCommandList* commandList, uint32_t width, uint32_t height, const Matrix& view, const Matrix& proj)
+dd::ContextHandle DebugDrawPass::getContext()
+{
+    return implementation ? implementation->contexts.getContext() : nullptr;
+}
+
+void DebugDrawPass::record(ID3D12GraphicsCommandList* commandList, uint32_t width, uint32_t height, const Matrix& view, const Matrix& proj,
+                           UINT64 frameFenceValue, UINT64 completedFenceValue)
 {
-    BEGIN_EVENT(commandList, "DebugDraw Pass");
+    if (commandList) BEGIN_EVENT(commandList, "DebugDraw Pass"); // (null in headless mode)
+
+    implementation->vertexArena.beginFrame(frameFenceValue, completedFenceValue);
+    for (size_t page : implementation->vertexArena.getReleasedPages())
+        implementation->arenaPages[page] = DDRenderInterfaceCoreD3D12::ArenaPage(); // (trimmed: no frame in flight uses it)
+    implementation->frameStats = FrameStats();
+    implementation->mvpMatrix = view * proj;
+
+    // Every context adds its vertices and instances to the same batches, recorded once (one upload)
+    dd::FrameCounters& queues = implementation->frameStats.queues;
+    implementation->frameStats.contexts = implementation->contexts.flush(&implementation->mvpMatrix._11, queues); // (row vectors, as dd expects)
+
+    // The glyph texture copy was submitted to the copy queue when the pass was created: the draw queue waits for it once
+    if (implementation->glyphUploadTicket != 0)
+    {
+        app->getModuleResources()->waitForUploadOnGPU(implementation->glyphUploadTicket);
+        implementation->glyphUploadTicket = 0;
+    }
 
-    implementation->mvpMatrix     = view * proj;
-    implementation->commandList   = commandList;
+    DebugDrawBatcher::Pipelines pso;
+    DebugDrawBatcher::Bindings bindings;
+    implementation->getPipelines(pso, bindings);
 
-    implementation->width         = width;
-    implementation->height        = height;
+    Matrix mvp = implementation->mvpMatrix.Transpose(); // (column vectors, as the shaders take it)
+    implementation->recordFrame(headless ? nullptr : commandList, pso, bindings, &mvp._11, width, height, implementation->frameStats);
 
-    dd::flush();
+    const FrameStats& stats = implementation->frameStats;
 
-    END_EVENT(commandList);
+    if (headless)
+    {
+        uint32_t submitted = queues.lines.submitted + queues.points.submitted + queues.strings.submitted + queues.shapes.submitted;
+        uint32_t dropped = queues.lines.dropped + queues.points.dropped + queues.strings.dropped + queues.shapes.dropped;
+
+        LOG("DebugDraw frame %llu: %u vertices, %u shape instances, %u glyphs, %u draws, %u state changes (%u redundant filtered), %u primitives submitted "
+            "from %u threads (%u lines and %u points culled, %u dropped), %zu KB of queues", frameFenceValue, stats.vertices, stats.instances, stats.glyphs,
+            stats.draws, stats.stateChanges, stats.filteredStateChanges, submitted, stats.contexts,
+            queues.lines.culled, queues.points.culled, dropped, queues.queueBytes / 1024);
+    }
+
+    if (commandList) END_EVENT(commandList);
+}
+
+const DebugDrawPass::FrameStats& DebugDrawPass::getFrameStats()
+{
+    static const FrameStats none;
+    return implementation ? implementation->frameStats : none;
 }
@@ -4,23 +4,41 @@
 #include <wrl.h>
 #include <d3d12.h>
 
+#include "DebugDrawBatcher.h"
+
 class DDRenderInterfaceCoreD3D12;
 
 // DebugDrawPass provides an interface for rendering debug geometry (lines, points, text, etc.) in a DirectX 12 application.
 // It wraps the DebugDraw library's D3D12 implementation, manages its lifetime, and exposes a simple API for recording debug draw commands.
 // Use this class to visualize geometry and diagnostics during development and debugging of graphics applications.
+// Any thread can draw, each one in its own dd context (see getContext()); record() merges all of them in a single upload.
 class DebugDrawPass 
 {
 
 public:
 
-    DebugDrawPass(ID3D12Device4* device, ID3D12CommandQueue* uploadQueue, D3D12_CPU_DESCRIPTOR_HANDLE cpuText = { 0 }, D3D12_GPU_DESCRIPTOR_HANDLE gpuText = { 0 });
+    typedef DebugDrawBatcher::FrameStats FrameStats;
+
+    // A null device is the headless counter mode: no GPU objects, record() only counts (and logs) what the frame would draw
+    // Text needs the descriptor of the glyph texture (it is only counted without it). The font bitmap is cached in
+    // Cache/DebugDraw and copied by ModuleResources without waiting: the first record() makes the draw queue wait for it.
+    DebugDrawPass(ID3D12Device4* device, D3D12_CPU_DESCRIPTOR_HANDLE cpuText = { 0 }, D3D12_GPU_DESCRIPTOR_HANDLE gpuText = { 0 });
 
     ~DebugDrawPass();
 
-    void record(ID3D12GraphicsCommandList* commandList, uint32_t width, uint32_t height, const Matrix& view ,const Matrix& proj);
+    // Fence values: the frame being recorded (its vertices live until it is reached) and the last one completed on the GPU
+    void record(ID3D12GraphicsCommandList* commandList, uint32_t width, uint32_t height, const Matrix& view ,const Matrix& proj,
+                UINT64 frameFenceValue, UINT64 completedFenceValue);
+
+    static const FrameStats& getFrameStats(); // of the last record()
+
+    // dd context of the calling thread (created on its first call, null without a pass). Draws only push to the
+    // thread's own context, no locks; they can't overlap record() though, which reads every context (see DebugDrawContexts).
+    static dd::ContextHandle getContext();
 
 private:
 
     static DDRenderInterfaceCoreD3D12* implementation;
+
+    bool headless = false;
 };
@@ -0,0 +1,57 @@
+#include "Globals.h"
+
+#include "DescriptorAllocator.h"
+
+void DescriptorAllocator::reset(uint32_t newCapacity)
+{
+	pendingFrees.clear();
+
+	capacity = newCapacity;
+	nextFree.assign(capacity, INVALID_INDEX);
+	freeHead = INVALID_INDEX;
+	untouched = allocated = 0;
+}
+
+uint32_t DescriptorAllocator::allocate()
+{
+	uint32_t index;
+
+	if (freeHead != INVALID_INDEX) { // recycled slots first (keeps the used part of the heap compact)
+		index = freeHead;
+		freeHead = nextFree[index];
+	}
+	else if (untouched < capacity) {
+		index = untouched++;
+	}
+	else {
+		return INVALID_INDEX; // full
+	}
+
+	++allocated;
+	return index;
+}
+
+void DescriptorAllocator::free(uint32_t index)
+{
+	if (index >= untouched) return; // (never allocated)
+
+	nextFree[index] = freeHead;
+	freeHead = index;
+	--allocated;
+}
+
+void DescriptorAllocator::deferFree(uint32_t index, uint64_t fenceValue)
+{
+	if (index >= untouched) return;
+
+	pendingFrees.push_back({ fenceValue, index });
+}
+
+void DescriptorAllocator::release(uint64_t completedFenceValue)
+{
+	while (!pendingFrees.empty() and pendingFrees.front().fenceValue <= completedFenceValue)
+	{
+		free(pendingFrees.front().index);
+		pendingFrees.pop_front();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Bookkeeping for the slots of a descriptor heap (indices only, no GPU objects here): O(1) allocate/free through
+// an intrusive free list, and frees that wait until the GPU is done with the frames that could still read them.
+class DescriptorAllocator
+{
+public:
+
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	DescriptorAllocator(uint32_t capacity = 0) { reset(capacity); }
+
+	void reset(uint32_t newCapacity); // everything is free again
+
+	uint32_t allocate();	// returns INVALID_INDEX if the heap is full
+	void free(uint32_t index); // right away (only if nothing in flight uses it)
+
+	void deferFree(uint32_t index, uint64_t fenceValue); // free once fenceValue is reached
+	void release(uint64_t completedFenceValue);		   // frees the deferred indices whose fence value was reached
+
+	inline uint32_t getCapacity() const { return capacity; };
+	inline uint32_t getAllocatedCount() const { return allocated; }; // (deferred frees still count as allocated)
+	inline size_t getPendingFreeCount() const { return pendingFrees.size(); };
+
+private:
+
+	struct PendingFree
+	{
+		uint64_t fenceValue;
+		uint32_t index;
+	};
+
+	std::vector<uint32_t> nextFree;		// free list links (only meaningful for free slots)
+	std::deque<PendingFree> pendingFrees; // in fence order
+
+	uint32_t capacity = 0;
+	uint32_t freeHead = INVALID_INDEX;	// last freed slot
+	uint32_t untouched = 0;				// slots >= this one were never allocated (so reset doesn't have to link them all)
+	uint32_t allocated = 0;
+};
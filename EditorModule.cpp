@@ -1,6 +1,7 @@
 #include "Globals.h"
 #include "Application.h"
 #include "D3D12Module.h"
+#include "DebugDrawPass.h"
 
 #include "EditorModule.h" 
 
@@ -11,9 +12,10 @@ EditorModule::EditorModule(HWND hwnd): hWnd(hwnd)
 
 bool EditorModule::init()
 {
-	ID3D12Device5* device = (app->getD3D12Module())->getDevice();
+	D3D12Module* d3d12Module = app->getD3D12Module();
+	ID3D12Device5* device = d3d12Module->getDevice();
 
-	imGUI = std::unique_ptr<ImGuiPass> (new ImGuiPass(device, hWnd)); // cpu, gpu handles could be indicated, so that we don't use default ones
+	imGUI = std::unique_ptr<ImGuiPass> (new ImGuiPass(device, hWnd, d3d12Module->getFramesInFlight())); // cpu, gpu handles could be indicated, so that we don't use default ones
 
 	return true;
 }
@@ -26,6 +28,11 @@ void EditorModule::preRender()
 {
 	imGUI->startFrame();
 
+	const ImGuiIO& io = ImGui::GetIO();
+	pickClicked = ImGui::IsMouseClicked(ImGuiMouseButton_Left) and not io.WantCaptureMouse and not io.KeyAlt;
+	pickX = io.MousePos.x;
+	pickY = io.MousePos.y;
+
 	// Interface calls (== interface elements) //
 	showExercise4Window();
 }
@@ -37,7 +44,12 @@ void EditorModule::render()
 
 void EditorModule::postRender()
 {
-	imGUI->record((app->getD3D12Module())->getCommandList());
+	// Recorded by a job in its own command list, executed after the scene ones
+	D3D12Module* d3d12Module = app->getD3D12Module();
+
+	d3d12Module->addRecordingJob(app->getJobSystem()->schedule([this, d3d12Module]() {
+		imGUI->record(d3d12Module->beginRecording(D3D12Module::SLOT_EDITOR));
+	}));
 }
 
 void EditorModule::showExercise4Window()
@@ -49,6 +61,26 @@ void EditorModule::showExercise4Window()
 	ImGui::Checkbox("Show grid", &showGrid);
 	ImGui::Checkbox("Show axis", &showAxis);
 	ImGui::Combo("Sampler", &usedSampler, "Linear/Wrap\0Point/Wrap\0Linear/Clamp\0Point/Clamp\0", ModuleSampler::MAX_SAMPLERS);
+	ImGui::Checkbox("GPU driven scene", &gpuDriven);
+	ImGui::Checkbox("Show BVH", &showBVH);
+	if (showBVH) ImGui::SliderInt("BVH levels", &bvhLevels, 1, 16);
+
+	if (ImGui::CollapsingHeader("Debug draw"))
+	{
+		// (counters of the last flush: submitted, culled, dropped over the limits and queued in total)
+		const dd::FrameCounters& counters = DebugDrawPass::getFrameStats().queues; // (all the threads)
+
+		auto row = [](const char* name, const dd::QueueCounters& queue) {
+			ImGui::Text("%-8s %7u %7u %7u %7u", name, queue.submitted, queue.culled, queue.dropped, queue.queued);
+		};
+
+		ImGui::Text("%-8s %7s %7s %7s %7s", "", "submit", "culled", "dropped", "queued");
+		row("Lines", counters.lines);
+		row("Points", counters.points);
+		row("Strings", counters.strings);
+		row("Shapes", counters.shapes);
+		ImGui::Text("Queue memory: %.1f KB", counters.queueBytes / 1024.0);
+	}
 
 	ImGui::End();
 }
@@ -22,6 +22,11 @@ public:
 	inline bool gridEnabled() const { return showGrid; };
 	inline bool objectAxisEnabled() const { return showAxis; };
 	inline int samplerType() const { return usedSampler; };
+	inline bool gpuDrivenEnabled() const { return gpuDriven; }; // scene culled and drawn with ExecuteIndirect
+	inline int bvhDepth() const { return showBVH ? bvhLevels - 1 : -1; }; // deepest BVH level to draw (-1 for none)
+
+	// Left click on the scene this frame (not on a window, and not an Alt + click orbit), in window pixels
+	inline bool pickRequested(float& x, float& y) const { x = pickX; y = pickY; return pickClicked; };
 
 private:
 
@@ -32,6 +37,12 @@ private:
 	bool showGrid = true;
 	bool showAxis = true; // used for current selected object on screen
 	int usedSampler = int (ModuleSampler::LINEAR_WRAP);
+	bool gpuDriven = false;
+	bool showBVH = false;
+	int bvhLevels = 4;
+
+	bool pickClicked = false;
+	float pickX = 0.0f, pickY = 0.0f;
 
 	void showExercise4Window();
 };
@@ -2,7 +2,7 @@
 #include "Application.h"
 #include "D3D12Module.h"
 #include "ModuleResources.h"
-#include <ReadData.h>
+#include "ModulePipelines.h"
 
 #include "Exercise2.h"
 
@@ -14,7 +14,7 @@ bool Exercise2::init()
 	d3d12module = app->getD3D12Module();
 	ID3D12Device5* device = d3d12module->getDevice();
 
-	if (not createVertexSignature(device)) return false;
+	if (not createVertexSignature()) return false;
 
 	// PIPELINE STATE DECLARATION //
 
@@ -23,10 +23,10 @@ bool Exercise2::init()
 	psoDesc.pRootSignature = rootSignature.Get();
 
 	// 2. Add compiled shaders to pipeline description
-	std::vector<uint8_t> dataVS, dataPS;
+	ModuleShaders::ShaderBlob dataVS, dataPS;
 	getCompiledShaders(dataVS, dataPS);
-	psoDesc.VS = { dataVS.data(), dataVS.size() };
-	psoDesc.PS = { dataPS.data(), dataPS.size() };
+	psoDesc.VS = ModuleShaders::getBytecode(dataVS);
+	psoDesc.PS = ModuleShaders::getBytecode(dataPS);
 	
 
 	// 3. Set vertex shader variables layout
@@ -84,6 +84,11 @@ void Exercise2::render()
 	pView.StrideInBytes = sizeof(Vertex); // stride between elements
 	commandList->IASetVertexBuffers(0, 1, &pView); // 0 for device slot to be bound, 1 for number of vertex buffers <- you may want to ask about this to the teacher
 
+	if (uploadTicket != 0) { // vertex data has to be copied before this frame executes
+		app->getModuleResources()->waitForUploadOnGPU(uploadTicket);
+		uploadTicket = 0;
+	}
+
 	// Set viewport + scissor
 	unsigned int windowWidth = d3d12module->getWindowWidth();
 	unsigned int windowHeight = d3d12module->getWindowHeight();
@@ -101,30 +106,24 @@ void Exercise2::render()
 
 inline bool Exercise2::uploadVertexData()
 {
-	ComPtr<ID3D12Resource> uploadBuffer;
+	ModuleResources::UploadAllocation upload;
 	ModuleResources* resModule = app->getModuleResources();
-	if (not resModule->CreateUploadBuffer(vertices, sizeof(vertices), uploadBuffer, L"Vertex upload buffer")) return false;
-	if (not resModule->CreateDefaultBuffer(uploadBuffer, sizeof(vertices), vertexBuffer, L"Vertex default buffer")) return false; // (on the GPU)
+	if (not resModule->CreateUploadBuffer(vertices, sizeof(vertices), upload)) return false;
+	if (not resModule->CreateDefaultBuffer(upload, sizeof(vertices), vertexBuffer, L"Vertex default buffer")) return false; // (on the GPU)
+	uploadTicket = resModule->getLastUploadTicket();
 	return true;
 }
 
-inline bool Exercise2::createVertexSignature(ID3D12Device5* device)
+inline bool Exercise2::createVertexSignature()
 {
-	// Create empty root signature for the vertex shader
-	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
-	rootSignatureDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT); // 3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT is because some pipelines do not use it (required for variable passing)
-
-	ComPtr<ID3DBlob> blob;
-	if (FAILED(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &blob, nullptr))) // desc serialization (for signature creation)
-		return false;
-
-	if (FAILED(device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&rootSignature)))) return false;
-
-	return true;
+	// The shared bindless root signature: no parameters are set, only its input layout flag is used (required for variable passing)
+	rootSignature = app->getModulePipelines()->getBindlessRootSignature();
+	return rootSignature != nullptr;
 }
 
-inline void Exercise2::getCompiledShaders(std::vector<uint8_t>& VS, std::vector<uint8_t>& PS)
+inline void Exercise2::getCompiledShaders(ModuleShaders::ShaderBlob& VS, ModuleShaders::ShaderBlob& PS)
 {
-	VS = DX::ReadData(L"Exercise2VS.cso");
-	PS = DX::ReadData(L"Exercise2PS.cso");
+	ModuleShaders* shaders = app->getModuleShaders(); // (compiled from Shaders/ or read from the shader cache)
+	VS = shaders->getShader("Exercise2VS.hlsl", "vs_6_0");
+	PS = shaders->getShader("Exercise2PS.hlsl", "ps_6_0");
 }
\ No newline at end of file
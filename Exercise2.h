@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Module.h"
+#include "ModuleShaders.h"
 
 class Exercise2 : public Module
 {
@@ -28,13 +29,14 @@ private:
 
 	// Pipeline related objects //
 	ComPtr<ID3D12Resource> vertexBuffer; // will contain vertex data on the GPU (is a default buffer)
+	UINT64 uploadTicket = 0; // copy queue ticket of the vertex data (0 once the draw queue waits for it)
 	ComPtr<ID3D12RootSignature> rootSignature; // param. specification for shaders
 
 	ComPtr<ID3D12PipelineState> pipelineStateObject;
 
 	inline bool uploadVertexData();
-	inline bool createVertexSignature(ID3D12Device5* device);
-	inline void getCompiledShaders(std::vector<uint8_t>& VS, std::vector<uint8_t>& PS);
+	inline bool createVertexSignature();
+	inline void getCompiledShaders(ModuleShaders::ShaderBlob& VS, ModuleShaders::ShaderBlob& PS);
 
 	inline D3D12_VIEWPORT getViewport(unsigned int width, unsigned int height) const
 	{
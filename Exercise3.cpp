@@ -2,7 +2,7 @@
 #include "Application.h"
 #include "D3D12Module.h"
 #include "ModuleResources.h"
-#include <ReadData.h>
+#include "ModulePipelines.h"
 
 #include "Exercise3.h"
 
@@ -14,7 +14,7 @@ bool Exercise3::init()
 	d3d12module = app->getD3D12Module();
 	ID3D12Device5* device = d3d12module->getDevice();
 
-	if (not createVertexSignature(device)) return false;
+	if (not createVertexSignature()) return false;
 
 	// PIPELINE STATE DECLARATION //
 
@@ -23,10 +23,10 @@ bool Exercise3::init()
 	psoDesc.pRootSignature = rootSignature.Get();
 
 	// 2. Add compiled shaders to pipeline description
-	std::vector<uint8_t> dataVS, dataPS;
+	ModuleShaders::ShaderBlob dataVS, dataPS;
 	getCompiledShaders(dataVS, dataPS);
-	psoDesc.VS = { dataVS.data(), dataVS.size() };
-	psoDesc.PS = { dataPS.data(), dataPS.size() };
+	psoDesc.VS = ModuleShaders::getBytecode(dataVS);
+	psoDesc.PS = ModuleShaders::getBytecode(dataPS);
 
 
 	// 3. Set vertex shader variables layout (on the shader, how they are)
@@ -50,12 +50,13 @@ bool Exercise3::init()
 	psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
 
-	// 5. Finally, we create the pipeline object
-	if (FAILED(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineStateObject)))) return false;
+	// 5. Finally, we get the pipeline object (created, or from the pipeline cache)
+	pipelineStateObject = app->getModulePipelines()->getPipeline(psoDesc, L"Exercise3");
+	if (not pipelineStateObject) return false;
 
 	setupMVP();
 
-	debugDraw = std::unique_ptr<DebugDrawPass>(new DebugDrawPass(device, d3d12module->getCommandQueue()) );
+	debugDraw = std::unique_ptr<DebugDrawPass>(new DebugDrawPass(device) );
 
 	return true;
 }
@@ -93,8 +94,13 @@ void Exercise3::render()
 	pView.StrideInBytes = sizeof(Vertex); // stride between elements
 	commandList->IASetVertexBuffers(0, 1, &pView); // 0 for device slot to be bound, 1 for number of vertex buffers <- you may want to ask about this to the teacher
 
+	if (uploadTicket != 0) { // vertex data has to be copied before this frame executes
+		app->getModuleResources()->waitForUploadOnGPU(uploadTicket);
+		uploadTicket = 0;
+	}
+
 	// Pass the mpv, which will be inserted in the root signature
-	commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / sizeof(UINT32), &mvp, 0);
+	commandList->SetGraphicsRoot32BitConstants(ModulePipelines::BINDLESS_CONSTANTS, sizeof(XMMATRIX) / sizeof(UINT32), &mvp, 0);
 
 	// Set viewport + scissor
 	unsigned int windowWidth = d3d12module->getWindowWidth();
@@ -111,44 +117,42 @@ void Exercise3::render()
 
 	// Debug elements (grid, arrows...)
 
-	dd::xzSquareGrid(-10.0f, 10.0f, 0.0f, 1.0f, dd::colors::LightGray); // Grid plane
-	dd::axisTriad(ddConvert(Matrix::Identity), 0.1f, 1.0f); // XYZ axis
+	dd::ContextHandle debugContext = DebugDrawPass::getContext();
+	dd::xzSquareGrid(debugContext, -10.0f, 10.0f, 0.0f, 1.0f, dd::colors::LightGray); // Grid plane
+	dd::axisTriad(debugContext, ddConvert(Matrix::Identity), 0.1f, 1.0f); // XYZ axis
 
-	debugDraw->record(commandList, windowWidth, windowHeight, view, projection);
+	// Debug draw is recorded by a job in its own command list (nothing else touches the dd context until the frame is submitted)
+	d3d12module->addRecordingJob(app->getJobSystem()->schedule([this, windowWidth, windowHeight, view = view, projection = projection,
+		frameFence = d3d12module->getCurrentFenceValue(), completedFence = d3d12module->getCompletedFenceValue()]() {
+		debugDraw->record(d3d12module->beginRecording(D3D12Module::SLOT_DEBUG_DRAW), windowWidth, windowHeight, view, projection, frameFence, completedFence);
+	}));
 }
 
 
 inline bool Exercise3::uploadVertexData()
 {
-	ComPtr<ID3D12Resource> uploadBuffer;
+	ModuleResources::UploadAllocation upload;
 	ModuleResources* resModule = app->getModuleResources();
-	if (not resModule->CreateUploadBuffer(vertices, sizeof(vertices), uploadBuffer, L"Vertex upload buffer")) return false;
-	if (not resModule->CreateDefaultBuffer(uploadBuffer, sizeof(vertices), vertexBuffer, L"Vertex default buffer")) return false; // (on the GPU)
+	if (not resModule->CreateUploadBuffer(vertices, sizeof(vertices), upload)) return false;
+	if (not resModule->CreateDefaultBuffer(upload, sizeof(vertices), vertexBuffer, L"Vertex default buffer")) return false; // (on the GPU)
+	uploadTicket = resModule->getLastUploadTicket();
 	return true;
 }
 
-inline bool Exercise3::createVertexSignature(ID3D12Device5* device)
+inline bool Exercise3::createVertexSignature()
 {
-	// Create root signature with mvp on it for the vertex shader
-	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-	CD3DX12_ROOT_PARAMETER rootParameters[1];
-	rootParameters[0].InitAsConstants(sizeof(Matrix) / sizeof(UINT32), 0); // number of 32 bit elements in a matrix (second param is shader register index)
-	rootSignatureDesc.Init(1, rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-	ComPtr<ID3DBlob> blob;
-	if (FAILED(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &blob, nullptr))) // desc serialization (for signature creation)
-		return false;
+	// The shared bindless root signature: the mvp goes in its root constants (b0, a matrix fits)
+	static_assert(sizeof(Matrix) / sizeof(UINT32) <= ModulePipelines::BINDLESS_CONSTANT_COUNT, "mvp doesn't fit in the root constants");
 
-	if (FAILED(device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&rootSignature))))
-		return false;
-
-	return true;
+	rootSignature = app->getModulePipelines()->getBindlessRootSignature();
+	return rootSignature != nullptr;
 }
 
-inline void Exercise3::getCompiledShaders(std::vector<uint8_t>& VS, std::vector<uint8_t>& PS)
+inline void Exercise3::getCompiledShaders(ModuleShaders::ShaderBlob& VS, ModuleShaders::ShaderBlob& PS)
 {
-	VS = DX::ReadData(L"Exercise3VS.cso");
-	PS = DX::ReadData(L"Exercise2PS.cso");
+	ModuleShaders* shaders = app->getModuleShaders(); // (compiled from Shaders/ or read from the shader cache)
+	VS = shaders->getShader("Exercise3VS.hlsl", "vs_6_0");
+	PS = shaders->getShader("Exercise2PS.hlsl", "ps_6_0");
 }
 
 inline void Exercise3::setupMVP()
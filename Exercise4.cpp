@@ -6,7 +6,11 @@
 #include "ModuleCamera.h"
 #include "ModuleShaderDescriptors.h"
 #include "ModuleSampler.h"
-#include <ReadData.h>
+#include "ModuleScene.h"
+#include "ModuleCulling.h"
+#include "ModulePipelines.h"
+
+#include <algorithm>
 
 #include "Exercise4.h"
 
@@ -15,23 +19,36 @@ bool Exercise4::init()
 {
 	ModuleResources* resModule = app->getModuleResources();
 
+	// Vertices go to the GPU in a copy submission (we only wait for it when drawing)
 	if (not uploadVertexData(resModule)) return false;
 
+	uploadTicket = resModule->getLastUploadTicket();
+
+	// The texture streams in on its own (decoded in a job, it gets a descriptor once its smallest mips are copied)
 	shaderDescModule = app->getModuleShaderDesc();
-	if (not uploadTextureData(resModule)) return false; // this also sets up the descriptor for it
+	texture = resModule->createStreamedTexture(texturePath);
+
+	// glTF scene (its own batch; copy tickets are ordered, so waiting for the scene one also covers the quad)
+	sceneModule = app->getModuleScene();
+	if (sceneModule->load(scenePath)) uploadTicket = sceneModule->getUploadTicket();
+	else LOG("Scene %s could not be loaded", scenePath.string().c_str());
 
 	d3d12Module = app->getD3D12Module();
 	ID3D12Device5* device = d3d12Module->getDevice();
 
-	if (not createVertexSignature(device)) return false;
+	if (not createVertexSignature()) return false;
 
 	if (not createPipelineStateObject(device)) return false;
 
+	indirectScene = std::make_unique<IndirectScenePass>(device);
+	if (not indirectScene->isCreated()) LOG("GPU driven scene not available, it is drawn from the CPU"); // (also until its pipelines compile)
+
 	samplerModule = app->getModuleSampler();
 	editorModule = app->getEditorModule();
 	cameraModule = app->getModuleCamera();
+	cullingModule = app->getModuleCulling();
 
-	debugDraw = std::unique_ptr<DebugDrawPass>(new DebugDrawPass(device, d3d12Module->getCommandQueue()));
+	debugDraw = std::unique_ptr<DebugDrawPass>(new DebugDrawPass(device));
 
 	return true;
 }
@@ -45,7 +62,8 @@ void Exercise4::render()
 	ID3D12GraphicsCommandList4* commandList = d3d12Module->getCommandList();
 
 	// Reset command list so that accepts commands AND is associated to the current allocator and pipeline (NOW WE USE THE PIPELINE)
-	commandList->Reset(d3d12Module->getCommandAllocator(), pipelineStateObject.Get());
+	ComPtr<ID3D12PipelineState> pipelineState = app->getModulePipelines()->getPipeline(pipeline); // (null while it compiles: the quad and the CPU scene are skipped)
+	commandList->Reset(d3d12Module->getCommandAllocator(), pipelineState.Get());
 
 	// Set frame buffer to render target state so we can add commands (CAN'T BE DONE ON A CLOSED COMMAND LIST!)
 	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(d3d12Module->getBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -71,20 +89,28 @@ void Exercise4::render()
 	pView.StrideInBytes = sizeof(Vertex); // stride between elements
 	commandList->IASetVertexBuffers(0, 1, &pView); // 0 for device slot to be bound, 1 for number of vertex buffers <- you may want to ask about this to the teacher
 
+	if (uploadTicket != 0) { // vertex data has to be copied before this frame executes
+		app->getModuleResources()->waitForUploadOnGPU(uploadTicket);
+		uploadTicket = 0;
+	}
+
 	// Pass the mpv, which will be inserted in the root signature
-	commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / sizeof(UINT32), &mvp, 0);
+	commandList->SetGraphicsRoot32BitConstants(ModulePipelines::BINDLESS_CONSTANTS, sizeof(XMMATRIX) / sizeof(UINT32), &mvp, 0);
 
 	// Pass texture and sampler (requires assigning their descriptor heaps)
 	ID3D12DescriptorHeap* descriptorHeaps[] = { shaderDescModule->getHeap(), samplerModule->getHeap() };
 	commandList->SetDescriptorHeaps(2, descriptorHeaps);
 
-	commandList->SetGraphicsRootDescriptorTable(1, shaderDescModule->GetGPUHandle(textureHeapIndex)); // set texture handle
-	commandList->SetGraphicsRootDescriptorTable(2, samplerModule->GetGPUHandle(ModuleSampler::Type(editorModule->samplerType()) )); // set sampler handle (same idea)
-
 	// Set viewport + scissor
 	unsigned int windowWidth = d3d12Module->getWindowWidth();
 	unsigned int windowHeight = d3d12Module->getWindowHeight();
 
+	ModuleResources* resModule = app->getModuleResources();
+	requestTextureDetail(resModule, windowHeight);
+	ModuleShaderDescriptors::Handle textureDescriptor = resModule->getTextureDescriptor(texture); // (the mips we have now)
+
+	commandList->SetGraphicsRootDescriptorTable(ModulePipelines::BINDLESS_SAMPLERS, samplerModule->GetGPUHandle(ModuleSampler::Type(editorModule->samplerType()) )); // set sampler handle
+
 	D3D12_VIEWPORT viewport = getViewport(windowWidth, windowHeight);
 	D3D12_RECT scissor = getScissorRect(windowWidth, windowHeight);
 	commandList->RSSetViewports(1, &viewport);
@@ -92,65 +118,55 @@ void Exercise4::render()
 
 	// Drawing
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	commandList->DrawInstanced(6, 1, 0, 0); // 6 vertices, 1 instance of them, vertices start at 0 and instances at 0
+	if (pipelineState and textureDescriptor.isValid()) { // (not streamed in yet)
+		commandList->SetGraphicsRootDescriptorTable(ModulePipelines::BINDLESS_TEXTURES, shaderDescModule->GetGPUHandle(textureDescriptor)); // set texture handle
+		commandList->DrawInstanced(6, 1, 0, 0); // 6 vertices, 1 instance of them, vertices start at 0 and instances at 0
+	}
+
+	updateSceneBounds();
+	pickInstance(windowWidth, windowHeight);
+	drawScene(commandList, textureDescriptor, pipelineState != nullptr);
 
 	// Debug elements (grid, arrows...)
 
-	if (editorModule->gridEnabled()) dd::xzSquareGrid(-10.0f, 10.0f, 0.0f, 1.0f, dd::colors::LightGray); // Grid plane
-	if (editorModule->objectAxisEnabled()) dd::axisTriad(ddConvert(Matrix::Identity), 0.1f, 1.0f); // XYZ axis
+	dd::ContextHandle debugContext = DebugDrawPass::getContext();
+	if (editorModule->gridEnabled()) dd::xzSquareGrid(debugContext, -10.0f, 10.0f, 0.0f, 1.0f, dd::colors::LightGray); // Grid plane
+	if (editorModule->objectAxisEnabled()) dd::axisTriad(debugContext, ddConvert(Matrix::Identity), 0.1f, 1.0f); // XYZ axis
+	drawSceneBounds(debugContext);
 
-	debugDraw->record(commandList, windowWidth, windowHeight, view, projection);
+	// Debug draw is recorded by a job in its own command list (no thread draws debug geometry until the frame is submitted)
+	d3d12Module->addRecordingJob(app->getJobSystem()->schedule([this, windowWidth, windowHeight, view = view, projection = projection,
+		frameFence = d3d12Module->getCurrentFenceValue(), completedFence = d3d12Module->getCompletedFenceValue()]() {
+		debugDraw->record(d3d12Module->beginRecording(D3D12Module::SLOT_DEBUG_DRAW), windowWidth, windowHeight, view, projection, frameFence, completedFence);
+	}));
 }
 
 
 inline bool Exercise4::uploadVertexData(ModuleResources* resModule)
 {
-	ComPtr<ID3D12Resource> uploadBuffer;
-	if (not resModule->CreateUploadBuffer(vertices, sizeof(vertices), uploadBuffer, L"Vertex upload buffer")) return false;
-	if (not resModule->CreateDefaultBuffer(uploadBuffer, sizeof(vertices), vertexBuffer, L"Vertex default buffer")) return false; // (on the GPU)
+	ModuleResources::UploadAllocation upload;
+	if (not resModule->CreateUploadBuffer(vertices, sizeof(vertices), upload)) return false;
+	if (not resModule->CreateDefaultBuffer(upload, sizeof(vertices), vertexBuffer, L"Vertex default buffer")) return false; // (on the GPU)
 	return true;
 }
 
-inline bool Exercise4::uploadTextureData(ModuleResources* resModule)
+inline void Exercise4::requestTextureDetail(ModuleResources* resModule, unsigned int windowHeight)
 {
-	if (not resModule->createTextureFromFile(texturePath, texture) ) return false;
+	// Projected size of the quad (2 units wide, at the origin): _22 is the vertical cot(fov / 2)
+	float distance = std::max(view.Invert().Translation().Length(), 0.01f);
+	float screenPixels = 2.0f * projection._22 * 0.5f * float(windowHeight) / distance;
 
-	// Now, we assign a descriptor for the texture
-	textureHeapIndex = shaderDescModule->CreateSRV(texture);
-
-	return (textureHeapIndex < SHADER_DESCRIPTORS); // if == , was the mark for heap being full
+	resModule->requestTextureDetail(texture, screenPixels);
 }
 
-inline bool Exercise4::createVertexSignature(ID3D12Device5* device)
+inline bool Exercise4::createVertexSignature()
 {
-	// Create root signature with mvp + texture + sampler object on it for the vertex shader
-
-	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-	CD3DX12_ROOT_PARAMETER rootParameters[3] = {};
-	
-	// mvp //
-	rootParameters[0].InitAsConstants(sizeof(Matrix) / sizeof(UINT32), 0); // number of 32 bit elements in a matrix (second param is shader register index)
-	
-	// texture //
-	CD3DX12_DESCRIPTOR_RANGE tableRange;
-	tableRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0); // 1 range of 1 SRV descriptor, on register 0
-	rootParameters[1].InitAsDescriptorTable(1, &tableRange, D3D12_SHADER_VISIBILITY_PIXEL); // The descriptor table (1 range, specified by tableRange, visible on pixel shader)
-	
-	// sampler //
-	CD3DX12_DESCRIPTOR_RANGE sampRange;
-	sampRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, ModuleSampler::Type::MAX_SAMPLERS, 0);
-	rootParameters[2].InitAsDescriptorTable(1, &sampRange, D3D12_SHADER_VISIBILITY_PIXEL);
-
-	rootSignatureDesc.Init(UINT(std::size(rootParameters)), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT); // 0 for no static samplers (=> nullptr afterwards for sampler list)
-
-	ComPtr<ID3DBlob> blob;
-	if (FAILED(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &blob, nullptr))) // desc serialization (for signature creation)
-		return false;
-
-	if (FAILED(device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&rootSignature)))) // 0 when no multiple GPU operation
-		return false;
+	// The shared bindless root signature: mvp in its root constants (b0), the texture table starts at the texture (t0)
+	// and the sampler table at the selected sampler type (s0)
+	static_assert(sizeof(Matrix) / sizeof(UINT32) <= ModulePipelines::BINDLESS_CONSTANT_COUNT, "mvp doesn't fit in the root constants");
 
-	return true;
+	rootSignature = app->getModulePipelines()->getBindlessRootSignature();
+	return rootSignature != nullptr;
 }
 
 inline bool Exercise4::createPipelineStateObject(ID3D12Device5* device)
@@ -160,10 +176,10 @@ inline bool Exercise4::createPipelineStateObject(ID3D12Device5* device)
 	psoDesc.pRootSignature = rootSignature.Get();
 
 	// 2. Add compiled shaders to pipeline description
-	std::vector<uint8_t> dataVS, dataPS;
+	ModuleShaders::ShaderBlob dataVS, dataPS;
 	getCompiledShaders(dataVS, dataPS);
-	psoDesc.VS = { dataVS.data(), dataVS.size() };
-	psoDesc.PS = { dataPS.data(), dataPS.size() };
+	psoDesc.VS = ModuleShaders::getBytecode(dataVS);
+	psoDesc.PS = ModuleShaders::getBytecode(dataPS);
 
 	// 3. Set vertex shader variables layout (on the shader, how they are)
 	D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
@@ -187,16 +203,17 @@ inline bool Exercise4::createPipelineStateObject(ID3D12Device5* device)
 	psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
 
-	// 5. Finally, we create the pipeline object
-	if (FAILED(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineStateObject)))) return false;
+	// 5. Finally, we request the pipeline object (compiled by a job, or from the pipeline cache)
+	pipeline = app->getModulePipelines()->requestPipeline(psoDesc, L"Exercise4");
 
-	return true;
+	return pipeline != 0;
 }
 
-inline void Exercise4::getCompiledShaders(std::vector<uint8_t>& VS, std::vector<uint8_t>& PS)
+inline void Exercise4::getCompiledShaders(ModuleShaders::ShaderBlob& VS, ModuleShaders::ShaderBlob& PS)
 {
-	VS = DX::ReadData(L"Exercise4VS.cso");
-	PS = DX::ReadData(L"Exercise4PS.cso");
+	ModuleShaders* shaders = app->getModuleShaders(); // (compiled from Shaders/ or read from the shader cache)
+	VS = shaders->getShader("Exercise4VS.hlsl", "vs_6_0");
+	PS = shaders->getShader("Exercise4PS.hlsl", "ps_6_0");
 }
 
 inline void Exercise4::setupMVP()
@@ -207,3 +224,124 @@ inline void Exercise4::setupMVP()
 
 	mvp = (model * view * projection).Transpose(); // transpose because the shader only accepts column-major matrices
 }
+
+inline void Exercise4::updateSceneBounds()
+{
+	const std::vector<ModuleScene::Mesh>& meshes = sceneModule->getMeshes();
+	const std::vector<ModuleScene::Instance>& instances = sceneModule->getInstances();
+
+	instanceBounds.resize(instances.size());
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		const ModuleScene::Mesh& mesh = meshes[instances[i].mesh];
+
+		BoundingBox localBox, worldBox;
+		BoundingBox::CreateFromPoints(localBox, mesh.boundsMin, mesh.boundsMax);
+		localBox.Transform(worldBox, instances[i].world * sceneTransform);
+
+		Vector3 boxMin = Vector3(worldBox.Center) - Vector3(worldBox.Extents), boxMax = Vector3(worldBox.Center) + Vector3(worldBox.Extents);
+		instanceBounds[i] = { { boxMin.x, boxMin.y, boxMin.z }, { boxMax.x, boxMax.y, boxMax.z } };
+	}
+
+	// Refit (a new scene is built right away, a worn out tree is rebuilt by a job and swapped in a later frame)
+	sceneBVH.update(instanceBounds, app->getJobSystem());
+	if (selectedInstance >= int(instanceBounds.size())) selectedInstance = -1;
+}
+
+inline void Exercise4::pickInstance(unsigned int windowWidth, unsigned int windowHeight)
+{
+	float mouseX, mouseY;
+	if (not editorModule->pickRequested(mouseX, mouseY)) return;
+
+	// Ray from the near to the far plane through the mouse
+	Matrix inverseViewProjection = (view * projection).Invert();
+	Vector3 clip = Vector3(2.0f * mouseX / float(windowWidth) - 1.0f, 1.0f - 2.0f * mouseY / float(windowHeight), 0.0f);
+	Vector3 nearPoint = Vector3::Transform(clip, inverseViewProjection);
+	clip.z = 1.0f;
+	Vector3 farPoint = Vector3::Transform(clip, inverseViewProjection);
+
+	Vector3 direction = farPoint - nearPoint;
+	float length = direction.Length();
+	direction /= length;
+
+	uint32_t object;
+	float distance;
+	selectedInstance = sceneBVH.pick(&nearPoint.x, &direction.x, length, object, distance) ? int(object) : -1;
+}
+
+inline void Exercise4::drawSceneBounds(dd::ContextHandle debugContext)
+{
+	int maxDepth = editorModule->bvhDepth();
+	if (maxDepth >= 0)
+	{
+		static const ddVec3 levelColors[] = { { 1.0f, 0.3f, 0.3f }, { 1.0f, 0.7f, 0.2f }, { 0.4f, 1.0f, 0.4f }, { 0.3f, 0.7f, 1.0f } };
+		sceneBVH.visit(maxDepth, [debugContext, maxDepth](const SceneBVH::Node& node, int depth) {
+			if (depth == maxDepth or node.count > 0) dd::aabb(debugContext, node.bounds.min, node.bounds.max, levelColors[depth % std::size(levelColors)]); // (deepest level drawn)
+		});
+	}
+
+	if (selectedInstance >= 0)
+		dd::aabb(debugContext, instanceBounds[selectedInstance].min, instanceBounds[selectedInstance].max, dd::colors::Yellow);
+}
+
+inline void Exercise4::drawScene(ID3D12GraphicsCommandList4* commandList, const ModuleShaderDescriptors::Handle& fallbackTexture, bool pipelineReady)
+{
+	if (editorModule->gpuDrivenEnabled() and indirectScene->isReady())
+	{
+		drawSceneIndirect(commandList, fallbackTexture);
+		return;
+	}
+
+	if (not pipelineReady) return;
+
+	// Same pipeline as the quad (scene vertices start with position + uv, only the stride changes)
+	const std::vector<ModuleScene::Mesh>& meshes = sceneModule->getMeshes();
+	const std::vector<ModuleScene::Material>& materials = sceneModule->getMaterials();
+	const std::vector<ModuleScene::Instance>& instances = sceneModule->getInstances();
+
+	// Only the instances whose world AABB touches the camera frustum
+	visibleInstances.clear();
+	sceneBVH.cull(cullingModule->getCuller(), visibleInstances);
+
+	for (uint32_t index : visibleInstances)
+	{
+		const ModuleScene::Instance& instance = instances[index];
+		const ModuleScene::Mesh& mesh = meshes[instance.mesh];
+
+		Matrix instanceMVP = (instance.world * sceneTransform * view * projection).Transpose();
+		commandList->SetGraphicsRoot32BitConstants(ModulePipelines::BINDLESS_CONSTANTS, sizeof(XMMATRIX) / sizeof(UINT32), &instanceMVP, 0);
+
+		// Base color texture (the quad one if the material has none)
+		bool hasTexture = mesh.material >= 0 and materials[mesh.material].baseColorDescriptor.isValid();
+		if (not hasTexture and not fallbackTexture.isValid()) continue;
+		commandList->SetGraphicsRootDescriptorTable(ModulePipelines::BINDLESS_TEXTURES, shaderDescModule->GetGPUHandle(hasTexture ? materials[mesh.material].baseColorDescriptor : fallbackTexture));
+
+		commandList->IASetVertexBuffers(0, 1, &mesh.vertexBufferView);
+		commandList->IASetIndexBuffer(&mesh.indexBufferView);
+		commandList->DrawIndexedInstanced(mesh.indexCount, 1, 0, 0, 0);
+	}
+}
+
+inline void Exercise4::drawSceneIndirect(ID3D12GraphicsCommandList4* commandList, const ModuleShaderDescriptors::Handle& fallbackTexture)
+{
+	const std::vector<ModuleScene::Mesh>& meshes = sceneModule->getMeshes();
+	const std::vector<ModuleScene::Material>& materials = sceneModule->getMaterials();
+	const std::vector<ModuleScene::Instance>& instances = sceneModule->getInstances();
+
+	// Every instance goes to the GPU (the compute shader culls them), with the same textures drawScene() would use
+	indirectDraws.clear();
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		const ModuleScene::Mesh& mesh = meshes[instances[i].mesh];
+
+		bool hasTexture = mesh.material >= 0 and materials[mesh.material].baseColorDescriptor.isValid();
+		if (not hasTexture and not fallbackTexture.isValid()) continue;
+		const ModuleShaderDescriptors::Handle& texture = hasTexture ? materials[mesh.material].baseColorDescriptor : fallbackTexture;
+
+		Matrix world = instances[i].world * sceneTransform;
+		indirectDraws.add(mesh.vertexBufferView, mesh.indexBufferView, mesh.indexCount, &world._11, instanceBounds[i].min, instanceBounds[i].max, texture.index);
+	}
+
+	indirectScene->record(commandList, indirectDraws, cullingModule->getCuller(), view * projection, shaderDescModule->GetGPUHandle(0u),
+						  samplerModule->GetGPUHandle(ModuleSampler::Type(editorModule->samplerType())), d3d12Module->getCurrentFenceValue(), d3d12Module->getCompletedFenceValue());
+}
@@ -1,8 +1,16 @@
 #pragma once
 
 #include "Module.h"
+#include "ModuleShaderDescriptors.h"
+#include "ModuleResources.h"
 
 #include "DebugDrawPass.h"
+#include "SceneBVH.h"
+#include "IndirectScenePass.h"
+#include "ModulePipelines.h"
+#include "ModuleShaders.h"
+
+class ModuleCulling;
 
 class Exercise4 : public Module
 {
@@ -36,32 +44,51 @@ private:
 	//std::filesystem::path texturePath = L"Assets/Textures/dog.dds";
 	std::filesystem::path texturePath = L"Assets/Textures/cracked_ground.jpg";
 
+	std::filesystem::path scenePath = L"3rdParty/tinygltf/models/Cube/Cube.gltf";
+	Matrix sceneTransform = Matrix::CreateTranslation(4.0f, 1.0f, 0.0f); // (next to the quad)
+
 	std::unique_ptr <DebugDrawPass> debugDraw; // for grid, object arrows
 
+	std::vector<SceneBVH::Bounds> instanceBounds; // world AABBs of the scene instances (updated every frame)
+	SceneBVH sceneBVH;							   // (over instanceBounds, refitted every frame)
+	std::vector<uint32_t> visibleInstances;
+	int selectedInstance = -1;					   // (picked with the mouse)
+
+	std::unique_ptr<IndirectScenePass> indirectScene; // GPU driven path (culled by a compute shader, drawn with ExecuteIndirect)
+	IndirectDrawBuilder indirectDraws;
+
 	// For easy access
 	D3D12Module* d3d12Module;
 	EditorModule* editorModule;
 	ModuleCamera* cameraModule;
 	ModuleShaderDescriptors* shaderDescModule; // YOU MAY WANT TO SET THE SIZE FOR THIS OPTIMALLY
 	ModuleSampler* samplerModule;
+	ModuleScene* sceneModule;
+	ModuleCulling* cullingModule;
 
 	// Pipeline related objects //
 	ComPtr<ID3D12Resource> vertexBuffer; // will contain vertex data on the GPU (is a default buffer)
 	ComPtr<ID3D12RootSignature> rootSignature; // param. specification for shaders (to indicate passed paramateres)
 
-	ComPtr<ID3D12Resource> texture; // will also be on the GPU
-	unsigned int textureHeapIndex;
+	ModuleResources::StreamedTexture texture; // streamed: only the mips needed at the current distance are on the GPU
+
+	UINT64 uploadTicket = 0; // copy queue ticket of the last batch (vertex + texture, then scene) (0 once the draw queue waits for it)
 
-	ComPtr<ID3D12PipelineState> pipelineStateObject;
+	ModulePipelines::PipelineHandle pipeline = 0; // (compiled in the background)
 
 	inline bool uploadVertexData(ModuleResources* resModule);
-	inline bool uploadTextureData(ModuleResources* resModule);
-	inline bool createVertexSignature(ID3D12Device5* device);
+	inline void requestTextureDetail(ModuleResources* resModule, unsigned int windowHeight);
+	inline bool createVertexSignature();
 	inline bool createPipelineStateObject(ID3D12Device5* device);
 
-	inline void getCompiledShaders(std::vector<uint8_t>& VS, std::vector<uint8_t>& PS);
+	inline void getCompiledShaders(ModuleShaders::ShaderBlob& VS, ModuleShaders::ShaderBlob& PS);
 
 	inline void setupMVP();
+	inline void updateSceneBounds();
+	inline void pickInstance(unsigned int windowWidth, unsigned int windowHeight);
+	inline void drawSceneBounds(dd::ContextHandle debugContext);
+	inline void drawScene(ID3D12GraphicsCommandList4* commandList, const ModuleShaderDescriptors::Handle& fallbackTexture, bool pipelineReady); // (CPU path skipped without its pipeline)
+	inline void drawSceneIndirect(ID3D12GraphicsCommandList4* commandList, const ModuleShaderDescriptors::Handle& fallbackTexture);
 
 	inline D3D12_VIEWPORT getViewport(unsigned int width, unsigned int height) const
 	{
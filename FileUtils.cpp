@@ -0,0 +1,46 @@
+#include "Globals.h"
+
+#include "FileUtils.h"
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace FileUtils
+{
+	bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (not file.is_open()) return false;
+
+		data.resize(size_t(file.tellg()));
+		file.seekg(0);
+		return bool(file.read(reinterpret_cast<char*>(data.data()), data.size()));
+	}
+
+	bool writeFile(const std::filesystem::path& path, const std::vector<uint8_t>& data)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(path.parent_path(), error);
+
+		std::filesystem::path temporary = path;
+		temporary += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+		bool ok;
+		{
+			std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+			ok = bool(out.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size())));
+		}
+
+		if (ok)
+		{
+			std::filesystem::rename(temporary, path, error);
+			ok = not error;
+		}
+
+		if (not ok) std::filesystem::remove(temporary, error);
+
+		return ok;
+	}
+}
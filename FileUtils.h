@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Whole file reads and writes for the caches (cooked scenes and textures, shaders, pipeline libraries...)
+namespace FileUtils
+{
+	bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& data);
+
+	// Creates the directories of the path, and writes through a temporary file (per thread: two jobs may be writing the same
+	// file), so a crash never leaves a half written file behind
+	bool writeFile(const std::filesystem::path& path, const std::vector<uint8_t>& data);
+}
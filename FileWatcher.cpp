@@ -0,0 +1,255 @@
+#include "Globals.h"
+
+#include "FileWatcher.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(const std::filesystem::path& directory, Mode mode, unsigned int pollIntervalMs, unsigned int settleMs) :
+	directory(std::filesystem::absolute(directory).lexically_normal()), pollInterval(std::chrono::milliseconds(pollIntervalMs)), settle(std::chrono::milliseconds(settleMs))
+{
+	native = mode == MODE_NATIVE and openNative();
+	scan(false); // (what is there now: polling compares with it, native watchers rescan after losing events)
+}
+
+FileWatcher::~FileWatcher()
+{
+	closeNative();
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll()
+{
+	if (native) {
+		if (not readNative()) scan(true);
+	}
+	else if (Clock::now() - lastScan >= pollInterval) scan(true);
+
+	// Settled files only (another write restarts the wait), not the ones that came and went (temporary files of a save)
+	Clock::time_point now = Clock::now();
+	std::vector<std::filesystem::path> settled;
+	std::error_code error;
+
+	for (auto it = changed.begin(); it != changed.end();)
+	{
+		if (now - it->second.time >= settle)
+		{
+			if (it->second.existed or std::filesystem::exists(it->first, error)) settled.push_back(it->first);
+			it = changed.erase(it);
+		}
+		else ++it;
+	}
+
+	std::sort(settled.begin(), settled.end());
+	return settled;
+}
+
+void FileWatcher::scan(bool report)
+{
+	std::unordered_map<std::string, FileState> scanned;
+	std::error_code error;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		if (not entry.is_regular_file(error)) continue;
+
+		FileState state;
+		state.writeTime = entry.last_write_time(error);
+		state.size = entry.file_size(error);
+
+		std::string path = entry.path().lexically_normal().string();
+		auto it = files.find(path);
+		if (report and (it == files.end() or it->second.writeTime != state.writeTime or it->second.size != state.size)) add(path);
+
+		scanned.emplace(std::move(path), state);
+	}
+
+	// (removed ones are changes too: whatever includes them must fail now)
+	if (report)
+		for (const auto& file : files)
+			if (scanned.count(file.first) == 0) add(file.first);
+
+	files = std::move(scanned);
+	lastScan = Clock::now();
+}
+
+void FileWatcher::add(const std::filesystem::path& path)
+{
+	std::string key = path.lexically_normal().string();
+
+	auto [it, first] = changed.try_emplace(key);
+	if (first) it->second.existed = files.count(key) != 0;
+	it->second.time = Clock::now();
+}
+
+// (a file a native event creates has no state: a rescan reports it again)
+void FileWatcher::addNative(const std::filesystem::path& path, bool removed)
+{
+	add(path);
+
+	std::string key = path.lexically_normal().string();
+	if (removed) files.erase(key);
+	else files.try_emplace(key);
+}
+
+#ifdef _WIN32
+
+bool FileWatcher::openNative()
+{
+	directoryHandle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+								  FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directoryHandle == INVALID_HANDLE_VALUE) return false;
+
+	overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	buffer.resize(16 * 1024);
+
+	if (overlapped.hEvent and readChanges()) return true;
+
+	closeNative();
+	return false;
+}
+
+void FileWatcher::closeNative()
+{
+	if (directoryHandle != INVALID_HANDLE_VALUE)
+	{
+		// The read in flight writes to the buffer: it must be over before the buffer goes
+		if (not HasOverlappedIoCompleted(&overlapped))
+		{
+			DWORD bytes = 0;
+			CancelIoEx(directoryHandle, &overlapped);
+			GetOverlappedResult(directoryHandle, &overlapped, &bytes, TRUE);
+		}
+
+		CloseHandle(directoryHandle);
+		directoryHandle = INVALID_HANDLE_VALUE;
+	}
+
+	if (overlapped.hEvent) CloseHandle(overlapped.hEvent);
+	overlapped = {};
+}
+
+bool FileWatcher::readChanges()
+{
+	return ReadDirectoryChangesW(directoryHandle, buffer.data(), DWORD(buffer.size() * sizeof(DWORD)), TRUE,
+								 FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped, nullptr) != FALSE;
+}
+
+bool FileWatcher::readNative()
+{
+	DWORD bytes = 0;
+	if (not GetOverlappedResult(directoryHandle, &overlapped, &bytes, FALSE) and GetLastError() == ERROR_IO_INCOMPLETE) return true; // (nothing yet)
+
+	// No bytes: the buffer overflowed, the changes are lost
+	bool complete = bytes > 0;
+	if (complete)
+	{
+		const BYTE* entry = reinterpret_cast<const BYTE*>(buffer.data());
+		for (;;)
+		{
+			const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+			addNative(directory / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)),
+					  info->Action == FILE_ACTION_REMOVED or info->Action == FILE_ACTION_RENAMED_OLD_NAME);
+
+			if (info->NextEntryOffset == 0) break;
+			entry += info->NextEntryOffset;
+		}
+	}
+
+	if (not readChanges())
+	{
+		LOG("Watching %s failed, polling it from now on", directory.string().c_str());
+		closeNative();
+		native = false;
+	}
+
+	return complete;
+}
+
+#elif defined(__linux__)
+
+bool FileWatcher::openNative()
+{
+	notifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (notifyDescriptor < 0) return false;
+
+	addWatches(directory);
+	if (not watches.empty()) return true;
+
+	closeNative();
+	return false;
+}
+
+void FileWatcher::closeNative()
+{
+	if (notifyDescriptor >= 0) close(notifyDescriptor); // (its watches go with it)
+
+	notifyDescriptor = -1;
+	watches.clear();
+}
+
+// A directory moved within the tree keeps its watch (same inode, same descriptor): adding it again updates its path
+void FileWatcher::addWatches(const std::filesystem::path& root)
+{
+	std::error_code error;
+	std::vector<std::filesystem::path> directories = { root };
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(root, error))
+		if (entry.is_directory(error)) directories.push_back(entry.path());
+
+	const uint32_t EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR;
+	for (const std::filesystem::path& path : directories)
+	{
+		int watch = inotify_add_watch(notifyDescriptor, path.c_str(), EVENTS);
+		if (watch >= 0) watches[watch] = path.lexically_normal();
+	}
+}
+
+bool FileWatcher::readNative()
+{
+	alignas(inotify_event) char events[16 * 1024];
+	bool complete = true;
+
+	for (;;)
+	{
+		ssize_t length = read(notifyDescriptor, events, sizeof(events));
+		if (length <= 0) break; // (EAGAIN: nothing else)
+
+		for (const char* next = events; next < events + length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(next);
+			next += sizeof(inotify_event) + event->len;
+
+			// The kernel queue overflowed: the changes are lost
+			if (event->mask & IN_Q_OVERFLOW) complete = false;
+			if (event->mask & IN_IGNORED) watches.erase(event->wd);
+
+			auto it = watches.find(event->wd);
+			if (it == watches.end() or event->len == 0) continue;
+
+			std::filesystem::path path = it->second / event->name;
+
+			if (event->mask & IN_ISDIR)
+			{
+				// New directories get watches, and their files (written before that) come from a scan. Moved away ones
+				// leave files that aren't there anymore.
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) addWatches(path);
+				if (event->mask & (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM)) complete = false;
+			}
+			else addNative(path, (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0);
+		}
+	}
+
+	return complete;
+}
+
+#else
+
+bool FileWatcher::openNative() { return false; }
+void FileWatcher::closeNative() {}
+bool FileWatcher::readNative() { return true; }
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+// Changes to the files of a directory tree (no GPU objects here): native notifications (ReadDirectoryChangesW on windows,
+// inotify on linux) or, where those can't be set up (and on other platforms), polling of the write times and sizes. poll()
+// reports each changed file once it has been quiet for a moment (editors save in several writes), as an absolute path. Not
+// thread safe (one thread polls, e.g. once a frame).
+class FileWatcher
+{
+public:
+
+	enum Mode
+	{
+		MODE_NATIVE, // (polling if it can't be set up)
+		MODE_POLLING
+	};
+
+	FileWatcher(const std::filesystem::path& directory, Mode mode = MODE_NATIVE, unsigned int pollIntervalMs = 500, unsigned int settleMs = 100);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	inline bool isNative() const { return native; };
+	inline const std::filesystem::path& getDirectory() const { return directory; };
+
+	std::vector<std::filesystem::path> poll(); // (never blocks)
+
+private:
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct FileState
+	{
+		std::filesystem::file_time_type writeTime;
+		uintmax_t size = 0;
+	};
+
+	std::filesystem::path directory;
+	bool native = false;
+	Clock::duration pollInterval;
+	Clock::duration settle;
+
+	struct Change
+	{
+		Clock::time_point time; // last change seen (reported once settled)
+		bool existed = false;	// before the first one (if not, and it's gone when settled, it came and went: not reported)
+	};
+
+	std::unordered_map<std::string, Change> changed;  // by path
+	std::unordered_map<std::string, FileState> files; // the last scan (native events keep the paths current)
+	Clock::time_point lastScan;
+
+#ifdef _WIN32
+	HANDLE directoryHandle = INVALID_HANDLE_VALUE;
+	OVERLAPPED overlapped = {};
+	std::vector<DWORD> buffer; // (DWORD aligned, as ReadDirectoryChangesW wants it)
+
+	bool readChanges(); // (queues the next read)
+#elif defined(__linux__)
+	int notifyDescriptor = -1;
+	std::unordered_map<int, std::filesystem::path> watches; // watch descriptor -> directory
+
+	void addWatches(const std::filesystem::path& root); // (inotify isn't recursive: every directory gets one)
+#endif
+
+	bool openNative();
+	void closeNative();
+	bool readNative(); // false when events were lost (everything is scanned again)
+
+	void scan(bool report);
+	void add(const std::filesystem::path& path);
+	void addNative(const std::filesystem::path& path, bool removed);
+};
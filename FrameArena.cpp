@@ -0,0 +1,147 @@
+#include "Globals.h"
+
+#include "FrameArena.h"
+
+#include <algorithm>
+
+void FrameArena::reset(size_t newPageSize)
+{
+	pages.clear();
+	freePages.clear();
+	usedPages.clear();
+	releasedPages.clear();
+	trimmedPages.clear();
+
+	basePageSize = pageSize = newPageSize;
+	current = INVALID_PAGE;
+	currentOffset = 0;
+	framePages = frameSize = 0;
+
+	framesWithoutSpill = 0;
+	peakFrameSize = 0;
+	minFreePages = SIZE_MAX;
+}
+
+void FrameArena::beginFrame(uint64_t fenceValue, uint64_t completedFenceValue)
+{
+	retireCurrent();
+	trimmedPages.clear();
+
+	// Trim window: a spill starts it again (with the pages that frame made). Free pages are counted before the ones of the
+	// frames just completed come back: the fewest seen is how many no frame needed
+	if (framePages > 1)
+	{
+		framesWithoutSpill = 0;
+		peakFrameSize = 0;
+		minFreePages = SIZE_MAX;
+	}
+	else if (framePages == 1)
+	{
+		++framesWithoutSpill;
+		peakFrameSize = std::max(peakFrameSize, frameSize);
+		minFreePages = std::min(minFreePages, freePages.size());
+	}
+
+	frameFenceValue = fenceValue;
+	framePages = frameSize = 0;
+
+	while (not usedPages.empty() and usedPages.front().fenceValue <= completedFenceValue)
+	{
+		freePages.push_back(usedPages.front().page);
+		usedPages.pop_front();
+	}
+
+	if (framesWithoutSpill >= TRIM_FRAMES) trim();
+}
+
+FrameArena::Allocation FrameArena::allocate(size_t size, size_t alignment)
+{
+	Allocation allocation;
+
+	if (current != INVALID_PAGE)
+	{
+		size_t offset = (currentOffset + alignment - 1) & ~(alignment - 1);
+
+		if (offset + size <= pages[current])
+		{
+			frameSize += offset + size - currentOffset;
+			currentOffset = offset + size;
+
+			allocation.page = current;
+			allocation.offset = offset;
+			return allocation;
+		}
+
+		retireCurrent(); // (the rest of the page is wasted this frame)
+	}
+
+	// A free page where it fits (pages start aligned, the owner creates them like that)
+	auto freePage = std::find_if(freePages.begin(), freePages.end(), [this, size](size_t page) { return pages[page] >= size; });
+
+	if (freePage != freePages.end())
+	{
+		current = *freePage;
+		freePages.erase(freePage);
+	}
+	else
+	{
+		// New page (twice the size if this frame already filled one), in the index of a released one if there is any
+		if (framePages > 0) pageSize *= 2;
+
+		if (releasedPages.empty())
+		{
+			current = pages.size();
+			pages.push_back(0);
+		}
+		else
+		{
+			current = releasedPages.back();
+			releasedPages.pop_back();
+		}
+
+		pages[current] = std::max(size, pageSize);
+	}
+
+	++framePages;
+	frameSize += size;
+	currentOffset = size;
+
+	allocation.page = current;
+	allocation.offset = 0;
+	return allocation;
+}
+
+void FrameArena::retireCurrent()
+{
+	if (current == INVALID_PAGE) return;
+
+	usedPages.push_back({ current, frameFenceValue });
+	current = INVALID_PAGE;
+	currentOffset = 0;
+}
+
+void FrameArena::trim()
+{
+	// Back to the smallest power of two steps of the page size where the peak frame of the window still fits
+	while (pageSize / 2 >= std::max(basePageSize, peakFrameSize)) pageSize /= 2;
+
+	// Free pages of another size go (frames will make new ones of the page size), and as many as no frame needed
+	size_t unneeded = minFreePages == SIZE_MAX ? 0 : minFreePages;
+
+	for (size_t i = freePages.size(); i-- > 0;)
+	{
+		size_t page = freePages[i];
+		if (pages[page] == pageSize and unneeded == 0) continue;
+
+		if (unneeded > 0) --unneeded;
+
+		pages[page] = 0;
+		releasedPages.push_back(page);
+		trimmedPages.push_back(page);
+		freePages.erase(freePages.begin() + i);
+	}
+
+	framesWithoutSpill = 0;
+	peakFrameSize = 0;
+	minFreePages = SIZE_MAX;
+}
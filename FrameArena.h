@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Bookkeeping for per frame allocations in pages of memory (page + offset only, no GPU objects here): allocations are
+// linear inside the current page, and the pages used by a frame go back to the free ones once that frame's fence value
+// is reached. Pages are created on demand (the owner creates the memory of a page the first time it shows up in an
+// allocation) and grow when a frame doesn't fit in one, so it settles at about one page per frame in flight. After
+// TRIM_FRAMES frames without a spill the page size shrinks back towards the peak frame size (never under the reset()
+// one) and the free pages that weren't needed (or have another size) are released: the owner frees their memory (see
+// getReleasedPages()) and their indices are given again to pages created later.
+class FrameArena
+{
+public:
+
+	static const size_t INVALID_PAGE = SIZE_MAX;
+	static const uint32_t TRIM_FRAMES = 256;
+
+	struct Allocation
+	{
+		size_t page = INVALID_PAGE;
+		size_t offset = 0;
+
+		inline bool isValid() const { return page != INVALID_PAGE; };
+	};
+
+	FrameArena(size_t pageSize = 0) : basePageSize(pageSize), pageSize(pageSize) {}
+
+	void reset(size_t newPageSize); // forgets all the pages (the owner frees their memory)
+
+	void beginFrame(uint64_t fenceValue, uint64_t completedFenceValue); // what is allocated from now on is in use until fenceValue is reached
+	Allocation allocate(size_t size, size_t alignment);
+
+	inline size_t getPageCount() const { return pages.size() - releasedPages.size(); };
+	inline size_t getPageSize(size_t page) const { return pages[page]; }; // (0 once released)
+	inline size_t getFreePageCount() const { return freePages.size(); };
+	inline size_t getFrameSize() const { return frameSize; }; // bytes allocated since beginFrame (alignment padding included)
+	inline size_t getNewPageSize() const { return pageSize; };
+
+	// Pages released by the last beginFrame (no frame in flight uses them): the owner frees their memory. A later allocation
+	// in one of these indices is a new page again
+	inline const std::vector<size_t>& getReleasedPages() const { return trimmedPages; };
+
+private:
+
+	struct UsedPage
+	{
+		size_t page;
+		uint64_t fenceValue;
+	};
+
+	std::vector<size_t> pages;	   // page sizes
+	std::vector<size_t> freePages;
+	std::deque<UsedPage> usedPages; // (in fence value order)
+	std::vector<size_t> releasedPages; // (indices to reuse)
+	std::vector<size_t> trimmedPages;  // (released by the last beginFrame)
+
+	size_t basePageSize = 0;
+	size_t pageSize = 0;		   // for new pages
+	size_t current = INVALID_PAGE; // page being filled
+	size_t currentOffset = 0;
+
+	uint64_t frameFenceValue = 0;
+	size_t framePages = 0;
+	size_t frameSize = 0;
+
+	uint32_t framesWithoutSpill = 0; // trim window: frames that fit in one page,
+	size_t peakFrameSize = 0;		 // the biggest of them
+	size_t minFreePages = SIZE_MAX;	 // and the free pages none of them needed
+
+	void retireCurrent();
+	void trim();
+};
@@ -0,0 +1,302 @@
+#include "Globals.h"
+
+#include "FrustumCuller.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX_FUNCTION
+#else
+#define AVX_FUNCTION __attribute__((target("avx"))) // (MSVC takes AVX intrinsics anywhere, gcc/clang only in AVX functions)
+#endif
+
+namespace
+{
+	// Lanes set in a 4 bit visibility mask, packed to the front (the rest don't matter, they are overwritten or past the end)
+	alignas(16) const uint32_t PACKED_LANES[16][4] = {
+		{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 1, 0, 0 },
+		{ 2, 0, 0, 0 }, { 0, 2, 0, 0 }, { 1, 2, 0, 0 }, { 0, 1, 2, 0 },
+		{ 3, 0, 0, 0 }, { 0, 3, 0, 0 }, { 1, 3, 0, 0 }, { 0, 1, 3, 0 },
+		{ 2, 3, 0, 0 }, { 0, 2, 3, 0 }, { 1, 2, 3, 0 }, { 0, 1, 2, 3 }
+	};
+
+	const uint32_t LANE_COUNTS[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+	// Always stores 4 indices: the caller makes sure they fit (the count so far is never ahead of the first index)
+	inline size_t packIndices(uint32_t* visible, uint32_t first, int mask)
+	{
+		__m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i*>(PACKED_LANES[mask]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(visible), _mm_add_epi32(_mm_set1_epi32(int(first)), lanes));
+
+		return LANE_COUNTS[mask];
+	}
+}
+
+void FrustumCuller::Spheres::add(float centerX, float centerY, float centerZ, float sphereRadius)
+{
+	x.push_back(centerX);
+	y.push_back(centerY);
+	z.push_back(centerZ);
+	radius.push_back(sphereRadius);
+}
+
+void FrustumCuller::Spheres::clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	radius.clear();
+}
+
+void FrustumCuller::Boxes::add(const float boxMin[3], const float boxMax[3])
+{
+	centerX.push_back((boxMin[0] + boxMax[0]) * 0.5f);
+	centerY.push_back((boxMin[1] + boxMax[1]) * 0.5f);
+	centerZ.push_back((boxMin[2] + boxMax[2]) * 0.5f);
+	extentX.push_back((boxMax[0] - boxMin[0]) * 0.5f);
+	extentY.push_back((boxMax[1] - boxMin[1]) * 0.5f);
+	extentZ.push_back((boxMax[2] - boxMin[2]) * 0.5f);
+}
+
+void FrustumCuller::Boxes::clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+void FrustumCuller::setFrustum(const Plane newPlanes[PLANE_COUNT], const float newOrigin[3])
+{
+	for (int i = 0; i < PLANE_COUNT; ++i) planes[i] = newPlanes[i];
+	for (int i = 0; i < 3; ++i) origin[i] = newOrigin[i];
+}
+
+size_t FrustumCuller::cull(const Spheres& spheres, uint32_t* visible) const
+{
+	return useAVX ? cullSpheresAVX(spheres, visible) : cullSpheresSSE(spheres, visible);
+}
+
+size_t FrustumCuller::cull(const Boxes& boxes, uint32_t* visible) const
+{
+	return useAVX ? cullBoxesAVX(boxes, visible) : cullBoxesSSE(boxes, visible);
+}
+
+void FrustumCuller::extractPlanes(const float m[16], Plane planes[PLANE_COUNT])
+{
+	// Columns of the matrix (clip = row vector * matrix): a point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w
+	auto column = [m](int j, float c[4]) { for (int i = 0; i < 4; ++i) c[i] = m[i * 4 + j]; };
+
+	float x[4], y[4], z[4], w[4];
+	column(0, x);
+	column(1, y);
+	column(2, z);
+	column(3, w);
+
+	const float signs[PLANE_COUNT] = { 1.0f, -1.0f, 1.0f, -1.0f, 0.0f, -1.0f };
+	const float* axes[PLANE_COUNT] = { x, x, y, y, z, z };
+
+	for (int i = 0; i < PLANE_COUNT; ++i)
+	{
+		// (near is z >= 0, the others are w +- axis >= 0)
+		float plane[4];
+		for (int j = 0; j < 4; ++j) plane[j] = i == 4 ? axes[i][j] : w[j] + signs[i] * axes[i][j];
+
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+		planes[i] = { plane[0] * scale, plane[1] * scale, plane[2] * scale, plane[3] * scale };
+	}
+}
+
+bool FrustumCuller::hasAVX()
+{
+	static const bool avx = []() {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0, cpuAVX = (info[2] & (1 << 28)) != 0;
+		return osxsave and cpuAVX and (_xgetbv(0) & 6) == 6; // (the OS saves the AVX registers)
+#else
+		return bool(__builtin_cpu_supports("avx"));
+#endif
+	}();
+
+	return avx;
+}
+
+// Scalar versions (same operations in the same order as the SIMD ones, so both agree on every bound)
+
+bool FrustumCuller::sphereVisible(const Spheres& spheres, size_t i) const
+{
+	float x = spheres.x[i] - origin[0], y = spheres.y[i] - origin[1], z = spheres.z[i] - origin[2];
+	float negRadius = 0.0f - spheres.radius[i];
+
+	bool inside = true;
+	for (const Plane& plane : planes)
+		inside = inside and plane.a * x + plane.b * y + plane.c * z + plane.d >= negRadius;
+
+	return inside;
+}
+
+bool FrustumCuller::boxVisible(const Boxes& boxes, size_t i) const
+{
+	float x = boxes.centerX[i] - origin[0], y = boxes.centerY[i] - origin[1], z = boxes.centerZ[i] - origin[2];
+
+	bool inside = true;
+	for (const Plane& plane : planes)
+	{
+		float negRadius = 0.0f - (std::fabs(plane.a) * boxes.extentX[i] + std::fabs(plane.b) * boxes.extentY[i] + std::fabs(plane.c) * boxes.extentZ[i]);
+		inside = inside and plane.a * x + plane.b * y + plane.c * z + plane.d >= negRadius;
+	}
+
+	return inside;
+}
+
+// SSE: 4 bounds per iteration, every plane tested (no branches), the ends of the arrays go through the scalar test
+
+size_t FrustumCuller::cullSpheresSSE(const Spheres& spheres, uint32_t* visible) const
+{
+	const size_t count = spheres.size();
+	const float *x = spheres.x.data(), *y = spheres.y.data(), *z = spheres.z.data(), *radius = spheres.radius.data();
+
+	const __m128 originX = _mm_set1_ps(origin[0]), originY = _mm_set1_ps(origin[1]), originZ = _mm_set1_ps(origin[2]);
+
+	size_t visibleCount = 0, i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_sub_ps(_mm_loadu_ps(x + i), originX);
+		__m128 py = _mm_sub_ps(_mm_loadu_ps(y + i), originY);
+		__m128 pz = _mm_sub_ps(_mm_loadu_ps(z + i), originZ);
+		__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const Plane& plane : planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.a), px), _mm_mul_ps(_mm_set1_ps(plane.b), py)),
+													_mm_mul_ps(_mm_set1_ps(plane.c), pz)), _mm_set1_ps(plane.d));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		visibleCount += packIndices(visible + visibleCount, uint32_t(i), _mm_movemask_ps(inside));
+	}
+
+	for (; i < count; ++i)
+		if (sphereVisible(spheres, i)) visible[visibleCount++] = uint32_t(i);
+
+	return visibleCount;
+}
+
+size_t FrustumCuller::cullBoxesSSE(const Boxes& boxes, uint32_t* visible) const
+{
+	const size_t count = boxes.size();
+	const float *cx = boxes.centerX.data(), *cy = boxes.centerY.data(), *cz = boxes.centerZ.data();
+	const float *ex = boxes.extentX.data(), *ey = boxes.extentY.data(), *ez = boxes.extentZ.data();
+
+	const __m128 originX = _mm_set1_ps(origin[0]), originY = _mm_set1_ps(origin[1]), originZ = _mm_set1_ps(origin[2]);
+
+	size_t visibleCount = 0, i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_sub_ps(_mm_loadu_ps(cx + i), originX);
+		__m128 py = _mm_sub_ps(_mm_loadu_ps(cy + i), originY);
+		__m128 pz = _mm_sub_ps(_mm_loadu_ps(cz + i), originZ);
+		__m128 sx = _mm_loadu_ps(ex + i), sy = _mm_loadu_ps(ey + i), sz = _mm_loadu_ps(ez + i);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const Plane& plane : planes)
+		{
+			// (projected radius of the box on the plane normal)
+			__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.a)), sx), _mm_mul_ps(_mm_set1_ps(std::fabs(plane.b)), sy)),
+																	   _mm_mul_ps(_mm_set1_ps(std::fabs(plane.c)), sz)));
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.a), px), _mm_mul_ps(_mm_set1_ps(plane.b), py)),
+													_mm_mul_ps(_mm_set1_ps(plane.c), pz)), _mm_set1_ps(plane.d));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		visibleCount += packIndices(visible + visibleCount, uint32_t(i), _mm_movemask_ps(inside));
+	}
+
+	for (; i < count; ++i)
+		if (boxVisible(boxes, i)) visible[visibleCount++] = uint32_t(i);
+
+	return visibleCount;
+}
+
+// AVX: same as SSE with 8 bounds per iteration (the 8 bit mask is packed as two halves)
+
+AVX_FUNCTION size_t FrustumCuller::cullSpheresAVX(const Spheres& spheres, uint32_t* visible) const
+{
+	const size_t count = spheres.size();
+	const float *x = spheres.x.data(), *y = spheres.y.data(), *z = spheres.z.data(), *radius = spheres.radius.data();
+
+	const __m256 originX = _mm256_set1_ps(origin[0]), originY = _mm256_set1_ps(origin[1]), originZ = _mm256_set1_ps(origin[2]);
+
+	size_t visibleCount = 0, i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 px = _mm256_sub_ps(_mm256_loadu_ps(x + i), originX);
+		__m256 py = _mm256_sub_ps(_mm256_loadu_ps(y + i), originY);
+		__m256 pz = _mm256_sub_ps(_mm256_loadu_ps(z + i), originZ);
+		__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const Plane& plane : planes)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.a), px), _mm256_mul_ps(_mm256_set1_ps(plane.b), py)),
+														  _mm256_mul_ps(_mm256_set1_ps(plane.c), pz)), _mm256_set1_ps(plane.d));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		visibleCount += packIndices(visible + visibleCount, uint32_t(i), mask & 15);
+		visibleCount += packIndices(visible + visibleCount, uint32_t(i + 4), mask >> 4);
+	}
+
+	for (; i < count; ++i)
+		if (sphereVisible(spheres, i)) visible[visibleCount++] = uint32_t(i);
+
+	return visibleCount;
+}
+
+AVX_FUNCTION size_t FrustumCuller::cullBoxesAVX(const Boxes& boxes, uint32_t* visible) const
+{
+	const size_t count = boxes.size();
+	const float *cx = boxes.centerX.data(), *cy = boxes.centerY.data(), *cz = boxes.centerZ.data();
+	const float *ex = boxes.extentX.data(), *ey = boxes.extentY.data(), *ez = boxes.extentZ.data();
+
+	const __m256 originX = _mm256_set1_ps(origin[0]), originY = _mm256_set1_ps(origin[1]), originZ = _mm256_set1_ps(origin[2]);
+
+	size_t visibleCount = 0, i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 px = _mm256_sub_ps(_mm256_loadu_ps(cx + i), originX);
+		__m256 py = _mm256_sub_ps(_mm256_loadu_ps(cy + i), originY);
+		__m256 pz = _mm256_sub_ps(_mm256_loadu_ps(cz + i), originZ);
+		__m256 sx = _mm256_loadu_ps(ex + i), sy = _mm256_loadu_ps(ey + i), sz = _mm256_loadu_ps(ez + i);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const Plane& plane : planes)
+		{
+			__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.a)), sx),
+																							  _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.b)), sy)),
+																				_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.c)), sz)));
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.a), px), _mm256_mul_ps(_mm256_set1_ps(plane.b), py)),
+														  _mm256_mul_ps(_mm256_set1_ps(plane.c), pz)), _mm256_set1_ps(plane.d));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		visibleCount += packIndices(visible + visibleCount, uint32_t(i), mask & 15);
+		visibleCount += packIndices(visible + visibleCount, uint32_t(i + 4), mask >> 4);
+	}
+
+	for (; i < count; ++i)
+		if (boxVisible(boxes, i)) visible[visibleCount++] = uint32_t(i);
+
+	return visibleCount;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Frustum culling of whole arrays of bounds (no GPU or camera objects here). Bounds are kept in SoA arrays and tested
+// four at a time with SSE, or eight with AVX when the CPU has it, and the indices of the visible ones are packed in a
+// compact list. Everything is camera relative: the planes are given relative to an origin (the camera position) and the
+// centers are moved by -origin in the test, so bounds far from the world origin don't lose the precision of the planes.
+class FrustumCuller
+{
+public:
+
+	enum { PLANE_COUNT = 6 };
+
+	struct Plane
+	{
+		float a, b, c, d; // inside when a * x + b * y + c * z + d >= 0, (a, b, c) normalized
+	};
+
+	// Bounding spheres in SoA form (entry i is x[i], y[i], z[i], radius[i])
+	struct Spheres
+	{
+		std::vector<float> x, y, z, radius;
+
+		void add(float centerX, float centerY, float centerZ, float sphereRadius);
+		void clear();
+		inline size_t size() const { return x.size(); };
+	};
+
+	// AABBs as center and half extents, in SoA form
+	struct Boxes
+	{
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+
+		void add(const float boxMin[3], const float boxMax[3]);
+		void clear();
+		inline size_t size() const { return centerX.size(); };
+	};
+
+	void setFrustum(const Plane planes[PLANE_COUNT], const float origin[3]);
+
+	inline const Plane* getPlanes() const { return planes; };
+	inline const float* getOrigin() const { return origin; };
+
+	// Write the indices of the bounds that touch the frustum to 'visible' (it needs room for all of them, size()) and
+	// return how many there are. Bounds right on a plane count as visible.
+	size_t cull(const Spheres& spheres, uint32_t* visible) const;
+	size_t cull(const Boxes& boxes, uint32_t* visible) const;
+
+	// Planes of a view * projection matrix (row major, row vectors, D3D clip depth in [0, w]): left, right, bottom, top, near, far
+	static void extractPlanes(const float viewProjection[16], Plane planes[PLANE_COUNT]);
+
+	static bool hasAVX(); // (checked once, the 8 wide loops are used if true)
+	inline void setUseAVX(bool enable) { useAVX = enable and hasAVX(); }; // (to compare both paths)
+
+private:
+
+	Plane planes[PLANE_COUNT] = {};
+	float origin[3] = {};
+	bool useAVX = hasAVX();
+
+	size_t cullSpheresSSE(const Spheres& spheres, uint32_t* visible) const;
+	size_t cullSpheresAVX(const Spheres& spheres, uint32_t* visible) const;
+	size_t cullBoxesSSE(const Boxes& boxes, uint32_t* visible) const;
+	size_t cullBoxesAVX(const Boxes& boxes, uint32_t* visible) const;
+
+	bool sphereVisible(const Spheres& spheres, size_t i) const; // (scalar, for the ends of the arrays)
+	bool boxVisible(const Boxes& boxes, size_t i) const;
+};
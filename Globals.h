@@ -1,5 +1,9 @@
 #pragma once
 
+#ifdef HEADLESS
+#include "Tests/Headless/Globals.h" // (CPU only builds of the engine code: Tests/)
+#else
+
 #define NOMINMAX
 #define INITGUID
 
@@ -32,9 +36,15 @@ using Microsoft::WRL::ComPtr;
 #define LOG(format, ...) log(__FILE__, __LINE__, format, __VA_ARGS__);
 void log(const char file[], int line, const char* format, ...);
 
-#define FRAMES_IN_FLIGHT 2
-#define SHADER_DESCRIPTORS 4
+#define FRAMES_IN_FLIGHT 2 // default, can be changed at runtime (see D3D12Module)
+#define MAX_FRAMES_IN_FLIGHT 4
+#define SHADER_DESCRIPTORS 1000000 // (shader visible CBV/SRV/UAV heap, max for resource binding tier 1)
+#define UPLOAD_RING_SIZE (64 * 1024 * 1024) // persistently mapped upload memory shared by all the copies
+#define TEXTURE_BUDGET (256 * 1024 * 1024) // GPU memory for the mips of streamed textures
+#define TEXTURE_STREAMING_UPLOAD (16 * 1024 * 1024) // max bytes of new mips per frame (at least one mip always goes)
+#define TEXTURE_STREAMING_TAIL 64 // mips this size (or smaller) of streamed textures are always resident
 
+#define DEBUG_DRAW_EXPLICIT_CONTEXT // (one context per thread that draws, see DebugDrawPass::getContext())
 #include "debug_draw.hpp"
 inline const ddVec3& ddConvert(const Vector3& v) { return reinterpret_cast<const ddVec3&>(v); }
 inline const ddMat4x4& ddConvert(const Matrix& m) { return reinterpret_cast<const ddMat4x4&>(m); }
@@ -56,3 +66,5 @@ inline size_t alignUp(size_t value, size_t alignment)
 
 #include <imgui.h>
 #include <imgui_internal.h>
+
+#endif // HEADLESS
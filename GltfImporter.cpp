@@ -0,0 +1,349 @@
+#include "Globals.h"
+
+#include "GltfImporter.h"
+#include "JobSystem.h"
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#include "tiny_gltf.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	inline double elapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// tinygltf image callback: keeps the encoded bytes, so the decoding happens later in parallel (and not while parsing)
+	bool keepEncodedImage(tinygltf::Image*, const int imageIndex, std::string*, std::string*, int, int, const unsigned char* bytes, int size, void* userData)
+	{
+		std::vector<std::vector<unsigned char>>& encoded = *static_cast<std::vector<std::vector<unsigned char>>*>(userData);
+
+		if (encoded.size() <= size_t(imageIndex)) encoded.resize(size_t(imageIndex) + 1);
+		encoded[imageIndex].assign(bytes, bytes + size);
+
+		return true;
+	}
+
+	inline size_t accessorCount(const tinygltf::Model& model, int accessorIndex)
+	{
+		return accessorIndex >= 0 and accessorIndex < int(model.accessors.size()) ? model.accessors[accessorIndex].count : 0;
+	}
+
+	// Calls write(i, src) for every element of the accessor, with src pointing to its first component (strides and offsets applied)
+	template<typename Write>
+	bool readAccessor(const tinygltf::Model& model, int accessorIndex, int componentType, int type, Write write)
+	{
+		if (accessorIndex < 0 or accessorIndex >= int(model.accessors.size())) return false;
+
+		const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+		if (accessor.componentType != componentType or accessor.type != type) return false;
+		if (accessor.bufferView < 0 or accessor.bufferView >= int(model.bufferViews.size())) return false; // (sparse only accessors aren't supported)
+		if (model.bufferViews[accessor.bufferView].buffer < 0 or model.bufferViews[accessor.bufferView].buffer >= int(model.buffers.size())) return false;
+
+		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+		const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+
+		int stride = accessor.ByteStride(view);
+		size_t elementSize = size_t(tinygltf::GetComponentSizeInBytes(componentType)) * tinygltf::GetNumComponentsInType(type);
+		size_t start = view.byteOffset + accessor.byteOffset;
+
+		if (stride <= 0 or (accessor.count > 0 and start + size_t(stride) * (accessor.count - 1) + elementSize > buffer.data.size()))
+			return false;
+
+		const unsigned char* src = buffer.data.data() + start;
+		for (size_t i = 0; i < accessor.count; ++i, src += stride)
+			write(i, src);
+
+		return true;
+	}
+
+	bool convertPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, GltfImporter::Mesh& mesh)
+	{
+		if (primitive.mode != -1 and primitive.mode != TINYGLTF_MODE_TRIANGLES) return false;
+
+		auto position = primitive.attributes.find("POSITION");
+		if (position == primitive.attributes.end()) return false;
+
+		mesh.vertices.resize(accessorCount(model, position->second));
+		mesh.material = primitive.material;
+
+		bool ok = readAccessor(model, position->second, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, [&mesh](size_t i, const unsigned char* src) {
+			memcpy(&mesh.vertices[i].position, src, sizeof(Vector3));
+		});
+
+		// Optional attributes (if they don't match the vertex count they are ignored)
+		auto normal = primitive.attributes.find("NORMAL");
+		if (ok and normal != primitive.attributes.end() and accessorCount(model, normal->second) == mesh.vertices.size())
+		{
+			readAccessor(model, normal->second, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, [&mesh](size_t i, const unsigned char* src) {
+				memcpy(&mesh.vertices[i].normal, src, sizeof(Vector3));
+			});
+		}
+
+		auto uv = primitive.attributes.find("TEXCOORD_0");
+		if (ok and uv != primitive.attributes.end() and accessorCount(model, uv->second) == mesh.vertices.size())
+		{
+			bool read = readAccessor(model, uv->second, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, [&mesh](size_t i, const unsigned char* src) {
+				memcpy(&mesh.vertices[i].uv, src, sizeof(Vector2));
+			});
+
+			// (normalized integer uvs)
+			read = read or readAccessor(model, uv->second, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC2, [&mesh](size_t i, const unsigned char* src) {
+				const uint16_t* value = reinterpret_cast<const uint16_t*>(src);
+				mesh.vertices[i].uv = Vector2(value[0] / 65535.0f, value[1] / 65535.0f);
+			});
+
+			if (not read) readAccessor(model, uv->second, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC2, [&mesh](size_t i, const unsigned char* src) {
+				mesh.vertices[i].uv = Vector2(src[0] / 255.0f, src[1] / 255.0f);
+			});
+		}
+
+		if (not ok) return false;
+
+		// Indices (32 bit always, generated if the primitive has none)
+		if (primitive.indices < 0)
+		{
+			mesh.indices.resize(mesh.vertices.size());
+			for (size_t i = 0; i < mesh.indices.size(); ++i) mesh.indices[i] = uint32_t(i);
+		}
+		else
+		{
+			mesh.indices.resize(accessorCount(model, primitive.indices));
+
+			ok = readAccessor(model, primitive.indices, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, [&mesh](size_t i, const unsigned char* src) {
+				memcpy(&mesh.indices[i], src, sizeof(uint32_t));
+			});
+
+			ok = ok or readAccessor(model, primitive.indices, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, [&mesh](size_t i, const unsigned char* src) {
+				mesh.indices[i] = *reinterpret_cast<const uint16_t*>(src);
+			});
+
+			ok = ok or readAccessor(model, primitive.indices, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_SCALAR, [&mesh](size_t i, const unsigned char* src) {
+				mesh.indices[i] = *src;
+			});
+		}
+
+		// Counter-clockwise to clockwise (and reject indices that point outside the vertices)
+		mesh.indices.resize(mesh.indices.size() - mesh.indices.size() % 3);
+
+		for (size_t i = 0; ok and i < mesh.indices.size(); i += 3)
+		{
+			std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+			ok = mesh.indices[i] < mesh.vertices.size() and mesh.indices[i + 1] < mesh.vertices.size() and mesh.indices[i + 2] < mesh.vertices.size();
+		}
+
+		return ok;
+	}
+
+	Matrix nodeTransform(const tinygltf::Node& node)
+	{
+		// glTF matrices are column major for column vectors, which is the same memory layout as our row major ones for row vectors
+		if (node.matrix.size() == 16)
+		{
+			float values[16];
+			for (int i = 0; i < 16; ++i) values[i] = float(node.matrix[i]);
+			return Matrix(values);
+		}
+
+		Matrix transform = Matrix::Identity;
+
+		if (node.scale.size() == 3)
+			transform *= Matrix::CreateScale(float(node.scale[0]), float(node.scale[1]), float(node.scale[2]));
+		if (node.rotation.size() == 4)
+			transform *= Matrix::CreateFromQuaternion(Quaternion(float(node.rotation[0]), float(node.rotation[1]), float(node.rotation[2]), float(node.rotation[3])));
+		if (node.translation.size() == 3)
+			transform *= Matrix::CreateTranslation(float(node.translation[0]), float(node.translation[1]), float(node.translation[2]));
+
+		return transform;
+	}
+
+	void addInstances(const tinygltf::Model& model, int nodeIndex, const Matrix& parent, const std::vector<unsigned int>& firstMesh, GltfImporter::Scene& scene, int depth)
+	{
+		if (nodeIndex < 0 or nodeIndex >= int(model.nodes.size()) or depth > 256) return; // (broken files could have cycles)
+
+		const tinygltf::Node& node = model.nodes[nodeIndex];
+		Matrix world = nodeTransform(node) * parent;
+
+		if (node.mesh >= 0 and node.mesh < int(model.meshes.size()))
+		{
+			for (unsigned int mesh = firstMesh[node.mesh]; mesh < firstMesh[node.mesh + 1]; ++mesh)
+				if (not scene.meshes[mesh].indices.empty()) scene.instances.push_back({ mesh, world });
+		}
+
+		for (int child : node.children)
+			addInstances(model, child, world, firstMesh, scene, depth + 1);
+	}
+}
+
+bool GltfImporter::decodeImage(const unsigned char* encoded, size_t size, ScratchImage& image, bool srgb)
+{
+	int width, height, components;
+	stbi_uc* pixels = stbi_load_from_memory(encoded, int(size), &width, &height, &components, STBI_rgb_alpha);
+	if (pixels == nullptr) return false;
+
+	ScratchImage baseLevel;
+	bool ok = SUCCEEDED(baseLevel.Initialize2D(srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, size_t(width), size_t(height), 1, 1));
+
+	if (ok)
+	{
+		const Image* dst = baseLevel.GetImage(0, 0, 0);
+		for (int row = 0; row < height; ++row)
+			memcpy(dst->pixels + row * dst->rowPitch, pixels + size_t(row) * width * 4, size_t(width) * 4);
+	}
+
+	stbi_image_free(pixels);
+
+	// Mips here too (it's the expensive part, and we are normally on a worker). Non WIC filter: workers don't initialize COM
+	ok = ok and SUCCEEDED(GenerateMipMaps(*baseLevel.GetImage(0, 0, 0), TEX_FILTER_DEFAULT | TEX_FILTER_FORCE_NON_WIC, 0, image));
+
+	return ok;
+}
+
+bool GltfImporter::import(const std::filesystem::path& path, JobSystem* jobSystem, Scene& scene, bool decodeImages)
+{
+	Clock::time_point start = Clock::now();
+	scene = Scene();
+
+	// 1. Parse (images are only read here, not decoded)
+	tinygltf::TinyGLTF loader;
+	tinygltf::Model model;
+	std::vector<std::vector<unsigned char>> encodedImages;
+	std::string error, warning;
+
+	loader.SetImageLoader(keepEncodedImage, &encodedImages);
+
+	bool ok;
+	if (path.extension() == ".glb")
+		ok = loader.LoadBinaryFromFile(&model, &error, &warning, path.string());
+	else
+		ok = loader.LoadASCIIFromFile(&model, &error, &warning, path.string());
+
+	if (not warning.empty()) LOG("glTF %s: %s", path.string().c_str(), warning.c_str());
+	if (not ok)
+	{
+		LOG("glTF %s failed: %s", path.string().c_str(), error.c_str());
+		return false;
+	}
+
+	scene.timings.parse = elapsedMs(start);
+
+	// 2. Decode images and convert primitives, all at the same time
+	encodedImages.resize(model.images.size());
+	if (decodeImages) scene.images.resize(model.images.size());
+
+	std::vector<unsigned int> firstMesh; // glTF mesh i => our meshes [firstMesh[i], firstMesh[i + 1])
+	for (const tinygltf::Mesh& mesh : model.meshes)
+	{
+		firstMesh.push_back(unsigned(scene.meshes.size()));
+		scene.meshes.resize(scene.meshes.size() + mesh.primitives.size());
+	}
+	firstMesh.push_back(unsigned(scene.meshes.size()));
+
+	// Colour images (the ones used as base color or emissive) are sRGB, the rest (normals, metallic roughness...) linear
+	scene.srgbImages.assign(model.images.size(), false);
+	for (const tinygltf::Material& material : model.materials)
+	{
+		for (int texture : { material.pbrMetallicRoughness.baseColorTexture.index, material.emissiveTexture.index })
+		{
+			if (texture >= 0 and texture < int(model.textures.size()) and model.textures[texture].source >= 0 and
+				model.textures[texture].source < int(model.images.size()))
+				scene.srgbImages[model.textures[texture].source] = true;
+		}
+	}
+
+	std::atomic<int64_t> decodeMicros = 0, convertMicros = 0;
+	std::vector<JobSystem::JobHandle> jobs;
+
+	for (size_t i = 0; i < scene.images.size(); ++i)
+	{
+		jobs.push_back(jobSystem->schedule([&, i]() {
+			Clock::time_point jobStart = Clock::now();
+
+			if (encodedImages[i].empty() or not decodeImage(encodedImages[i].data(), encodedImages[i].size(), scene.images[i], scene.srgbImages[i]))
+			{
+				LOG("glTF %s: image %d could not be decoded", path.string().c_str(), int(i));
+				scene.images[i].Release();
+			}
+			encodedImages[i] = std::vector<unsigned char>(); // (no need to keep it in memory until everything is done)
+
+			decodeMicros += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - jobStart).count();
+		}));
+	}
+
+	for (size_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex)
+	{
+		for (size_t primitive = 0; primitive < model.meshes[meshIndex].primitives.size(); ++primitive)
+		{
+			jobs.push_back(jobSystem->schedule([&, meshIndex, primitive]() {
+				Clock::time_point jobStart = Clock::now();
+
+				Mesh& mesh = scene.meshes[firstMesh[meshIndex] + primitive];
+				if (not convertPrimitive(model, model.meshes[meshIndex].primitives[primitive], mesh))
+				{
+					LOG("glTF %s: mesh %d primitive %d skipped", path.string().c_str(), int(meshIndex), int(primitive));
+					mesh = Mesh();
+				}
+
+				convertMicros += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - jobStart).count();
+			}));
+		}
+	}
+
+	// Materials (base color only, for now) while the jobs run
+	for (const tinygltf::Material& material : model.materials)
+	{
+		Material converted;
+
+		const std::vector<double>& factor = material.pbrMetallicRoughness.baseColorFactor;
+		if (factor.size() == 4) converted.baseColor = Vector4(float(factor[0]), float(factor[1]), float(factor[2]), float(factor[3]));
+
+		int texture = material.pbrMetallicRoughness.baseColorTexture.index;
+		if (texture >= 0 and texture < int(model.textures.size()) and model.textures[texture].source < int(model.images.size()))
+			converted.baseColorImage = model.textures[texture].source;
+
+		scene.materials.push_back(converted);
+	}
+
+	jobSystem->waitAll(jobs);
+
+	if (not decodeImages) scene.encodedImages = std::move(encodedImages);
+
+	for (Mesh& mesh : scene.meshes)
+		if (mesh.material >= int(scene.materials.size())) mesh.material = -1;
+
+	// 3. Flatten the default scene (or the first one, or every root node if there are no scenes)
+	int sceneIndex = model.defaultScene >= 0 ? model.defaultScene : 0;
+
+	if (sceneIndex < int(model.scenes.size()))
+	{
+		for (int node : model.scenes[sceneIndex].nodes)
+			addInstances(model, node, Matrix::Identity, firstMesh, scene, 0);
+	}
+	else
+	{
+		std::vector<bool> isChild(model.nodes.size(), false);
+		for (const tinygltf::Node& node : model.nodes)
+			for (int child : node.children)
+				if (child >= 0 and child < int(isChild.size())) isChild[child] = true;
+
+		for (size_t node = 0; node < model.nodes.size(); ++node)
+			if (not isChild[node]) addInstances(model, int(node), Matrix::Identity, firstMesh, scene, 0);
+	}
+
+	scene.timings.decode = decodeMicros * 0.001;
+	scene.timings.convert = convertMicros * 0.001;
+	scene.timings.total = elapsedMs(start);
+
+	LOG("glTF %s: parse %.2f ms, decode %.2f ms (%d images), convert %.2f ms (%d meshes), total %.2f ms",
+		path.string().c_str(), scene.timings.parse, scene.timings.decode, int(model.images.size()),
+		scene.timings.convert, int(scene.meshes.size()), scene.timings.total);
+
+	return true;
+}
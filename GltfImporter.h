@@ -0,0 +1,67 @@
+#pragma once
+
+#include "DirectXTex.h"
+
+#include <filesystem>
+#include <vector>
+
+class JobSystem;
+
+// Turns a .gltf/.glb into CPU ready data (no GPU objects here): interleaved vertices, 32 bit indices, decoded images
+// (with mips) and the flattened nodes of the default scene. Images are decoded and primitives converted in parallel jobs.
+class GltfImporter
+{
+public:
+
+	struct Vertex
+	{
+		Vector3 position;
+		Vector2 uv;		// (position + uv first, so pipelines that only need those can read these vertices with a bigger stride)
+		Vector3 normal;
+	};
+
+	struct Mesh // one per glTF primitive
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices; // clockwise (glTF is counter-clockwise, flipped for our default rasterizer state)
+		int material = -1;
+	};
+
+	struct Material
+	{
+		Vector4 baseColor = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+		int baseColorImage = -1; // index in images
+	};
+
+	struct Instance
+	{
+		unsigned int mesh;
+		Matrix world;
+	};
+
+	struct Timings // milliseconds (decode and convert are added over all the jobs, so they can be bigger than total)
+	{
+		double parse = 0.0;
+		double decode = 0.0;
+		double convert = 0.0;
+		double total = 0.0;
+	};
+
+	struct Scene
+	{
+		std::vector<Mesh> meshes;
+		std::vector<Material> materials;
+		std::vector<DirectX::ScratchImage> images; // (empty if an image couldn't be decoded)
+		std::vector<std::vector<unsigned char>> encodedImages; // (only when importing without decoding, e.g. for cooking)
+		std::vector<bool> srgbImages; // per image: used as base color or emissive
+		std::vector<Instance> instances;
+
+		Timings timings;
+	};
+
+	static bool import(const std::filesystem::path& path, JobSystem* jobSystem, Scene& scene, bool decodeImages = true);
+
+	// png, jpg... to RGBA8 with mips. Colour images (glTF base color and emissive) are sRGB: the format says so, the mips are
+	// averaged in linear and the GPU linearizes them when sampled
+	static bool decodeImage(const unsigned char* encoded, size_t size, DirectX::ScratchImage& image, bool srgb = false);
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a (64 bits) for the cache keys and names (pipeline descs, root signatures, shader sources, file contents...):
+// chain calls passing the previous hash to hash several pieces as one
+inline uint64_t hashBytes(const void* bytes, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+{
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(bytes);
+	for (size_t i = 0; i < size; ++i) hash = (hash ^ data[i]) * 0x100000001b3ull;
+
+	return hash;
+}
@@ -7,7 +7,7 @@ class ImGuiPass
 
 public:
     ImGuiPass(); // uninitialised
-    ImGuiPass(ID3D12Device2* device, HWND hWnd, D3D12_CPU_DESCRIPTOR_HANDLE cpuTextHandle = { 0 }, D3D12_GPU_DESCRIPTOR_HANDLE gpuTextHandle = { 0 });
+    ImGuiPass(ID3D12Device2* device, HWND hWnd, unsigned int framesInFlight = FRAMES_IN_FLIGHT, D3D12_CPU_DESCRIPTOR_HANDLE cpuTextHandle = { 0 }, D3D12_GPU_DESCRIPTOR_HANDLE gpuTextHandle = { 0 });
     ~ImGuiPass();
 
     void startFrame();
@@ -0,0 +1,98 @@
+#include "Globals.h"
+
+#include "IndirectDrawBuilder.h"
+
+#include <cmath>
+#include <cstring>
+
+static_assert(sizeof(IndirectDrawBuilder::Object) == 96, "Object must match Shaders/IndirectCommon.hlsli");
+static_assert(sizeof(IndirectDrawBuilder::Command) == 56, "Command must match Shaders/IndirectCommon.hlsli");
+static_assert(sizeof(IndirectDrawBuilder::CullConstants) == 28 * sizeof(uint32_t), "CullConstants must match Shaders/IndirectCullCS.hlsl");
+
+void IndirectDrawBuilder::clear()
+{
+	objects.clear();
+	commands.clear();
+}
+
+void IndirectDrawBuilder::add(const D3D12_VERTEX_BUFFER_VIEW& vertexBuffer, const D3D12_INDEX_BUFFER_VIEW& indexBuffer, uint32_t indexCount,
+							  const float world[16], const float boundsMin[3], const float boundsMax[3], uint32_t textureIndex)
+{
+	Object object = {};
+	memcpy(object.world, world, sizeof(object.world));
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		object.center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+		object.extent[axis] = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+	}
+	object.textureIndex = textureIndex;
+
+	Command command = {};
+	command.vertexBuffer = vertexBuffer;
+	command.indexBuffer = indexBuffer;
+	command.objectIndex = uint32_t(objects.size());
+	command.draw.IndexCountPerInstance = indexCount;
+	command.draw.InstanceCount = 1;
+
+	objects.push_back(object);
+	commands.push_back(command);
+}
+
+D3D12_COMMAND_SIGNATURE_DESC IndirectDrawBuilder::getCommandSignatureDesc(D3D12_INDIRECT_ARGUMENT_DESC* arguments)
+{
+	// (same order as the members of Command)
+	arguments[0] = {};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+	arguments[0].VertexBuffer.Slot = 0;
+
+	arguments[1] = {};
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+
+	arguments[2] = {};
+	arguments[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	arguments[2].Constant.RootParameterIndex = OBJECT_INDEX_PARAMETER;
+	arguments[2].Constant.DestOffsetIn32BitValues = 0;
+	arguments[2].Constant.Num32BitValuesToSet = 1;
+
+	arguments[3] = {};
+	arguments[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC desc = {};
+	desc.ByteStride = sizeof(Command);
+	desc.NumArgumentDescs = ARGUMENT_COUNT;
+	desc.pArgumentDescs = arguments;
+
+	return desc;
+}
+
+IndirectDrawBuilder::CullConstants IndirectDrawBuilder::getCullConstants(const FrustumCuller& frustum) const
+{
+	CullConstants constants = {};
+	memcpy(constants.planes, frustum.getPlanes(), sizeof(constants.planes));
+	memcpy(constants.origin, frustum.getOrigin(), sizeof(constants.origin));
+	constants.objectCount = uint32_t(objects.size());
+
+	return constants;
+}
+
+uint32_t IndirectDrawBuilder::cull(const CullConstants& constants, Command* visible) const
+{
+	uint32_t visibleCount = 0;
+	for (uint32_t i = 0; i < constants.objectCount; ++i) // (a thread each)
+	{
+		const Object& object = objects[i];
+		float center[3] = { object.center[0] - constants.origin[0], object.center[1] - constants.origin[1], object.center[2] - constants.origin[2] };
+
+		bool inside = true;
+		for (const FrustumCuller::Plane& plane : constants.planes)
+		{
+			float radius = std::fabs(plane.a) * object.extent[0] + std::fabs(plane.b) * object.extent[1] + std::fabs(plane.c) * object.extent[2];
+			float distance = plane.a * center[0] + plane.b * center[1] + plane.c * center[2] + plane.d;
+			inside = inside and distance >= -radius;
+		}
+
+		if (inside) visible[visibleCount++] = commands[i];
+	}
+
+	return visibleCount;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "FrustumCuller.h"
+
+#include <cstdint>
+#include <vector>
+
+// CPU side of the GPU driven scene (no GPU objects here): the per object data and the draw commands the culling shader
+// compacts for ExecuteIndirect, the command signature that reads them, and a reference of that shader. The layouts are
+// the ones in Shaders/IndirectCommon.hlsli (keep them in sync).
+class IndirectDrawBuilder
+{
+public:
+
+	// Per object, in a structured buffer read by the culling and the vertex shaders
+	struct Object
+	{
+		float world[16];		// row major, row vectors (as Matrix)
+		float center[3];		// world AABB as center and half extents
+		uint32_t textureIndex;	// base color texture in the shader descriptor heap
+		float extent[3];
+		uint32_t padding;
+	};
+
+	// One ExecuteIndirect command (the arguments of the command signature, in order)
+	struct Command
+	{
+		D3D12_VERTEX_BUFFER_VIEW vertexBuffer;
+		D3D12_INDEX_BUFFER_VIEW indexBuffer;
+		uint32_t objectIndex;	// root constant of the draw (its Object)
+		D3D12_DRAW_INDEXED_ARGUMENTS draw;
+	};
+
+	// Root constants of the culling shader
+	struct CullConstants
+	{
+		FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT]; // camera relative
+		float origin[3];
+		uint32_t objectCount;
+	};
+
+	enum { ARGUMENT_COUNT = 4, OBJECT_INDEX_PARAMETER = 0 }; // (root parameter the commands set in the draw root signature)
+
+	void clear();
+	void add(const D3D12_VERTEX_BUFFER_VIEW& vertexBuffer, const D3D12_INDEX_BUFFER_VIEW& indexBuffer, uint32_t indexCount,
+			 const float world[16], const float boundsMin[3], const float boundsMax[3], uint32_t textureIndex);
+
+	inline const std::vector<Object>& getObjects() const { return objects; };
+	inline const std::vector<Command>& getCommands() const { return commands; }; // (command i draws object i)
+	inline size_t size() const { return objects.size(); };
+
+	// Description for CreateCommandSignature (arguments needs room for ARGUMENT_COUNT)
+	static D3D12_COMMAND_SIGNATURE_DESC getCommandSignatureDesc(D3D12_INDIRECT_ARGUMENT_DESC* arguments);
+
+	CullConstants getCullConstants(const FrustumCuller& frustum) const;
+
+	// What Shaders/IndirectCullCS.hlsl writes, one object after the other (the GPU appends in any order): the commands
+	// of the visible objects packed in visible (room for size()), returns how many
+	uint32_t cull(const CullConstants& constants, Command* visible) const;
+
+private:
+
+	std::vector<Object> objects;
+	std::vector<Command> commands;
+};
@@ -0,0 +1,223 @@
+#include "Globals.h"
+
+#include "IndirectScenePass.h"
+#include "Application.h"
+#include "ModulePipelines.h"
+#include "ModuleShaders.h"
+
+#include <algorithm>
+
+IndirectScenePass::IndirectScenePass(ID3D12Device5* device) : device(device), pipelines(app->getModulePipelines())
+{
+	uploadArena.reset(size_t(1) << 20); // (objects and commands of a frame, it grows if needed)
+
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[IndirectDrawBuilder::ARGUMENT_COUNT];
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = IndirectDrawBuilder::getCommandSignatureDesc(arguments);
+
+	created = createCullPipeline() and createDrawPipeline() and
+			SUCCEEDED(device->CreateCommandSignature(&signatureDesc, drawSignature.Get(), IID_PPV_ARGS(&commandSignature)));
+
+	CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+	CD3DX12_RESOURCE_DESC countDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	created = created and SUCCEEDED(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &countDesc, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+															   nullptr, IID_PPV_ARGS(&visibleCount)));
+	if (created) visibleCount->SetName(L"Indirect Visible Count");
+}
+
+bool IndirectScenePass::isReady() const
+{
+	return created and pipelines->isReady(cullPipeline) and pipelines->isReady(drawPipeline);
+}
+
+bool IndirectScenePass::createCullPipeline()
+{
+	// Constants (frustum), objects and commands as root SRVs, packed commands and their count as root UAVs (no descriptors)
+	CD3DX12_ROOT_PARAMETER rootParameters[5] = {};
+	rootParameters[CULL_CONSTANTS].InitAsConstants(sizeof(IndirectDrawBuilder::CullConstants) / sizeof(UINT32), 0);
+	rootParameters[CULL_OBJECTS].InitAsShaderResourceView(0);
+	rootParameters[CULL_COMMANDS].InitAsShaderResourceView(1);
+	rootParameters[CULL_VISIBLE_COMMANDS].InitAsUnorderedAccessView(0);
+	rootParameters[CULL_VISIBLE_COUNT].InitAsUnorderedAccessView(1);
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(UINT(std::size(rootParameters)), rootParameters);
+
+	cullSignature = pipelines->getRootSignature(rootSignatureDesc, RootSignatureDesc::UPGRADE_VOLATILE, L"Indirect Cull"); // (buffers written every frame)
+	if (not cullSignature) return false;
+
+	ModuleShaders::ShaderBlob dataCS = app->getModuleShaders()->getShader("IndirectCullCS.hlsl", "cs_6_0");
+	if (not dataCS) return false;
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.pRootSignature = cullSignature.Get();
+	psoDesc.CS = ModuleShaders::getBytecode(dataCS);
+
+	cullPipeline = pipelines->requestPipeline(psoDesc, L"Indirect Cull");
+	return cullPipeline != 0;
+}
+
+bool IndirectScenePass::createDrawPipeline()
+{
+	// Object index (set by every command), view projection, objects as a root SRV, then the whole descriptor heap and the sampler
+	CD3DX12_DESCRIPTOR_RANGE textureRange, samplerRange;
+	textureRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1); // (unbounded, space1)
+	samplerRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 1, 0);
+
+	CD3DX12_ROOT_PARAMETER rootParameters[5] = {};
+	rootParameters[DRAW_OBJECT_INDEX].InitAsConstants(1, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	rootParameters[DRAW_VIEW_PROJECTION].InitAsConstants(sizeof(Matrix) / sizeof(UINT32), 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	rootParameters[DRAW_OBJECTS].InitAsShaderResourceView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	rootParameters[DRAW_TEXTURES].InitAsDescriptorTable(1, &textureRange, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootParameters[DRAW_SAMPLER].InitAsDescriptorTable(1, &samplerRange, D3D12_SHADER_VISIBILITY_PIXEL);
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(UINT(std::size(rootParameters)), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	drawSignature = pipelines->getRootSignature(rootSignatureDesc, RootSignatureDesc::UPGRADE_VOLATILE, L"Indirect Draw"); // (textures stream in while drawn)
+	if (not drawSignature) return false;
+
+	ModuleShaders* shaders = app->getModuleShaders();
+	ModuleShaders::ShaderBlob dataVS = shaders->getShader("IndirectDrawVS.hlsl", "vs_6_0");
+	ModuleShaders::ShaderBlob dataPS = shaders->getShader("IndirectDrawPS.hlsl", "ps_6_0");
+	if (not dataVS or not dataPS) return false;
+
+	// Scene vertices start with position + uv (as in Exercise4)
+	D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
+		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+	};
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.pRootSignature = drawSignature.Get();
+	psoDesc.VS = ModuleShaders::getBytecode(dataVS);
+	psoDesc.PS = ModuleShaders::getBytecode(dataPS);
+	psoDesc.InputLayout = { inputLayout, UINT(std::size(inputLayout)) };
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.SampleDesc = { 1, 0 };
+	psoDesc.SampleMask = 0xffffffff;
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+
+	drawPipeline = pipelines->requestPipeline(psoDesc, L"Indirect Draw");
+	return drawPipeline != 0;
+}
+
+bool IndirectScenePass::reserveVisibleCommands(size_t count, UINT64 frameFenceValue)
+{
+	if (count <= visibleCapacity) return true;
+
+	if (visibleCommands) retired.push_back({ frameFenceValue, std::move(visibleCommands) }); // (earlier frames may still read it)
+
+	size_t capacity = std::max<size_t>(visibleCapacity * 2, std::max<size_t>(count, 256));
+
+	CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(capacity * sizeof(IndirectDrawBuilder::Command), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	if (FAILED(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, nullptr, IID_PPV_ARGS(&visibleCommands))))
+	{
+		visibleCapacity = 0;
+		return false;
+	}
+
+	visibleCommands->SetName(L"Indirect Visible Commands");
+	visibleCapacity = capacity;
+
+	return true;
+}
+
+FrameArena::Allocation IndirectScenePass::copyToArena(const void* data, size_t size)
+{
+	FrameArena::Allocation allocation = uploadArena.allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	if (allocation.page >= arenaPages.size() or not arenaPages[allocation.page].buffer) // (new page: upload buffer mapped for its whole life)
+	{
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadArena.getPageSize(allocation.page));
+
+		ArenaPage page;
+		D3D12_RANGE readRange = { 0, 0 }; // (never read)
+		bool ok = SUCCEEDED(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&page.buffer))) and
+				  SUCCEEDED(page.buffer->Map(0, &readRange, reinterpret_cast<void**>(&page.data)));
+		if (not ok) return FrameArena::Allocation();
+
+		page.buffer->SetName(L"Indirect Upload Arena");
+		if (allocation.page >= arenaPages.size()) arenaPages.resize(allocation.page + 1);
+		arenaPages[allocation.page] = std::move(page);
+	}
+
+	memcpy(arenaPages[allocation.page].data + allocation.offset, data, size);
+
+	return allocation;
+}
+
+bool IndirectScenePass::record(ID3D12GraphicsCommandList* commandList, const IndirectDrawBuilder& draws, const FrustumCuller& frustum, const Matrix& viewProjection,
+							   D3D12_GPU_DESCRIPTOR_HANDLE textures, D3D12_GPU_DESCRIPTOR_HANDLE sampler, UINT64 frameFenceValue, UINT64 completedFenceValue)
+{
+	uploadArena.beginFrame(frameFenceValue, completedFenceValue);
+	for (size_t page : uploadArena.getReleasedPages()) arenaPages[page] = ArenaPage(); // (trimmed: no frame in flight uses it)
+	while (not retired.empty() and retired.front().fenceValue <= completedFenceValue) retired.pop_front();
+
+	// (nothing is recorded while the pipelines compile)
+	ComPtr<ID3D12PipelineState> cullPSO = pipelines->getPipeline(cullPipeline);
+	ComPtr<ID3D12PipelineState> drawPSO = pipelines->getPipeline(drawPipeline);
+	bool ready = created and cullPSO and drawPSO;
+
+	UINT objectCount = UINT(draws.size());
+	if (not ready or objectCount == 0) return ready;
+
+	if (not reserveVisibleCommands(objectCount, frameFenceValue)) return false;
+
+	const uint32_t zero = 0;
+	FrameArena::Allocation objectsCopy = copyToArena(draws.getObjects().data(), objectCount * sizeof(IndirectDrawBuilder::Object));
+	FrameArena::Allocation commandsCopy = copyToArena(draws.getCommands().data(), objectCount * sizeof(IndirectDrawBuilder::Command));
+	FrameArena::Allocation zeroCopy = copyToArena(&zero, sizeof(zero));
+	if (not objectsCopy.isValid() or not commandsCopy.isValid() or not zeroCopy.isValid()) return false;
+
+	D3D12_GPU_VIRTUAL_ADDRESS objects = getAddress(objectsCopy), commands = getAddress(commandsCopy);
+
+	// 1. Count back to 0
+	CD3DX12_RESOURCE_BARRIER toCopy = CD3DX12_RESOURCE_BARRIER::Transition(visibleCount.Get(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_DEST);
+	commandList->ResourceBarrier(1, &toCopy);
+	commandList->CopyBufferRegion(visibleCount.Get(), 0, arenaPages[zeroCopy.page].buffer.Get(), zeroCopy.offset, sizeof(uint32_t));
+
+	// 2. Cull: every visible object appends its command
+	CD3DX12_RESOURCE_BARRIER toCull[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(visibleCount.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+		CD3DX12_RESOURCE_BARRIER::Transition(visibleCommands.Get(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+	};
+	commandList->ResourceBarrier(UINT(std::size(toCull)), toCull);
+
+	IndirectDrawBuilder::CullConstants constants = draws.getCullConstants(frustum);
+
+	commandList->SetComputeRootSignature(cullSignature.Get());
+	commandList->SetPipelineState(cullPSO.Get());
+	commandList->SetComputeRoot32BitConstants(CULL_CONSTANTS, sizeof(constants) / sizeof(UINT32), &constants, 0);
+	commandList->SetComputeRootShaderResourceView(CULL_OBJECTS, objects);
+	commandList->SetComputeRootShaderResourceView(CULL_COMMANDS, commands);
+	commandList->SetComputeRootUnorderedAccessView(CULL_VISIBLE_COMMANDS, visibleCommands->GetGPUVirtualAddress());
+	commandList->SetComputeRootUnorderedAccessView(CULL_VISIBLE_COUNT, visibleCount->GetGPUVirtualAddress());
+	commandList->Dispatch((objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	CD3DX12_RESOURCE_BARRIER toDraw[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(visibleCount.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+		CD3DX12_RESOURCE_BARRIER::Transition(visibleCommands.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT)
+	};
+	commandList->ResourceBarrier(UINT(std::size(toDraw)), toDraw);
+
+	// 3. Draw whatever survived (the count is read on the GPU)
+	Matrix viewProjectionTransposed = viewProjection.Transpose(); // (the shader takes column major matrices)
+
+	commandList->SetGraphicsRootSignature(drawSignature.Get());
+	commandList->SetPipelineState(drawPSO.Get());
+	commandList->SetGraphicsRoot32BitConstants(DRAW_VIEW_PROJECTION, sizeof(Matrix) / sizeof(UINT32), &viewProjectionTransposed, 0);
+	commandList->SetGraphicsRootShaderResourceView(DRAW_OBJECTS, objects);
+	commandList->SetGraphicsRootDescriptorTable(DRAW_TEXTURES, textures);
+	commandList->SetGraphicsRootDescriptorTable(DRAW_SAMPLER, sampler);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList->ExecuteIndirect(commandSignature.Get(), objectCount, visibleCommands.Get(), 0, visibleCount.Get(), 0);
+
+	return true;
+}
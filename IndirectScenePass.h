@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Globals.h"
+#include "FrameArena.h"
+#include "IndirectDrawBuilder.h"
+#include "ModulePipelines.h"
+
+#include <deque>
+#include <vector>
+
+// GPU driven drawing of the objects of an IndirectDrawBuilder: a compute shader culls them against the frustum and packs
+// the commands of the visible ones, and a single ExecuteIndirect draws them (the CPU records the same few commands
+// whatever the object count). Objects and commands are copied every record() to upload pages recycled per frame; the
+// packed commands live in a default buffer that grows with the object count. Its pipelines compile in the background.
+class IndirectScenePass
+{
+public:
+
+	IndirectScenePass(ID3D12Device5* device); // (shaders: IndirectCullCS, IndirectDrawVS and IndirectDrawPS from ModuleShaders)
+
+	inline bool isCreated() const { return created; }; // false if something couldn't be created (nothing is ever recorded)
+	bool isReady() const;							  // (created and its pipelines compiled, nothing is recorded until then)
+
+	// Records the cull dispatch and the draw on a list with the render target, viewport and descriptor heaps already set.
+	// textures is the start of the shader descriptor heap (objects index it) and sampler the one to use
+	bool record(ID3D12GraphicsCommandList* commandList, const IndirectDrawBuilder& draws, const FrustumCuller& frustum, const Matrix& viewProjection,
+				D3D12_GPU_DESCRIPTOR_HANDLE textures, D3D12_GPU_DESCRIPTOR_HANDLE sampler, UINT64 frameFenceValue, UINT64 completedFenceValue);
+
+private:
+
+	enum CullParameter { CULL_CONSTANTS, CULL_OBJECTS, CULL_COMMANDS, CULL_VISIBLE_COMMANDS, CULL_VISIBLE_COUNT };
+	enum DrawParameter { DRAW_OBJECT_INDEX = IndirectDrawBuilder::OBJECT_INDEX_PARAMETER, DRAW_VIEW_PROJECTION, DRAW_OBJECTS, DRAW_TEXTURES, DRAW_SAMPLER };
+	enum { CULL_GROUP_SIZE = 64 }; // (numthreads of IndirectCullCS)
+
+	struct ArenaPage
+	{
+		ComPtr<ID3D12Resource> buffer;
+		BYTE* data = nullptr;
+	};
+
+	struct Retired
+	{
+		UINT64 fenceValue; // frame fence value after which nothing uses it
+		ComPtr<ID3D12Resource> buffer;
+	};
+
+	ID3D12Device5* device;
+	ModulePipelines* pipelines;
+	bool created = false;
+
+	ComPtr<ID3D12RootSignature> cullSignature, drawSignature;
+	ModulePipelines::PipelineHandle cullPipeline = 0, drawPipeline = 0;
+	ComPtr<ID3D12CommandSignature> commandSignature;
+
+	ComPtr<ID3D12Resource> visibleCommands; // (UAV of the cull, indirect arguments of the draw)
+	ComPtr<ID3D12Resource> visibleCount;
+	size_t visibleCapacity = 0;
+	std::deque<Retired> retired;
+
+	FrameArena uploadArena;
+	std::vector<ArenaPage> arenaPages;
+
+	bool createCullPipeline();
+	bool createDrawPipeline();
+	bool reserveVisibleCommands(size_t count, UINT64 frameFenceValue);
+	FrameArena::Allocation copyToArena(const void* data, size_t size); // (invalid if its page couldn't be created)
+
+	inline D3D12_GPU_VIRTUAL_ADDRESS getAddress(const FrameArena::Allocation& allocation) const
+	{
+		return arenaPages[allocation.page].buffer->GetGPUVirtualAddress() + allocation.offset;
+	}
+};
@@ -0,0 +1,183 @@
+#include "Globals.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+static thread_local unsigned int threadIndex = 0;
+
+JobSystem::JobSystem(unsigned int numWorkers)
+{
+	if (numWorkers == 0)
+		numWorkers = std::max(2u, std::thread::hardware_concurrency()) - 1; // (0 when unknown: one worker)
+
+	for (unsigned i = 0; i <= numWorkers; ++i)
+		queues.push_back(std::make_unique<WorkerQueue>());
+
+	for (unsigned i = 1; i <= numWorkers; ++i)
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+JobSystem::JobHandle JobSystem::schedule(std::function<void()> task, const std::vector<JobHandle>& dependencies)
+{
+	JobHandle job = std::make_shared<Job>();
+	job->task = std::move(task);
+
+	// +1 so that it can't be queued by a dependency finishing while we are still registering the others
+	job->pendingDependencies = int(dependencies.size()) + 1;
+
+	for (const JobHandle& dependency : dependencies)
+	{
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+
+		if (dependency->done)
+			--job->pendingDependencies;
+		else
+			dependency->continuations.push_back(job);
+	}
+
+	if (--job->pendingDependencies == 0)
+		push(job);
+
+	return job;
+}
+
+bool JobSystem::isDone(const JobHandle& job) const
+{
+	std::lock_guard<std::mutex> lock(job->mutex);
+	return job->done;
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+	while (not isDone(job))
+	{
+		// Help instead of just sleeping (the job we wait for may even be in our own queue)
+		if (runOne(threadIndex)) continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait_for(lock, std::chrono::milliseconds(1), [&] { return queuedJobs > 0 or isDone(job); });
+	}
+}
+
+void JobSystem::waitAll(const std::vector<JobHandle>& jobs)
+{
+	for (const JobHandle& job : jobs)
+		wait(job);
+}
+
+unsigned int JobSystem::getThreadIndex()
+{
+	return threadIndex;
+}
+
+// Auxiliary functions //
+
+void JobSystem::workerLoop(unsigned int index)
+{
+	threadIndex = index;
+
+	while (running)
+	{
+		if (runOne(index)) continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [&] { return queuedJobs > 0 or not running; });
+	}
+}
+
+void JobSystem::push(const JobHandle& job)
+{
+	// Workers keep what they spawn (better locality), other threads spread jobs among the workers
+	unsigned int index = threadIndex;
+	if (index == 0 and not workers.empty())
+		index = 1 + nextQueue++ % unsigned(workers.size());
+
+	{
+		std::lock_guard<std::mutex> lock(queues[index]->mutex);
+		queues[index]->jobs.push_back(job);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		++queuedJobs;
+	}
+	sleepCondition.notify_one();
+}
+
+bool JobSystem::pop(unsigned int index, JobHandle& job)
+{
+	// 1. Newest job of our own queue (LIFO)
+	{
+		WorkerQueue& own = *queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (not own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			return true;
+		}
+	}
+
+	// 2. Steal the oldest job of someone else (FIFO)
+	for (size_t i = 1; i < queues.size(); ++i)
+	{
+		WorkerQueue& victim = *queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (not victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool JobSystem::runOne(unsigned int index)
+{
+	JobHandle job;
+	if (not pop(index, job)) return false;
+
+	--queuedJobs;
+	execute(job);
+
+	return true;
+}
+
+void JobSystem::execute(const JobHandle& job)
+{
+	job->task();
+
+	std::vector<JobHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->done = true;
+		continuations.swap(job->continuations);
+	}
+
+	for (const JobHandle& continuation : continuations)
+	{
+		if (--continuation->pendingDependencies == 0)
+			push(continuation);
+	}
+
+	// Wake up whoever is waiting for this job (taking the mutex so that a waiter can't miss it between its check and its sleep)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_all();
+}
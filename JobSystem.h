@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job system (no GPU code here): every worker owns a deque, takes its own jobs from the back
+// and steals from the front of the others when it runs out. Jobs can depend on other jobs (task graphs),
+// and they are only queued once all their dependencies are done.
+class JobSystem
+{
+public:
+
+	struct Job;
+	typedef std::shared_ptr<Job> JobHandle;
+
+	JobSystem(unsigned int numWorkers = 0); // 0 = one worker per core (minus the main thread)
+	~JobSystem();
+
+	JobHandle schedule(std::function<void()> task, const std::vector<JobHandle>& dependencies = {});
+
+	bool isDone(const JobHandle& job) const;
+	void wait(const JobHandle& job); // the calling thread runs jobs while waiting
+	void waitAll(const std::vector<JobHandle>& jobs);
+
+	inline unsigned int getWorkerCount() const { return unsigned(workers.size()); };
+	inline unsigned int getThreadCount() const { return getWorkerCount() + 1; }; // workers + the threads that schedule/wait
+
+	static unsigned int getThreadIndex(); // 1..N on workers, 0 on any other thread (e.g. for per-thread resources)
+
+	struct Job
+	{
+		std::function<void()> task;
+		std::atomic<int> pendingDependencies = 0;
+
+		std::mutex mutex; // (protects the two below)
+		bool done = false;
+		std::vector<JobHandle> continuations; // jobs waiting for this one
+	};
+
+private:
+
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkerQueue>> queues; // one per thread index (0 is for non worker threads)
+
+	std::atomic<unsigned int> nextQueue = 0; // round robin for jobs pushed from non worker threads
+	std::atomic<int> queuedJobs = 0;
+	std::atomic<bool> running = true;
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition; // wakes workers (new jobs) and waiters (finished jobs)
+
+	void workerLoop(unsigned int index);
+
+	void push(const JobHandle& job);
+	bool pop(unsigned int index, JobHandle& job); // own queue first, then steal
+	bool runOne(unsigned int index);
+	void execute(const JobHandle& job);
+};
@@ -2,10 +2,49 @@
 
 #include "Globals.h"
 
+#include <vector>
+
 class Module
 {
 public:
 
+    // Phases run by the ModuleScheduler
+    enum Phase
+    {
+        PHASE_INIT,
+        PHASE_UPDATE,
+        PHASE_PRE_RENDER,
+        PHASE_RENDER,
+        PHASE_POST_RENDER,
+        MAX_PHASES
+    };
+
+    // Shared state that modules read/write on each phase (modules whose sets don't conflict can run at the same time)
+    enum Access : unsigned int
+    {
+        ACCESS_NONE         = 0,
+        ACCESS_FRAME        = 1 << 0, // swap chain, current frame buffer, main command list, recording jobs
+        ACCESS_DEVICE       = 1 << 1, // creation of the device objects owned by D3D12Module
+        ACCESS_RESOURCES    = 1 << 2, // uploads (ModuleResources)
+        ACCESS_DESCRIPTORS  = 1 << 3, // shader descriptor and sampler heaps
+        ACCESS_INPUT        = 1 << 4, // keyboard/mouse state
+        ACCESS_CAMERA       = 1 << 5, // view/projection matrices
+        ACCESS_IMGUI        = 1 << 6, // ImGui context (+ editor options)
+        ACCESS_DEBUG_DRAW   = 1 << 7, // dd global context
+        ACCESS_SCENE        = 1 << 8, // loaded meshes, materials and instances (ModuleScene)
+        ACCESS_CULLING      = 1 << 9, // frustum planes of the frame (ModuleCulling)
+        ACCESS_PIPELINES    = 1 << 10, // pipeline cache and its library (ModulePipelines, its getters are thread safe once open)
+        ACCESS_SHADERS      = 1 << 11, // shader compilers and blob cache (ModuleShaders, thread safe once open)
+        ACCESS_ALL          = ~0u
+    };
+
+    struct PhaseAccess
+    {
+        unsigned int reads = ACCESS_ALL;  // by default a module conflicts with everything (runs alone, in registration order)
+        unsigned int writes = ACCESS_ALL;
+        bool mainThread = false;          // for things that must happen on the window thread
+    };
+
 	Module()
 	{
 	}
@@ -15,6 +54,8 @@ public:
 
     }
 
+    // Every phase, init() included, may run on a worker thread (ModuleScheduler): modules must not assume the window
+    // thread unless their access for that phase asks for it (setAccess(phase, ..., mainThread = true))
 	virtual bool init() 
 	{
 		return true; 
@@ -40,4 +81,18 @@ public:
 	{ 
 		return true; 
 	}
+
+    // Scheduling info //
+
+    inline void dependsOn(Module* module, Phase phase) { dependencies[phase].push_back(module); }; // module runs this phase before this one
+    inline void dependsOn(Module* module) { for (int phase = 0; phase < MAX_PHASES; ++phase) dependsOn(module, Phase(phase)); };
+    inline const std::vector<Module*>& getDependencies(Phase phase) const { return dependencies[phase]; };
+
+    inline void setAccess(Phase phase, unsigned int reads, unsigned int writes, bool mainThread = false) { access[phase] = { reads, writes, mainThread }; };
+    inline const PhaseAccess& getAccess(Phase phase) const { return access[phase]; };
+
+private:
+
+    std::vector<Module*> dependencies[MAX_PHASES];
+    PhaseAccess access[MAX_PHASES];
 };
@@ -16,6 +16,7 @@ public:
 
 	inline Matrix getProjectionMatrix() const { return projection; };
 	inline Matrix getViewMatrix() const { return view; };
+	inline Vector3 getPosition() const { return position; };
 
 
 private:
@@ -0,0 +1,26 @@
+#include "Globals.h"
+
+#include "Application.h"
+#include "ModuleCamera.h"
+
+#include "ModuleCulling.h"
+
+void ModuleCulling::update()
+{
+	ModuleCamera* cameraModule = app->getModuleCamera();
+
+	// View without its translation (rotation only for a look at matrix): a camera relative point goes straight to view space
+	Matrix relativeView = cameraModule->getViewMatrix();
+	relativeView._41 = relativeView._42 = relativeView._43 = 0.0f;
+
+	Matrix viewProjection = relativeView * cameraModule->getProjectionMatrix();
+	origin = cameraModule->getPosition();
+
+	FrustumCuller::Plane extracted[FrustumCuller::PLANE_COUNT];
+	FrustumCuller::extractPlanes(&viewProjection._11, extracted);
+
+	for (int i = 0; i < FrustumCuller::PLANE_COUNT; ++i)
+		planes[i] = Plane(extracted[i].a, extracted[i].b, extracted[i].c, extracted[i].d);
+
+	culler.setFrustum(extracted, &origin.x);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Module.h"
+#include "FrustumCuller.h"
+
+// Frustum of the camera for the current frame, to cull on the CPU before recording draws. The planes are camera relative
+// (the view translation is left out and the bounds are moved by -origin when tested), so they keep their precision far
+// from the world origin. Until the first update every plane is zero and everything is visible.
+class ModuleCulling : public Module
+{
+public:
+
+	ModuleCulling() { for (Plane& plane : planes) plane = Plane(0.0f, 0.0f, 0.0f, 0.0f); };
+
+	void update() override;
+
+	inline const Plane* getPlanes() const { return planes; }; // left, right, bottom, top, near, far (normalized, inside is positive)
+	inline const Vector3& getOrigin() const { return origin; }; // (camera position, the planes are relative to it)
+	inline const FrustumCuller& getCuller() const { return culler; }; // (same frustum, for other structures to test against)
+
+	// Indices of the bounds (world space) inside the frustum, see FrustumCuller::cull()
+	inline size_t cull(const FrustumCuller::Spheres& spheres, uint32_t* visible) const { return culler.cull(spheres, visible); };
+	inline size_t cull(const FrustumCuller::Boxes& boxes, uint32_t* visible) const { return culler.cull(boxes, visible); };
+
+private:
+
+	Plane planes[FrustumCuller::PLANE_COUNT];
+	Vector3 origin;
+
+	FrustumCuller culler;
+};
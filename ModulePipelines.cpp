@@ -0,0 +1,452 @@
+#include "Globals.h"
+#include "Application.h"
+#include "D3D12Module.h"
+#include "FileUtils.h"
+#include "JobSystem.h"
+#include "ModuleShaders.h"
+#include "ModuleSampler.h"
+
+#include "ModulePipelines.h"
+
+#include <deque>
+#include <string>
+
+static const char* LIBRARY_PATH = "Cache/Pipelines/pipelines.bin";
+
+namespace
+{
+	// Copy of a desc with everything it points to, for the compile jobs (the caller's shaders and layout are gone by then)
+	template<typename Desc>
+	struct DescCopy
+	{
+		Desc desc;
+		ComPtr<ID3D12RootSignature> rootSignature;
+		std::deque<std::vector<uint8_t>> shaders;
+		std::vector<D3D12_INPUT_ELEMENT_DESC> elements;
+		std::vector<D3D12_SO_DECLARATION_ENTRY> streamOutput;
+		std::vector<UINT> strides;
+		std::deque<std::string> semantics; // (a deque: the names keep their address)
+		std::wstring name;
+
+		DescCopy(const Desc& source, const wchar_t* name) : desc(source), rootSignature(source.pRootSignature), name(name ? name : L"")
+		{
+			desc.CachedPSO = {};
+		}
+
+		void copy(D3D12_SHADER_BYTECODE& shader)
+		{
+			if (not shader.pShaderBytecode or shader.BytecodeLength == 0) return;
+
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(shader.pShaderBytecode);
+			shaders.emplace_back(bytes, bytes + shader.BytecodeLength);
+			shader.pShaderBytecode = shaders.back().data();
+		}
+
+		const char* copy(const char* semantic)
+		{
+			if (not semantic) return nullptr;
+
+			semantics.emplace_back(semantic);
+			return semantics.back().c_str();
+		}
+
+		inline const wchar_t* getName() const { return name.empty() ? nullptr : name.c_str(); };
+	};
+
+	std::shared_ptr<DescCopy<D3D12_GRAPHICS_PIPELINE_STATE_DESC>> copyDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& source, const wchar_t* name)
+	{
+		auto copy = std::make_shared<DescCopy<D3D12_GRAPHICS_PIPELINE_STATE_DESC>>(source, name);
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc = copy->desc;
+
+		for (D3D12_SHADER_BYTECODE* shader : { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS }) copy->copy(*shader);
+
+		if (desc.InputLayout.pInputElementDescs)
+		{
+			copy->elements.assign(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + desc.InputLayout.NumElements);
+			for (D3D12_INPUT_ELEMENT_DESC& element : copy->elements) element.SemanticName = copy->copy(element.SemanticName);
+			desc.InputLayout.pInputElementDescs = copy->elements.data();
+		}
+
+		if (desc.StreamOutput.pSODeclaration)
+		{
+			copy->streamOutput.assign(desc.StreamOutput.pSODeclaration, desc.StreamOutput.pSODeclaration + desc.StreamOutput.NumEntries);
+			for (D3D12_SO_DECLARATION_ENTRY& entry : copy->streamOutput) entry.SemanticName = copy->copy(entry.SemanticName);
+			desc.StreamOutput.pSODeclaration = copy->streamOutput.data();
+		}
+
+		if (desc.StreamOutput.pBufferStrides)
+		{
+			copy->strides.assign(desc.StreamOutput.pBufferStrides, desc.StreamOutput.pBufferStrides + desc.StreamOutput.NumStrides);
+			desc.StreamOutput.pBufferStrides = copy->strides.data();
+		}
+
+		return copy;
+	}
+
+	std::shared_ptr<DescCopy<D3D12_COMPUTE_PIPELINE_STATE_DESC>> copyDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& source, const wchar_t* name)
+	{
+		auto copy = std::make_shared<DescCopy<D3D12_COMPUTE_PIPELINE_STATE_DESC>>(source, name);
+		copy->copy(copy->desc.CS);
+
+		return copy;
+	}
+
+	// Hot reload: the stages whose shaders came from ModuleShaders (shaders gets their ids), and a rebuild of the copy
+	// with the current blobs of those (null if there are none: nothing to reload)
+	template<typename Desc>
+	std::function<ComPtr<ID3D12PipelineState>()> makeRebuild(ModulePipelines* pipelines, const Desc& source, const std::shared_ptr<DescCopy<Desc>>& copy,
+															 std::initializer_list<D3D12_SHADER_BYTECODE Desc::*> members, std::vector<uint32_t>& shaders)
+	{
+		ModuleShaders* shaderModule = app->getModuleShaders();
+		std::vector<std::pair<D3D12_SHADER_BYTECODE Desc::*, ModuleShaders::ShaderId>> stages;
+
+		for (D3D12_SHADER_BYTECODE Desc::*member : members)
+		{
+			ModuleShaders::ShaderId shader = shaderModule ? shaderModule->findShader(source.*member) : 0; // (by address: the caller's blob)
+			if (shader == 0) continue;
+
+			stages.emplace_back(member, shader);
+			shaders.push_back(shader);
+		}
+
+		if (stages.empty()) return nullptr;
+
+		return [pipelines, shaderModule, copy, stages]() {
+			Desc desc = copy->desc;
+			std::vector<ModuleShaders::ShaderBlob> blobs; // (alive until the pipeline is created)
+
+			for (const auto& stage : stages)
+			{
+				blobs.push_back(shaderModule->getCurrentShader(stage.second));
+				desc.*stage.first = ModuleShaders::getBytecode(blobs.back());
+			}
+
+			return pipelines->getPipeline(desc, copy->getName(), false); // (not to the library: edited shaders would pile up there)
+		};
+	}
+}
+
+bool ModulePipelines::init()
+{
+	device = app->getD3D12Module()->getDevice();
+	libraryPath = LIBRARY_PATH;
+
+	// A library from another driver or GPU fails to open: start an empty one (saved over it)
+	std::error_code error;
+	bool found = std::filesystem::exists(libraryPath, error) and FileUtils::readFile(libraryPath, libraryData) and not libraryData.empty();
+	if (found and FAILED(device->CreatePipelineLibrary(libraryData.data(), libraryData.size(), IID_PPV_ARGS(&library))))
+	{
+		LOG("Pipeline library %s doesn't match this driver, pipelines will be compiled again", libraryPath.string().c_str());
+		libraryData.clear();
+		library.Reset();
+	}
+
+	if (not library and FAILED(device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library))))
+	{
+		LOG("Pipeline libraries not supported, pipelines are only shared in memory");
+		library.Reset();
+	}
+
+	compileQueue = std::make_unique<CompileQueue>(app->getJobSystem());
+
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE feature = { D3D_ROOT_SIGNATURE_VERSION_1_1 };
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &feature, sizeof(feature)))) rootSignatureVersion = feature.HighestVersion;
+	else LOG("Root signature 1.1 not supported, root signatures are created as 1.0 (no static data)");
+
+	bindlessSignature = createBindlessSignature();
+
+	return bindlessSignature != nullptr;
+}
+
+bool ModulePipelines::cleanUp()
+{
+	compileQueue.reset(); // (drops the queued compiles, waits for the running ones: they store in the library)
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	LOG("Pipelines: %u requests, %u created, %u loaded from the library", stats.requests, stats.created, stats.loaded);
+	LOG("Root signatures: %u requests, %u created", stats.rootSignatureRequests, stats.rootSignaturesCreated);
+
+	if (library and libraryChanged)
+	{
+		std::vector<uint8_t> serialized(library->GetSerializedSize());
+
+		bool ok = SUCCEEDED(library->Serialize(serialized.data(), serialized.size())) and FileUtils::writeFile(libraryPath, serialized);
+		if (not ok) LOG("Pipeline library could not be saved to %s", libraryPath.string().c_str());
+
+		libraryChanged = not ok;
+	}
+
+	return true; // (the pipelines and the library are released with the module, after the passes that use them)
+}
+
+ComPtr<ID3D12RootSignature> ModulePipelines::getRootSignature(const D3D12_ROOT_SIGNATURE_DESC& desc, RootSignatureDesc::Upgrade upgrade, const wchar_t* name)
+{
+	return getRootSignature(RootSignatureDesc(desc, upgrade), name);
+}
+
+ComPtr<ID3D12RootSignature> ModulePipelines::getRootSignature(const D3D12_ROOT_SIGNATURE_DESC1& desc, const wchar_t* name)
+{
+	return getRootSignature(RootSignatureDesc(desc), name);
+}
+
+ComPtr<ID3D12PipelineState> ModulePipelines::getPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const wchar_t* name, bool store)
+{
+	RootSignature rootSignature = findRootSignature(desc.pRootSignature);
+	PipelineKey key(desc, rootSignature.id);
+
+	ComPtr<ID3D12PipelineState> pipeline = find(key);
+	if (pipeline) return pipeline;
+
+	// Compiled outside the lock (other threads keep getting theirs meanwhile, the ones asking for this key wait for it)
+	bool loaded = rootSignature.persistent and library and SUCCEEDED(library->LoadGraphicsPipeline(key.getName().c_str(), &desc, IID_PPV_ARGS(&pipeline)));
+	if (not loaded and FAILED(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipeline)))) pipeline = nullptr;
+
+	return add(key, rootSignature.persistent and store, loaded, pipeline, name);
+}
+
+ComPtr<ID3D12PipelineState> ModulePipelines::getPipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const wchar_t* name, bool store)
+{
+	RootSignature rootSignature = findRootSignature(desc.pRootSignature);
+	PipelineKey key(desc, rootSignature.id);
+
+	ComPtr<ID3D12PipelineState> pipeline = find(key);
+	if (pipeline) return pipeline;
+
+	bool loaded = rootSignature.persistent and library and SUCCEEDED(library->LoadComputePipeline(key.getName().c_str(), &desc, IID_PPV_ARGS(&pipeline)));
+	if (not loaded and FAILED(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pipeline)))) pipeline = nullptr;
+
+	return add(key, rootSignature.persistent and store, loaded, pipeline, name);
+}
+
+ModulePipelines::PipelineHandle ModulePipelines::requestPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const wchar_t* name, PipelineHandle fallback)
+{
+	PipelineKey key(desc, findRootSignature(desc.pRootSignature).id);
+
+	PipelineHandle handle = findRequest(key);
+	if (handle != 0) return handle;
+
+	auto copy = copyDesc(desc, name);
+	handle = request(key, [this, copy]() { return getPipeline(copy->desc, copy->getName()); }, fallback);
+
+	std::vector<uint32_t> shaders;
+	track(handle, makeRebuild(this, desc, copy, { &D3D12_GRAPHICS_PIPELINE_STATE_DESC::VS, &D3D12_GRAPHICS_PIPELINE_STATE_DESC::PS, &D3D12_GRAPHICS_PIPELINE_STATE_DESC::DS,
+											  &D3D12_GRAPHICS_PIPELINE_STATE_DESC::HS, &D3D12_GRAPHICS_PIPELINE_STATE_DESC::GS }, shaders), shaders);
+
+	return handle;
+}
+
+ModulePipelines::PipelineHandle ModulePipelines::requestPipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const wchar_t* name, PipelineHandle fallback)
+{
+	PipelineKey key(desc, findRootSignature(desc.pRootSignature).id);
+
+	PipelineHandle handle = findRequest(key);
+	if (handle != 0) return handle;
+
+	auto copy = copyDesc(desc, name);
+	handle = request(key, [this, copy]() { return getPipeline(copy->desc, copy->getName()); }, fallback);
+
+	std::vector<uint32_t> shaders;
+	track(handle, makeRebuild(this, desc, copy, { &D3D12_COMPUTE_PIPELINE_STATE_DESC::CS }, shaders), shaders);
+
+	return handle;
+}
+
+ModulePipelines::PipelineHandle ModulePipelines::addPipeline(const ComPtr<ID3D12PipelineState>& pipeline)
+{
+	return compileQueue ? compileQueue->add(pipeline) : 0;
+}
+
+bool ModulePipelines::rebuildPipeline(PipelineHandle handle)
+{
+	Rebuild rebuild;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = reloadables.find(handle);
+		if (it == reloadables.end()) return false;
+		rebuild = it->second.rebuild;
+	}
+
+	ComPtr<ID3D12PipelineState> pipeline = rebuild(); // (outside the lock, as any other compile)
+	if (not pipeline) return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	reloadables[handle].rebuilt = pipeline;
+	return true;
+}
+
+void ModulePipelines::swapPipeline(PipelineHandle handle)
+{
+	ComPtr<ID3D12PipelineState> pipeline;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = reloadables.find(handle);
+		if (it != reloadables.end()) pipeline = std::move(it->second.rebuilt);
+	}
+
+	// (the one replaced stays in pipelines, the frames still in flight keep using it)
+	if (pipeline and compileQueue) compileQueue->replace(handle, pipeline);
+}
+
+ModulePipelines::Stats ModulePipelines::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+ComPtr<ID3D12RootSignature> ModulePipelines::getRootSignature(const RootSignatureDesc& desc, const wchar_t* name)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++stats.rootSignatureRequests;
+
+		auto it = sharedSignatures.find(desc.getKey());
+		if (it != sharedSignatures.end()) return it->second;
+	}
+
+	ComPtr<ID3DBlob> blob, errors;
+	HRESULT result = E_FAIL;
+
+	if (rootSignatureVersion >= D3D_ROOT_SIGNATURE_VERSION_1_1) result = D3D12SerializeVersionedRootSignature(&desc.getDesc(), &blob, &errors);
+	else
+	{
+		std::vector<D3D12_ROOT_PARAMETER> parameters;
+		std::vector<D3D12_DESCRIPTOR_RANGE> ranges;
+		D3D12_ROOT_SIGNATURE_DESC desc10 = desc.getDesc_1_0(parameters, ranges);
+
+		result = D3D12SerializeRootSignature(&desc10, D3D_ROOT_SIGNATURE_VERSION_1, &blob, &errors);
+	}
+
+	ComPtr<ID3D12RootSignature> rootSignature;
+	if (FAILED(result) or FAILED(device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&rootSignature))))
+	{
+		LOG("Root signature %ls could not be created: %s", name ? name : L"", errors ? reinterpret_cast<const char*>(errors->GetBufferPointer()) : "");
+		return nullptr;
+	}
+
+	if (name) rootSignature->SetName(name);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto inserted = sharedSignatures.emplace(desc.getKey(), rootSignature);
+	if (not inserted.second) return inserted.first->second; // (another thread got it first)
+
+	++stats.rootSignaturesCreated;
+
+	RootSignature& entry = rootSignatures[rootSignature.Get()];
+	entry.signature = rootSignature;
+	entry.id = desc.getHash();
+	entry.persistent = true;
+
+	return rootSignature;
+}
+
+ComPtr<ID3D12RootSignature> ModulePipelines::createBindlessSignature()
+{
+	// Volatile descriptors: passes point the tables anywhere in the heaps (e.g. a sampler type past the heap start), and
+	// unbounded tables can't be static. The root CBV only has to be there while it's set.
+	CD3DX12_DESCRIPTOR_RANGE1 textureRange, samplerRange;
+	textureRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+	samplerRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, ModuleSampler::MAX_SAMPLERS, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+
+	CD3DX12_ROOT_PARAMETER1 rootParameters[BINDLESS_PARAMETER_COUNT] = {};
+	rootParameters[BINDLESS_CONSTANTS].InitAsConstants(BINDLESS_CONSTANT_COUNT, 0);
+	rootParameters[BINDLESS_TEXTURES].InitAsDescriptorTable(1, &textureRange);
+	rootParameters[BINDLESS_SAMPLERS].InitAsDescriptorTable(1, &samplerRange);
+	rootParameters[BINDLESS_CONSTANT_BUFFER].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+	D3D12_ROOT_SIGNATURE_DESC1 desc = { UINT(std::size(rootParameters)), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT };
+
+	return getRootSignature(desc, L"Bindless");
+}
+
+ModulePipelines::RootSignature ModulePipelines::findRootSignature(ID3D12RootSignature* rootSignature)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = rootSignatures.find(rootSignature);
+	if (it != rootSignatures.end()) return it->second;
+
+	RootSignature entry;
+	entry.signature = rootSignature;
+	entry.id = uint64_t(uintptr_t(rootSignature));
+	entry.persistent = rootSignature == nullptr; // (root signature in the shaders, their hash covers it)
+
+	if (rootSignature) rootSignatures[rootSignature] = entry;
+
+	return entry;
+}
+
+ComPtr<ID3D12PipelineState> ModulePipelines::find(const PipelineKey& key)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	++stats.requests;
+
+	// Only one thread loads or compiles a key (the library can't load a name twice at once), the rest wait for it
+	while (true)
+	{
+		auto it = pipelines.find(key);
+		if (it != pipelines.end()) return it->second;
+
+		if (inFlight.insert(key).second) return nullptr; // (this one does it, and add()s the result)
+
+		inFlightDone.wait(lock);
+	}
+}
+
+ComPtr<ID3D12PipelineState> ModulePipelines::add(const PipelineKey& key, bool persistent, bool loaded, const ComPtr<ID3D12PipelineState>& pipeline, const wchar_t* name)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	inFlight.erase(key);
+	inFlightDone.notify_all(); // (if it failed, the next one waiting tries)
+
+	if (not pipeline) return nullptr;
+
+	auto inserted = pipelines.emplace(key, pipeline);
+	if (not inserted.second) return inserted.first->second; // (another thread got it first, this one is dropped)
+
+	if (name) pipeline->SetName(name);
+
+	if (loaded) ++stats.loaded;
+	else ++stats.created;
+
+	// The library refuses names it already has (a stale pipeline under the same key): that one just isn't stored
+	if (persistent and not loaded and library and SUCCEEDED(library->StorePipeline(key.getName().c_str(), pipeline.Get())))
+		libraryChanged = true;
+
+	return pipeline;
+}
+
+ModulePipelines::PipelineHandle ModulePipelines::request(const PipelineKey& key, CompileQueue::Compile compile, PipelineHandle fallback)
+{
+	if (not compileQueue) return 0;
+
+	// Queued outside the lock (two threads asking at once both queue it: the second compile finds the first pipeline)
+	PipelineHandle handle = compileQueue->request(std::move(compile), fallback);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return requests.emplace(key, handle).first->second;
+}
+
+void ModulePipelines::track(PipelineHandle handle, Rebuild rebuild, const std::vector<uint32_t>& shaders)
+{
+	if (handle == 0 or not rebuild) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		reloadables[handle].rebuild = std::move(rebuild);
+	}
+
+	app->getModuleShaders()->trackPipeline(handle, shaders);
+}
+
+ModulePipelines::PipelineHandle ModulePipelines::findRequest(const PipelineKey& key) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = requests.find(key);
+	return it != requests.end() ? it->second : 0;
+}
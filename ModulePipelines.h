@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Module.h"
+#include "PipelineKey.h"
+#include "PipelineCompileQueue.h"
+#include "RootSignatureDesc.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// Pipeline state cache: every pass gets its pipelines from here instead of creating them. Identical descs (same
+// PipelineKey) share one pipeline, and pipelines are stored in an ID3D12PipelineLibrary saved in Cache/Pipelines on
+// cleanUp, so the next run loads them instead of having the driver compile them again. Pipelines can also be requested
+// in the background (jobs compile them while the passes draw with a fallback or skip the draw). Requested pipelines
+// with shaders from ModuleShaders::getShader are rebuilt when those are reloaded: the handle stays, its pipeline is
+// swapped. Root signatures come from here too: descs that create the same one (see RootSignatureDesc) share it, so
+// passes that draw one after the other don't rebind, and there is a bindless one for passes that fit in it. Thread safe.
+class ModulePipelines : public Module
+{
+public:
+
+	typedef PipelineCompileQueue<ComPtr<ID3D12PipelineState>> CompileQueue;
+	typedef CompileQueue::Handle PipelineHandle; // (0 = none)
+
+	// The bindless root signature: root constants (b0), every texture of the shader descriptor heap from the table's
+	// start (t0...), the samplers of ModuleSampler (s0...) and a root CBV (b1). Passes set the parameters they use.
+	enum BindlessParameter
+	{
+		BINDLESS_CONSTANTS,
+		BINDLESS_TEXTURES,
+		BINDLESS_SAMPLERS,
+		BINDLESS_CONSTANT_BUFFER,
+		BINDLESS_PARAMETER_COUNT
+	};
+
+	static constexpr UINT BINDLESS_CONSTANT_COUNT = 16; // (a matrix)
+
+	struct Stats
+	{
+		uint32_t requests = 0;
+		uint32_t created = 0; // (compiled by the driver)
+		uint32_t loaded = 0;  // from the library
+		uint32_t rootSignatureRequests = 0;
+		uint32_t rootSignaturesCreated = 0;
+	};
+
+	bool init() override;    // opens the library of the last run (an empty one if it doesn't match this driver)
+	bool cleanUp() override; // saves it if pipelines were added
+
+	// The root signature for the desc (null if it couldn't be created), created as 1.1 when the device has it. Pipelines
+	// with root signatures from here go to the library (the canonical hash is part of their key), the ones with root
+	// signatures created elsewhere (their id is the pointer) are only shared in memory. Name is the first request's.
+	ComPtr<ID3D12RootSignature> getRootSignature(const D3D12_ROOT_SIGNATURE_DESC& desc, RootSignatureDesc::Upgrade upgrade = RootSignatureDesc::UPGRADE_VOLATILE,
+												 const wchar_t* name = nullptr);
+	ComPtr<ID3D12RootSignature> getRootSignature(const D3D12_ROOT_SIGNATURE_DESC1& desc, const wchar_t* name = nullptr);
+
+	inline ID3D12RootSignature* getBindlessRootSignature() const { return bindlessSignature.Get(); };
+
+	// The pipeline for the desc (null if it couldn't be created); name is only for debugging tools. Store = false keeps a
+	// new one out of the library (e.g. the hot reload ones: their shaders are being edited, the next run won't have them)
+	ComPtr<ID3D12PipelineState> getPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const wchar_t* name = nullptr, bool store = true);
+	ComPtr<ID3D12PipelineState> getPipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const wchar_t* name = nullptr, bool store = true);
+
+	// Compiled by a job (the desc is copied, nothing it points to has to outlive the call): the handle is there right
+	// away, getPipeline(handle) returns its fallback (or null: skip the draw) until it's ready. Same desc, same handle.
+	PipelineHandle requestPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const wchar_t* name = nullptr, PipelineHandle fallback = 0);
+	PipelineHandle requestPipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const wchar_t* name = nullptr, PipelineHandle fallback = 0);
+	PipelineHandle addPipeline(const ComPtr<ID3D12PipelineState>& pipeline); // (e.g. a fallback from getPipeline(desc))
+
+	inline ComPtr<ID3D12PipelineState> getPipeline(PipelineHandle handle) const { return compileQueue ? compileQueue->get(handle) : nullptr; };
+	inline bool isReady(PipelineHandle handle) const { return compileQueue and compileQueue->isReady(handle); };
+	inline bool hasFailed(PipelineHandle handle) const { return compileQueue and compileQueue->getState(handle) == CompileQueue::STATE_FAILED; };
+	inline void waitForPipelines() { if (compileQueue) compileQueue->waitAll(); }; // (e.g. before measuring)
+
+	// Shader hot reload (ModuleShaders): the pipeline with the current shaders, kept aside (any thread), then put under
+	// its handle (at a frame boundary). Replaced pipelines stay alive with the module, frames in flight may use them.
+	bool rebuildPipeline(PipelineHandle handle);
+	void swapPipeline(PipelineHandle handle);
+
+	Stats getStats() const;
+
+private:
+
+	typedef std::function<ComPtr<ID3D12PipelineState>()> Rebuild;
+
+	struct Reloadable
+	{
+		Rebuild rebuild;
+		ComPtr<ID3D12PipelineState> rebuilt; // (until swapped)
+	};
+
+	struct RootSignature
+	{
+		ComPtr<ID3D12RootSignature> signature; // (kept alive: its address must not be reused by another one)
+		uint64_t id = 0;
+		bool persistent = false;
+	};
+
+	ID3D12Device5* device = nullptr;
+	D3D_ROOT_SIGNATURE_VERSION rootSignatureVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+
+	std::vector<uint8_t> libraryData; // (must outlive the library, which points to it)
+	ComPtr<ID3D12PipelineLibrary> library;
+	std::filesystem::path libraryPath;
+	bool libraryChanged = false;
+
+	mutable std::mutex mutex;
+	std::unordered_map<ID3D12RootSignature*, RootSignature> rootSignatures;
+	std::unordered_map<std::vector<uint8_t>, ComPtr<ID3D12RootSignature>, RootSignatureDesc::KeyHasher> sharedSignatures; // (by canonical key)
+	std::unordered_map<PipelineKey, ComPtr<ID3D12PipelineState>, PipelineKey::Hasher> pipelines;
+	std::unordered_set<PipelineKey, PipelineKey::Hasher> inFlight; // (being loaded or compiled)
+	std::condition_variable inFlightDone;
+	std::unordered_map<PipelineKey, PipelineHandle, PipelineKey::Hasher> requests;
+	std::unordered_map<PipelineHandle, Reloadable> reloadables;
+	Stats stats;
+
+	std::unique_ptr<CompileQueue> compileQueue;
+	ComPtr<ID3D12RootSignature> bindlessSignature;
+
+	ComPtr<ID3D12RootSignature> getRootSignature(const RootSignatureDesc& desc, const wchar_t* name);
+	ComPtr<ID3D12RootSignature> createBindlessSignature();
+	RootSignature findRootSignature(ID3D12RootSignature* rootSignature);
+	ComPtr<ID3D12PipelineState> find(const PipelineKey& key); // (null: the caller loads or compiles it and add()s it, even if it fails)
+	ComPtr<ID3D12PipelineState> add(const PipelineKey& key, bool persistent, bool loaded, const ComPtr<ID3D12PipelineState>& pipeline, const wchar_t* name);
+	PipelineHandle findRequest(const PipelineKey& key) const;
+	PipelineHandle request(const PipelineKey& key, CompileQueue::Compile compile, PipelineHandle fallback);
+	void track(PipelineHandle handle, Rebuild rebuild, const std::vector<uint32_t>& shaders);
+};
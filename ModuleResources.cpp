@@ -1,93 +1,159 @@
+
 #include "Globals.h"
 #include "Application.h" 
 
 #include "ModuleResources.h"
+#include "ModuleShaderDescriptors.h"
+#include "TextureCooker.h"
 #include "DirectXTex.h"
 
+#include <algorithm>
+
 bool ModuleResources::init() {
 
     bool ok;
 
     ID3D12Device5* device = (app->getD3D12Module())->getDevice();
 
-    // Command list and allocator initialization
-    ok = SUCCEEDED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator)) );
+    // Dedicated copy queue, so uploads don't have to go through (and stall) the draw queue
+    D3D12_COMMAND_QUEUE_DESC desc = {};
+    desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+    desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    desc.NodeMask = 0;
+
+    ok = SUCCEEDED(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&copyQueue)));
+    if (ok) copyQueue->SetName(L"Upload Copy Queue");
+
+    // Command list and allocators initialization
+    for (unsigned i = 0; ok && i < UPLOAD_ALLOCATORS; ++i)
+        ok = SUCCEEDED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocators[i])) );
+
     if (ok) {
-        ok = SUCCEEDED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+        ok = SUCCEEDED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, commandAllocators[0].Get(), nullptr, IID_PPV_ARGS(&commandList)));
         if (ok)
             ok = SUCCEEDED(commandList->Close());
     }
 
+    // Fence for the copy queue (its values are the upload tickets)
+    ok = ok and SUCCEEDED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&copyFence)));
+    if (ok) {
+        copyEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        ok = copyEvent != NULL;
+    }
+
+    // Upload ring: a single big upload buffer, mapped once and suballocated for every copy
+    if (ok) {
+        D3D12_RESOURCE_DESC ringDesc = CD3DX12_RESOURCE_DESC::Buffer(UPLOAD_RING_SIZE);
+        CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+
+        ok = SUCCEEDED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &ringDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadRing)));
+        if (ok) {
+            uploadRing->SetName(L"Upload Ring");
+
+            CD3DX12_RANGE readRange(0, 0); // We won't read from it, so range is (0,0)
+            ok = SUCCEEDED(uploadRing->Map(0, &readRange, reinterpret_cast<void**>(&uploadRingData)));
+        }
+
+        uploadRingAllocator.reset(UPLOAD_RING_SIZE);
+    }
+
+    residency.setMaxLoadPerUpdate(TEXTURE_STREAMING_UPLOAD);
+
     return ok;
 }
 
-bool ModuleResources::CreateUploadBuffer(const void* buffer, std::size_t numBytes, ComPtr<ID3D12Resource>& uploadBuffer, const LPCWSTR name)
+void ModuleResources::preRender()
 {
-    bool ok;
+    releaseFinishedUploads();
+    updateStreaming();
+}
 
-    // 1. Describe the buffer
-    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(numBytes);
+bool ModuleResources::cleanUp()
+{
+    // Decode jobs write into the streamed textures
+    for (const std::unique_ptr<Streamed>& texture : streamed)
+        if (texture and texture->decodeJob) app->getJobSystem()->wait(texture->decodeJob);
 
-    // 2. Specify UPLOAD heap properties
-    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+    if (batchOpen) endUploadBatch();
 
-    // 3. Create the resource
-    ID3D12Device5* device = (app->getD3D12Module())->getDevice();
-    ok = SUCCEEDED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer)) );
+    // Copies may still be running, wait before releasing the staging buffers
+    if (copyFence) waitForUpload(lastSubmittedTicket);
+    pendingUploads.clear();
 
-    if (ok){
-        uploadBuffer->SetName(name);
+    if (uploadRingData != nullptr) {
+        uploadRing->Unmap(0, nullptr);
+        uploadRingData = nullptr;
+    }
 
-        // 4. Map the buffer: get a CPU pointer to its memory
-        BYTE* pData = nullptr;
-        CD3DX12_RANGE readRange(0, 0); // We won't read from it, so range is (0,0)
-        ok = SUCCEEDED(uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pData)) );
+    bool ok = true;
+    if (copyEvent != nullptr) {
+        ok = CloseHandle(copyEvent);
+        copyEvent = nullptr;
+    }
 
-        if (ok) {
-            // 5. Copy our application data into the GPU buffer
-            memcpy(pData, buffer, numBytes);
+    return ok;
+}
 
-            // 6. Unmap the buffer (invalidate the pointer)
-            uploadBuffer->Unmap(0, nullptr);
-        }
+bool ModuleResources::allocateUpload(std::size_t numBytes, std::size_t alignment, UploadAllocation& upload)
+{
+    size_t offset = uploadRingAllocator.allocate(numBytes, alignment);
+
+    // No room: wait for the oldest copies in flight, so that their regions are recycled
+    while (offset == RingAllocator::INVALID_OFFSET and uploadRingAllocator.hasBatchesInFlight())
+    {
+        waitForUpload(uploadRingAllocator.getOldestFenceValue());
+        uploadRingAllocator.release(copyFence->GetCompletedValue());
+
+        offset = uploadRingAllocator.allocate(numBytes, alignment);
     }
 
-    return ok;
+    if (offset == RingAllocator::INVALID_OFFSET) // bigger than the ring (or the open batch already filled it)
+        return createCommittedUpload(numBytes, upload);
+
+    upload.resource = uploadRing;
+    upload.offset = offset;
+    upload.data = uploadRingData + offset;
+
+    return true;
 }
 
-bool ModuleResources::CreateDefaultBuffer(const ComPtr<ID3D12Resource>& uploadBuffer, std::size_t numBytes, ComPtr<ID3D12Resource>& defaultBuffer, const LPCWSTR name)
+bool ModuleResources::CreateUploadBuffer(const void* buffer, std::size_t numBytes, UploadAllocation& upload)
 {
-    bool ok;
+    // 1. Get a region of the upload ring (aligned so that it could also be read as a constant buffer)
+    if (not allocateUpload(numBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, upload)) return false;
 
-    D3D12Module* d3d12module = app->getD3D12Module();
+    // 2. Copy our application data into it (the ring stays mapped, no Map/Unmap needed)
+    memcpy(upload.data, buffer, numBytes);
+
+    return true;
+}
+
+bool ModuleResources::CreateDefaultBuffer(const UploadAllocation& upload, std::size_t numBytes, ComPtr<ID3D12Resource>& defaultBuffer, const LPCWSTR name)
+{
+    bool ok;
 
     // 1. CREATE THE FINAL GPU BUFFER (DEFAULT HEAP)
     CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
     D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(numBytes);
 
-    ID3D12Device5* device = d3d12module->getDevice();
-    ok = SUCCEEDED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&defaultBuffer)) );
+    // (created in COMMON: it is promoted to COPY_DEST by the copy, and decays back to COMMON when the copy queue is done)
+    ID3D12Device5* device = (app->getD3D12Module())->getDevice();
+    ok = SUCCEEDED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&defaultBuffer)) );
 
     if (ok) {
         defaultBuffer->SetName(name);
 
-        // 2. SEND COPY COMMAND FROM UPLOAD TO DEFAULT
-
-        ok = ok and SUCCEEDED(commandAllocator->Reset() ); // empty previous commands so that it doesn't fill up
-        ok = ok and SUCCEEDED(commandList->Reset(commandAllocator.Get(), nullptr) );
+        // 2. RECORD COPY COMMAND FROM UPLOAD TO DEFAULT (in the current batch, or in a batch of its own)
 
-        // Copy command (we do not need resource barriers here, since it is not a render operation)
-        commandList->CopyResource(defaultBuffer.Get(), uploadBuffer.Get());
+        bool ownBatch = not batchOpen;
+        if (ownBatch) ok = beginUploadBatch();
 
-        ok = ok and SUCCEEDED(commandList->Close());
         if (ok) {
+            // Copy command (we do not need resource barriers here, since it is not a render operation)
+            commandList->CopyBufferRegion(defaultBuffer.Get(), 0, upload.resource.Get(), upload.offset, numBytes);
 
-            ID3D12CommandList* listsToExecute[] = { commandList.Get() };
-            ID3D12CommandQueue* queue = d3d12module->getCommandQueue();
-            queue->ExecuteCommandLists(UINT(std::size(listsToExecute)), listsToExecute);
-
-            // Now we wait so that the copy is finished (and thus it is ready if we need to use the data)
-            d3d12module->flush();
+            if (ownBatch) ok = endUploadBatch() != 0;
         }
     }
     return ok;
@@ -97,11 +163,11 @@ bool ModuleResources::createTextureFromFile(const std::filesystem::path& path, C
 {
 
     ScratchImage image;
-    bool ok = SUCCEEDED(LoadFromDDSFile(path.native().c_str(), DDS_FLAGS_NONE, nullptr, image)); // native().cstr() only on Windows!
+    bool ok = TextureCooker::load(path, app->getJobSystem(), image); // dds as is, png/jpg... cooked (from the cache after the first time)
 
     if (not ok)
     {
-        ok = SUCCEEDED(LoadFromTGAFile(path.native().c_str(), nullptr, image));
+        ok = SUCCEEDED(LoadFromTGAFile(path.native().c_str(), nullptr, image)); // native().cstr() only on Windows!
         if (not ok)
         {
             ok = SUCCEEDED(LoadFromWICFile(path.native().c_str(), WIC_FLAGS_NONE, nullptr, image));
@@ -113,12 +179,8 @@ bool ModuleResources::createTextureFromFile(const std::filesystem::path& path, C
 
 bool ModuleResources::createTextureFromScratchImg(ScratchImage& image, ComPtr<ID3D12Resource>& texture, const LPCWSTR name)
 {
-    D3D12Module* d3d12module = app->getD3D12Module();
-
-    TexMetadata metaData = image.GetMetadata();
-
-    // If the given image doesn't have mipmaps, we create them
-    if (metaData.mipLevels == 1)
+    // If the given image doesn't have mipmaps, we create them (and continue with the new image)
+    if (image.GetMetadata().mipLevels == 1)
     {
         ScratchImage imageWithMips;
 
@@ -131,130 +193,348 @@ bool ModuleResources::createTextureFromScratchImg(ScratchImage& image, ComPtr<ID
         )))
             return false;
 
-       TexMetadata metaDataWithMips = imageWithMips.GetMetadata();
+        image = std::move(imageWithMips);
+    }
 
-       // (we continue with the new image and metadata with mipmaps) <- PROBABLY YOU WILL WANT TO CHANGE SO THAT ONLY THE DIFFERENT PART IS DONE INSIDE THE IF
+    return createTextureFromMips(image, 0, texture, name);
+}
 
-       // 1. Create texture resource in default heap
+bool ModuleResources::createTextureFromMips(const ScratchImage& image, size_t firstMip, ComPtr<ID3D12Resource>& texture, const LPCWSTR name, UploadTicket* ticket)
+{
+    TexMetadata metaData = image.GetMetadata();
+    const DirectX::Image* top = image.GetImage(firstMip, 0, 0);
+    UINT16 mipLevels = UINT16(metaData.mipLevels - firstMip);
 
-       D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(metaDataWithMips.format, UINT64(metaDataWithMips.width), UINT(metaDataWithMips.height), UINT16(metaDataWithMips.arraySize), UINT16(metaDataWithMips.mipLevels));
-       CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
+    // 1. Create texture resource in default heap (COMMON, same as buffers: the copy queue can't transition to shader resource states,
+    //    the texture decays to COMMON after the copy and is promoted to PIXEL_SHADER_RESOURCE on its first use)
 
-       ID3D12Device5* device = d3d12module->getDevice();
-       if (FAILED(device->CreateCommittedResource(&heap, D3D12_HEAP_FLAG_NONE, &textureDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&texture))))
-           return false;
+    D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(metaData.format, UINT64(top->width), UINT(top->height), UINT16(metaData.arraySize), mipLevels);
+    CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
 
-       texture->SetName(name);
-       // 2. Create intermediate (staging) buffer to copy data to GPU
+    ID3D12Device5* device = (app->getD3D12Module())->getDevice();
+    if (FAILED(device->CreateCommittedResource(&heap, D3D12_HEAP_FLAG_NONE, &textureDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&texture))))
+        return false;
 
-       UINT64 size = GetRequiredIntermediateSize(texture.Get(), 0, imageWithMips.GetImageCount());
-       CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-       CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    texture->SetName(name);
+    // 2. Get intermediate (staging) memory from the upload ring to copy data to GPU
 
-       ComPtr<ID3D12Resource> intermediateBuf;
-       if (FAILED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&intermediateBuf))))
-           return false;
+    UINT subresourceCount = UINT(metaData.arraySize * mipLevels);
+    UINT64 size = GetRequiredIntermediateSize(texture.Get(), 0, subresourceCount);
 
-       // 3. Copy the data to the texture (in GPU)
+    UploadAllocation staging;
+    if (not allocateUpload(size_t(size), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, staging))
+        return false;
 
-       // 1) Set up command list
-       if (FAILED(commandAllocator->Reset())) return false; // empty previous commands so that it doesn't fill up
-       if (FAILED(commandList->Reset(commandAllocator.Get(), nullptr))) return false;
+    // 3. Copy the data to the texture (in GPU)
 
-       // 2) Get texture subresource data and copy
-       std::vector<D3D12_SUBRESOURCE_DATA> subData;
-       subData.reserve(imageWithMips.GetImageCount());
+    // 1) Set up command list (current batch, or a batch of its own)
+    bool ownBatch = not batchOpen;
+    if (ownBatch and not beginUploadBatch()) return false;
 
-       // (Note we are iterating over mipLevels of each array item to respect Subresource index order)
-       for (size_t item = 0; item < metaDataWithMips.arraySize; ++item)
-       {
-           for (size_t level = 0; level < metaDataWithMips.mipLevels; ++level)
-           {
-               const DirectX::Image* subImg = imageWithMips.GetImage(level, item, 0);
-               D3D12_SUBRESOURCE_DATA data = { subImg->pixels, subImg->rowPitch, subImg->slicePitch };
-               subData.push_back(data);
-           }
-       }
+    // 2) Get texture subresource data and copy
+    std::vector<D3D12_SUBRESOURCE_DATA> subData;
+    subData.reserve(subresourceCount);
 
-       UpdateSubresources(commandList.Get(), texture.Get(), intermediateBuf.Get(), 0, 0, UINT(imageWithMips.GetImageCount()), subData.data());
+    // (Note we are iterating over mipLevels of each array item to respect Subresource index order)
+    for (size_t item = 0; item < metaData.arraySize; ++item)
+    {
+        for (size_t level = firstMip; level < metaData.mipLevels; ++level)
+        {
+            const DirectX::Image* subImg = image.GetImage(level, item, 0);
+            D3D12_SUBRESOURCE_DATA data = { subImg->pixels, LONG_PTR(subImg->rowPitch), LONG_PTR(subImg->slicePitch) };
+            subData.push_back(data);
+        }
+    }
+
+    UpdateSubresources(commandList.Get(), texture.Get(), staging.resource.Get(), staging.offset, 0, subresourceCount, subData.data());
+
+    // 4. Submit (if the caller isn't batching: its batch is the next one submitted)
+    UploadTicket batchTicket = ownBatch ? endUploadBatch() : lastSubmittedTicket + 1;
+    if (ticket) *ticket = batchTicket;
 
-       // 4. Transition the texture to RESOURCE_STATE_PIXEL_SHADER_RESOURCE so that it can be used (WE ASUME COMMANDLIST OPENED AFTER UPDATESUBRESOURCES)
+    return batchTicket != 0;
+}
 
-       CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-       commandList->ResourceBarrier(1, &barrier);
+ModuleResources::StreamedTexture ModuleResources::createStreamedTexture(const std::filesystem::path& path)
+{
+    StreamedTexture id = StreamedTexture(std::find(streamed.begin(), streamed.end(), nullptr) - streamed.begin());
+    if (id == streamed.size()) streamed.emplace_back();
 
-       // 5. Execute the command list
-       commandList->Close();
+    streamed[id] = std::make_unique<Streamed>();
+    Streamed* texture = streamed[id].get();
+    texture->path = path;
 
-       ID3D12CommandList* listsToExecute[] = { commandList.Get() };
-       ID3D12CommandQueue* queue = d3d12module->getCommandQueue();
-       queue->ExecuteCommandLists(UINT(std::size(listsToExecute)), listsToExecute);
+    // (preRender picks it up once decoded)
+    texture->decodeJob = app->getJobSystem()->schedule([texture]() {
+        if (not decodeStreamedImage(texture->path, texture->image))
+            texture->image.Release();
 
-       // And we do a flush to ensure all operations finished
-       d3d12module->flush();
+        texture->decoded = true;
+    });
 
-       return true;
+    return id;
+}
+
+void ModuleResources::destroyStreamedTexture(StreamedTexture id)
+{
+    if (id >= streamed.size() or not streamed[id]) return;
+
+    Streamed& texture = *streamed[id];
+    app->getJobSystem()->wait(texture.decodeJob);
+
+    if (texture.residencyId != TextureResidency::INVALID_TEXTURE) {
+        residency.remove(texture.residencyId);
+        residencyOwners[texture.residencyId] = INVALID_STREAMED_TEXTURE;
     }
-    
-    // (steps with the original image, since it had the mipmaps)
 
-    // 1. Create texture resource in default heap
+    if (texture.descriptor.isValid()) app->getModuleShaderDesc()->Free(texture.descriptor);
+    if (texture.texture) retireTexture(texture.texture);
+    if (texture.pendingTexture) retireTexture(texture.pendingTexture, texture.pendingTicket);
 
-    D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(metaData.format, UINT64(metaData.width), UINT(metaData.height), UINT16(metaData.arraySize), UINT16(metaData.mipLevels));
-    CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
+    streamed[id].reset();
+}
 
-    ID3D12Device5* device = d3d12module->getDevice();
-    if (FAILED(device->CreateCommittedResource(&heap, D3D12_HEAP_FLAG_NONE, &textureDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&texture))))
-        return false;
+void ModuleResources::requestTextureDetail(StreamedTexture id, float screenPixels)
+{
+    const Streamed& texture = *streamed[id];
+    if (texture.residencyId == TextureResidency::INVALID_TEXTURE) return; // (not decoded yet)
 
-    texture->SetName(name);
-    // 2. Create intermediate (staging) buffer to copy data to GPU
+    const TexMetadata& metaData = texture.image.GetMetadata();
+    uint32_t mip = TextureResidency::mipForScreenSize(uint32_t(metaData.width), uint32_t(metaData.height), screenPixels, uint32_t(metaData.mipLevels));
 
-    UINT64 size = GetRequiredIntermediateSize(texture.Get(), 0, image.GetImageCount());
-    CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    residency.request(texture.residencyId, mip, streamingFrame);
+}
 
-    ComPtr<ID3D12Resource> intermediateBuf;
-    if (FAILED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&intermediateBuf))))
-        return false;
+ModuleShaderDescriptors::Handle ModuleResources::getTextureDescriptor(StreamedTexture id) const
+{
+    return streamed[id]->descriptor;
+}
 
-    // 3. Copy the data to the texture (in GPU)
+bool ModuleResources::decodeStreamedImage(const std::filesystem::path& path, ScratchImage& image)
+{
+    // (the cooker doesn't use WIC, which needs COM initialized on the calling thread, workers don't)
+    if (not TextureCooker::load(path, app->getJobSystem(), image)) return false;
+
+    if (image.GetMetadata().mipLevels == 1 and not IsCompressed(image.GetMetadata().format))
+    {
+        ScratchImage imageWithMips;
+        if (FAILED(GenerateMipMaps(*image.GetImage(0, 0, 0), TEX_FILTER_DEFAULT | TEX_FILTER_FORCE_NON_WIC, 0, imageWithMips)))
+            return false;
 
-    // 1) Set up command list
-    if (FAILED (commandAllocator->Reset()) ) return false; // empty previous commands so that it doesn't fill up
-    if (FAILED (commandList->Reset(commandAllocator.Get(), nullptr)) ) return false;
+        image = std::move(imageWithMips);
+    }
 
-    // 2) Get texture subresource data and copy
-    std::vector<D3D12_SUBRESOURCE_DATA> subData;
-    subData.reserve(image.GetImageCount());
+    return true;
+}
 
-    // (Note we are iterating over mipLevels of each array item to respect Subresource index order)
-    for (size_t item = 0; item < metaData.arraySize; ++item)
+void ModuleResources::registerStreamed(StreamedTexture id)
+{
+    Streamed& texture = *streamed[id];
+    const TexMetadata& metaData = texture.image.GetMetadata();
+
+    // Mip sizes as stored in system memory (close enough to the GPU ones for the budget), and the always resident tail
+    // (block compressed textures can only start at mips with sizes multiple of 4)
+    bool blocks = IsCompressed(metaData.format);
+    std::vector<uint64_t> mipSizes(metaData.mipLevels);
+    uint32_t tailMip = 0;
+    bool tailFound = false;
+
+    for (size_t mip = 0; mip < metaData.mipLevels; ++mip) {
+        const DirectX::Image* level = texture.image.GetImage(mip, 0, 0);
+        mipSizes[mip] = uint64_t(level->slicePitch) * metaData.arraySize;
+
+        if (tailFound or (blocks and (level->width % 4 != 0 or level->height % 4 != 0))) {
+            tailFound = true;
+            continue;
+        }
+
+        tailMip = uint32_t(mip);
+        tailFound = std::max(level->width, level->height) <= TEXTURE_STREAMING_TAIL;
+    }
+
+    texture.residencyId = residency.add(mipSizes, tailMip);
+
+    if (texture.residencyId >= residencyOwners.size()) residencyOwners.resize(texture.residencyId + 1, INVALID_STREAMED_TEXTURE);
+    residencyOwners[texture.residencyId] = id;
+
+    // The tail is copied like any other change (in the same batch)
+    residencyChanges.push_back({ texture.residencyId, tailMip });
+}
+
+void ModuleResources::updateStreaming()
+{
+    if (streamed.empty()) return;
+
+    ModuleShaderDescriptors* shaderDescModule = app->getModuleShaderDesc();
+
+    // 1. Copies that are done replace the textures in use (the old ones live until the frames using them are done)
+    for (const std::unique_ptr<Streamed>& texture : streamed)
     {
-        for (size_t level = 0; level < metaData.mipLevels; ++level)
-        {
-            const DirectX::Image* subImg = image.GetImage(level, item, 0);
-            D3D12_SUBRESOURCE_DATA data = { subImg->pixels, subImg->rowPitch, subImg->slicePitch };
-            subData.push_back(data);
+        if (not texture or not texture->pendingTexture or not isUploadFinished(texture->pendingTicket)) continue;
+
+        ModuleShaderDescriptors::Handle descriptor = shaderDescModule->CreateSRV(texture->pendingTexture.Get());
+        if (not descriptor.isValid()) continue; // (heap full, try again next frame)
+
+        if (texture->descriptor.isValid()) shaderDescModule->Free(texture->descriptor);
+        if (texture->texture) retireTexture(texture->texture);
+
+        texture->texture = std::move(texture->pendingTexture);
+        texture->descriptor = descriptor;
+        texture->residentMip = texture->pendingMip;
+    }
+
+    // 2. The residency decides with the requests of the last frame, then the newly decoded textures join it (tail only)
+    residency.update(streamingFrame++, residencyChanges);
+
+    for (StreamedTexture id = 0; id < streamed.size(); ++id)
+    {
+        Streamed* texture = streamed[id].get();
+        if (not texture or texture->residencyId != TextureResidency::INVALID_TEXTURE or not texture->decoded) continue;
+
+        if (texture->image.GetImageCount() == 0) {
+            LOG("Streamed texture %s could not be decoded", texture->path.string().c_str());
+            texture->decoded = false; // (logged once, it stays without descriptor)
+            continue;
         }
+
+        registerStreamed(id);
     }
 
-    UpdateSubresources(commandList.Get(), texture.Get(), intermediateBuf.Get(), 0, 0, UINT(image.GetImageCount()), subData.data());
+    // 3. Every change is a new texture with the new mip range, all of them copied in one batch
+    if (residencyChanges.empty() or not beginUploadBatch()) return;
 
-    // 4. Transition the texture to RESOURCE_STATE_PIXEL_SHADER_RESOURCE so that it can be used (WE ASUME COMMANDLIST OPENED AFTER UPDATESUBRESOURCES)
+    std::vector<Streamed*> changed;
+    for (const TextureResidency::Change& change : residencyChanges)
+    {
+        Streamed& texture = *streamed[residencyOwners[change.texture]];
 
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    commandList->ResourceBarrier(1, &barrier);
+        // Superseded before being used (it may be in this batch: waiting for its ticket covers the older ones too)
+        if (texture.pendingTexture) retireTexture(texture.pendingTexture, lastSubmittedTicket + 1);
+        if (texture.texture and change.residentMip == texture.residentMip) continue; // back to what we have
 
-    // 5. Execute the command list
-    commandList->Close();
+        if (not createTextureFromMips(texture.image, change.residentMip, texture.pendingTexture, texture.path.c_str())) {
+            LOG("Streamed texture %s: mips from %u could not be copied", texture.path.string().c_str(), change.residentMip);
+            texture.pendingTexture.Reset();
+            continue;
+        }
+
+        texture.pendingMip = change.residentMip;
+        changed.push_back(&texture);
+    }
+
+    UploadTicket ticket = endUploadBatch();
+    for (Streamed* texture : changed) texture->pendingTicket = ticket;
+}
+
+void ModuleResources::retireTexture(ComPtr<ID3D12Resource>& texture, UploadTicket ticket)
+{
+    retiredTextures.push_back({ app->getD3D12Module()->getCurrentFenceValue(), ticket, std::move(texture) });
+}
+
+bool ModuleResources::beginUploadBatch()
+{
+    assert(not batchOpen && "upload batches can't be nested");
+
+    batchOpen = openBatch();
+    return batchOpen;
+}
+
+ModuleResources::UploadTicket ModuleResources::endUploadBatch()
+{
+    if (not batchOpen) return 0;
+
+    batchOpen = false;
+    return submitBatch();
+}
+
+bool ModuleResources::isUploadFinished(UploadTicket ticket) const
+{
+    return copyFence->GetCompletedValue() >= ticket;
+}
+
+void ModuleResources::waitForUpload(UploadTicket ticket)
+{
+    if (isUploadFinished(ticket)) return;
+
+    copyFence->SetEventOnCompletion(ticket, copyEvent);
+    WaitForSingleObject(copyEvent, INFINITE);
+}
+
+void ModuleResources::waitForUploadOnGPU(UploadTicket ticket)
+{
+    if (isUploadFinished(ticket)) return;
+
+    // Only the draw queue waits (on its timeline), commands already submitted there are not affected
+    app->getD3D12Module()->getCommandQueue()->Wait(copyFence.Get(), ticket);
+}
+
+// Auxiliary functions //
+
+bool ModuleResources::openBatch()
+{
+    currentAllocator = (currentAllocator + 1) % UPLOAD_ALLOCATORS;
+
+    // The allocator may still be in use by a previous batch (only happens when submitting batches faster than they are copied)
+    waitForUpload(allocatorTickets[currentAllocator]);
+
+    ID3D12CommandAllocator* allocator = commandAllocators[currentAllocator].Get();
+    return SUCCEEDED(allocator->Reset()) and SUCCEEDED(commandList->Reset(allocator, nullptr));
+}
+
+ModuleResources::UploadTicket ModuleResources::submitBatch()
+{
+    if (FAILED(commandList->Close())) return 0;
 
     ID3D12CommandList* listsToExecute[] = { commandList.Get() };
-    ID3D12CommandQueue* queue = d3d12module->getCommandQueue();
-    queue->ExecuteCommandLists(UINT(std::size(listsToExecute)), listsToExecute);
+    copyQueue->ExecuteCommandLists(UINT(std::size(listsToExecute)), listsToExecute);
+
+    copyQueue->Signal(copyFence.Get(), ++lastSubmittedTicket);
+    allocatorTickets[currentAllocator] = lastSubmittedTicket;
+    uploadRingAllocator.finishBatch(lastSubmittedTicket); // ring regions used by this batch are free once it is done
+
+    return lastSubmittedTicket;
+}
+
+void ModuleResources::releaseFinishedUploads()
+{
+    UploadTicket completed = copyFence->GetCompletedValue();
+
+    // Streamed texture versions that are no longer drawn nor copied
+    UINT64 completedFrame = app->getD3D12Module()->getCompletedFenceValue();
+    retiredTextures.erase(std::remove_if(retiredTextures.begin(), retiredTextures.end(), [completed, completedFrame](const RetiredTexture& retired) {
+        return retired.fenceValue <= completedFrame and retired.ticket <= completed;
+    }), retiredTextures.end());
+
+    uploadRingAllocator.release(completed);
+
+    if (pendingUploads.empty()) return;
+
+    // (tickets are pushed in increasing order)
+    auto firstPending = pendingUploads.begin();
+    while (firstPending != pendingUploads.end() and firstPending->ticket <= completed)
+        ++firstPending;
+
+    pendingUploads.erase(pendingUploads.begin(), firstPending);
+}
+
+bool ModuleResources::createCommittedUpload(std::size_t numBytes, UploadAllocation& upload)
+{
+    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(numBytes);
+    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+
+    ID3D12Device5* device = (app->getD3D12Module())->getDevice();
+    if (FAILED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&upload.resource))))
+        return false;
+
+    upload.resource->SetName(L"Upload Buffer (out of ring)");
+    upload.offset = 0;
+
+    CD3DX12_RANGE readRange(0, 0);
+    if (FAILED(upload.resource->Map(0, &readRange, reinterpret_cast<void**>(&upload.data))))
+        return false;
 
-    // And we do a flush to ensure all operations finished
-    d3d12module->flush();
+    // It must live until the batch that copies from it is done, even if the caller drops it (released mapped, that's fine)
+    pendingUploads.push_back({ lastSubmittedTicket + 1, upload.resource });
 
     return true;
 }
@@ -3,30 +3,143 @@
 #include "Module.h"
 
 #include "D3D12Module.h"
-#include <filesystem>
+#include "RingAllocator.h"
+#include "TextureResidency.h"
+#include "ModuleShaderDescriptors.h"
+#include "JobSystem.h"
+#include "DirectXTex.h"
 
-namespace DirectX { class ScratchImage;}
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <vector>
 
 
 class ModuleResources : public Module
 {
 public:
 
+	typedef UINT64 UploadTicket; // copy fence value that is reached when a submitted upload batch is done on the GPU
+
+	typedef uint32_t StreamedTexture;
+	static constexpr StreamedTexture INVALID_STREAMED_TEXTURE = UINT32_MAX;
+
+	// Region of upload memory (normally inside the upload ring) that the CPU can write and the copy queue can read
+	struct UploadAllocation
+	{
+		ComPtr<ID3D12Resource> resource;
+		UINT64 offset = 0;
+		BYTE* data = nullptr; // (persistently mapped)
+	};
+
 	bool init();
+	void preRender() override;
+	bool cleanUp() override;
 
-	bool CreateUploadBuffer(const void* buffer, std::size_t numBytes, ComPtr<ID3D12Resource>& uploadBuffer, const LPCWSTR name);
+	bool allocateUpload(std::size_t numBytes, std::size_t alignment, UploadAllocation& upload);
+	bool CreateUploadBuffer(const void* buffer, std::size_t numBytes, UploadAllocation& upload);
 
-	// WARNING: numBytes has to be the exact same size of the upload buffer (TO CHANGE?)
-	bool CreateDefaultBuffer(const ComPtr<ID3D12Resource>& uploadBuffer, std::size_t numBytes, ComPtr<ID3D12Resource>& defaultBuffer, const LPCWSTR name);
+	// WARNING: numBytes has to be the exact same size of the uploaded data (TO CHANGE?)
+	bool CreateDefaultBuffer(const UploadAllocation& upload, std::size_t numBytes, ComPtr<ID3D12Resource>& defaultBuffer, const LPCWSTR name);
 
 	bool createTextureFromFile(const std::filesystem::path& path, ComPtr<ID3D12Resource>& texture);
+	bool createTextureFromScratchImg(ScratchImage& image, ComPtr<ID3D12Resource>& texture, const LPCWSTR name); // (mips are generated if it has none)
+	bool createTextureFromMips(const ScratchImage& image, size_t firstMip, ComPtr<ID3D12Resource>& texture, const LPCWSTR name, // mips [firstMip, mipLevels), as they are
+							   UploadTicket* ticket = nullptr); // (of the batch it went to: the open one, if any, once it is ended)
+
+	// Streamed textures: the whole mip chain is decoded to system memory (in a job), but only the mips that are requested
+	// (and fit in the budget) are on the GPU. Changes are applied in preRender by copying a texture with the new mip range,
+	// the previous one keeps being used until that copy is done.
+	StreamedTexture createStreamedTexture(const std::filesystem::path& path);
+	void destroyStreamedTexture(StreamedTexture texture);
+
+	void requestTextureDetail(StreamedTexture texture, float screenPixels); // pixels it covers on screen this frame (biggest side)
+	ModuleShaderDescriptors::Handle getTextureDescriptor(StreamedTexture texture) const; // (invalid until its tail mips are copied)
+
+	inline void setTextureBudget(UINT64 bytes) { residency.setBudget(bytes); };
+	inline UINT64 getTextureBudget() const { return residency.getBudget(); };
+	inline UINT64 getTextureMemoryUsage() const { return residency.getUsage(); };
+
+	// Upload batches: every copy recorded between begin and end goes to the copy queue in a single submission.
+	// Copies done outside of a batch are submitted right away (one batch each). Nothing here waits for the GPU.
+	bool beginUploadBatch();
+	UploadTicket endUploadBatch();
+
+	inline UploadTicket getLastUploadTicket() const { return lastSubmittedTicket; };
+
+	bool isUploadFinished(UploadTicket ticket) const;
+	void waitForUpload(UploadTicket ticket);		// CPU blocks until the copies are done (only if really needed)
+	void waitForUploadOnGPU(UploadTicket ticket);	// the draw queue waits for the copies, CPU keeps going
 
 private:
 
-	// Variables for default buffer copying to command
+	enum { UPLOAD_ALLOCATORS = 3 }; // ring of allocators, so we can record a batch while previous ones are being copied
+
+	struct PendingUpload
+	{
+		UploadTicket ticket;
+		ComPtr<ID3D12Resource> resource; // staging buffer kept alive until the copy is done
+	};
+
+	// Copy queue and its commands
+	ComPtr<ID3D12CommandQueue> copyQueue;
 	ComPtr<ID3D12GraphicsCommandList4> commandList;
-	ComPtr <ID3D12CommandAllocator> commandAllocator; // for the command list
+	ComPtr <ID3D12CommandAllocator> commandAllocators[UPLOAD_ALLOCATORS];
+	UploadTicket allocatorTickets[UPLOAD_ALLOCATORS] = {0}; // last batch recorded with each allocator
+	unsigned int currentAllocator = 0;
 
-	bool createTextureFromScratchImg(ScratchImage& image, ComPtr<ID3D12Resource>& texture, const LPCWSTR name);
-};
+	// Synchronization
+	ComPtr<ID3D12Fence> copyFence;
+	HANDLE copyEvent = nullptr;
+	UploadTicket lastSubmittedTicket = 0;
+
+	bool batchOpen = false;
+	std::vector<PendingUpload> pendingUploads;
+
+	// Upload ring (regions are recycled when the batch that copies them is done)
+	ComPtr<ID3D12Resource> uploadRing;
+	BYTE* uploadRingData = nullptr;
+	RingAllocator uploadRingAllocator;
+
+	// Texture streaming
+	struct Streamed
+	{
+		std::filesystem::path path;
+		ScratchImage image;				// full mip chain (written by the decode job, no images if it failed)
+		JobSystem::JobHandle decodeJob;
+		std::atomic<bool> decoded = false;
+		uint32_t residencyId = TextureResidency::INVALID_TEXTURE;
+
+		ComPtr<ID3D12Resource> texture; // mips [residentMip, mipLevels) of the image
+		ModuleShaderDescriptors::Handle descriptor;
+		uint32_t residentMip = 0;
 
+		ComPtr<ID3D12Resource> pendingTexture; // replacement being copied
+		uint32_t pendingMip = 0;
+		UploadTicket pendingTicket = 0;
+	};
+
+	struct RetiredTexture
+	{
+		UINT64 fenceValue;		// frame fence value after which the draw queue doesn't use it
+		UploadTicket ticket;	// copy that may still be writing it (0 if none)
+		ComPtr<ID3D12Resource> resource;
+	};
+
+	std::vector<std::unique_ptr<Streamed>> streamed; // (indexed by StreamedTexture, null once destroyed)
+	std::vector<StreamedTexture> residencyOwners;	 // residency id => StreamedTexture
+	std::vector<RetiredTexture> retiredTextures;
+	std::vector<TextureResidency::Change> residencyChanges;
+	TextureResidency residency = TextureResidency(TEXTURE_BUDGET);
+	uint64_t streamingFrame = 1; // requests are made with it, preRender updates the residency with them and advances it
+
+	bool openBatch(); // resets the next allocator of the ring and the command list
+	UploadTicket submitBatch();
+	void releaseFinishedUploads();
+	bool createCommittedUpload(std::size_t numBytes, UploadAllocation& upload); // for what doesn't fit in the ring
+
+	static bool decodeStreamedImage(const std::filesystem::path& path, ScratchImage& image); // (safe on workers: no WIC)
+	void registerStreamed(StreamedTexture id);
+	void updateStreaming();
+	void retireTexture(ComPtr<ID3D12Resource>& texture, UploadTicket ticket = 0);
+};
@@ -0,0 +1,217 @@
+#include "Globals.h"
+#include "Application.h"
+#include "D3D12Module.h"
+#include "ModuleResources.h"
+#include "JobSystem.h"
+#include "FileUtils.h"
+
+#include "ModuleScene.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+namespace
+{
+	const char* CACHE_DIRECTORY = "Cache/Scenes";
+}
+
+void ModuleScene::preRender()
+{
+	UINT64 completed = app->getD3D12Module()->getCompletedFenceValue();
+
+	while (not retired.empty() and retired.front().fenceValue <= completed)
+		retired.pop_front();
+}
+
+bool ModuleScene::load(const std::filesystem::path& path)
+{
+	unload();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// 1. Cooked file (cooked now if it's missing, older than the source, or from another format version). It goes to the cache,
+	// not next to the source: the name keeps the source one for humans, plus a hash of its path (models with the same name)
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), "-%016llx.cooked", (unsigned long long)std::hash<std::string>()(std::filesystem::absolute(path).generic_string()));
+
+	std::filesystem::path cookedPath = std::filesystem::path(CACHE_DIRECTORY) / path.stem();
+	cookedPath += suffix;
+
+	std::error_code error;
+	bool upToDate = std::filesystem::exists(cookedPath, error) and
+					std::filesystem::last_write_time(cookedPath, error) >= std::filesystem::last_write_time(path, error) and not error;
+
+	CookedScene::Reader reader;
+	bool cooked = not upToDate or not reader.open(cookedPath);
+
+	if (cooked)
+	{
+		std::vector<uint8_t> file;
+		if (not cook(path, file)) return false;
+
+		if (not FileUtils::writeFile(cookedPath, file)) // (through a temporary file, never left half written)
+			LOG("Cooked scene %s could not be saved (it will be cooked again next time)", cookedPath.string().c_str());
+
+		if (not reader.open(std::move(file))) return false;
+	}
+
+	double openMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// 2. GPU resources, straight from the cooked data
+	bool ok = upload(reader, path.filename().wstring());
+
+	LOG("Scene %s: %s %.2f ms, decode + upload recording %.2f ms", path.string().c_str(), cooked ? "cook" : "open",
+		openMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() - openMs);
+
+	return ok;
+}
+
+bool ModuleScene::cook(const std::filesystem::path& path, std::vector<uint8_t>& cooked) const
+{
+	// Images stay encoded (decoded on every load, on the job system)
+	GltfImporter::Scene imported;
+	if (not GltfImporter::import(path, app->getJobSystem(), imported, false)) return false;
+
+	CookedScene::Writer writer(sizeof(Vertex));
+
+	for (const GltfImporter::Mesh& mesh : imported.meshes) // (also the skipped ones, so the indices stay the same)
+		writer.addMesh(mesh.vertices.data(), uint32_t(mesh.vertices.size()), mesh.indices.data(), uint32_t(mesh.indices.size()), mesh.material);
+
+	for (const GltfImporter::Material& material : imported.materials)
+		writer.addMaterial(&material.baseColor.x, material.baseColorImage);
+
+	for (const GltfImporter::Instance& instance : imported.instances)
+		writer.addInstance(instance.mesh, &instance.world._11);
+
+	for (const std::vector<unsigned char>& image : imported.encodedImages)
+		writer.addImage(image.data(), image.size());
+
+	writer.write(cooked);
+
+	return true;
+}
+
+bool ModuleScene::upload(const CookedScene::Reader& reader, const std::wstring& name)
+{
+	if (reader.getVertexStride() != sizeof(Vertex)) return false;
+
+	// 1. Decode images in parallel (from the mapped file). Base color images are sRGB
+	std::vector<ScratchImage> images(reader.getImageCount());
+	std::vector<JobSystem::JobHandle> jobs;
+
+	std::vector<bool> srgb(reader.getImageCount(), false);
+	for (uint32_t i = 0; i < reader.getMaterialCount(); ++i)
+	{
+		int32_t image = reader.getMaterial(i).image;
+		if (image >= 0 and uint32_t(image) < reader.getImageCount()) srgb[image] = true;
+	}
+
+	for (uint32_t i = 0; i < reader.getImageCount(); ++i)
+	{
+		jobs.push_back(app->getJobSystem()->schedule([&reader, &images, &srgb, i]() {
+			const CookedScene::ImageInfo& image = reader.getImage(i);
+
+			if (not GltfImporter::decodeImage(static_cast<const unsigned char*>(reader.at(image.offset)), size_t(image.size), images[i], srgb[i]))
+				images[i].Release();
+		}));
+	}
+
+	app->getJobSystem()->waitAll(jobs);
+
+	// 2. Everything goes to the GPU in a single copy submission
+	ModuleResources* resModule = app->getModuleResources();
+	ModuleShaderDescriptors* shaderDescModule = app->getModuleShaderDesc();
+
+	if (not resModule->beginUploadBatch()) return false;
+
+	bool ok = true;
+	std::vector<ComPtr<ID3D12Resource>> textures(images.size());
+
+	for (size_t i = 0; i < images.size() and ok; ++i)
+	{
+		if (images[i].GetImageCount() == 0) continue; // (couldn't be decoded, materials using it won't have texture)
+
+		std::wstring textureName = name + L" image " + std::to_wstring(i);
+		ok = resModule->createTextureFromScratchImg(images[i], textures[i], textureName.c_str());
+	}
+
+	for (uint32_t i = 0; i < reader.getMaterialCount(); ++i)
+	{
+		const CookedScene::MaterialInfo& info = reader.getMaterial(i);
+
+		Material material;
+		material.baseColor = Vector4(info.baseColor);
+
+		if (ok and info.image >= 0 and textures[info.image])
+		{
+			material.baseColorTexture = textures[info.image];
+			material.baseColorDescriptor = shaderDescModule->CreateSRV(material.baseColorTexture.Get());
+			ok = material.baseColorDescriptor.isValid();
+		}
+
+		materials.push_back(material);
+	}
+
+	meshes.resize(reader.getMeshCount());
+
+	for (uint32_t i = 0; i < reader.getMeshCount() and ok; ++i)
+	{
+		const CookedScene::MeshInfo& info = reader.getMesh(i);
+		Mesh& mesh = meshes[i];
+
+		mesh.material = info.material;
+		mesh.boundsMin = Vector3(info.boundsMin);
+		mesh.boundsMax = Vector3(info.boundsMax);
+		if (info.indexCount == 0) continue; // (skipped by the importer)
+
+		size_t vertexBytes = size_t(info.vertexCount) * sizeof(Vertex);
+		size_t indexBytes = size_t(info.indexCount) * sizeof(uint32_t);
+
+		// (the only copy on the CPU: mapped file => upload ring)
+		ModuleResources::UploadAllocation upload;
+		ok = resModule->CreateUploadBuffer(reader.at(info.vertexOffset), vertexBytes, upload) and
+			 resModule->CreateDefaultBuffer(upload, vertexBytes, mesh.vertexBuffer, L"Scene vertex buffer");
+
+		ok = ok and resModule->CreateUploadBuffer(reader.at(info.indexOffset), indexBytes, upload) and
+			 resModule->CreateDefaultBuffer(upload, indexBytes, mesh.indexBuffer, L"Scene index buffer");
+
+		if (ok)
+		{
+			mesh.vertexBufferView = { mesh.vertexBuffer->GetGPUVirtualAddress(), UINT(vertexBytes), UINT(sizeof(Vertex)) };
+			mesh.indexBufferView = { mesh.indexBuffer->GetGPUVirtualAddress(), UINT(indexBytes), DXGI_FORMAT_R32_UINT };
+			mesh.indexCount = info.indexCount;
+		}
+	}
+
+	// (the batch is submitted even if something failed, the staging memory is released with it)
+	uploadTicket = resModule->endUploadBatch();
+	ok = ok and uploadTicket != 0;
+
+	for (uint32_t i = 0; i < reader.getInstanceCount() and ok; ++i)
+	{
+		const CookedScene::InstanceInfo& info = reader.getInstance(i);
+		if (meshes[info.mesh].indexCount > 0) instances.push_back({ info.mesh, Matrix(info.world) });
+	}
+
+	if (not ok) unload();
+
+	return ok;
+}
+
+void ModuleScene::unload()
+{
+	if (meshes.empty() and materials.empty()) return;
+
+	ModuleShaderDescriptors* shaderDescModule = app->getModuleShaderDesc();
+
+	for (Material& material : materials)
+		shaderDescModule->Free(material.baseColorDescriptor);
+
+	// Frames in flight may still draw them
+	retired.push_back({ app->getD3D12Module()->getCurrentFenceValue(), std::move(meshes), std::move(materials) });
+
+	meshes.clear();
+	materials.clear();
+	instances.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Module.h"
+#include "GltfImporter.h"
+#include "CookedScene.h"
+#include "ModuleShaderDescriptors.h"
+
+#include <filesystem>
+#include <deque>
+#include <vector>
+
+// Meshes, textures and instances of the loaded glTF, on the GPU. Scenes are cooked the first time (CookedScene file in Cache/Scenes,
+// cooked again when the source is newer) and loaded from the memory mapped cooked file from then on.
+class ModuleScene : public Module
+{
+public:
+
+	typedef GltfImporter::Vertex Vertex;
+
+	struct Mesh
+	{
+		ComPtr<ID3D12Resource> vertexBuffer;
+		ComPtr<ID3D12Resource> indexBuffer;
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
+		D3D12_INDEX_BUFFER_VIEW indexBufferView = {};
+		UINT indexCount = 0;
+		int material = -1;
+		Vector3 boundsMin, boundsMax; // (local space)
+	};
+
+	struct Material
+	{
+		Vector4 baseColor;
+		ComPtr<ID3D12Resource> baseColorTexture;			// (null if it has none)
+		ModuleShaderDescriptors::Handle baseColorDescriptor;
+	};
+
+	typedef GltfImporter::Instance Instance;
+
+	void preRender() override; // releases the resources of unloaded scenes once the GPU is done with them
+
+	bool load(const std::filesystem::path& path); // replaces the current scene (can't be called inside an upload batch)
+	void unload();
+
+	inline const std::vector<Mesh>& getMeshes() const { return meshes; };
+	inline const std::vector<Material>& getMaterials() const { return materials; };
+	inline const std::vector<Instance>& getInstances() const { return instances; };
+
+	inline UINT64 getUploadTicket() const { return uploadTicket; }; // copy queue ticket of the last load (wait for it before drawing)
+
+private:
+
+	std::vector<Mesh> meshes;
+	std::vector<Material> materials;
+	std::vector<Instance> instances;
+
+	UINT64 uploadTicket = 0;
+
+	bool cook(const std::filesystem::path& path, std::vector<uint8_t>& cooked) const;
+	bool upload(const CookedScene::Reader& reader, const std::wstring& name);
+
+	struct Retired
+	{
+		UINT64 fenceValue; // frame fence value after which nothing uses them
+		std::vector<Mesh> meshes;
+		std::vector<Material> materials;
+	};
+
+	std::deque<Retired> retired;
+};
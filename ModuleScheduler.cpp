@@ -0,0 +1,154 @@
+#include "Globals.h"
+
+#include "ModuleScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+
+ModuleScheduler::ModuleScheduler(JobSystem* jobSystem) : jobSystem(jobSystem)
+{
+}
+
+bool ModuleScheduler::build(const std::vector<Module*>& modules)
+{
+	bool ok = true;
+
+	for (int phase = 0; phase < Module::MAX_PHASES and ok; ++phase)
+	{
+		ok = sort(modules, Module::Phase(phase));
+		if (ok) buildEdges(Module::Phase(phase));
+	}
+
+	return ok;
+}
+
+bool ModuleScheduler::sort(const std::vector<Module*>& modules, Module::Phase phase)
+{
+	// Kahn's algorithm, always taking the first ready module in registration order (so it is stable)
+	std::vector<int> pendingDeps(modules.size(), 0);
+
+	for (std::size_t i = 0; i < modules.size(); ++i)
+	{
+		for (Module* dependency : modules[i]->getDependencies(phase))
+		{
+			if (std::find(modules.begin(), modules.end(), dependency) == modules.end())
+			{
+				LOG("Module dependency not registered in the application");
+				return false;
+			}
+			++pendingDeps[i];
+		}
+	}
+
+	order[phase].clear();
+	std::vector<bool> placed(modules.size(), false);
+
+	while (order[phase].size() < modules.size())
+	{
+		std::size_t next = 0;
+		while (next < modules.size() and (placed[next] or pendingDeps[next] > 0)) ++next;
+
+		if (next == modules.size())
+		{
+			LOG("Cycle in module dependencies (phase %d)", int(phase));
+			return false;
+		}
+
+		placed[next] = true;
+		order[phase].push_back(modules[next]);
+
+		for (std::size_t i = 0; i < modules.size(); ++i)
+		{
+			const std::vector<Module*>& deps = modules[i]->getDependencies(phase);
+			pendingDeps[i] -= int(std::count(deps.begin(), deps.end(), modules[next]));
+		}
+	}
+
+	return true;
+}
+
+bool ModuleScheduler::mustPrecede(unsigned int first, unsigned int second, Module::Phase phase) const
+{
+	const std::vector<Module*>& deps = order[phase][second]->getDependencies(phase);
+	if (std::find(deps.begin(), deps.end(), order[phase][first]) != deps.end()) return true;
+
+	// Conflicting access keeps the topological order (write-write, write-read, read-write)
+	const Module::PhaseAccess& a = order[phase][first]->getAccess(phase);
+	const Module::PhaseAccess& b = order[phase][second]->getAccess(phase);
+
+	return (a.writes & (b.reads | b.writes)) != 0 or (a.reads & b.writes) != 0;
+}
+
+void ModuleScheduler::buildEdges(Module::Phase phase)
+{
+	edges[phase].assign(order[phase].size(), {});
+
+	for (unsigned int second = 0; second < order[phase].size(); ++second)
+		for (unsigned int first = 0; first < second; ++first)
+			if (mustPrecede(first, second, phase)) edges[phase][second].push_back(first);
+}
+
+void ModuleScheduler::execute(Module::Phase phase, const std::function<void(unsigned int)>& task)
+{
+	std::vector<JobSystem::JobHandle> jobs(order[phase].size());
+
+	for (unsigned int i = 0; i < order[phase].size(); ++i)
+	{
+		std::vector<JobSystem::JobHandle> dependencies;
+		for (unsigned int predecessor : edges[phase][i])
+			if (jobs[predecessor]) dependencies.push_back(jobs[predecessor]); // (null == already run here, on the main thread)
+
+		if (order[phase][i]->getAccess(phase).mainThread)
+		{
+			// Wait for its predecessors (running other jobs meanwhile) and call it right here
+			jobSystem->waitAll(dependencies);
+			task(i);
+		}
+		else
+		{
+			jobs[i] = jobSystem->schedule([&task, i]() { task(i); }, dependencies);
+		}
+	}
+
+	std::vector<JobSystem::JobHandle> pending;
+	for (const JobSystem::JobHandle& job : jobs)
+		if (job) pending.push_back(job);
+
+	jobSystem->waitAll(pending);
+}
+
+bool ModuleScheduler::init()
+{
+	// A module that failed (or whose predecessors failed) stops everything that comes after it
+	std::vector<std::atomic<bool>> succeeded(order[Module::PHASE_INIT].size());
+	std::atomic<bool> ret = true;
+
+	execute(Module::PHASE_INIT, [this, &succeeded, &ret](unsigned int index) {
+		bool ok = true;
+		for (unsigned int predecessor : edges[Module::PHASE_INIT][index])
+			ok = ok and succeeded[predecessor];
+
+		ok = ok and order[Module::PHASE_INIT][index]->init();
+		succeeded[index] = ok;
+
+		if (!ok) ret = false;
+	});
+
+	return ret;
+}
+
+void ModuleScheduler::run(Module::Phase phase)
+{
+	execute(phase, [this, phase](unsigned int index) {
+		Module* module = order[phase][index];
+
+		switch (phase)
+		{
+		case Module::PHASE_UPDATE:		module->update();		break;
+		case Module::PHASE_PRE_RENDER:	module->preRender();	break;
+		case Module::PHASE_RENDER:		module->render();		break;
+		case Module::PHASE_POST_RENDER:	module->postRender();	break;
+		default: break; // (init has its own call)
+		}
+	});
+}
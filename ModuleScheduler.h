@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Module.h"
+#include "JobSystem.h"
+
+#include <vector>
+
+// Runs the module phases as task graphs on the job system. For every phase, modules are sorted by their declared
+// dependencies (keeping registration order when nothing says otherwise) and two modules are only ordered if one
+// depends on the other or their read/write sets conflict. The rest run at the same time.
+class ModuleScheduler
+{
+public:
+
+	ModuleScheduler(JobSystem* jobSystem);
+
+	bool build(const std::vector<Module*>& modules); // false if the dependencies of a phase have a cycle
+
+	bool init();					// every module whose predecessors were initialized fine (returns false if any failed)
+	void run(Module::Phase phase);	// update/preRender/render/postRender (returns when the whole phase is done)
+
+	inline const std::vector<Module*>& getOrder(Module::Phase phase) const { return order[phase]; }; // (cleanUp goes in reverse init order)
+
+private:
+
+	JobSystem* jobSystem;
+
+	std::vector<Module*> order[Module::MAX_PHASES];						// topological order of each phase
+	std::vector<std::vector<unsigned int>> edges[Module::MAX_PHASES];	// predecessors of each module (indices in order[phase])
+
+	bool sort(const std::vector<Module*>& modules, Module::Phase phase);
+	void buildEdges(Module::Phase phase);
+	bool mustPrecede(unsigned int first, unsigned int second, Module::Phase phase) const;
+
+	void execute(Module::Phase phase, const std::function<void(unsigned int)>& task);
+};
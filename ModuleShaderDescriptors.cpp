@@ -1,4 +1,3 @@
-
 #include "Globals.h"
 #include "Application.h"
 #include "D3D12Module.h"
@@ -16,7 +15,11 @@ bool ModuleShaderDescriptors::init() {
 	desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
 	if (SUCCEEDED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&shaderDescriptorHeap)))) {
-		nextFreeSlot = 0; // YOU CAN ALSO DO THIS ON THE CONSTRUCTOR (MAYBE BETTER THAN THIS)
+		allocator.reset(SHADER_DESCRIPTORS);
+
+		cpuStart = shaderDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+		gpuStart = shaderDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+		descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 		shaderDescriptorHeap->SetName(L"CBV SRV UAV Resources Heap");
 
@@ -26,31 +29,67 @@ bool ModuleShaderDescriptors::init() {
 	return false;
 }
 
-unsigned int ModuleShaderDescriptors::CreateSRV(ComPtr<ID3D12Resource>& resource)
+void ModuleShaderDescriptors::preRender()
+{
+	UINT64 completed = app->getD3D12Module()->getCompletedFenceValue();
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	allocator.release(completed);
+}
+
+ModuleShaderDescriptors::Handle ModuleShaderDescriptors::allocate(Type type)
 {
-	if (nextFreeSlot == SHADER_DESCRIPTORS) // if the heap is full, return the index value, which is > max index
-		return nextFreeSlot;
+	Handle handle;
+	handle.type = type;
 
-	D3D12_CPU_DESCRIPTOR_HANDLE SRVHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(shaderDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-		nextFreeSlot, device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	handle.index = allocator.allocate();
 
-	device->CreateShaderResourceView(resource.Get(), nullptr, SRVHandle); // nullptr for default SRV descriptor
+	if (!handle.isValid()) LOG("Shader descriptor heap is full");
 
-	return nextFreeSlot++; // we return the previous value, then update the free slot to the next one.
+	return handle;
 }
 
-/*unsigned int ModuleShaderDescriptors::AllocateDescriptor(ComPtr<ID3D12Resource>& resource, SHADER_RESOURCE_VIEW_DESC description)
+ModuleShaderDescriptors::Handle ModuleShaderDescriptors::CreateSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* description)
 {
-	if (nextFreeSlot == SHADER_DESCRIPTORS) // if the heap is full, return the index value, which is > max index
-		return nextFreeSlot;
+	Handle handle = allocate(SRV);
+
+	if (handle.isValid())
+		device->CreateShaderResourceView(resource, description, GetCPUHandle(handle));
 
-	D3D12_CPU_DESCRIPTOR_HANDLE SRVHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(shaderDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-		nextFreeSlot, device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+	return handle;
+}
+
+ModuleShaderDescriptors::Handle ModuleShaderDescriptors::CreateCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& description)
+{
+	Handle handle = allocate(CBV);
 
-	device->CreateShaderResourceView(resource.Get(), description, SRVHandle); // nullptr for default SRV descriptor
+	if (handle.isValid())
+		device->CreateConstantBufferView(&description, GetCPUHandle(handle));
 
-	return nextFreeSlot++; // we return the previous value, then update the free slot to the next one.
+	return handle;
 }
-*/
 
+ModuleShaderDescriptors::Handle ModuleShaderDescriptors::CreateUAV(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* description, ID3D12Resource* counter)
+{
+	Handle handle = allocate(UAV);
+
+	if (handle.isValid())
+		device->CreateUnorderedAccessView(resource, counter, description, GetCPUHandle(handle));
 
+	return handle;
+}
+
+void ModuleShaderDescriptors::Free(Handle& handle)
+{
+	if (!handle.isValid()) return;
+
+	{
+		// Frames already recorded (and the one being recorded) may still read it. The fence is read under the lock: the
+		// pending list stays in fence order whatever thread frees
+		std::lock_guard<std::mutex> lock(allocatorMutex);
+		allocator.deferFree(handle.index, app->getD3D12Module()->getCurrentFenceValue());
+	}
+
+	handle.index = DescriptorAllocator::INVALID_INDEX;
+}
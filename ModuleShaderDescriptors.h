@@ -1,35 +1,64 @@
 #pragma once
 
 #include "Module.h"
+#include "DescriptorAllocator.h"
 
-struct SHADER_RESOURCE_VIEW_DESC;
+#include <mutex>
 
 class ModuleShaderDescriptors : public Module
 {
 public:
 
+	enum Type
+	{
+		SRV,
+		CBV,
+		UAV
+	};
+
+	// Slot of a descriptor in the shader visible heap (the index is what shaders use to reach it bindlessly)
+	struct Handle
+	{
+		unsigned int index = DescriptorAllocator::INVALID_INDEX;
+		Type type = SRV;
+
+		inline bool isValid() const { return index != DescriptorAllocator::INVALID_INDEX; };
+	};
+
 	bool init();
+	void preRender() override; // recycles the descriptors freed on frames the GPU is done with
+
+	// Invalid handles mean that the heap is full. Can be called from any thread
+	Handle CreateSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* description = nullptr); // nullptr for default SRV descriptor
+	Handle CreateCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& description);
+	Handle CreateUAV(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* description = nullptr, ID3D12Resource* counter = nullptr);
 
-	unsigned int CreateSRV (ComPtr<ID3D12Resource>& resource);
-	//unsigned int AllocateDescriptor(ComPtr<ID3D12Resource>& resource, SHADER_RESOURCE_VIEW_DESC description);
+	void Free(Handle& handle); // the slot is reused once the frames that may still read it are done (handle is invalidated)
 
 	inline D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(unsigned int index) const {
-		return CD3DX12_CPU_DESCRIPTOR_HANDLE(shaderDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-			index, device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+		return CD3DX12_CPU_DESCRIPTOR_HANDLE(cpuStart, index, descriptorSize);
 	}
 
 	inline D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(unsigned int index) const {
-		return CD3DX12_GPU_DESCRIPTOR_HANDLE(shaderDescriptorHeap->GetGPUDescriptorHandleForHeapStart(),
-			index, device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(gpuStart, index, descriptorSize);
 	}
 
+	inline D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(const Handle& handle) const { return GetCPUHandle(handle.index); }
+	inline D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(const Handle& handle) const { return GetGPUHandle(handle.index); }
+
 	inline ID3D12DescriptorHeap* getHeap() const { return shaderDescriptorHeap.Get(); }
 
 private:
 
 	ComPtr<ID3D12DescriptorHeap> shaderDescriptorHeap; // for CBV + SRV + UAV descriptors
-	unsigned int nextFreeSlot;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart = {};
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuStart = {};
+	UINT descriptorSize = 0;
+
+	DescriptorAllocator allocator;
+	std::mutex allocatorMutex;
 
 	ID3D12Device5* device; // for easy access
-};
 
+	Handle allocate(Type type);
+};
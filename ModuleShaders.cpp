@@ -0,0 +1,172 @@
+#include "Globals.h"
+#include "Application.h"
+#include "ModulePipelines.h"
+
+#include "ModuleShaders.h"
+
+#include <cstring>
+
+static const char* SHADER_DIRECTORY = "Shaders";
+static const char* CACHE_DIRECTORY = "Cache/Shaders";
+
+bool ModuleShaders::init()
+{
+	compiler = std::make_unique<ShaderCompiler>();
+	if (not compiler->hasDXC()) LOG("DXC (dxcompiler.dll) not found, shader model 6 shaders come from the .cso files of the build");
+
+	const ShaderCompiler* shaderCompiler = compiler.get();
+	cache = std::make_unique<ShaderCache>(CACHE_DIRECTORY, [shaderCompiler](const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob,
+																			std::string& errors) { return shaderCompiler->compile(desc, source, blob, errors); },
+										  compiler->getId());
+
+	// (only where the sources are: running from the build output there is nothing to watch)
+	std::error_code error;
+	if (std::filesystem::is_directory(SHADER_DIRECTORY, error))
+	{
+		ModulePipelines* pipelines = app->getModulePipelines();
+
+		watcher = std::make_unique<FileWatcher>(SHADER_DIRECTORY);
+		hotReload = std::make_unique<ShaderHotReload>(app->getJobSystem(),
+													  [this](ShaderId shader, std::vector<std::filesystem::path>& files) { return recompile(shader, files); },
+													  [pipelines](uint32_t pipeline) { return pipelines->rebuildPipeline(pipeline); },
+													  [pipelines](uint32_t pipeline) { pipelines->swapPipeline(pipeline); });
+
+		if (not watcher->isNative()) LOG("Shaders/ changes can't be watched, polling them");
+	}
+
+	return true;
+}
+
+void ModuleShaders::preRender()
+{
+	if (hotReload) hotReload->update(watcher->poll());
+}
+
+bool ModuleShaders::cleanUp()
+{
+	hotReload.reset(); // (waits for its job, which uses the cache and the pipelines)
+	watcher.reset();
+
+	ShaderCache::Stats stats = getStats();
+	LOG("Shaders: %u requests, %u shared, %u loaded from the cache (%.1f ms), %u compiled (%.1f ms), %u failed", stats.requests, stats.shared, stats.loaded,
+		stats.loadMs, stats.compiled, stats.compileMs, stats.failed);
+
+	return true; // (blobs stay alive with the passes holding them)
+}
+
+ModuleShaders::ShaderBlob ModuleShaders::getShader(const std::filesystem::path& file, const char* profile, const char* entry, const std::vector<ShaderDefine>& defines)
+{
+	ShaderCache::Desc desc;
+	desc.path = std::filesystem::path(SHADER_DIRECTORY) / file;
+	desc.entry = entry;
+	desc.profile = profile;
+	desc.defines = defines;
+
+	std::string errors;
+	std::vector<std::filesystem::path> files;
+	ShaderBlob blob = cache->get(desc, &errors, &files);
+
+	if (not blob)
+	{
+		LOG("Shader %s (%s) could not be compiled: %s", desc.path.string().c_str(), profile, errors.c_str());
+
+		// The build compiles the main entry point without defines
+		std::vector<uint8_t> prebuilt;
+		if (defines.empty() and strcmp(entry, "main") == 0 and ShaderCompiler::readPrebuilt(file, prebuilt))
+			blob = std::make_shared<const std::vector<uint8_t>>(std::move(prebuilt));
+	}
+
+	if (blob) track(desc, blob, files); // (a .cso too: fixing the source reloads it)
+	return blob;
+}
+
+ModuleShaders::ShaderBlob ModuleShaders::getShaderFromSource(std::string_view source, const char* name, const char* entry, const char* profile,
+															 const std::vector<ShaderDefine>& defines)
+{
+	ShaderCache::Desc desc;
+	desc.path = name;
+	desc.source = source;
+	desc.entry = entry;
+	desc.profile = profile;
+	desc.defines = defines;
+
+	std::string errors;
+	ShaderBlob blob = cache->get(desc, &errors);
+	if (not blob) LOG("Shader %s (%s) could not be compiled: %s", name, profile, errors.c_str());
+
+	return blob;
+}
+
+ModuleShaders::ShaderId ModuleShaders::findShader(const D3D12_SHADER_BYTECODE& bytecode) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = ids.find(bytecode.pShaderBytecode);
+	return it != ids.end() ? it->second : 0;
+}
+
+ModuleShaders::ShaderBlob ModuleShaders::getCurrentShader(ShaderId shader) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return shader > 0 and shader <= records.size() ? records[shader - 1].blob : nullptr;
+}
+
+void ModuleShaders::trackPipeline(uint32_t pipeline, const std::vector<ShaderId>& shaders)
+{
+	if (hotReload) hotReload->setPipelineShaders(pipeline, shaders);
+}
+
+ModuleShaders::ShaderId ModuleShaders::track(const ShaderCache::Desc& desc, const ShaderBlob& blob, const std::vector<std::filesystem::path>& files)
+{
+	if (not hotReload) return 0;
+
+	ShaderId shader = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Asked for again: the same blob (the cache shares it), the same shader
+		auto it = ids.find(blob->data());
+		if (it != ids.end()) return it->second;
+
+		ShaderRecord record;
+		record.desc = desc;
+		record.blob = blob;
+		records.push_back(std::move(record));
+
+		shader = ShaderId(records.size());
+		ids[blob->data()] = shader;
+	}
+
+	hotReload->setShaderFiles(shader, files);
+	return shader;
+}
+
+ShaderHotReload::CompileResult ModuleShaders::recompile(ShaderId shader, std::vector<std::filesystem::path>& files)
+{
+	ShaderCache::Desc desc;
+	ShaderBlob current;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		desc = records[shader - 1].desc;
+		current = records[shader - 1].blob;
+	}
+
+	std::string errors;
+	ShaderBlob blob = cache->get(desc, &errors, &files);
+
+	if (not blob)
+	{
+		LOG("Shader %s (%s) could not be compiled: %s", desc.path.string().c_str(), desc.profile.c_str(), errors.c_str());
+		return ShaderHotReload::COMPILE_FAILED;
+	}
+
+	if (blob == current or *blob == *current) return ShaderHotReload::COMPILE_UNCHANGED;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	ShaderRecord& record = records[shader - 1];
+	record.previous.push_back(record.blob);
+	record.blob = blob;
+	ids[blob->data()] = shader;
+
+	return ShaderHotReload::COMPILE_CHANGED;
+}
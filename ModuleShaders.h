@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Module.h"
+#include "FileWatcher.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderHotReload.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Shader blobs for every pass: compiled at runtime from the sources in Shaders/ (or embedded ones) through a ShaderCache
+// in Cache/Shaders, so changed sources are picked up without a rebuild and unchanged ones are read instead of compiled.
+// Passes asking for the same shader share its blob. Shaders that can't be compiled here (no DXC, no sources next to the
+// executable, errors) fall back to the .cso the build made of them. Shaders/ is watched: a changed file is recompiled
+// by a job and the pipelines requested with the shaders reading it are rebuilt and swapped at the start of a frame
+// (ModulePipelines tracks them). Thread safe.
+class ModuleShaders : public Module
+{
+public:
+
+	typedef ShaderCache::Blob ShaderBlob;
+	typedef ShaderCache::Define ShaderDefine;
+	typedef ShaderHotReload::ShaderId ShaderId;
+
+	bool init() override;	   // loads the compilers, starts watching Shaders/
+	void preRender() override; // swaps the pipelines of the last reload, starts the next one
+	bool cleanUp() override;   // (logs the stats: startup cost of the shaders, cold vs warm cache)
+
+	// A file in Shaders/ (with the files it includes), null if it couldn't be compiled and there is no .cso for it
+	ShaderBlob getShader(const std::filesystem::path& file, const char* profile, const char* entry = "main", const std::vector<ShaderDefine>& defines = {});
+	ShaderBlob getShaderFromSource(std::string_view source, const char* name, const char* entry, const char* profile, const std::vector<ShaderDefine>& defines = {});
+
+	inline ShaderCache::Stats getStats() const { return cache ? cache->getStats() : ShaderCache::Stats(); };
+
+	// Hot reload: the shader a bytecode comes from (0 if it isn't one of getShader, those don't reload), its latest
+	// blob, and the shaders of a pipeline (rebuilt when one of them changes)
+	ShaderId findShader(const D3D12_SHADER_BYTECODE& bytecode) const;
+	ShaderBlob getCurrentShader(ShaderId shader) const;
+	void trackPipeline(uint32_t pipeline, const std::vector<ShaderId>& shaders);
+
+	static inline D3D12_SHADER_BYTECODE getBytecode(const ShaderBlob& blob) { return blob ? D3D12_SHADER_BYTECODE{ blob->data(), blob->size() } : D3D12_SHADER_BYTECODE{}; };
+
+private:
+
+	struct ShaderRecord
+	{
+		ShaderCache::Desc desc;
+		ShaderBlob blob;
+		std::vector<ShaderBlob> previous; // (passes may still hold them, and their addresses are in ids)
+	};
+
+	std::unique_ptr<ShaderCompiler> compiler;
+	std::unique_ptr<ShaderCache> cache;
+
+	mutable std::mutex mutex;
+	std::deque<ShaderRecord> records;			   // id - 1
+	std::unordered_map<const void*, ShaderId> ids; // by blob data
+	std::unique_ptr<FileWatcher> watcher;
+	std::unique_ptr<ShaderHotReload> hotReload;
+
+	ShaderId track(const ShaderCache::Desc& desc, const ShaderBlob& blob, const std::vector<std::filesystem::path>& files);
+	ShaderHotReload::CompileResult recompile(ShaderId shader, std::vector<std::filesystem::path>& files);
+};
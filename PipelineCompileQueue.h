@@ -0,0 +1,278 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Pipelines compiled in the background (no GPU objects here, Pipeline is e.g. a ComPtr<ID3D12PipelineState>): request()
+// queues the compile and returns a handle right away, and jobs take the queued compiles in order, a few at a time so the
+// frame jobs keep most of the workers. get() returns the pipeline once it's ready and until then the first ready one of
+// its fallbacks (e.g. a simpler pipeline added ready), or an empty Pipeline: the draw is skipped. Thread safe.
+template<typename Pipeline>
+class PipelineCompileQueue
+{
+public:
+
+	typedef uint32_t Handle;					// (0 = none)
+	typedef std::function<Pipeline()> Compile;	// returns an empty Pipeline when it fails
+
+	enum State { STATE_INVALID, STATE_QUEUED, STATE_COMPILING, STATE_READY, STATE_FAILED };
+
+	PipelineCompileQueue(JobSystem* jobSystem, unsigned int maxCompiling = 0); // null job system: compiled in request(), 0 = half the workers
+	~PipelineCompileQueue(); // queued compiles are dropped (failed), waits for the ones running
+
+	Handle request(Compile compile, Handle fallback = 0);
+	Handle add(const Pipeline& pipeline); // (ready already, for fallbacks)
+
+	// Puts another pipeline under the handle (e.g. rebuilt with reloaded shaders), ready from the next get(): a compile
+	// queued or running for it is dropped. The old pipeline is only released here, whoever keeps it for the GPU holds it.
+	void replace(Handle handle, const Pipeline& pipeline);
+
+	State getState(Handle handle) const;
+	inline bool isReady(Handle handle) const { return getState(handle) == STATE_READY; };
+
+	// The pipeline if it's ready, else the first ready one following the fallbacks, else empty (used gets the handle
+	// whose pipeline it is, 0 for none)
+	Pipeline get(Handle handle, Handle* used = nullptr) const;
+
+	void wait(Handle handle); // until it's ready or failed, compiled here if no job took it yet (loading screens)
+	void waitAll();			  // (helps with the queued ones)
+
+	size_t getQueuedCount() const; // (not compiling yet)
+
+private:
+
+	enum { MAX_FALLBACK_DEPTH = 8 }; // (a chain longer than this is a loop)
+
+	struct Slot
+	{
+		State state = STATE_INVALID;
+		Pipeline pipeline;
+		Handle fallback = 0;
+		Compile compile;	  // (until a job takes it)
+		uint32_t version = 0; // (replaced: the compile running is stale)
+	};
+
+	JobSystem* jobSystem;
+	unsigned int maxCompiling;
+
+	mutable std::mutex mutex;
+	std::condition_variable compiledCondition;
+	std::deque<Slot> slots; // handle - 1 (a deque: references stay valid while it grows)
+	std::deque<Handle> queued;
+	std::vector<JobSystem::JobHandle> compileJobs;
+	unsigned int compileJobCount = 0; // (running)
+	unsigned int compiling = 0;		  // pipelines being compiled, by the jobs or by waiting threads
+	bool stopping = false;
+
+	void compileQueued(); // (a compile job: takes compiles until the queue is empty)
+	void compile(Handle handle, std::unique_lock<std::mutex>& lock); // (a queued one, unlocked meanwhile)
+};
+
+template<typename Pipeline>
+PipelineCompileQueue<Pipeline>::PipelineCompileQueue(JobSystem* jobSystem, unsigned int maxCompiling) : jobSystem(jobSystem), maxCompiling(maxCompiling)
+{
+	if (jobSystem and maxCompiling == 0) this->maxCompiling = std::max(1u, jobSystem->getWorkerCount() / 2);
+}
+
+template<typename Pipeline>
+PipelineCompileQueue<Pipeline>::~PipelineCompileQueue()
+{
+	std::vector<JobSystem::JobHandle> jobs;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+
+		for (Handle handle : queued)
+		{
+			slots[handle - 1].state = STATE_FAILED;
+			slots[handle - 1].compile = nullptr;
+		}
+		queued.clear();
+
+		compiledCondition.wait(lock, [this]() { return compiling == 0; });
+		jobs = compileJobs;
+	}
+
+	if (jobSystem) jobSystem->waitAll(jobs); // (they reference the queue, even with nothing left to take)
+}
+
+template<typename Pipeline>
+typename PipelineCompileQueue<Pipeline>::Handle PipelineCompileQueue<Pipeline>::request(Compile compile, Handle fallback)
+{
+	if (not jobSystem) // (right away)
+	{
+		Handle handle = add(compile());
+
+		std::lock_guard<std::mutex> lock(mutex);
+		slots[handle - 1].fallback = fallback;
+		return handle;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (stopping) return 0;
+
+	Slot slot;
+	slot.state = STATE_QUEUED;
+	slot.fallback = fallback;
+	slot.compile = std::move(compile);
+	slots.push_back(std::move(slot));
+
+	Handle handle = Handle(slots.size());
+	queued.push_back(handle);
+
+	// Another compile job while under the limit (the running ones take it otherwise)
+	if (compileJobCount < maxCompiling)
+	{
+		++compileJobCount;
+		compileJobs.erase(std::remove_if(compileJobs.begin(), compileJobs.end(), [this](const JobSystem::JobHandle& job) { return jobSystem->isDone(job); }),
+						  compileJobs.end());
+		compileJobs.push_back(jobSystem->schedule([this]() { compileQueued(); }));
+	}
+
+	return handle;
+}
+
+template<typename Pipeline>
+typename PipelineCompileQueue<Pipeline>::Handle PipelineCompileQueue<Pipeline>::add(const Pipeline& pipeline)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Slot slot;
+	slot.state = pipeline ? STATE_READY : STATE_FAILED;
+	slot.pipeline = pipeline;
+	slots.push_back(std::move(slot));
+
+	return Handle(slots.size());
+}
+
+template<typename Pipeline>
+void PipelineCompileQueue<Pipeline>::replace(Handle handle, const Pipeline& pipeline)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (handle == 0 or handle > slots.size()) return;
+
+	Slot& slot = slots[handle - 1];
+	if (slot.state == STATE_QUEUED)
+	{
+		queued.erase(std::find(queued.begin(), queued.end(), handle));
+		slot.compile = nullptr;
+	}
+
+	++slot.version;
+	slot.pipeline = pipeline;
+	slot.state = pipeline ? STATE_READY : STATE_FAILED;
+
+	compiledCondition.notify_all(); // (waiting for it)
+}
+
+template<typename Pipeline>
+typename PipelineCompileQueue<Pipeline>::State PipelineCompileQueue<Pipeline>::getState(Handle handle) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return handle > 0 and handle <= slots.size() ? slots[handle - 1].state : STATE_INVALID;
+}
+
+template<typename Pipeline>
+Pipeline PipelineCompileQueue<Pipeline>::get(Handle handle, Handle* used) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (int depth = 0; depth < MAX_FALLBACK_DEPTH and handle > 0 and handle <= slots.size(); ++depth)
+	{
+		const Slot& slot = slots[handle - 1];
+		if (slot.state == STATE_READY)
+		{
+			if (used) *used = handle;
+			return slot.pipeline;
+		}
+
+		handle = slot.fallback;
+	}
+
+	if (used) *used = 0;
+	return Pipeline();
+}
+
+template<typename Pipeline>
+void PipelineCompileQueue<Pipeline>::wait(Handle handle)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (handle == 0 or handle > slots.size()) return;
+
+	// Queued: no job will get to it sooner than this thread (a thread compiling it always finishes)
+	if (slots[handle - 1].state == STATE_QUEUED)
+	{
+		queued.erase(std::find(queued.begin(), queued.end(), handle));
+		compile(handle, lock);
+	}
+
+	compiledCondition.wait(lock, [&]() { return slots[handle - 1].state != STATE_COMPILING; });
+}
+
+template<typename Pipeline>
+void PipelineCompileQueue<Pipeline>::waitAll()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (not queued.empty())
+	{
+		Handle handle = queued.front();
+		queued.pop_front();
+		compile(handle, lock);
+	}
+
+	compiledCondition.wait(lock, [this]() { return compiling == 0; });
+}
+
+template<typename Pipeline>
+size_t PipelineCompileQueue<Pipeline>::getQueuedCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return queued.size();
+}
+
+template<typename Pipeline>
+void PipelineCompileQueue<Pipeline>::compileQueued()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (not queued.empty())
+	{
+		Handle handle = queued.front();
+		queued.pop_front();
+		compile(handle, lock);
+	}
+
+	--compileJobCount;
+}
+
+template<typename Pipeline>
+void PipelineCompileQueue<Pipeline>::compile(Handle handle, std::unique_lock<std::mutex>& lock)
+{
+	Slot& slot = slots[handle - 1];
+	slot.state = STATE_COMPILING;
+	Compile task = std::move(slot.compile);
+	slot.compile = nullptr;
+	uint32_t version = slot.version;
+	++compiling;
+
+	lock.unlock();
+	Pipeline pipeline = task(); // (others keep requesting and drawing meanwhile)
+	lock.lock();
+
+	if (slot.version == version)
+	{
+		slot.pipeline = pipeline;
+		slot.state = slot.pipeline ? STATE_READY : STATE_FAILED;
+	}
+	--compiling;
+
+	compiledCondition.notify_all();
+}
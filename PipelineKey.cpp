@@ -0,0 +1,198 @@
+#include "Globals.h"
+
+#include "PipelineKey.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cwchar>
+#include <iterator>
+
+namespace
+{
+	enum Type : uint8_t { TYPE_GRAPHICS = 'G', TYPE_COMPUTE = 'C' };
+
+	const UINT MAX_RENDER_TARGETS = 8; // (size of RTVFormats and BlendState.RenderTarget)
+}
+
+PipelineKey::PipelineKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureId)
+{
+	begin(TYPE_GRAPHICS, rootSignatureId);
+
+	writeShader(desc.VS);
+	writeShader(desc.PS);
+	writeShader(desc.DS);
+	writeShader(desc.HS);
+	writeShader(desc.GS);
+
+	// Stream output (nothing else of it matters without entries)
+	const D3D12_STREAM_OUTPUT_DESC& streamOutput = desc.StreamOutput;
+	UINT entryCount = streamOutput.pSODeclaration ? streamOutput.NumEntries : 0;
+	write(entryCount);
+	if (entryCount > 0)
+	{
+		for (UINT i = 0; i < entryCount; ++i)
+		{
+			const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+			write(entry.Stream);
+			writeString(entry.SemanticName); // (null for gaps)
+			write(entry.SemanticIndex);
+			write(entry.StartComponent);
+			write(entry.ComponentCount);
+			write(entry.OutputSlot);
+		}
+
+		UINT strideCount = streamOutput.pBufferStrides ? streamOutput.NumStrides : 0;
+		write(strideCount);
+		writeBytes(streamOutput.pBufferStrides, strideCount * sizeof(UINT));
+		write(streamOutput.RasterizedStream);
+	}
+
+	// Blend: without independent blend only the first render target is used, factors and ops only when blending is on
+	UINT renderTargetCount = std::min(desc.NumRenderTargets, MAX_RENDER_TARGETS);
+	const D3D12_BLEND_DESC& blend = desc.BlendState;
+	write(blend.AlphaToCoverageEnable != FALSE);
+	write(blend.IndependentBlendEnable != FALSE);
+
+	UINT blendCount = blend.IndependentBlendEnable ? std::max(renderTargetCount, 1u) : 1;
+	for (UINT i = 0; i < blendCount; ++i)
+	{
+		const D3D12_RENDER_TARGET_BLEND_DESC& target = blend.RenderTarget[i];
+		write(target.BlendEnable != FALSE);
+		write(target.LogicOpEnable != FALSE);
+		if (target.BlendEnable)
+		{
+			write(target.SrcBlend);
+			write(target.DestBlend);
+			write(target.BlendOp);
+			write(target.SrcBlendAlpha);
+			write(target.DestBlendAlpha);
+			write(target.BlendOpAlpha);
+		}
+		if (target.LogicOpEnable) write(target.LogicOp);
+		write(target.RenderTargetWriteMask);
+	}
+
+	write(desc.SampleMask);
+
+	const D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+	write(rasterizer.FillMode);
+	write(rasterizer.CullMode);
+	write(rasterizer.FrontCounterClockwise != FALSE);
+	write(rasterizer.DepthBias);
+	write(rasterizer.DepthBiasClamp);
+	write(rasterizer.SlopeScaledDepthBias);
+	write(rasterizer.DepthClipEnable != FALSE);
+	write(rasterizer.MultisampleEnable != FALSE);
+	write(rasterizer.AntialiasedLineEnable != FALSE);
+	write(rasterizer.ForcedSampleCount);
+	write(rasterizer.ConservativeRaster);
+
+	// Depth write and test only with depth on, the stencil state only with stencil on
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	write(depthStencil.DepthEnable != FALSE);
+	if (depthStencil.DepthEnable)
+	{
+		write(depthStencil.DepthWriteMask);
+		write(depthStencil.DepthFunc);
+	}
+
+	write(depthStencil.StencilEnable != FALSE);
+	if (depthStencil.StencilEnable)
+	{
+		write(depthStencil.StencilReadMask);
+		write(depthStencil.StencilWriteMask);
+		for (const D3D12_DEPTH_STENCILOP_DESC& face : { depthStencil.FrontFace, depthStencil.BackFace })
+		{
+			write(face.StencilFailOp);
+			write(face.StencilDepthFailOp);
+			write(face.StencilPassOp);
+			write(face.StencilFunc);
+		}
+	}
+
+	// Input layout (the step rate only means something for per instance data)
+	UINT elementCount = desc.InputLayout.pInputElementDescs ? desc.InputLayout.NumElements : 0;
+	write(elementCount);
+	for (UINT i = 0; i < elementCount; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		writeString(element.SemanticName);
+		write(element.SemanticIndex);
+		write(element.Format);
+		write(element.InputSlot);
+		write(element.AlignedByteOffset);
+		write(element.InputSlotClass);
+		write(element.InputSlotClass == D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA ? element.InstanceDataStepRate : 0u);
+	}
+
+	write(desc.IBStripCutValue);
+	write(desc.PrimitiveTopologyType);
+
+	write(renderTargetCount);
+	for (UINT i = 0; i < renderTargetCount; ++i) write(desc.RTVFormats[i]);
+	write(desc.DSVFormat);
+
+	write(desc.SampleDesc.Count);
+	write(desc.SampleDesc.Quality);
+	write(desc.NodeMask);
+	write(desc.Flags);
+
+	end(); // (CachedPSO is not part of the pipeline)
+}
+
+PipelineKey::PipelineKey(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureId)
+{
+	begin(TYPE_COMPUTE, rootSignatureId);
+
+	writeShader(desc.CS);
+	write(desc.NodeMask);
+	write(desc.Flags);
+
+	end();
+}
+
+std::wstring PipelineKey::getName() const
+{
+	wchar_t name[17];
+	swprintf(name, std::size(name), L"%016llx", (unsigned long long)hash);
+
+	return name;
+}
+
+void PipelineKey::begin(uint8_t type, uint64_t rootSignatureId)
+{
+	data.clear();
+	data.reserve(256);
+
+	write(VERSION);
+	write(type);
+	write(rootSignatureId);
+}
+
+void PipelineKey::end()
+{
+	hash = hashBytes(data.data(), data.size());
+}
+
+void PipelineKey::writeBytes(const void* bytes, size_t size)
+{
+	if (size == 0) return;
+
+	const uint8_t* first = reinterpret_cast<const uint8_t*>(bytes);
+	data.insert(data.end(), first, first + size);
+}
+
+void PipelineKey::writeString(const char* string)
+{
+	for (const char* c = string; c and *c; ++c) data.push_back(uint8_t(toupper(uint8_t(*c))));
+	data.push_back(0);
+}
+
+void PipelineKey::writeShader(const D3D12_SHADER_BYTECODE& shader)
+{
+	// Size and hash instead of the whole bytecode, keys stay small (a few hundred bytes)
+	uint64_t size = shader.pShaderBytecode ? uint64_t(shader.BytecodeLength) : 0;
+	write(size);
+	write(size > 0 ? hashBytes(shader.pShaderBytecode, size_t(size)) : 0ull);
+}
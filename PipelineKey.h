@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Identity of a pipeline state for the pipeline cache (no GPU objects here): the desc written field by field in a fixed
+// order, with what the runtime ignores left out (disabled blend and stencil state, formats past NumRenderTargets, the
+// other render targets without independent blend...), shaders and semantics by contents instead of by pointer, and the
+// root signature as an id given by the caller. Descs that create the same pipeline get the same key.
+class PipelineKey
+{
+public:
+
+	static constexpr uint32_t VERSION = 1; // (part of every key: change it whenever what gets written changes)
+
+	PipelineKey() = default;
+	PipelineKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureId);
+	PipelineKey(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureId);
+
+	inline uint64_t getHash() const { return hash; };
+	inline const std::vector<uint8_t>& getData() const { return data; }; // (normalized desc, shaders as size + hash)
+
+	std::wstring getName() const; // hash as 16 hex digits (name in an ID3D12PipelineLibrary)
+
+	inline bool operator==(const PipelineKey& other) const { return hash == other.hash and data == other.data; };
+	inline bool operator!=(const PipelineKey& other) const { return not (*this == other); };
+
+	struct Hasher
+	{
+		inline size_t operator()(const PipelineKey& key) const { return size_t(key.hash); };
+	};
+
+private:
+
+	std::vector<uint8_t> data;
+	uint64_t hash = 0;
+
+	void begin(uint8_t type, uint64_t rootSignatureId);
+	void end();
+
+	void writeBytes(const void* bytes, size_t size);
+	void writeString(const char* string); // (case insensitive, as semantics: written in upper case)
+	void writeShader(const D3D12_SHADER_BYTECODE& shader);
+
+	template<typename T>
+	inline void write(T value) { writeBytes(&value, sizeof(T)); };
+};
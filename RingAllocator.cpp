@@ -0,0 +1,66 @@
+#include "Globals.h"
+
+#include "RingAllocator.h"
+
+void RingAllocator::reset(size_t newCapacity)
+{
+	batches.clear();
+
+	capacity = newCapacity;
+	head = tail = used = openBatchSize = 0;
+}
+
+size_t RingAllocator::allocate(size_t size, size_t alignment)
+{
+	if (size == 0 or size > capacity) return INVALID_OFFSET;
+
+	if (used == 0) head = tail = 0; // empty ring, start again from the beginning (less wrapping)
+
+	size_t offset = alignUp(head, alignment);
+	size_t consumed;
+
+	if (head >= tail) // free space is [head, capacity) + [0, tail)
+	{
+		if (head == tail and used != 0) return INVALID_OFFSET; // full
+
+		if (offset + size <= capacity) {
+			consumed = offset + size - head;
+		}
+		else if (size <= tail) { // wrap around (the end of the ring is wasted until this batch is released)
+			offset = 0;
+			consumed = (capacity - head) + size;
+		}
+		else return INVALID_OFFSET;
+	}
+	else // free space is [head, tail)
+	{
+		if (offset + size > tail) return INVALID_OFFSET;
+
+		consumed = offset + size - head;
+	}
+
+	head = offset + size;
+	used += consumed;
+	openBatchSize += consumed;
+
+	return offset;
+}
+
+void RingAllocator::finishBatch(uint64_t fenceValue)
+{
+	if (openBatchSize == 0) return;
+
+	batches.push_back({ fenceValue, head, openBatchSize });
+	openBatchSize = 0;
+}
+
+void RingAllocator::release(uint64_t completedFenceValue)
+{
+	while (not batches.empty() and batches.front().fenceValue <= completedFenceValue)
+	{
+		tail = batches.front().end;
+		used -= batches.front().size;
+
+		batches.pop_front();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+
+// Bookkeeping for a linear ring of memory (offsets only, no GPU objects here): allocations are handed out
+// from the head, and whole batches of them are given back at the tail once the fence value they were submitted with is reached.
+class RingAllocator
+{
+public:
+
+	static const size_t INVALID_OFFSET = SIZE_MAX;
+
+	RingAllocator(size_t capacity = 0) : capacity(capacity) {}
+
+	void reset(size_t newCapacity);
+
+	size_t allocate(size_t size, size_t alignment); // returns INVALID_OFFSET if there is no room (until some batch is released)
+
+	void finishBatch(uint64_t fenceValue);	  // everything allocated since the last call is in use until fenceValue is reached
+	void release(uint64_t completedFenceValue); // recycles the batches whose fence value was reached
+
+	inline bool hasBatchesInFlight() const { return not batches.empty(); };
+	inline uint64_t getOldestFenceValue() const { return batches.empty() ? 0 : batches.front().fenceValue; };
+
+	inline size_t getCapacity() const { return capacity; };
+	inline size_t getUsedSize() const { return used; }; // (alignment padding and the wasted end of the ring when wrapping count as used)
+
+private:
+
+	struct Batch
+	{
+		uint64_t fenceValue;
+		size_t end;	 // head position when the batch was finished (new tail when released)
+		size_t size; // bytes consumed by the batch
+	};
+
+	std::deque<Batch> batches;
+
+	size_t capacity = 0;
+	size_t head = 0;		 // next free byte
+	size_t tail = 0;		 // first byte still in use
+	size_t used = 0;
+	size_t openBatchSize = 0; // bytes allocated since the last finishBatch()
+};
@@ -0,0 +1,249 @@
+#include "Globals.h"
+
+#include "RootSignatureDesc.h"
+#include "Hash.h"
+
+#include <algorithm>
+
+namespace
+{
+	typedef RootSignatureDesc::Upgrade Upgrade;
+
+	// Static data only with static descriptors (what a volatile descriptor points to can't be known early)
+	D3D12_DESCRIPTOR_RANGE_FLAGS upgradeRange(D3D12_DESCRIPTOR_RANGE_TYPE type, bool bounded, Upgrade upgrade)
+	{
+		bool staticDescriptors = upgrade == RootSignatureDesc::UPGRADE_STATIC and bounded;
+		D3D12_DESCRIPTOR_RANGE_FLAGS flags = staticDescriptors ? D3D12_DESCRIPTOR_RANGE_FLAG_NONE : D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
+
+		if (type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER) return flags; // (samplers have no data flags)
+		if (type == D3D12_DESCRIPTOR_RANGE_TYPE_UAV) return flags | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+
+		return flags | (staticDescriptors ? D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC : D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+	}
+
+	D3D12_ROOT_DESCRIPTOR_FLAGS upgradeDescriptor(D3D12_ROOT_PARAMETER_TYPE type, Upgrade upgrade)
+	{
+		if (type == D3D12_ROOT_PARAMETER_TYPE_UAV) return D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE;
+		return upgrade == RootSignatureDesc::UPGRADE_STATIC ? D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC : D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+	}
+
+	// Flags as the runtime reads them: no data flag means the defaults (CBV/SRV static while set at execute, UAV volatile)
+	D3D12_DESCRIPTOR_RANGE_FLAGS getEffectiveFlags(const D3D12_DESCRIPTOR_RANGE1& range)
+	{
+		const D3D12_DESCRIPTOR_RANGE_FLAGS DATA_FLAGS = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE |
+														D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
+
+		if (range.RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER or (range.Flags & DATA_FLAGS) != 0) return range.Flags;
+
+		return range.Flags | (range.RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_UAV ? D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE :
+																				  D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+	}
+
+	D3D12_ROOT_DESCRIPTOR_FLAGS getEffectiveFlags(D3D12_ROOT_PARAMETER_TYPE type, D3D12_ROOT_DESCRIPTOR_FLAGS flags)
+	{
+		if (flags != D3D12_ROOT_DESCRIPTOR_FLAG_NONE) return flags;
+		return type == D3D12_ROOT_PARAMETER_TYPE_UAV ? D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE : D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+	}
+
+	inline float canonicalFloat(float value)
+	{
+		return value == 0.0f ? 0.0f : value; // (-0 is 0)
+	}
+}
+
+RootSignatureDesc::RootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC& source, Upgrade upgrade)
+{
+	parameters.resize(source.NumParameters);
+	ranges.resize(source.NumParameters);
+
+	for (UINT i = 0; i < source.NumParameters; ++i)
+	{
+		const D3D12_ROOT_PARAMETER& from = source.pParameters[i];
+		D3D12_ROOT_PARAMETER1& to = parameters[i];
+
+		to.ParameterType = from.ParameterType;
+		to.ShaderVisibility = from.ShaderVisibility;
+
+		switch (from.ParameterType)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			for (UINT j = 0; j < from.DescriptorTable.NumDescriptorRanges; ++j)
+			{
+				const D3D12_DESCRIPTOR_RANGE& range = from.DescriptorTable.pDescriptorRanges[j];
+				D3D12_DESCRIPTOR_RANGE_FLAGS flags = upgradeRange(range.RangeType, range.NumDescriptors != UINT_MAX, upgrade);
+
+				ranges[i].push_back({ range.RangeType, range.NumDescriptors, range.BaseShaderRegister, range.RegisterSpace, flags, range.OffsetInDescriptorsFromTableStart });
+			}
+			break;
+
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			to.Constants = from.Constants;
+			break;
+
+		default: // (root CBV, SRV or UAV)
+			to.Descriptor = { from.Descriptor.ShaderRegister, from.Descriptor.RegisterSpace, upgradeDescriptor(from.ParameterType, upgrade) };
+			break;
+		}
+	}
+
+	samplers.assign(source.pStaticSamplers, source.pStaticSamplers + source.NumStaticSamplers);
+	desc.Desc_1_1.Flags = source.Flags;
+
+	canonicalize();
+}
+
+RootSignatureDesc::RootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& source)
+{
+	parameters.assign(source.pParameters, source.pParameters + source.NumParameters);
+	ranges.resize(source.NumParameters);
+
+	for (UINT i = 0; i < source.NumParameters; ++i)
+	{
+		const D3D12_ROOT_PARAMETER1& parameter = source.pParameters[i];
+		if (parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+			ranges[i].assign(parameter.DescriptorTable.pDescriptorRanges, parameter.DescriptorTable.pDescriptorRanges + parameter.DescriptorTable.NumDescriptorRanges);
+	}
+
+	samplers.assign(source.pStaticSamplers, source.pStaticSamplers + source.NumStaticSamplers);
+	desc.Desc_1_1.Flags = source.Flags;
+
+	canonicalize();
+}
+
+D3D12_ROOT_SIGNATURE_DESC RootSignatureDesc::getDesc_1_0(std::vector<D3D12_ROOT_PARAMETER>& parameters10, std::vector<D3D12_DESCRIPTOR_RANGE>& ranges10) const
+{
+	size_t rangeCount = 0;
+	for (const std::vector<D3D12_DESCRIPTOR_RANGE1>& table : ranges) rangeCount += table.size();
+
+	parameters10.resize(parameters.size());
+	ranges10.clear();
+	ranges10.reserve(rangeCount); // (the tables point into it)
+
+	for (size_t i = 0; i < parameters.size(); ++i)
+	{
+		const D3D12_ROOT_PARAMETER1& from = parameters[i];
+		D3D12_ROOT_PARAMETER& to = parameters10[i];
+
+		to = {};
+		to.ParameterType = from.ParameterType;
+		to.ShaderVisibility = from.ShaderVisibility;
+
+		if (from.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+		{
+			to.DescriptorTable = { UINT(ranges[i].size()), ranges10.data() + ranges10.size() };
+			for (const D3D12_DESCRIPTOR_RANGE1& range : ranges[i])
+				ranges10.push_back({ range.RangeType, range.NumDescriptors, range.BaseShaderRegister, range.RegisterSpace, range.OffsetInDescriptorsFromTableStart });
+		}
+		else if (from.ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS) to.Constants = from.Constants;
+		else to.Descriptor = { from.Descriptor.ShaderRegister, from.Descriptor.RegisterSpace };
+	}
+
+	const D3D12_ROOT_SIGNATURE_DESC1& desc11 = desc.Desc_1_1;
+	return { desc11.NumParameters, parameters10.data(), desc11.NumStaticSamplers, desc11.pStaticSamplers, desc11.Flags };
+}
+
+size_t RootSignatureDesc::KeyHasher::operator()(const std::vector<uint8_t>& key) const
+{
+	return size_t(hashBytes(key.data(), key.size()));
+}
+
+void RootSignatureDesc::canonicalize()
+{
+	for (size_t i = 0; i < parameters.size(); ++i)
+	{
+		if (parameters[i].ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE) continue;
+
+		// Appended ranges at their offsets (a range after an unbounded one can't append: left as it is, creating it fails)
+		UINT offset = 0;
+		for (D3D12_DESCRIPTOR_RANGE1& range : ranges[i])
+		{
+			if (range.OffsetInDescriptorsFromTableStart == D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND and offset != UINT_MAX) range.OffsetInDescriptorsFromTableStart = offset;
+			offset = range.NumDescriptors == UINT_MAX or range.OffsetInDescriptorsFromTableStart == D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND ?
+						 UINT_MAX : range.OffsetInDescriptorsFromTableStart + range.NumDescriptors;
+		}
+
+		parameters[i].DescriptorTable = { UINT(ranges[i].size()), ranges[i].empty() ? nullptr : ranges[i].data() };
+	}
+
+	// The order of static samplers means nothing (their registers do)
+	std::sort(samplers.begin(), samplers.end(), [](const D3D12_STATIC_SAMPLER_DESC& a, const D3D12_STATIC_SAMPLER_DESC& b) {
+		return a.RegisterSpace != b.RegisterSpace ? a.RegisterSpace < b.RegisterSpace : a.ShaderRegister < b.ShaderRegister;
+	});
+
+	desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	desc.Desc_1_1.NumParameters = UINT(parameters.size());
+	desc.Desc_1_1.pParameters = parameters.empty() ? nullptr : parameters.data();
+	desc.Desc_1_1.NumStaticSamplers = UINT(samplers.size());
+	desc.Desc_1_1.pStaticSamplers = samplers.empty() ? nullptr : samplers.data();
+
+	buildKey();
+}
+
+void RootSignatureDesc::buildKey()
+{
+	key.clear();
+	key.reserve(64 + parameters.size() * 32 + samplers.size() * 64);
+
+	write(VERSION);
+	write(desc.Desc_1_1.Flags);
+	write(uint32_t(parameters.size()));
+
+	for (size_t i = 0; i < parameters.size(); ++i)
+	{
+		const D3D12_ROOT_PARAMETER1& parameter = parameters[i];
+		write(parameter.ParameterType);
+		write(parameter.ShaderVisibility);
+
+		switch (parameter.ParameterType)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			write(uint32_t(ranges[i].size()));
+			for (const D3D12_DESCRIPTOR_RANGE1& range : ranges[i])
+			{
+				write(range.RangeType);
+				write(range.NumDescriptors);
+				write(range.BaseShaderRegister);
+				write(range.RegisterSpace);
+				write(getEffectiveFlags(range));
+				write(range.OffsetInDescriptorsFromTableStart);
+			}
+			break;
+
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			write(parameter.Constants.ShaderRegister);
+			write(parameter.Constants.RegisterSpace);
+			write(parameter.Constants.Num32BitValues);
+			break;
+
+		default:
+			write(parameter.Descriptor.ShaderRegister);
+			write(parameter.Descriptor.RegisterSpace);
+			write(getEffectiveFlags(parameter.ParameterType, parameter.Descriptor.Flags));
+			break;
+		}
+	}
+
+	// Samplers: anisotropy, comparison and border color only where the filter and address modes read them
+	write(uint32_t(samplers.size()));
+	for (const D3D12_STATIC_SAMPLER_DESC& sampler : samplers)
+	{
+		bool border = sampler.AddressU == D3D12_TEXTURE_ADDRESS_MODE_BORDER or sampler.AddressV == D3D12_TEXTURE_ADDRESS_MODE_BORDER or
+					  sampler.AddressW == D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+
+		write(sampler.Filter);
+		write(sampler.AddressU);
+		write(sampler.AddressV);
+		write(sampler.AddressW);
+		write(canonicalFloat(sampler.MipLODBias));
+		write(D3D12_DECODE_IS_ANISOTROPIC_FILTER(sampler.Filter) ? sampler.MaxAnisotropy : 0u);
+		write(D3D12_DECODE_FILTER_REDUCTION(sampler.Filter) == D3D12_FILTER_REDUCTION_TYPE_COMPARISON ? sampler.ComparisonFunc : D3D12_COMPARISON_FUNC(0));
+		write(border ? sampler.BorderColor : D3D12_STATIC_BORDER_COLOR(0));
+		write(canonicalFloat(sampler.MinLOD));
+		write(canonicalFloat(sampler.MaxLOD));
+		write(sampler.ShaderRegister);
+		write(sampler.RegisterSpace);
+		write(sampler.ShaderVisibility);
+	}
+
+	hash = hashBytes(key.data(), key.size());
+}
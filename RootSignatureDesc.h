@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// A root signature desc with everything it points to, in canonical form (no GPU objects here): always version 1.1 (1.0
+// descs are upgraded, see Upgrade), range offsets resolved, static samplers in register order. The key writes it field
+// by field with what the runtime ignores left out (e.g. the border color of samplers that never read it), so descs that
+// create the same root signature get the same key, whatever version, order or offset style they were written with.
+class RootSignatureDesc
+{
+public:
+
+	static constexpr uint32_t VERSION = 1; // (part of every key: change it whenever what gets written changes)
+
+	// 1.0 has no flags: the runtime treats its descriptors as volatile and only trusts CBV/SRV data while set at execute
+	enum Upgrade
+	{
+		UPGRADE_VOLATILE, // exactly the 1.0 behaviour, always safe
+		UPGRADE_STATIC	  // descriptors and CBV/SRV data don't change once written (e.g. loaded textures, constants written
+						  // once), the driver may read them early. UAV data and unbounded ranges stay volatile.
+	};
+
+	RootSignatureDesc() = default;
+	explicit RootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC& desc, Upgrade upgrade = UPGRADE_VOLATILE);
+	explicit RootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& desc);
+
+	// (moved, not copied: the desc points to its own arrays)
+	RootSignatureDesc(RootSignatureDesc&&) = default;
+	RootSignatureDesc& operator=(RootSignatureDesc&&) = default;
+	RootSignatureDesc(const RootSignatureDesc&) = delete;
+	RootSignatureDesc& operator=(const RootSignatureDesc&) = delete;
+
+	inline const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& getDesc() const { return desc; }; // (valid while this lives)
+
+	// For devices without 1.1: the flags dropped (1.0 treats everything as UPGRADE_VOLATILE does), arrays in the vectors
+	D3D12_ROOT_SIGNATURE_DESC getDesc_1_0(std::vector<D3D12_ROOT_PARAMETER>& parameters, std::vector<D3D12_DESCRIPTOR_RANGE>& ranges) const;
+
+	inline uint64_t getHash() const { return hash; };
+	inline const std::vector<uint8_t>& getKey() const { return key; };
+
+	inline bool operator==(const RootSignatureDesc& other) const { return hash == other.hash and key == other.key; };
+	inline bool operator!=(const RootSignatureDesc& other) const { return not (*this == other); };
+
+	struct KeyHasher
+	{
+		size_t operator()(const std::vector<uint8_t>& key) const;
+	};
+
+private:
+
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc = {};
+	std::vector<D3D12_ROOT_PARAMETER1> parameters;
+	std::vector<std::vector<D3D12_DESCRIPTOR_RANGE1>> ranges; // by parameter (empty for the ones that aren't tables)
+	std::vector<D3D12_STATIC_SAMPLER_DESC> samplers;
+
+	std::vector<uint8_t> key;
+	uint64_t hash = 0;
+
+	void canonicalize(); // (after the arrays are filled)
+	void buildKey();
+
+	template<typename T>
+	inline void write(T value) { key.insert(key.end(), reinterpret_cast<const uint8_t*>(&value), reinterpret_cast<const uint8_t*>(&value) + sizeof(T)); };
+};
@@ -0,0 +1,437 @@
+#include "Globals.h"
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+struct SceneBVH::BuildRef
+{
+	Bounds bounds;
+	float centroid[3];
+	uint32_t object;
+};
+
+namespace
+{
+	const SceneBVH::Bounds EMPTY_BOUNDS = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+	inline void grow(SceneBVH::Bounds& bounds, const SceneBVH::Bounds& other)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			bounds.min[axis] = std::min(bounds.min[axis], other.min[axis]);
+			bounds.max[axis] = std::max(bounds.max[axis], other.max[axis]);
+		}
+	}
+
+	inline void grow(SceneBVH::Bounds& bounds, const float point[3])
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			bounds.min[axis] = std::min(bounds.min[axis], point[axis]);
+			bounds.max[axis] = std::max(bounds.max[axis], point[axis]);
+		}
+	}
+
+	inline float halfArea(const SceneBVH::Bounds& bounds) // (half the surface, the SAH only needs ratios)
+	{
+		float x = bounds.max[0] - bounds.min[0], y = bounds.max[1] - bounds.min[1], z = bounds.max[2] - bounds.min[2];
+		return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+	}
+
+	inline float nodeCost(const SceneBVH::Node& node) // (traversing an inner node costs as much as testing an object)
+	{
+		return halfArea(node.bounds) * float(node.count > 0 ? node.count : 1);
+	}
+
+	inline float treeCost(const std::vector<SceneBVH::Node>& nodes, float total)
+	{
+		float rootArea = nodes.empty() ? 0.0f : halfArea(nodes[0].bounds);
+		return rootArea > 0.0f ? total / rootArea : 0.0f;
+	}
+}
+
+SceneBVH::~SceneBVH()
+{
+	if (rebuildJob) rebuildJobSystem->wait(rebuildJob);
+}
+
+void SceneBVH::build(const Bounds* bounds, size_t count, JobSystem* jobSystem)
+{
+	if (rebuildJob) // (built from bounds that don't matter anymore)
+	{
+		rebuildJobSystem->wait(rebuildJob);
+		rebuildJob = nullptr;
+		rebuilt.reset();
+	}
+
+	build(tree, bounds, count, jobSystem);
+}
+
+void SceneBVH::refit(const Bounds* bounds)
+{
+	refit(tree, bounds);
+}
+
+void SceneBVH::update(const std::vector<Bounds>& bounds, JobSystem* jobSystem)
+{
+	if (rebuildJob and rebuildJobSystem->isDone(rebuildJob))
+	{
+		if (rebuilt->objects.size() == bounds.size()) tree = std::move(*rebuilt);
+
+		rebuildJob = nullptr;
+		rebuilt.reset();
+	}
+
+	if (bounds.size() != tree.objects.size())
+	{
+		build(bounds.data(), bounds.size(), jobSystem);
+		return;
+	}
+
+	refit(tree, bounds.data()); // (also fits a tree just swapped in, it was built from the bounds of an older frame)
+
+	if (getCostRatio() > REBUILD_RATIO and not rebuildJob and jobSystem)
+	{
+		rebuilt = std::make_unique<Tree>();
+		rebuildJobSystem = jobSystem;
+		rebuildJob = jobSystem->schedule([target = rebuilt.get(), snapshot = bounds, jobSystem]() {
+			build(*target, snapshot.data(), snapshot.size(), jobSystem);
+		});
+	}
+}
+
+void SceneBVH::build(Tree& target, const Bounds* bounds, size_t count, JobSystem* jobSystem)
+{
+	target.nodes.clear();
+	target.objects.resize(count);
+	target.leafBounds.resize(count);
+	target.builtCost = target.cost = 0.0f;
+
+	if (count == 0) return;
+
+	std::vector<BuildRef> refs(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		refs[i].bounds = bounds[i];
+		for (int axis = 0; axis < 3; ++axis) refs[i].centroid[axis] = (bounds[i].min[axis] + bounds[i].max[axis]) * 0.5f;
+		refs[i].object = uint32_t(i);
+	}
+
+	// Every split leaves objects on both sides, so there are at most 2 * count - 1 nodes (allocated in pairs by the jobs)
+	target.nodes.resize(2 * count - 1);
+	std::atomic<uint32_t> nodeCount = 1;
+
+	buildNode(target, refs.data(), 0, 0, uint32_t(count), nodeCount, jobSystem);
+	target.nodes.resize(nodeCount);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		target.objects[i] = refs[i].object;
+		target.leafBounds[i] = refs[i].bounds;
+	}
+
+	float total = 0.0f;
+	for (const Node& node : target.nodes) total += nodeCost(node);
+
+	target.builtCost = target.cost = treeCost(target.nodes, total);
+}
+
+void SceneBVH::buildNode(Tree& target, BuildRef* refs, uint32_t nodeIndex, uint32_t first, uint32_t count, std::atomic<uint32_t>& nodeCount, JobSystem* jobSystem)
+{
+	Node& node = target.nodes[nodeIndex];
+
+	Bounds centroidBounds = EMPTY_BOUNDS;
+	node.bounds = EMPTY_BOUNDS;
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		grow(node.bounds, refs[i].bounds);
+		grow(centroidBounds, refs[i].centroid);
+	}
+
+	node.first = first;
+	node.count = count;
+	if (count == 1) return;
+
+	// Binned SAH: objects go to BIN_COUNT bins by centroid on each axis (all three in one pass over the objects) and the
+	// cheapest split between bins wins
+	struct Bin
+	{
+		Bounds bounds = EMPTY_BOUNDS;
+		uint32_t count = 0;
+	};
+
+	Bin axisBins[3][BIN_COUNT];
+	float scales[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		scales[axis] = extent > 0.0f ? float(BIN_COUNT) / extent : 0.0f;
+	}
+
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			Bin& bin = axisBins[axis][std::min(int(BIN_COUNT) - 1, int((refs[i].centroid[axis] - centroidBounds.min[axis]) * scales[axis]))];
+			grow(bin.bounds, refs[i].bounds);
+			++bin.count;
+		}
+	}
+
+	int bestAxis = -1, bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (scales[axis] == 0.0f) continue;
+
+		const Bin* bins = axisBins[axis];
+
+		// (split s: bins [0, s) on the left)
+		float rightCost[BIN_COUNT];
+		Bounds right = EMPTY_BOUNDS;
+		uint32_t rightCount = 0;
+		for (int split = BIN_COUNT - 1; split > 0; --split)
+		{
+			grow(right, bins[split].bounds);
+			rightCount += bins[split].count;
+			rightCost[split] = rightCount > 0 ? halfArea(right) * float(rightCount) : FLT_MAX;
+		}
+
+		Bounds left = EMPTY_BOUNDS;
+		uint32_t leftCount = 0;
+		for (int split = 1; split < BIN_COUNT; ++split)
+		{
+			grow(left, bins[split - 1].bounds);
+			leftCount += bins[split - 1].count;
+			if (leftCount == 0 or leftCount == count) continue;
+
+			float cost = halfArea(left) * float(leftCount) + rightCost[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	uint32_t leftCount;
+	if (bestAxis < 0) // all the centroids in one point: only splitting in halves helps a big leaf
+	{
+		if (count <= MAX_LEAF_SIZE) return;
+		leftCount = count / 2;
+	}
+	else
+	{
+		float leafCost = halfArea(node.bounds) * float(count), splitCost = halfArea(node.bounds) + bestCost;
+		if (count <= MAX_LEAF_SIZE and leafCost <= splitCost) return;
+
+		float scale = scales[bestAxis];
+		BuildRef* middle = std::partition(refs + first, refs + first + count, [&](const BuildRef& ref) {
+			return std::min(int(BIN_COUNT) - 1, int((ref.centroid[bestAxis] - centroidBounds.min[bestAxis]) * scale)) < bestSplit;
+		});
+		leftCount = uint32_t(middle - (refs + first));
+	}
+
+	uint32_t children = nodeCount.fetch_add(2);
+	node.first = children;
+	node.count = 0;
+
+	if (jobSystem and count > PARALLEL_BUILD_SIZE)
+	{
+		JobSystem::JobHandle leftJob = jobSystem->schedule([&target, refs, children, first, leftCount, &nodeCount, jobSystem]() {
+			buildNode(target, refs, children, first, leftCount, nodeCount, jobSystem);
+		});
+		buildNode(target, refs, children + 1, first + leftCount, count - leftCount, nodeCount, jobSystem);
+		jobSystem->wait(leftJob);
+	}
+	else
+	{
+		buildNode(target, refs, children, first, leftCount, nodeCount, jobSystem);
+		buildNode(target, refs, children + 1, first + leftCount, count - leftCount, nodeCount, jobSystem);
+	}
+}
+
+void SceneBVH::refit(Tree& target, const Bounds* bounds)
+{
+	for (size_t i = 0; i < target.objects.size(); ++i) target.leafBounds[i] = bounds[target.objects[i]];
+
+	float total = 0.0f;
+	for (size_t i = target.nodes.size(); i-- > 0;)
+	{
+		Node& node = target.nodes[i];
+
+		node.bounds = EMPTY_BOUNDS;
+		if (node.count > 0)
+		{
+			for (uint32_t object = node.first; object < node.first + node.count; ++object) grow(node.bounds, target.leafBounds[object]);
+		}
+		else
+		{
+			grow(node.bounds, target.nodes[node.first].bounds);
+			grow(node.bounds, target.nodes[node.first + 1].bounds);
+		}
+
+		total += nodeCost(node);
+	}
+
+	target.cost = treeCost(target.nodes, total);
+}
+
+void SceneBVH::cull(const FrustumCuller& frustum, std::vector<uint32_t>& visible) const
+{
+	if (tree.nodes.empty()) return;
+
+	const FrustumCuller::Plane* planes = frustum.getPlanes();
+	const float* origin = frustum.getOrigin();
+
+	// Same test as FrustumCuller (camera relative), and the planes a node is fully inside of are not tested again below it
+	auto test = [planes, origin](const Bounds& bounds, uint32_t& planeMask) {
+		float center[3], extent[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			center[axis] = (bounds.min[axis] + bounds.max[axis]) * 0.5f - origin[axis];
+			extent[axis] = (bounds.max[axis] - bounds.min[axis]) * 0.5f;
+		}
+
+		for (int i = 0; i < FrustumCuller::PLANE_COUNT; ++i)
+		{
+			if ((planeMask & (1u << i)) == 0) continue;
+
+			const FrustumCuller::Plane& plane = planes[i];
+			float radius = std::fabs(plane.a) * extent[0] + std::fabs(plane.b) * extent[1] + std::fabs(plane.c) * extent[2];
+			float distance = plane.a * center[0] + plane.b * center[1] + plane.c * center[2] + plane.d;
+
+			if (distance < -radius) return false;
+			if (distance >= radius) planeMask &= ~(1u << i);
+		}
+
+		return true;
+	};
+
+	struct Entry
+	{
+		uint32_t node;
+		uint32_t planeMask;
+	};
+
+	std::vector<Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, (1u << FrustumCuller::PLANE_COUNT) - 1 });
+
+	while (not stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+
+		const Node& node = tree.nodes[entry.node];
+		if (entry.planeMask != 0 and not test(node.bounds, entry.planeMask)) continue;
+
+		if (node.count == 0)
+		{
+			stack.push_back({ node.first + 1, entry.planeMask });
+			stack.push_back({ node.first, entry.planeMask });
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			uint32_t planeMask = entry.planeMask;
+			if (planeMask == 0 or test(tree.leafBounds[i], planeMask)) visible.push_back(tree.objects[i]);
+		}
+	}
+}
+
+bool SceneBVH::pick(const float rayOrigin[3], const float rayDirection[3], float maxDistance, uint32_t& object, float& distance) const
+{
+	if (tree.nodes.empty()) return false;
+
+	float inverse[3];
+	for (int axis = 0; axis < 3; ++axis)
+		inverse[axis] = 1.0f / (std::fabs(rayDirection[axis]) > 1e-30f ? rayDirection[axis] : 1e-30f); // (no 0 * inf NaNs in the slabs)
+
+	// Distance where the ray enters the box, or a negative value if it misses it before 'limit'
+	auto enter = [rayOrigin, &inverse](const Bounds& bounds, float limit) {
+		float tEnter = 0.0f, tExit = limit;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float tNear = (bounds.min[axis] - rayOrigin[axis]) * inverse[axis], tFar = (bounds.max[axis] - rayOrigin[axis]) * inverse[axis];
+			if (tNear > tFar) std::swap(tNear, tFar);
+
+			tEnter = std::max(tEnter, tNear);
+			tExit = std::min(tExit, tFar);
+		}
+
+		return tEnter <= tExit ? tEnter : -1.0f;
+	};
+
+	bool found = false;
+	float closest = maxDistance;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (not stack.empty())
+	{
+		const Node& node = tree.nodes[stack.back()];
+		stack.pop_back();
+
+		if (enter(node.bounds, closest) < 0.0f) continue;
+
+		if (node.count == 0)
+		{
+			// Nearest child on top (it may shorten the ray before the other one is tested)
+			float leftEnter = enter(tree.nodes[node.first].bounds, closest), rightEnter = enter(tree.nodes[node.first + 1].bounds, closest);
+			uint32_t nearChild = node.first, farChild = node.first + 1;
+			if (rightEnter >= 0.0f and (leftEnter < 0.0f or rightEnter < leftEnter))
+			{
+				std::swap(nearChild, farChild);
+				std::swap(leftEnter, rightEnter);
+			}
+
+			if (rightEnter >= 0.0f) stack.push_back(farChild);
+			if (leftEnter >= 0.0f) stack.push_back(nearChild);
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			float t = enter(tree.leafBounds[i], closest);
+			if (t >= 0.0f and (not found or t < closest))
+			{
+				found = true;
+				closest = t;
+				object = tree.objects[i];
+			}
+		}
+	}
+
+	if (found) distance = closest;
+	return found;
+}
+
+void SceneBVH::visit(int maxDepth, const std::function<void(const Node& node, int depth)>& visitor) const
+{
+	if (tree.nodes.empty()) return;
+
+	std::vector<std::pair<uint32_t, int>> stack = { { 0, 0 } };
+	while (not stack.empty())
+	{
+		auto [index, depth] = stack.back();
+		stack.pop_back();
+
+		const Node& node = tree.nodes[index];
+		visitor(node, depth);
+
+		if (node.count == 0 and depth < maxDepth)
+		{
+			stack.push_back({ node.first + 1, depth + 1 });
+			stack.push_back({ node.first, depth + 1 });
+		}
+	}
+}
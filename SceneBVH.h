@@ -0,0 +1,78 @@
+#pragma once
+
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Bounding volume hierarchy over object AABBs (no GPU objects here). Built with a binned SAH (big subtrees are built in
+// parallel jobs), refitted bottom up when only the bounds move, and rebuilt by a background job once refits made it too
+// much worse than a fresh build. Nodes are stored parents first (children always after their parent), so a refit is a
+// single backwards pass.
+class SceneBVH
+{
+public:
+
+	struct Bounds
+	{
+		float min[3], max[3];
+	};
+
+	struct Node
+	{
+		Bounds bounds;
+		uint32_t first; // left child (the right one is first + 1) or first object of a leaf
+		uint32_t count; // objects of a leaf, 0 for inner nodes
+	};
+
+	~SceneBVH(); // (waits for a background rebuild)
+
+	void build(const Bounds* bounds, size_t count, JobSystem* jobSystem = nullptr); // jobs for the big subtrees if given
+	void refit(const Bounds* bounds);												// same objects as the last build, new bounds
+
+	// Once a frame: refits to the new bounds, starts a background rebuild when the quality got worse than REBUILD_RATIO
+	// and swaps it in when done (refitted to the bounds of that frame). Builds right away if the object count changed.
+	void update(const std::vector<Bounds>& bounds, JobSystem* jobSystem);
+
+	// Objects whose AABB touches the frustum (appended to visible, in no particular order)
+	void cull(const FrustumCuller& frustum, std::vector<uint32_t>& visible) const;
+
+	// Closest object whose AABB the ray hits before maxDistance (distance is where it enters the AABB, 0 if it starts inside)
+	bool pick(const float rayOrigin[3], const float rayDirection[3], float maxDistance, uint32_t& object, float& distance) const;
+
+	void visit(int maxDepth, const std::function<void(const Node& node, int depth)>& visitor) const; // (parents first)
+
+	inline size_t getObjectCount() const { return tree.objects.size(); };
+	inline size_t getNodeCount() const { return tree.nodes.size(); };
+	inline float getCostRatio() const { return tree.builtCost > 0.0f ? tree.cost / tree.builtCost : 1.0f; }; // SAH cost now / after the build
+	inline bool isRebuilding() const { return rebuildJob != nullptr; };
+
+private:
+
+	enum { BIN_COUNT = 16, MAX_LEAF_SIZE = 8, PARALLEL_BUILD_SIZE = 4096 }; // (subtrees with more objects than that are a job)
+	static constexpr float REBUILD_RATIO = 1.3f;
+
+	struct Tree
+	{
+		std::vector<Node> nodes;
+		std::vector<uint32_t> objects; // object index of every leaf entry
+		std::vector<Bounds> leafBounds; // (same order, so leaves test their objects without touching the caller's array)
+		float builtCost = 0.0f, cost = 0.0f;
+	};
+
+	struct BuildRef; // (object being sorted into the tree)
+
+	Tree tree;
+
+	std::unique_ptr<Tree> rebuilt; // written by the rebuild job
+	JobSystem::JobHandle rebuildJob;
+	JobSystem* rebuildJobSystem = nullptr;
+
+	static void build(Tree& target, const Bounds* bounds, size_t count, JobSystem* jobSystem);
+	static void buildNode(Tree& target, BuildRef* refs, uint32_t nodeIndex, uint32_t first, uint32_t count, std::atomic<uint32_t>& nodeCount, JobSystem* jobSystem);
+	static void refit(Tree& target, const Bounds* bounds);
+};
@@ -0,0 +1,276 @@
+#include "Globals.h"
+
+#include "ShaderCache.h"
+#include "FileUtils.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <set>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	inline double elapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	const uint32_t MAGIC = 0x43444853; // "SHDC"
+
+	struct FileHeader // followed by the key and the blob
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t keySize;
+		uint64_t blobSize;
+		uint64_t blobHash;
+	};
+
+	template<typename T>
+	inline void write(std::string& key, T value)
+	{
+		key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	inline void writeString(std::string& key, const std::string& string)
+	{
+		key.append(string);
+		key.push_back(0);
+	}
+
+	inline void writeContents(std::string& key, const std::string& contents)
+	{
+		// Size and hash instead of the whole source, keys stay small
+		write(key, uint64_t(contents.size()));
+		write(key, hashBytes(contents.data(), contents.size()));
+	}
+
+	bool readText(const std::filesystem::path& path, std::string& text)
+	{
+		std::vector<uint8_t> data;
+		if (not FileUtils::readFile(path, data)) return false;
+
+		text.assign(data.begin(), data.end());
+		return true;
+	}
+
+	// Quoted #include names of a source, all of them (also the ones in disabled #if blocks: at worst a key covers a file too many)
+	std::vector<std::string> findIncludes(const std::string& text)
+	{
+		std::vector<std::string> includes;
+
+		for (size_t position = text.find('#'); position != std::string::npos; position = text.find('#', position))
+		{
+			position = text.find_first_not_of(" \t", position + 1);
+			if (position == std::string::npos or text.compare(position, 7, "include") != 0) continue;
+
+			position = text.find_first_not_of(" \t", position + 7);
+			if (position == std::string::npos or text[position] != '"') continue;
+
+			size_t end = text.find_first_of("\"\n", position + 1);
+			if (end == std::string::npos or text[end] != '"') continue;
+
+			includes.push_back(text.substr(position + 1, end - position - 1));
+			position = end;
+		}
+
+		return includes;
+	}
+}
+
+ShaderCache::ShaderCache(const std::filesystem::path& directory, Compiler compiler, uint64_t compilerId) : directory(directory), compiler(std::move(compiler)),
+																											 compilerId(compilerId)
+{
+}
+
+ShaderCache::Blob ShaderCache::get(const Desc& desc, std::string* errors, std::vector<std::filesystem::path>* files)
+{
+	std::string source, key;
+	bool found = buildKey(desc, source, key, files);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		++stats.requests;
+
+		if (not found)
+		{
+			++stats.failed;
+			if (errors) *errors = "source not found";
+			return nullptr;
+		}
+
+		// Another thread on it: its result (if it fails this one tries, and gets the errors)
+		pendingCondition.wait(lock, [&]() { return pending.count(key) == 0; });
+
+		auto it = blobs.find(key);
+		if (it != blobs.end())
+		{
+			++stats.shared;
+			return it->second;
+		}
+
+		pending.insert(key);
+	}
+
+	// Loaded or compiled outside the lock (other shaders keep going meanwhile)
+	std::filesystem::path cachePath = getCachePath(key);
+
+	Clock::time_point start = Clock::now();
+	Blob blob = load(cachePath, key);
+	double loadMs = elapsedMs(start);
+
+	bool loaded = blob != nullptr;
+	double compileMs = 0.0;
+
+	if (not loaded)
+	{
+		start = Clock::now();
+		std::vector<uint8_t> compiled;
+		std::string messages;
+
+		if (compiler(desc, source, compiled, messages) and not compiled.empty())
+		{
+			blob = std::make_shared<const std::vector<uint8_t>>(std::move(compiled));
+			if (not save(cachePath, key, *blob)) LOG("Shader %s could not be saved to %s", desc.path.string().c_str(), cachePath.string().c_str()); // (it can still be used)
+		}
+
+		compileMs = elapsedMs(start);
+		if (errors) *errors = std::move(messages);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.loadMs += loadMs;
+	stats.compileMs += compileMs;
+
+	pending.erase(key);
+	pendingCondition.notify_all();
+
+	if (not blob)
+	{
+		++stats.failed;
+		return nullptr;
+	}
+
+	if (loaded) ++stats.loaded;
+	else ++stats.compiled;
+
+	blobs.emplace(key, blob);
+	return blob;
+}
+
+ShaderCache::Stats ShaderCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+bool ShaderCache::buildKey(const Desc& desc, std::string& source, std::string& key, std::vector<std::filesystem::path>* files) const
+{
+	bool embedded = not desc.source.empty();
+	if (files) files->clear();
+	if (files and not embedded) files->push_back(desc.path);
+
+	if (embedded) source.assign(desc.source);
+	else if (not readText(desc.path, source)) return false;
+
+	key.clear();
+	key.reserve(256);
+
+	write(key, VERSION);
+	write(key, compilerId);
+	writeString(key, desc.profile);
+	writeString(key, desc.entry);
+
+	// Defines in name order (the order they are given in doesn't change the shader)
+	std::vector<Define> defines = desc.defines;
+	std::sort(defines.begin(), defines.end(), [](const Define& a, const Define& b) { return a.name < b.name; });
+
+	write(key, uint32_t(defines.size()));
+	for (const Define& define : defines)
+	{
+		writeString(key, define.name);
+		writeString(key, define.value);
+	}
+
+	writeContents(key, source);
+	if (embedded) return true;
+
+	// Included files, each one once: next to the file including it, else next to the shader (as the compilers search)
+	std::filesystem::path shaderDirectory = desc.path.parent_path();
+	std::set<std::filesystem::path> visited;
+	std::vector<std::pair<std::filesystem::path, std::string>> pending = { { desc.path, source } };
+
+	while (not pending.empty())
+	{
+		std::filesystem::path including = pending.back().first;
+		std::vector<std::string> includes = findIncludes(pending.back().second);
+		pending.pop_back();
+
+		for (const std::string& name : includes)
+		{
+			std::filesystem::path path = including.parent_path() / name;
+			std::error_code error;
+			if (not std::filesystem::exists(path, error)) path = shaderDirectory / name;
+
+			path = path.lexically_normal();
+			if (not visited.insert(path).second) continue;
+			if (files) files->push_back(path); // (missing ones too: creating them changes the shader)
+
+			std::string contents;
+			bool read = readText(path, contents);
+
+			writeString(key, path.generic_string());
+			if (read) writeContents(key, contents);
+			else write(key, ~0ull); // (missing: the compile reports it)
+
+			if (read) pending.emplace_back(path, std::move(contents));
+		}
+	}
+
+	return true;
+}
+
+std::filesystem::path ShaderCache::getCachePath(const std::string& key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hashBytes(key.data(), key.size()));
+
+	return directory / name;
+}
+
+ShaderCache::Blob ShaderCache::load(const std::filesystem::path& path, const std::string& key)
+{
+	std::error_code error;
+	if (not std::filesystem::exists(path, error)) return nullptr;
+
+	std::vector<uint8_t> file;
+	if (not FileUtils::readFile(path, file) or file.size() < sizeof(FileHeader)) return nullptr;
+
+	// The whole key is compared (not just its hash in the name), the blob hash catches files cut short or damaged
+	FileHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+
+	bool ok = header.magic == MAGIC and header.version == VERSION and header.keySize == key.size() and
+			  file.size() == sizeof(header) + header.keySize + header.blobSize and header.blobSize > 0 and
+			  memcmp(file.data() + sizeof(header), key.data(), key.size()) == 0;
+
+	const uint8_t* bytes = file.data() + sizeof(header) + key.size();
+	ok = ok and hashBytes(bytes, size_t(header.blobSize)) == header.blobHash;
+
+	return ok ? std::make_shared<const std::vector<uint8_t>>(bytes, bytes + header.blobSize) : nullptr;
+}
+
+bool ShaderCache::save(const std::filesystem::path& path, const std::string& key, const std::vector<uint8_t>& blob)
+{
+	FileHeader header = { MAGIC, VERSION, key.size(), blob.size(), hashBytes(blob.data(), blob.size()) };
+
+	std::vector<uint8_t> file(sizeof(header) + key.size() + blob.size());
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), key.data(), key.size());
+	memcpy(file.data() + sizeof(header) + key.size(), blob.data(), blob.size());
+
+	return FileUtils::writeFile(path, file);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Compiled shaders (no GPU objects or compilers here, the compile function is given): blobs keyed by the source, the
+// files it includes, the entry point, the profile, the defines and the compiler id, kept for the whole run (passes asking
+// for the same shader share its blob) and saved in a directory, so the next runs read them instead of compiling again.
+// Failed compiles are not kept (fixed sources compile on the next request). Thread safe, a shader is compiled once even
+// when several threads ask for it at the same time.
+class ShaderCache
+{
+public:
+
+	static constexpr uint32_t VERSION = 1; // (part of every key: change it whenever what gets written changes)
+
+	typedef std::shared_ptr<const std::vector<uint8_t>> Blob;
+
+	struct Define
+	{
+		std::string name;
+		std::string value;
+	};
+
+	struct Desc
+	{
+		std::filesystem::path path; // source file, or only its name with source set
+		std::string_view source;	// (embedded sources, these don't include files)
+		std::string entry = "main";
+		std::string profile;		// e.g. vs_6_0
+		std::vector<Define> defines;
+	};
+
+	// Compiles the source (read from the desc path already), errors gets the compiler messages
+	typedef std::function<bool(const Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors)> Compiler;
+
+	struct Stats
+	{
+		uint32_t requests = 0;
+		uint32_t shared = 0;   // (compiled or loaded before in this run)
+		uint32_t loaded = 0;   // from the directory
+		uint32_t compiled = 0;
+		uint32_t failed = 0;
+		double loadMs = 0.0;   // (summed over the threads)
+		double compileMs = 0.0;
+	};
+
+	ShaderCache(const std::filesystem::path& directory, Compiler compiler, uint64_t compilerId); // (id of the compiler and its options)
+
+	// Null if it can't be read or compiled; files gets the ones the shader reads (its source and includes, also when it
+	// fails: fixing any of them may fix it)
+	Blob get(const Desc& desc, std::string* errors = nullptr, std::vector<std::filesystem::path>* files = nullptr);
+
+	Stats getStats() const;
+
+private:
+
+	std::filesystem::path directory;
+	Compiler compiler;
+	uint64_t compilerId;
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, Blob> blobs; // by key
+	std::unordered_set<std::string> pending;	  // keys being loaded or compiled (other threads asking for them wait)
+	std::condition_variable pendingCondition;
+	Stats stats;
+
+	bool buildKey(const Desc& desc, std::string& source, std::string& key, std::vector<std::filesystem::path>* files) const;
+	std::filesystem::path getCachePath(const std::string& key) const;
+
+	static Blob load(const std::filesystem::path& path, const std::string& key);
+	static bool save(const std::filesystem::path& path, const std::string& key, const std::vector<uint8_t>& blob);
+};
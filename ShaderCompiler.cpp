@@ -0,0 +1,164 @@
+#include "Globals.h"
+
+#include "ShaderCompiler.h"
+#include "FileUtils.h"
+#include "Hash.h"
+
+#include <d3dcompiler.h>
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+#ifdef _DEBUG
+	const wchar_t* DXC_OPTIONS[] = { L"-Zi", L"-Qembed_debug", L"-Od" };
+	const UINT FXC_FLAGS = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_ALL_RESOURCES_BOUND;
+#else
+	const wchar_t* DXC_OPTIONS[] = { L"-O3" };
+	const UINT FXC_FLAGS = D3DCOMPILE_OPTIMIZATION_LEVEL3 | D3DCOMPILE_ALL_RESOURCES_BOUND;
+#endif
+
+	inline std::wstring widen(const std::string& string)
+	{
+		return std::wstring(string.begin(), string.end()); // (entry points, profiles and defines are ascii)
+	}
+}
+
+ShaderCompiler::ShaderCompiler()
+{
+	library = LoadLibraryW(L"dxcompiler.dll");
+	if (library) createInstance = reinterpret_cast<DxcCreateInstanceProc>(GetProcAddress(library, "DxcCreateInstance"));
+
+	// Versions of both compilers and the options into the id: a new compiler or other options don't get the old blobs
+	UINT32 version[3] = { D3D_COMPILER_VERSION, 0, 0 };
+
+	ComPtr<IDxcCompiler3> compiler;
+	ComPtr<IDxcVersionInfo> versionInfo;
+	if (createInstance and SUCCEEDED(createInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler))) and SUCCEEDED(compiler.As(&versionInfo)))
+		versionInfo->GetVersion(&version[1], &version[2]);
+	else
+		createInstance = nullptr;
+
+	id = hashBytes(version, sizeof(version));
+	for (const wchar_t* option : DXC_OPTIONS) id = hashBytes(option, wcslen(option) * sizeof(wchar_t), id);
+	id = hashBytes(&FXC_FLAGS, sizeof(FXC_FLAGS), id);
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	if (library) FreeLibrary(library);
+}
+
+bool ShaderCompiler::compile(const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) const
+{
+	int shaderModel = getShaderModel(desc.profile);
+	if (shaderModel >= 6) return compileDXC(desc, source, blob, errors);
+	if (shaderModel > 0) return compileFXC(desc, source, blob, errors);
+
+	errors = "unknown profile " + desc.profile;
+	return false;
+}
+
+int ShaderCompiler::getShaderModel(const std::string& profile)
+{
+	size_t separator = profile.find('_');
+	bool valid = separator != std::string::npos and separator + 1 < profile.size() and isdigit(uint8_t(profile[separator + 1]));
+
+	return valid ? profile[separator + 1] - '0' : 0;
+}
+
+std::string ShaderCompiler::getProfile(const std::filesystem::path& file)
+{
+	std::string stem = file.stem().string();
+	if (file.extension() != ".hlsl" or stem.size() < 2) return std::string();
+
+	std::string stage = stem.substr(stem.size() - 2);
+	std::transform(stage.begin(), stage.end(), stage.begin(), [](char c) { return char(tolower(c)); });
+
+	bool known = stage == "vs" or stage == "ps" or stage == "cs" or stage == "gs" or stage == "hs" or stage == "ds";
+	return known ? stage + "_6_0" : std::string();
+}
+
+bool ShaderCompiler::readPrebuilt(const std::filesystem::path& file, std::vector<uint8_t>& blob)
+{
+	std::filesystem::path name = file.filename().replace_extension(".cso");
+
+	wchar_t executable[MAX_PATH] = {};
+	GetModuleFileNameW(nullptr, executable, MAX_PATH);
+
+	for (const std::filesystem::path& path : { name, std::filesystem::path(executable).parent_path() / name })
+		if (FileUtils::readFile(path, blob) and not blob.empty()) return true;
+
+	return false;
+}
+
+bool ShaderCompiler::compileDXC(const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) const
+{
+	if (not createInstance)
+	{
+		errors = "no DXC (dxcompiler.dll) for " + desc.profile;
+		return false;
+	}
+
+	ComPtr<IDxcUtils> utils;
+	ComPtr<IDxcCompiler3> compiler;
+	ComPtr<IDxcIncludeHandler> includeHandler;
+
+	bool ok = SUCCEEDED(createInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils))) and SUCCEEDED(createInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler))) and
+			  SUCCEEDED(utils->CreateDefaultIncludeHandler(&includeHandler));
+	if (not ok) return false;
+
+	// Source name first (includes are relative to it), then as dxc.exe takes them
+	std::vector<std::wstring> arguments = { desc.path.wstring(), L"-E", widen(desc.entry), L"-T", widen(desc.profile) };
+	if (desc.source.empty() and desc.path.has_parent_path()) arguments.insert(arguments.end(), { L"-I", desc.path.parent_path().wstring() });
+	for (const ShaderCache::Define& define : desc.defines) arguments.insert(arguments.end(), { L"-D", widen(define.value.empty() ? define.name : define.name + "=" + define.value) });
+	arguments.insert(arguments.end(), std::begin(DXC_OPTIONS), std::end(DXC_OPTIONS));
+
+	std::vector<LPCWSTR> argumentPointers;
+	for (const std::wstring& argument : arguments) argumentPointers.push_back(argument.c_str());
+
+	DxcBuffer buffer = { source.data(), source.size(), DXC_CP_UTF8 };
+	ComPtr<IDxcResult> result;
+	ok = SUCCEEDED(compiler->Compile(&buffer, argumentPointers.data(), UINT32(argumentPointers.size()), includeHandler.Get(), IID_PPV_ARGS(&result)));
+
+	ComPtr<IDxcBlobUtf8> messages;
+	if (ok and SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&messages), nullptr)) and messages and messages->GetStringLength() > 0)
+		errors.assign(messages->GetStringPointer(), messages->GetStringLength());
+
+	HRESULT status = E_FAIL;
+	ComPtr<IDxcBlob> object;
+	ok = ok and SUCCEEDED(result->GetStatus(&status)) and SUCCEEDED(status) and SUCCEEDED(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object), nullptr)) and
+		 object and object->GetBufferSize() > 0;
+
+	if (ok)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(object->GetBufferPointer());
+		blob.assign(bytes, bytes + object->GetBufferSize());
+	}
+
+	return ok;
+}
+
+bool ShaderCompiler::compileFXC(const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) const
+{
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderCache::Define& define : desc.defines) macros.push_back({ define.name.c_str(), define.value.c_str() });
+	macros.push_back({ nullptr, nullptr });
+
+	std::string name = desc.path.string();
+
+	ComPtr<ID3DBlob> code, messages;
+	bool ok = SUCCEEDED(D3DCompile(source.data(), source.size(), name.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, desc.entry.c_str(),
+								   desc.profile.c_str(), FXC_FLAGS, 0, &code, &messages));
+
+	if (messages) errors.assign(reinterpret_cast<const char*>(messages->GetBufferPointer()), messages->GetBufferSize());
+
+	if (ok)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(code->GetBufferPointer());
+		blob.assign(bytes, bytes + code->GetBufferSize());
+	}
+
+	return ok;
+}
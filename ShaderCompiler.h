@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+#include <dxcapi.h>
+
+// HLSL compilers for the shader cache: shader model 6 profiles go to DXC (dxcompiler.dll, loaded if it's there: the SDK
+// ships it, windows doesn't), the older ones to D3DCompile. Options follow the build of the .cso files (debug info and no
+// optimizations in debug builds). Thread safe (a DXC compiler per compile, they aren't).
+class ShaderCompiler
+{
+public:
+
+	ShaderCompiler();
+	~ShaderCompiler();
+
+	inline bool hasDXC() const { return createInstance != nullptr; };
+	inline uint64_t getId() const { return id; }; // (compiler versions and options: part of the cache keys)
+
+	bool compile(const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) const;
+
+	static int getShaderModel(const std::string& profile); // major version (vs_6_0 -> 6), 0 if it isn't a profile
+	static std::string getProfile(const std::filesystem::path& file); // as the build gives them (Exercise4VS.hlsl -> vs_6_0), empty for includes
+	static bool readPrebuilt(const std::filesystem::path& file, std::vector<uint8_t>& blob); // the .cso the build made of it (here or next to the executable)
+
+private:
+
+	HMODULE library = nullptr;
+	DxcCreateInstanceProc createInstance = nullptr;
+	uint64_t id = 0;
+
+	bool compileDXC(const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) const;
+	bool compileFXC(const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) const;
+};
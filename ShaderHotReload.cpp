@@ -0,0 +1,216 @@
+#include "Globals.h"
+
+#include "ShaderHotReload.h"
+
+#include <algorithm>
+#include <cctype>
+
+ShaderHotReload::ShaderHotReload(JobSystem* jobSystem, Recompile recompile, Rebuild rebuild, Swap swap) : jobSystem(jobSystem), recompile(std::move(recompile)),
+																										   rebuild(std::move(rebuild)), swap(std::move(swap))
+{
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+	if (reloadJob) jobSystem->wait(reloadJob); // (it calls the callbacks: their owners go after this)
+}
+
+void ShaderHotReload::setShaderFiles(ShaderId shader, const std::vector<std::filesystem::path>& files)
+{
+	if (shader == 0) return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::string>& keys = shaderFiles[shader];
+
+	for (const std::string& key : keys)
+	{
+		auto it = fileShaders.find(key);
+		if (it != fileShaders.end() and it->second.erase(shader) > 0 and it->second.empty()) fileShaders.erase(it);
+	}
+
+	keys.clear();
+	for (const std::filesystem::path& file : files)
+	{
+		keys.push_back(getKey(file));
+		fileShaders[keys.back()].insert(shader);
+	}
+}
+
+void ShaderHotReload::setPipelineShaders(PipelineId pipeline, const std::vector<ShaderId>& shaders)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<ShaderId>& ids = pipelineShaders[pipeline];
+
+	for (ShaderId shader : ids)
+	{
+		auto it = shaderPipelines.find(shader);
+		if (it != shaderPipelines.end() and it->second.erase(pipeline) > 0 and it->second.empty()) shaderPipelines.erase(it);
+	}
+
+	ids.clear();
+	for (ShaderId shader : shaders)
+	{
+		if (shader == 0) continue;
+
+		ids.push_back(shader);
+		shaderPipelines[shader].insert(pipeline);
+	}
+}
+
+std::vector<ShaderHotReload::ShaderId> ShaderHotReload::findShaders(const std::vector<std::filesystem::path>& files) const
+{
+	std::unordered_set<ShaderId> found;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (const std::filesystem::path& file : files)
+		{
+			auto it = fileShaders.find(getKey(file));
+			if (it != fileShaders.end()) found.insert(it->second.begin(), it->second.end());
+		}
+	}
+
+	std::vector<ShaderId> shaders(found.begin(), found.end());
+	std::sort(shaders.begin(), shaders.end());
+	return shaders;
+}
+
+std::vector<ShaderHotReload::PipelineId> ShaderHotReload::findPipelines(const std::vector<ShaderId>& shaders) const
+{
+	std::unordered_set<PipelineId> found;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (ShaderId shader : shaders)
+		{
+			auto it = shaderPipelines.find(shader);
+			if (it != shaderPipelines.end()) found.insert(it->second.begin(), it->second.end());
+		}
+	}
+
+	std::vector<PipelineId> pipelines(found.begin(), found.end());
+	std::sort(pipelines.begin(), pipelines.end());
+	return pipelines;
+}
+
+void ShaderHotReload::update(const std::vector<std::filesystem::path>& changedFiles)
+{
+	if (reload and jobSystem->isDone(reloadJob)) finish();
+
+	for (const std::filesystem::path& file : changedFiles)
+	{
+		if (changed.empty()) firstChange = Clock::now();
+		changed.insert(getKey(file));
+	}
+
+	if (not reload and not changed.empty()) start();
+}
+
+void ShaderHotReload::wait()
+{
+	if (reload) finish();
+}
+
+bool ShaderHotReload::isReloading() const
+{
+	return reload != nullptr;
+}
+
+ShaderHotReload::Stats ShaderHotReload::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void ShaderHotReload::start()
+{
+	std::vector<std::filesystem::path> files(changed.begin(), changed.end());
+	changed.clear();
+
+	auto next = std::make_shared<Reload>();
+	next->start = firstChange;
+	next->shaders = findShaders(files);
+	if (next->shaders.empty()) return; // (files no shader reads)
+
+	std::vector<PipelineId> pipelines = findPipelines(next->shaders);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (PipelineId pipeline : pipelines) next->pipelines.emplace_back(pipeline, pipelineShaders[pipeline]);
+	}
+
+	reload = next;
+	if (not jobSystem) finish(); // (right away)
+	else reloadJob = jobSystem->schedule([this, next]() { run(*next); });
+}
+
+void ShaderHotReload::run(Reload& reload) const
+{
+	std::unordered_map<ShaderId, CompileResult> results;
+
+	for (ShaderId shader : reload.shaders)
+	{
+		std::vector<std::filesystem::path> files;
+		CompileResult result = recompile(shader, files);
+
+		results[shader] = result;
+		if (result == COMPILE_FAILED) ++reload.failed;
+		else ++reload.compiled;
+
+		if (not files.empty()) reload.files.emplace_back(shader, std::move(files));
+	}
+
+	// Only the pipelines using a shader that changed, and none that failed (half the change on screen helps nobody)
+	for (const auto& pipeline : reload.pipelines)
+	{
+		bool changed = false, failed = false;
+
+		for (ShaderId shader : pipeline.second)
+		{
+			auto it = results.find(shader);
+			if (it == results.end()) continue;
+
+			changed = changed or it->second == COMPILE_CHANGED;
+			failed = failed or it->second == COMPILE_FAILED;
+		}
+
+		if (failed or (changed and not rebuild(pipeline.first))) ++reload.skipped;
+		else if (changed) reload.rebuilt.push_back(pipeline.first);
+	}
+}
+
+void ShaderHotReload::finish()
+{
+	if (not jobSystem) run(*reload);
+	else jobSystem->wait(reloadJob); // (done already when update() finishes it)
+
+	std::shared_ptr<Reload> done = std::move(reload);
+	reloadJob = nullptr;
+
+	for (const auto& files : done->files) setShaderFiles(files.first, files.second);
+
+	// All of them in the same frame: no frame draws with some pipelines of the change and not others
+	for (PipelineId pipeline : done->rebuilt) swap(pipeline);
+
+	double ms = std::chrono::duration<double, std::milli>(Clock::now() - done->start).count();
+	LOG("Shaders reloaded: %u compiled, %u failed, %zu pipelines swapped, %u kept (%.0f ms)", done->compiled, done->failed, done->rebuilt.size(), done->skipped, ms);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	++stats.reloads;
+	stats.compiled += done->compiled;
+	stats.failed += done->failed;
+	stats.rebuilt += uint32_t(done->rebuilt.size());
+	stats.skipped += done->skipped;
+	stats.lastReloadMs = ms;
+}
+
+std::string ShaderHotReload::getKey(const std::filesystem::path& path)
+{
+	std::error_code error;
+	std::string key = std::filesystem::absolute(path, error).lexically_normal().string();
+
+#ifdef _WIN32
+	std::transform(key.begin(), key.end(), key.begin(), [](char c) { return char(tolower((unsigned char)c)); }); // (case insensitive file names)
+#endif
+
+	return key;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Shaders and pipelines rebuilt when the files they come from change (no GPU objects or files read here, the callbacks
+// do that). It keeps the graph file -> shaders (the source and what it includes) -> pipelines, and update() gets the
+// changed files, once a frame: a job recompiles the shaders reading them, then rebuilds only the pipelines with a shader
+// that really changed (none failed: those keep the old one), and a later update() swaps all of them in the same frame.
+// Changes arriving meanwhile wait for the next reload. update() from one thread, the graph from any.
+class ShaderHotReload
+{
+public:
+
+	typedef uint32_t ShaderId;	 // (0 = none)
+	typedef uint32_t PipelineId;
+
+	enum CompileResult
+	{
+		COMPILE_FAILED,	   // (the shader keeps its last blob)
+		COMPILE_UNCHANGED, // same blob (e.g. a comment changed)
+		COMPILE_CHANGED
+	};
+
+	// Called on a job: files gets the ones the shader reads now (its includes may have changed), Rebuild keeps the new
+	// pipeline aside until Swap (on the update() thread) puts it in place
+	typedef std::function<CompileResult(ShaderId shader, std::vector<std::filesystem::path>& files)> Recompile;
+	typedef std::function<bool(PipelineId pipeline)> Rebuild;
+	typedef std::function<void(PipelineId pipeline)> Swap;
+
+	struct Stats
+	{
+		uint32_t reloads = 0;
+		uint32_t compiled = 0; // shaders
+		uint32_t failed = 0;
+		uint32_t rebuilt = 0;  // pipelines
+		uint32_t skipped = 0;  // (a shader failed: kept the old one)
+		double lastReloadMs = 0.0; // file change seen -> swapped
+	};
+
+	ShaderHotReload(JobSystem* jobSystem, Recompile recompile, Rebuild rebuild, Swap swap); // null job system: reloaded in update()
+	~ShaderHotReload(); // waits for the reload running (its results are dropped)
+
+	ShaderHotReload(const ShaderHotReload&) = delete;
+	ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+	void setShaderFiles(ShaderId shader, const std::vector<std::filesystem::path>& files);
+	void setPipelineShaders(PipelineId pipeline, const std::vector<ShaderId>& shaders);
+
+	std::vector<ShaderId> findShaders(const std::vector<std::filesystem::path>& files) const;
+	std::vector<PipelineId> findPipelines(const std::vector<ShaderId>& shaders) const;
+
+	void update(const std::vector<std::filesystem::path>& changedFiles); // (the frame boundary)
+	void wait();														 // for the reload running, swapped here
+
+	bool isReloading() const;
+	Stats getStats() const;
+
+private:
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Reload
+	{
+		std::vector<ShaderId> shaders;
+		std::vector<std::pair<PipelineId, std::vector<ShaderId>>> pipelines; // (with all their shaders)
+		Clock::time_point start;
+
+		// (written by the job)
+		std::vector<std::pair<ShaderId, std::vector<std::filesystem::path>>> files;
+		std::vector<PipelineId> rebuilt;
+		uint32_t compiled = 0;
+		uint32_t failed = 0;
+		uint32_t skipped = 0;
+	};
+
+	JobSystem* jobSystem;
+	Recompile recompile;
+	Rebuild rebuild;
+	Swap swap;
+
+	mutable std::mutex mutex; // (the graph)
+	std::unordered_map<std::string, std::unordered_set<ShaderId>> fileShaders;
+	std::unordered_map<ShaderId, std::vector<std::string>> shaderFiles;
+	std::unordered_map<ShaderId, std::unordered_set<PipelineId>> shaderPipelines;
+	std::unordered_map<PipelineId, std::vector<ShaderId>> pipelineShaders;
+
+	std::unordered_set<std::string> changed; // (waiting for the reload running)
+	Clock::time_point firstChange;
+	std::shared_ptr<Reload> reload;
+	JobSystem::JobHandle reloadJob;
+	Stats stats;
+
+	void start();
+	void run(Reload& reload) const;
+	void finish();
+
+	static std::string getKey(const std::filesystem::path& path); // (absolute and normalized, as the watcher reports them)
+};
@@ -0,0 +1,9 @@
+// The back buffer is UNORM (no conversion on write) while colour textures are sRGB (linear when sampled), so the colour
+// is encoded back by hand before it's written
+
+float3 linearToSrgb(float3 colour)
+{
+    float3 low = colour * 12.92;
+    float3 high = 1.055 * pow(max(colour, 0.0031308), 1.0 / 2.4) - 0.055;
+    return colour <= 0.0031308 ? low : high; // (per component)
+}
@@ -1,7 +1,10 @@
+#include "ColorSpace.hlsli"
+
 Texture2D colourTex : register(t0); // our texture
 SamplerState colourSampler : register(s0);
 
 float4 main(float2 texCoords : TEXCOORD) : SV_TARGET
 {
-    return colourTex.Sample(colourSampler, texCoords); // sets the pixel colour from the texture sampled
+    float4 colour = colourTex.Sample(colourSampler, texCoords); // sets the pixel colour from the texture sampled
+    return float4(linearToSrgb(colour.rgb), colour.a);
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+// Layouts shared with IndirectDrawBuilder (keep them in sync)
+
+struct IndirectObject
+{
+    row_major float4x4 world; // (stored as Matrix, row vectors)
+    float3 center;            // world AABB
+    uint textureIndex;        // base color texture in the shader descriptor heap
+    float3 extent;
+    uint padding;
+};
+
+struct IndirectCommand
+{
+    uint2 vertexBufferLocation;
+    uint vertexBufferSize;
+    uint vertexBufferStride;
+    uint2 indexBufferLocation;
+    uint indexBufferSize;
+    uint indexBufferFormat;
+    uint objectIndex;
+    uint indexCountPerInstance;
+    uint instanceCount;
+    uint startIndexLocation;
+    int baseVertexLocation;
+    uint startInstanceLocation;
+};
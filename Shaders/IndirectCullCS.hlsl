@@ -0,0 +1,40 @@
+#include "IndirectCommon.hlsli"
+
+cbuffer CullConstants : register(b0)
+{
+    float4 planes[6]; // camera relative frustum planes (inside when dot(plane.xyz, p) + plane.w >= 0)
+    float3 origin;
+    uint objectCount;
+};
+
+StructuredBuffer<IndirectObject> objects : register(t0);
+StructuredBuffer<IndirectCommand> commands : register(t1); // (command i draws object i)
+
+RWStructuredBuffer<IndirectCommand> visibleCommands : register(u0);
+RWByteAddressBuffer visibleCount : register(u1); // (zeroed before the dispatch, ExecuteIndirect's count)
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint index = id.x;
+    if (index >= objectCount) return;
+
+    IndirectObject object = objects[index];
+    float3 center = object.center - origin;
+
+    bool inside = true;
+    [unroll]
+    for (uint i = 0; i < 6; ++i)
+    {
+        float radius = dot(abs(planes[i].xyz), object.extent); // (AABB projected on the plane normal)
+        float distance = dot(planes[i].xyz, center) + planes[i].w;
+        inside = inside && distance >= -radius;
+    }
+
+    if (inside)
+    {
+        uint slot;
+        visibleCount.InterlockedAdd(0, 1, slot);
+        visibleCommands[slot] = commands[index];
+    }
+}
@@ -0,0 +1,10 @@
+#include "ColorSpace.hlsli"
+
+Texture2D textures[] : register(t0, space1); // the whole shader descriptor heap (indexed by the object's texture)
+SamplerState colourSampler : register(s0);
+
+float4 main(float2 texCoord : TEXCOORD, nointerpolation uint textureIndex : TEXTURE) : SV_TARGET
+{
+    float4 colour = textures[textureIndex].Sample(colourSampler, texCoord);
+    return float4(linearToSrgb(colour.rgb), colour.a);
+}
\ No newline at end of file
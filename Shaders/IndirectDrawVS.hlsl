@@ -0,0 +1,32 @@
+#include "IndirectCommon.hlsli"
+
+cbuffer DrawConstants : register(b0)
+{
+    uint objectIndex; // (set by each indirect command)
+};
+
+cbuffer ViewConstants : register(b1)
+{
+    float4x4 viewProjection;
+};
+
+StructuredBuffer<IndirectObject> objects : register(t0);
+
+struct VertexOutput
+{
+    float2 texCoord : TEXCOORD;
+    nointerpolation uint textureIndex : TEXTURE;
+    float4 position : SV_POSITION;
+};
+
+VertexOutput main(float3 position : POSITION, float2 texCoord : TEXCOORD)
+{
+    IndirectObject object = objects[objectIndex];
+
+    VertexOutput output;
+    output.texCoord = texCoord;
+    output.textureIndex = object.textureIndex;
+    output.position = mul(mul(float4(position, 1.0), object.world), viewProjection);
+
+    return output;
+}
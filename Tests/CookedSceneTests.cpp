@@ -0,0 +1,276 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "CookedScene.h"
+#include "FileUtils.h"
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#include "tiny_gltf.h"
+
+#include <cstring>
+#include <random>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace CookedScene;
+
+namespace
+{
+	struct Vertex
+	{
+		float position[3];
+		float normal[3];
+		float uv[2];
+	};
+
+	std::filesystem::path getTestDirectory()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "EngineTests";
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		return directory;
+	}
+
+	// Grid of quads, the way a large terrain or building comes out of the exporter
+	void makeGrid(uint32_t side, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		vertices.resize(size_t(side) * side);
+		for (uint32_t y = 0; y < side; ++y)
+			for (uint32_t x = 0; x < side; ++x)
+				vertices[y * side + x] = { { float(x), float((x * 7 + y * 13) % 17) * 0.1f, float(y) }, { 0.0f, 1.0f, 0.0f }, { float(x) / side, float(y) / side } };
+
+		indices.clear();
+		for (uint32_t y = 0; y + 1 < side; ++y)
+			for (uint32_t x = 0; x + 1 < side; ++x)
+			{
+				uint32_t corner = y * side + x;
+				indices.insert(indices.end(), { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 });
+			}
+	}
+
+	// The same mesh as a .gltf + .bin, for tinygltf
+	bool writeGltf(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::vector<uint8_t> buffer(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+		memcpy(buffer.data(), vertices.data(), vertices.size() * sizeof(Vertex));
+		memcpy(buffer.data() + vertices.size() * sizeof(Vertex), indices.data(), indices.size() * sizeof(uint32_t));
+
+		std::filesystem::path bin = path;
+		bin.replace_extension(".bin");
+		if (not FileUtils::writeFile(bin, buffer)) return false;
+
+		const Vertex& last = vertices.back();
+		size_t vertexBytes = vertices.size() * sizeof(Vertex);
+
+		char json[2048];
+		int length = snprintf(json, sizeof(json),
+							  R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],"nodes":[{"mesh":0}],)"
+							  R"("meshes":[{"primitives":[{"attributes":{"POSITION":0,"NORMAL":1,"TEXCOORD_0":2},"indices":3}]}],)"
+							  R"("buffers":[{"uri":"%s","byteLength":%zu}],)"
+							  R"("bufferViews":[{"buffer":0,"byteLength":%zu,"byteStride":%zu},{"buffer":0,"byteOffset":%zu,"byteLength":%zu}],)"
+							  R"("accessors":[{"bufferView":0,"componentType":5126,"count":%zu,"type":"VEC3","min":[0,0,0],"max":[%f,%f,%f]},)"
+							  R"({"bufferView":0,"byteOffset":12,"componentType":5126,"count":%zu,"type":"VEC3"},)"
+							  R"({"bufferView":0,"byteOffset":24,"componentType":5126,"count":%zu,"type":"VEC2"},)"
+							  R"({"bufferView":1,"componentType":5125,"count":%zu,"type":"SCALAR"}]})",
+							  bin.filename().string().c_str(), buffer.size(), vertexBytes, sizeof(Vertex), vertexBytes, indices.size() * sizeof(uint32_t),
+							  vertices.size(), last.position[0], 1.6f, last.position[2], vertices.size(), vertices.size(), indices.size());
+
+		return FileUtils::writeFile(path, std::vector<uint8_t>(json, json + length));
+	}
+
+	// Evicts the file from the page cache, so the next load reads the disk (there's no user mode equivalent on windows:
+	// there the cold numbers are warm ones)
+	void dropFromCache(const std::filesystem::path& path)
+	{
+#ifndef _WIN32
+		int descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) return;
+
+		fdatasync(descriptor);
+		posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+		close(descriptor);
+#else
+		(void)path;
+#endif
+	}
+}
+
+TEST(CookedScene_RoundTrip)
+{
+	std::mt19937 random(3);
+	std::vector<Vertex> vertices(20000);
+	for (Vertex& vertex : vertices)
+		for (float& value : vertex.position) value = float(random() % 1000) * 0.1f;
+
+	std::vector<uint32_t> indices(60000);
+	for (uint32_t& index : indices) index = uint32_t(random() % vertices.size());
+
+	const float baseColor[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+	float world[16] = {};
+	world[0] = world[5] = world[10] = world[15] = 1.0f;
+	world[12] = 42.0f;
+	const char image[] = "not really a png";
+
+	Writer writer(sizeof(Vertex));
+	writer.addMesh(vertices.data(), uint32_t(vertices.size()), indices.data(), uint32_t(indices.size()), 0);
+	writer.addMaterial(baseColor, 0);
+	writer.addInstance(0, world);
+	writer.addImage(image, sizeof(image));
+
+	std::filesystem::path path = getTestDirectory() / "RoundTrip.cooked";
+	CHECK(writer.write(path));
+
+	Reader reader;
+	CHECK(reader.open(path));
+	if (not reader.isOpen()) return;
+
+	CHECK(reader.getVertexStride() == sizeof(Vertex));
+	CHECK(reader.getMeshCount() == 1 and reader.getMaterialCount() == 1 and reader.getInstanceCount() == 1 and reader.getImageCount() == 1);
+
+	const MeshInfo& mesh = reader.getMesh(0);
+	CHECK(mesh.vertexCount == vertices.size() and mesh.indexCount == indices.size() and mesh.material == 0);
+	CHECK(mesh.vertexOffset % BLOB_ALIGNMENT == 0 and mesh.indexOffset % BLOB_ALIGNMENT == 0);
+	CHECK(memcmp(reader.at(mesh.vertexOffset), vertices.data(), vertices.size() * sizeof(Vertex)) == 0);
+	CHECK(memcmp(reader.at(mesh.indexOffset), indices.data(), indices.size() * sizeof(uint32_t)) == 0);
+	CHECK(mesh.boundsMin[0] >= 0.0f and mesh.boundsMax[0] <= 99.9f and mesh.boundsMin[0] < mesh.boundsMax[0]);
+
+	CHECK(memcmp(reader.getMaterial(0).baseColor, baseColor, sizeof(baseColor)) == 0 and reader.getMaterial(0).image == 0);
+	CHECK(reader.getInstance(0).mesh == 0 and memcmp(reader.getInstance(0).world, world, sizeof(world)) == 0);
+	CHECK(reader.getImage(0).size == sizeof(image) and memcmp(reader.at(reader.getImage(0).offset), image, sizeof(image)) == 0);
+
+	// The meshlets, in order, give back the index buffer
+	const Meshlet* meshlets = static_cast<const Meshlet*>(reader.at(mesh.meshletOffset));
+	const uint32_t* meshletVertices = static_cast<const uint32_t*>(reader.at(mesh.meshletVertexOffset));
+	const uint32_t* meshletTriangles = static_cast<const uint32_t*>(reader.at(mesh.meshletTriangleOffset));
+
+	size_t next = 0, mismatches = 0;
+	for (uint32_t i = 0; i < mesh.meshletCount; ++i)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		CHECK(meshlet.vertexCount <= MAX_MESHLET_VERTICES and meshlet.triangleCount <= MAX_MESHLET_TRIANGLES);
+
+		for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+		{
+			uint32_t packed = meshletTriangles[meshlet.triangleOffset + triangle];
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				uint32_t local = (packed >> (8 * corner)) & 0xFF;
+				if (next >= indices.size() or meshletVertices[meshlet.vertexOffset + local] != indices[next]) ++mismatches;
+				++next;
+			}
+		}
+	}
+
+	CHECK(next == indices.size() and mismatches == 0);
+}
+
+TEST(CookedScene_Invalid)
+{
+	float world[16] = {};
+	uint32_t indices[3] = { 0, 1, 2 };
+	Vertex vertices[3] = {};
+
+	Writer writer(sizeof(Vertex));
+	writer.addMesh(vertices, 3, indices, 3, -1);
+	writer.addInstance(0, world);
+
+	std::vector<uint8_t> file;
+	writer.write(file);
+
+	Reader reader;
+	CHECK(reader.open(std::vector<uint8_t>(file)));
+
+	std::vector<uint8_t> version = file;
+	version[4] = VERSION + 1;
+	CHECK(not reader.open(std::move(version)));
+
+	std::vector<uint8_t> truncated = file;
+	truncated.resize(truncated.size() - BLOB_ALIGNMENT);
+	CHECK(not reader.open(std::move(truncated)));
+
+	std::vector<uint8_t> offset = file;
+	reinterpret_cast<Section*>(offset.data() + sizeof(FileHeader))->offset = offset.size(); // (section past the end)
+	CHECK(not reader.open(std::move(offset)));
+
+	CHECK(not reader.open(getTestDirectory() / "Missing.cooked"));
+	CHECK(not reader.isOpen());
+}
+
+// Time to have the vertices and indices of a 1M vertex mesh in memory, ready to copy to the upload ring: the cooked file
+// mapped (and every page touched) against tinygltf parsing the .gltf + .bin, with the files out of the page cache and in it
+BENCH(CookedScene_Load)
+{
+	const uint32_t SIDE = 1024;
+	const int RUNS = 5;
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	makeGrid(SIDE, vertices, indices);
+
+	std::filesystem::path directory = getTestDirectory();
+	std::filesystem::path cooked = directory / "Grid.cooked", gltf = directory / "Grid.gltf", bin = directory / "Grid.bin";
+
+	Writer writer(sizeof(Vertex));
+	writer.addMesh(vertices.data(), uint32_t(vertices.size()), indices.data(), uint32_t(indices.size()), -1);
+	if (not writer.write(cooked) or not writeGltf(gltf, vertices, indices)) {
+		printf("  couldn't write the files to %s\n", directory.string().c_str());
+		return;
+	}
+
+	std::vector<uint8_t> upload(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+
+	auto loadCooked = [&]() {
+		Reader reader;
+		if (not reader.open(cooked)) return false;
+
+		const MeshInfo& mesh = reader.getMesh(0);
+		memcpy(upload.data(), reader.at(mesh.vertexOffset), size_t(mesh.vertexCount) * sizeof(Vertex));
+		memcpy(upload.data() + size_t(mesh.vertexCount) * sizeof(Vertex), reader.at(mesh.indexOffset), size_t(mesh.indexCount) * sizeof(uint32_t));
+		return true;
+	};
+
+	auto loadGltf = [&]() {
+		tinygltf::Model model;
+		tinygltf::TinyGLTF loader;
+		std::string error, warning;
+		if (not loader.LoadASCIIFromFile(&model, &error, &warning, gltf.string())) return false;
+
+		memcpy(upload.data(), model.buffers[0].data.data(), std::min(upload.size(), model.buffers[0].data.size()));
+		return true;
+	};
+
+	auto time = [&](auto load, bool cold) {
+		double best = 1e30;
+		for (int run = 0; run < RUNS; ++run)
+		{
+			if (cold) {
+				dropFromCache(cooked);
+				dropFromCache(gltf);
+				dropFromCache(bin);
+			}
+
+			Test::Clock::time_point start = Test::Clock::now();
+			if (not load()) return -1.0;
+			best = std::min(best, Test::elapsedMs(start));
+		}
+		return best;
+	};
+
+	double cookedCold = time(loadCooked, true), gltfCold = time(loadGltf, true);
+	double cookedWarm = time(loadCooked, false), gltfWarm = time(loadGltf, false);
+	Test::keep(upload[upload.size() / 2]);
+
+	printf("  %zu vertices, %zu indices (cooked %.1f MB, glTF %.1f MB), best of %d\n", vertices.size(), indices.size(),
+		   std::filesystem::file_size(cooked) / 1048576.0, (std::filesystem::file_size(gltf) + std::filesystem::file_size(bin)) / 1048576.0, RUNS);
+	printf("  cold cache: cooked %.2f ms, tinygltf %.2f ms (x%.1f)\n", cookedCold, gltfCold, gltfCold / cookedCold);
+	printf("  warm cache: cooked %.2f ms, tinygltf %.2f ms (x%.1f)\n", cookedWarm, gltfWarm, gltfWarm / cookedWarm);
+
+	std::error_code error;
+	for (const std::filesystem::path& path : { cooked, gltf, bin }) std::filesystem::remove(path, error);
+}
@@ -0,0 +1,1001 @@
+#define DEBUG_DRAW_IMPLEMENTATION
+#define DEBUG_DRAW_MAX_LINES (16 * 1024 * 1024) // (10k spheres drawn as lines)
+#define DEBUG_DRAW_OVERFLOWED(message) ((void)0)   // (counted, see DebugDraw_Counters)
+
+#include "Globals.h"
+#include "DebugDrawBatcher.h"
+#include "DebugDrawContexts.h"
+
+#include "Test.h"
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace
+{
+	// Keeps what dd hands to the renderer (or just counts it)
+	class Capture : public dd::RenderInterface
+	{
+	public:
+
+		Capture(bool shapeInstancing = false) : shapeInstancing(shapeInstancing) {}
+
+		bool keep = true;
+		size_t lineCount = 0, pointCount = 0, shapeInstances = 0; // (vertices)
+		size_t depthShapeInstances[2] = {}; // (per depth mode)
+
+		std::vector<float> lines; // (x, y, z per vertex)
+		std::vector<dd::ShapeInstance> shapes[dd::ShapeCount];
+		std::vector<dd::DrawVertex> lineVertices[2], pointVertices[2]; // (per depth mode)
+
+		bool supportsShapeInstancing() override { return shapeInstancing; }
+
+		void drawLineList(const dd::DrawVertex* vertices, int count, bool depthEnabled) override
+		{
+			lineCount += count;
+			if (not keep) return;
+
+			for (int i = 0; i < count; ++i) lines.insert(lines.end(), { vertices[i].line.x, vertices[i].line.y, vertices[i].line.z });
+			lineVertices[depthEnabled].insert(lineVertices[depthEnabled].end(), vertices, vertices + count);
+		}
+
+		void drawPointList(const dd::DrawVertex* points, int count, bool depthEnabled) override
+		{
+			pointCount += count;
+			if (keep) pointVertices[depthEnabled].insert(pointVertices[depthEnabled].end(), points, points + count);
+		}
+
+		void drawShapeList(dd::ShapeType shape, const dd::ShapeInstance* instances, int count, bool depthEnabled) override
+		{
+			shapeInstances += count;
+			depthShapeInstances[depthEnabled] += count;
+			if (keep) shapes[shape].insert(shapes[shape].end(), instances, instances + count);
+		}
+
+	private:
+
+		bool shapeInstancing;
+	};
+
+	// The instances as lines, the way the vertex shader places the unit meshes
+	std::vector<float> expandShapes(const Capture& capture)
+	{
+		std::vector<float> lines;
+		for (int shape = 0; shape < dd::ShapeCount; ++shape)
+		{
+			std::vector<float> mesh(dd::getShapeMesh(dd::ShapeType(shape), nullptr) * 3);
+			dd::getShapeMesh(dd::ShapeType(shape), mesh.data());
+
+			for (const dd::ShapeInstance& instance : capture.shapes[shape])
+				for (size_t vertex = 0; vertex < mesh.size(); vertex += 3)
+					for (int axis = 0; axis < 3; ++axis)
+						lines.push_back(instance.origin[axis] + mesh[vertex] * instance.axisX[axis] + mesh[vertex + 1] * instance.axisY[axis] +
+										mesh[vertex + 2] * instance.axisZ[axis]);
+		}
+		return lines;
+	}
+
+	// Segments in a canonical order (ends sorted, then segments), for shapes whose edges come in another order
+	void sortSegments(std::vector<float>& lines)
+	{
+		std::vector<std::array<float, 6>> segments;
+		for (size_t i = 0; i + 6 <= lines.size(); i += 6)
+		{
+			std::array<float, 6> segment;
+			for (int k = 0; k < 6; ++k) segment[k] = std::round(lines[i + k] * 1000.0f) / 1000.0f;
+			if (std::lexicographical_compare(segment.begin() + 3, segment.end(), segment.begin(), segment.begin() + 3))
+				std::swap_ranges(segment.begin(), segment.begin() + 3, segment.begin() + 3);
+			segments.push_back(segment);
+		}
+
+		std::sort(segments.begin(), segments.end());
+		lines.clear();
+		for (const std::array<float, 6>& segment : segments) lines.insert(lines.end(), segment.begin(), segment.end());
+	}
+
+	// Perspective (row vectors, as ours) looking down +Z from the origin
+	void getViewProjection(float matrix[16])
+	{
+		const float focal = 1.0f / std::tan(0.5f), zNear = 0.1f, zFar = 100.0f;
+
+		memset(matrix, 0, 16 * sizeof(float));
+		matrix[0] = matrix[5] = focal;
+		matrix[10] = zFar / (zFar - zNear);
+		matrix[11] = 1.0f;
+		matrix[14] = -zNear * zFar / (zFar - zNear);
+	}
+
+	// Planes a point is out of, as dd culls: both [-w, w] and [0, w] depth ranges
+	int getOutcode(const float p[3], const float m[16])
+	{
+		float x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+		float y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+		float z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+		float w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+
+		return (x < -w) | ((x > w) << 1) | ((y < -w) << 2) | ((y > w) << 3) | ((z < -w) << 4) | ((z > w) << 5);
+	}
+
+	struct Primitive
+	{
+		float from[3], to[3], color[3];
+		int duration;
+		bool depthEnabled, point;
+	};
+
+	// Short lines all over (most of them out of the frustum), some long ones across it, and a point every 8 lines
+	std::vector<Primitive> makePrimitives(int lines, uint32_t seed, bool durations)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f), color(0.0f, 1.0f);
+
+		std::vector<Primitive> primitives;
+		for (int i = 0; i < lines; ++i)
+		{
+			Primitive line;
+			float length = i % 16 == 0 ? 1.0f : 0.02f;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				line.from[axis] = position(random);
+				line.to[axis] = line.from[axis] + position(random) * length;
+				line.color[axis] = color(random);
+			}
+			line.duration = durations ? int(random() % 3) * 10 : 0;
+			line.depthEnabled = random() % 4 != 0;
+			line.point = false;
+			primitives.push_back(line);
+
+			if (i % 8 == 0) {
+				Primitive point = line;
+				point.depthEnabled = random() % 2 != 0;
+				point.point = true;
+				primitives.push_back(point);
+			}
+		}
+		return primitives;
+	}
+
+	void queue(dd::ContextHandle context, const std::vector<Primitive>& primitives)
+	{
+		for (const Primitive& primitive : primitives)
+		{
+			if (primitive.point) dd::point(context, primitive.from, primitive.color, 3.0f, primitive.duration, primitive.depthEnabled);
+			else dd::line(context, primitive.from, primitive.to, primitive.color, primitive.duration, primitive.depthEnabled);
+		}
+	}
+
+	// What dd should draw on a flush after one at 'previousTime' (the primitives still alive, minus the culled ones), per depth mode
+	void getExpected(const std::vector<Primitive>& primitives, int64_t previousTime, const float* cullMatrix, std::vector<float> lines[2],
+					 std::vector<float> points[2])
+	{
+		for (const Primitive& primitive : primitives)
+		{
+			if (primitive.duration <= previousTime) continue; // (expired on the previous flush: queued at time 0)
+
+			int out = cullMatrix ? getOutcode(primitive.from, cullMatrix) : 0;
+			if (primitive.point) {
+				if (out != 0) continue;
+				points[primitive.depthEnabled].insert(points[primitive.depthEnabled].end(), { primitive.from[0], primitive.from[1], primitive.from[2],
+																						   primitive.color[0], primitive.color[1], primitive.color[2], 3.0f });
+			}
+			else {
+				if (cullMatrix and (out & getOutcode(primitive.to, cullMatrix)) != 0) continue;
+				for (const float* end : { primitive.from, primitive.to })
+					lines[primitive.depthEnabled].insert(lines[primitive.depthEnabled].end(), { end[0], end[1], end[2], primitive.color[0], primitive.color[1],
+																							 primitive.color[2] });
+			}
+		}
+	}
+
+	std::vector<float> getFloats(const std::vector<dd::DrawVertex>& vertices, int components)
+	{
+		std::vector<float> floats;
+		for (const dd::DrawVertex& vertex : vertices) floats.insert(floats.end(), &vertex.point.x, &vertex.point.x + components);
+		return floats;
+	}
+
+	// The queues as they were before they grew by chunks (fixed arrays of structures, in the context), for the benchmark
+	struct FixedQueues
+	{
+		static const int MAX_LINES = 32768, MAX_POINTS = 8192;
+
+		struct Line
+		{
+			int64_t expiryDateMillis;
+			float from[3], to[3], color[3];
+			bool depthEnabled;
+		};
+
+		struct Point
+		{
+			int64_t expiryDateMillis;
+			float position[3], color[3];
+			float size;
+			bool depthEnabled;
+		};
+
+		std::vector<Line> lines;
+		std::vector<Point> points;
+		int lineCount = 0, pointCount = 0, dropped = 0;
+
+		FixedQueues(int maxLines = MAX_LINES, int maxPoints = MAX_POINTS) : lines(maxLines), points(maxPoints) {}
+
+		void line(const float from[3], const float to[3], const float color[3], int duration, bool depthEnabled)
+		{
+			if (lineCount == int(lines.size())) {
+				++dropped;
+				return;
+			}
+
+			Line& line = lines[lineCount++];
+			line.expiryDateMillis = duration;
+			memcpy(line.from, from, sizeof(line.from));
+			memcpy(line.to, to, sizeof(line.to));
+			memcpy(line.color, color, sizeof(line.color));
+			line.depthEnabled = depthEnabled;
+		}
+
+		void point(const float position[3], const float color[3], float size, int duration, bool depthEnabled)
+		{
+			if (pointCount == int(points.size())) {
+				++dropped;
+				return;
+			}
+
+			Point& point = points[pointCount++];
+			point.expiryDateMillis = duration;
+			memcpy(point.position, position, sizeof(point.position));
+			memcpy(point.color, color, sizeof(point.color));
+			point.size = size;
+			point.depthEnabled = depthEnabled;
+		}
+	};
+
+	// The renderer of DebugDrawPass without GPU (its contexts are DebugDrawContexts): all of them share the glyph texture of
+	// the first one
+	class Producers : public Capture
+	{
+	public:
+
+		int glyphTextures = 0;
+		size_t glyphCount = 0;
+
+		Producers() : Capture(true) {}
+
+		dd::GlyphTextureHandle findGlyphTexture(int, int, uint32_t) override { return glyphTextures > 0 ? GLYPH_TEXTURE : nullptr; }
+
+		dd::GlyphTextureHandle createGlyphTexture(int, int, const void*) override
+		{
+			++glyphTextures;
+			return GLYPH_TEXTURE;
+		}
+
+		void drawGlyphList(const dd::DrawVertex*, int count, dd::GlyphTextureHandle) override { glyphCount += count; }
+
+	private:
+
+		dd::GlyphTextureHandle const GLYPH_TEXTURE = reinterpret_cast<dd::GlyphTextureHandle>(uintptr_t(1));
+	};
+
+	// Text as triangles or as glyph instances. The glyph texture is created by the first context and found by the others
+	class TextCapture : public dd::RenderInterface
+	{
+	public:
+
+		TextCapture(bool glyphInstancing, int* created = nullptr) : glyphInstancing(glyphInstancing), created(created) {}
+
+		bool keep = true;
+		int found = 0;
+		std::vector<dd::DrawVertex> triangles;
+		std::vector<dd::GlyphInstance> instances;
+		size_t glyphs = 0, bytes = 0; // (handed to the renderer)
+
+		bool supportsGlyphInstancing() override { return glyphInstancing; }
+
+		dd::GlyphTextureHandle findGlyphTexture(int, int, uint32_t) override
+		{
+			if (created == nullptr or *created == 0) return nullptr;
+
+			++found;
+			return GLYPH_TEXTURE;
+		}
+
+		dd::GlyphTextureHandle createGlyphTexture(int, int, const void*) override
+		{
+			if (created) ++*created;
+			return GLYPH_TEXTURE;
+		}
+
+		void drawGlyphList(const dd::DrawVertex* vertices, int count, dd::GlyphTextureHandle) override
+		{
+			glyphs += count / 6;
+			bytes += count * sizeof(dd::DrawVertex);
+			if (keep) triangles.insert(triangles.end(), vertices, vertices + count);
+		}
+
+		void drawGlyphInstances(const dd::GlyphInstance* glyphInstances, int count, dd::GlyphTextureHandle) override
+		{
+			glyphs += count;
+			bytes += count * sizeof(dd::GlyphInstance);
+			if (keep) instances.insert(instances.end(), glyphInstances, glyphInstances + count);
+		}
+
+	private:
+
+		bool glyphInstancing;
+		int* created;
+
+		dd::GlyphTextureHandle const GLYPH_TEXTURE = reinterpret_cast<dd::GlyphTextureHandle>(uintptr_t(1));
+	};
+
+	// 5000 projected labels (an entity name and its health, as the editor shows them) and a screen text with tabs and new lines
+	void queueLabels(dd::ContextHandle context, const std::vector<std::string>& labels, int frame)
+	{
+		float viewProjection[16] = {}; // (x / z, y / z)
+		viewProjection[0] = viewProjection[10] = viewProjection[11] = 1.0f;
+		viewProjection[5] = 1.7f;
+		viewProjection[14] = -0.1f;
+
+		for (int i = 0; i < int(labels.size()); ++i)
+		{
+			const float position[3] = { float(i % 100) - 50.0f, float((i / 100) % 50) - 25.0f, 10.0f + (frame % 7) }, color[3] = { (i % 3) / 2.0f, 1.0f, 0.25f };
+			dd::projectedText(context, labels[i].c_str(), position, color, viewProjection, 0, 0, 1920, 1080, 0.6f + (i % 5) * 0.1f);
+		}
+
+		const float position[3] = { 10.5f, 20.25f, 0.0f }, color[3] = { 1.0f, 1.0f, 1.0f };
+		dd::screenText(context, "Tabs\tand\nnew lines", position, color, 1.3f);
+	}
+
+	std::vector<std::string> makeLabels()
+	{
+		std::vector<std::string> labels;
+		for (int i = 0; i < 5000; ++i) labels.push_back("Entity " + std::to_string(i) + " hp " + std::to_string(i * 7 % 100));
+		return labels;
+	}
+
+	std::vector<float> draw(bool instanced, int shape, bool depthEnabled, Capture& capture)
+	{
+		dd::ContextHandle context = nullptr;
+		dd::initialize(&context, &capture);
+
+		const float center[3] = { 1.0f, 2.0f, 3.0f }, color[3] = { 1.0f, 0.0f, 0.0f }, normal[3] = { 0.3f, 0.5f, 0.81f }, direction[3] = { 0.2f, -1.5f, 0.7f };
+		const float mins[3] = { -1.0f, 0.0f, 2.0f }, maxs[3] = { 3.0f, 1.0f, 5.0f };
+
+		switch (shape)
+		{
+		case 0: dd::sphere(context, center, color, 2.5f, 0, depthEnabled); break;
+		case 1: dd::box(context, center, color, 1.0f, 2.0f, 3.0f, 0, depthEnabled); break;
+		case 2: dd::cone(context, center, direction, color, 0.8f, 0.0f, 0, depthEnabled); break;
+		case 3: dd::circle(context, center, normal, color, 1.7f, DEBUG_DRAW_CIRCLE_SHAPE_STEPS, 0, depthEnabled); break;
+		case 4: dd::aabb(context, mins, maxs, color, 0, depthEnabled); break;
+		}
+
+		dd::flush(context);
+		dd::shutdown(context);
+
+		return instanced ? expandShapes(capture) : capture.lines;
+	}
+
+	// Counts what reaches the command list
+	struct CommandListCounter : ID3D12GraphicsCommandList
+	{
+		uint32_t stateChanges = 0, draws = 0, vertices = 0; // (vertices times instances)
+
+		void SetPipelineState(ID3D12PipelineState*) override { ++stateChanges; }
+		void SetGraphicsRootSignature(ID3D12RootSignature*) override { ++stateChanges; }
+		void RSSetViewports(UINT, const D3D12_VIEWPORT*) override { ++stateChanges; }
+		void RSSetScissorRects(UINT, const D3D12_RECT*) override { ++stateChanges; }
+		void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) override { ++stateChanges; }
+		void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY) override { ++stateChanges; }
+		void SetGraphicsRoot32BitConstants(UINT, UINT, const void*, UINT) override { ++stateChanges; }
+		void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) override { ++stateChanges; }
+		void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { ++stateChanges; }
+
+		void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT, UINT) override
+		{
+			++draws;
+			vertices += vertexCount * instanceCount;
+		}
+	};
+
+	// The batches are uploaded to memory
+	class MemoryBatcher : public DebugDrawBatcher
+	{
+	public:
+
+		std::vector<uint8_t> vertices, instances;
+
+	protected:
+
+		bool uploadBatches(D3D12_VERTEX_BUFFER_VIEW& vertexView, D3D12_VERTEX_BUFFER_VIEW& instanceView, D3D12_VERTEX_BUFFER_VIEW& glyphView) override
+		{
+			vertices.resize(vertexView.SizeInBytes);
+			instances.resize(instanceView.SizeInBytes);
+			copyVertices(vertices.data());
+			copyInstances(instances.data());
+
+			vertexView.BufferLocation = 0x10000;
+			instanceView.BufferLocation = 0x20000;
+			return glyphView.SizeInBytes == 0; // (no text here)
+		}
+	};
+}
+
+// Every shape drawn as an instance of its unit mesh gives the lines the CPU expansion gives, in the same depth mode
+TEST(DebugDraw_ShapeInstances)
+{
+	const char* names[] = { "sphere", "box", "cone", "circle", "aabb" };
+
+	for (int i = 0; i < 10; ++i)
+	{
+		int shape = i % 5;
+		bool depthEnabled = i < 5;
+
+		Capture expanded(false), instanced(true);
+		std::vector<float> lines = draw(false, shape, depthEnabled, expanded), instances = draw(true, shape, depthEnabled, instanced);
+
+		CHECK(expanded.shapeInstances == 0 and instanced.lineCount == 0 and instanced.shapeInstances == 1);
+		CHECK(instanced.depthShapeInstances[depthEnabled] == 1 and expanded.lineVertices[depthEnabled].size() == expanded.lineCount);
+
+		if (shape == 1 or shape == 4) { // (the corners come in another order: same edges)
+			sortSegments(lines);
+			sortSegments(instances);
+		}
+
+		float error = 0.0f;
+		if (lines.size() == instances.size())
+			for (size_t k = 0; k < lines.size(); ++k) error = std::max(error, std::fabs(lines[k] - instances[k]));
+
+		if (lines.empty() or lines.size() != instances.size() or error > 1e-4f)
+			printf("  %s: %zu line vertices, %zu from the instance (error %g)\n", names[shape], lines.size() / 3, instances.size() / 3, error);
+
+		CHECK(not lines.empty() and lines.size() == instances.size() and error <= 1e-4f);
+	}
+}
+
+// Lines and points, culled or not, go out in order in the vertices of their depth mode, and the ones that haven't expired
+// stay for the next flushes (several chunks of the queues, so the 4-wide kernels and their tails run)
+TEST(DebugDraw_LinesAndPoints)
+{
+	float viewProjection[16];
+	getViewProjection(viewProjection);
+
+	const std::vector<Primitive> primitives = makePrimitives(3 * DEBUG_DRAW_QUEUE_CHUNK_SIZE + 3, 7, true);
+	size_t lineCount = std::count_if(primitives.begin(), primitives.end(), [](const Primitive& primitive) { return not primitive.point; });
+
+	for (bool cull : { false, true })
+	{
+		Capture capture;
+		dd::ContextHandle context = nullptr;
+		dd::initialize(&context, &capture);
+		if (cull) dd::setCullMatrix(context, viewProjection);
+
+		queue(context, primitives);
+
+		int64_t previousTime = -1;
+		for (int64_t time : { 1, 15, 25 })
+		{
+			for (int depth = 0; depth < 2; ++depth)
+			{
+				capture.lineVertices[depth].clear();
+				capture.pointVertices[depth].clear();
+			}
+			dd::flush(context, time);
+
+			std::vector<float> lines[2], points[2];
+			getExpected(primitives, previousTime, cull ? viewProjection : nullptr, lines, points);
+			previousTime = time;
+
+			for (int depth = 0; depth < 2; ++depth)
+			{
+				CHECK(getFloats(capture.lineVertices[depth], 6) == lines[depth]);
+				CHECK(getFloats(capture.pointVertices[depth], 7) == points[depth]);
+			}
+
+			const dd::FrameCounters& counters = dd::getFrameCounters(context);
+			size_t drawn = (capture.lineVertices[0].size() + capture.lineVertices[1].size()) / 2;
+			CHECK(counters.lines.queued == counters.lines.culled + drawn);
+			if (time == 1) CHECK(counters.lines.submitted == lineCount and counters.lines.queued == lineCount);
+			if (cull and time == 1) CHECK(counters.lines.culled > 0 and counters.points.culled > 0);
+			if (not cull) CHECK(counters.lines.culled == 0 and counters.points.culled == 0);
+		}
+
+		CHECK(not dd::hasPendingDraws(context));
+		dd::shutdown(context);
+	}
+}
+
+// Submitted, dropped (over DEBUG_DRAW_MAX_*) and culled primitives of a flush, and the queue memory: it grows with what is
+// queued and goes back after DEBUG_DRAW_QUEUE_IDLE_FLUSHES flushes that didn't need it
+TEST(DebugDraw_Counters)
+{
+	Capture capture;
+	capture.keep = false;
+
+	dd::ContextHandle context = nullptr;
+	dd::initialize(&context, &capture);
+
+	float cullMatrix[16] = {}; // (visible: z > 0.1, |x| and |y| < z)
+	cullMatrix[0] = cullMatrix[5] = cullMatrix[10] = cullMatrix[11] = 1.0f;
+	cullMatrix[14] = -0.1f;
+	dd::setCullMatrix(context, cullMatrix);
+
+	const float color[3] = { 1.0f, 1.0f, 1.0f }, outside[3] = { 100.0f, 0.0f, 1.0f };
+	for (int i = 0; i < 6000; ++i)
+	{
+		const float position[3] = { 0.0f, 0.0f, i % 2 ? 5.0f : -5.0f };
+		dd::line(context, position, position, color);
+	}
+	for (int i = 0; i < DEBUG_DRAW_MAX_POINTS + 10; ++i) dd::point(context, outside, color);
+
+	dd::flush(context, 1);
+
+	const dd::FrameCounters& counters = dd::getFrameCounters(context);
+	CHECK(counters.lines.submitted == 6000 and counters.lines.dropped == 0 and counters.lines.queued == 6000 and counters.lines.culled == 3000);
+	CHECK(capture.lineCount == 2 * 3000);
+	CHECK(counters.points.submitted == DEBUG_DRAW_MAX_POINTS and counters.points.dropped == 10 and counters.points.culled == DEBUG_DRAW_MAX_POINTS);
+	CHECK(capture.pointCount == 0);
+
+	// The first idle window still saw the peak, the second one gives the chunks back
+	size_t peak = counters.queueBytes;
+	int flushes = 1;
+	while (dd::getFrameCounters(context).queueBytes != 0 and flushes < 10 * DEBUG_DRAW_QUEUE_IDLE_FLUSHES)
+	{
+		dd::flush(context, 1);
+		++flushes;
+	}
+
+	CHECK(peak >= 6000 * 10 * sizeof(float) + DEBUG_DRAW_MAX_POINTS * 8 * sizeof(float));
+	CHECK(flushes == 2 * DEBUG_DRAW_QUEUE_IDLE_FLUSHES);
+	CHECK(dd::getFrameCounters(context).lines.submitted == 0);
+
+	// And they grow again
+	for (int i = 0; i < 3000; ++i) dd::line(context, outside, outside, color);
+	dd::flush(context, 1);
+	CHECK(dd::getFrameCounters(context).lines.submitted == 3000 and dd::getFrameCounters(context).queueBytes > 0);
+
+	dd::shutdown(context);
+}
+
+// 16 threads draw every frame into their own contexts while the main thread draws too, then the main thread flushes all the
+// contexts (as record()): every line, point, shape and string arrives whole, once. Twice, so the main thread drops the context
+// of the first pass
+TEST(DebugDraw_Producers)
+{
+	const int THREADS = 16, FRAMES = 100, LINES = 2000, POINTS = 300, SHAPES = 100;
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		Producers renderer;
+		DebugDrawContexts contexts(&renderer); // (the main thread gets a new context on the second pass)
+		contexts.getContext();
+
+		std::barrier start(THREADS + 1), done(THREADS + 1);
+		std::vector<std::thread> threads;
+
+		for (int thread = 0; thread < THREADS; ++thread)
+		{
+			threads.emplace_back([&start, &done, &contexts, thread]() {
+				for (int frame = 0; frame < FRAMES; ++frame)
+				{
+					start.arrive_and_wait();
+					dd::ContextHandle context = contexts.getContext();
+
+					for (int i = 0; i < LINES; ++i)
+					{
+						const float from[3] = { float(thread), float(frame), float(i) }, to[3] = { float(thread), float(frame), float(i) + 0.5f };
+						dd::line(context, from, to, from);
+					}
+					for (int i = 0; i < POINTS; ++i)
+					{
+						const float position[3] = { float(thread), float(frame), float(-i) };
+						dd::point(context, position, position, 2.0f);
+					}
+					for (int i = 0; i < SHAPES; ++i)
+					{
+						const float center[3] = { float(thread), float(i), 0.0f };
+						dd::sphere(context, center, center, 1.0f);
+					}
+					if (frame % 7 == 0) {
+						const float position[3] = { 10.0f, 10.0f, 0.0f };
+						dd::screenText(context, std::to_string(thread).c_str(), position, position);
+					}
+
+					done.arrive_and_wait();
+				}
+			});
+		}
+
+		int wrongLines = 0, wrongFrames = 0;
+		uint32_t contextCount = 0;
+		for (int frame = 0; frame < FRAMES; ++frame)
+		{
+			start.arrive_and_wait();
+			const float position[3] = { -1.0f, -1.0f, -1.0f };
+			dd::line(contexts.getContext(), position, position, position);
+			done.arrive_and_wait();
+
+			dd::FrameCounters total = {};
+			contextCount = contexts.flush(nullptr, total);
+
+			std::vector<int> threadLines(THREADS, 0);
+			const std::vector<dd::DrawVertex>& lines = renderer.lineVertices[1];
+			for (size_t vertex = 0; vertex + 1 < lines.size(); vertex += 2)
+			{
+				const dd::DrawVertex& from = lines[vertex];
+				if (from.line.x < 0.0f) continue; // (main thread)
+
+				if (from.line.y != float(frame) or lines[vertex + 1].line.z != from.line.z + 0.5f) ++wrongLines;
+				++threadLines[int(from.line.x)];
+			}
+
+			bool ok = std::all_of(threadLines.begin(), threadLines.end(), [](int count) { return count == LINES; });
+			ok = ok and renderer.pointVertices[1].size() == size_t(THREADS * POINTS);
+			ok = ok and renderer.shapes[dd::ShapeSphere].size() == size_t(THREADS * SHAPES);
+			ok = ok and total.lines.submitted == uint32_t(THREADS * LINES + 1) and total.shapes.submitted == uint32_t(THREADS * SHAPES);
+			ok = ok and total.strings.submitted == uint32_t(frame % 7 == 0 ? THREADS : 0);
+			if (not ok) ++wrongFrames;
+
+			renderer.lineVertices[1].clear();
+			renderer.pointVertices[1].clear();
+			renderer.shapes[dd::ShapeSphere].clear();
+		}
+
+		for (std::thread& thread : threads) thread.join();
+
+		CHECK(wrongLines == 0 and wrongFrames == 0);
+		CHECK(contextCount == THREADS + 1);
+		CHECK(renderer.glyphTextures == 1 and renderer.glyphCount > 0);
+	}
+}
+
+// A 16 byte instance per glyph gives back the 6 vertices of the triangles (the quad from the glyph size and the 8.8
+// scaling, the texture coordinates from the glyph rects), and only the first context creates the glyph texture
+TEST(DebugDraw_GlyphInstances)
+{
+	static_assert(sizeof(dd::GlyphInstance) == 16, "GlyphInstance should be 16 bytes");
+
+	const std::vector<std::string> labels = makeLabels();
+	int created = 0;
+
+	TextCapture instanced(true, &created), expanded(false, &created);
+	dd::ContextHandle instancedContext = nullptr, expandedContext = nullptr;
+	dd::initialize(&instancedContext, &instanced);
+	dd::initialize(&expandedContext, &expanded);
+
+	queueLabels(instancedContext, labels, 3);
+	queueLabels(expandedContext, labels, 3);
+	dd::flush(instancedContext);
+	dd::flush(expandedContext);
+
+	CHECK(created == 1 and instanced.found + expanded.found == 1);
+	CHECK(not instanced.instances.empty() and instanced.triangles.empty());
+	CHECK(expanded.triangles.size() == instanced.instances.size() * 6);
+
+	float rects[256 * 4], glyphSize[2];
+	CHECK(dd::getGlyphRects(nullptr, nullptr) <= 256);
+	dd::getGlyphRects(rects, glyphSize);
+
+	static const int corners[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } }; // (0, 1, 2, 2, 1, 3)
+	int mismatches = 0;
+	float maxError = 0.0f;
+
+	for (size_t glyph = 0; glyph < instanced.instances.size() and expanded.triangles.size() == instanced.instances.size() * 6; ++glyph)
+	{
+		const dd::GlyphInstance& instance = instanced.instances[glyph];
+		float scaling = instance.scaling / 256.0f;
+
+		for (int vertex = 0; vertex < 6; ++vertex)
+		{
+			const dd::DrawVertex& triangle = expanded.triangles[glyph * 6 + vertex];
+			float x = instance.x + corners[vertex][0] * glyphSize[0] * scaling, y = instance.y + corners[vertex][1] * glyphSize[1] * scaling;
+			float u = rects[instance.glyph * 4 + (corners[vertex][0] ? 2 : 0)], v = rects[instance.glyph * 4 + (corners[vertex][1] ? 3 : 1)];
+
+			float error = std::max(std::fabs(x - triangle.glyph.x), std::fabs(y - triangle.glyph.y));
+			maxError = std::max(maxError, error);
+
+			bool same = error < 0.2f and u == triangle.glyph.u and v == triangle.glyph.v and instance.color[3] == 255;
+			same = same and instance.color[0] == uint8_t(triangle.glyph.r * 255.0f + 0.5f) and instance.color[1] == uint8_t(triangle.glyph.g * 255.0f + 0.5f) and
+				   instance.color[2] == uint8_t(triangle.glyph.b * 255.0f + 0.5f);
+			if (not same) ++mismatches;
+		}
+	}
+
+	if (mismatches > 0) printf("  %d vertices differ (max position error %.3f pixels)\n", mismatches, maxError);
+	CHECK(mismatches == 0);
+
+	dd::shutdown(instancedContext);
+	dd::shutdown(expandedContext);
+}
+
+// More lines and points than a vertex buffer of dd (they come in DEBUG_DRAW_VERTEX_BUFFER_SIZE chunks) in both depth modes, and
+// shapes: a draw per pipeline (and shape), whatever the chunks, and the state cache drops what the previous draw set. Counted
+// the same without a command list (headless DebugDrawPass) as recorded with one; a pipeline still compiling drops its draw.
+TEST(DebugDraw_Batching)
+{
+	const int LINES = 3000, POINTS = 5000, SHAPES = 10; // (a depth mode)
+
+	static uint8_t objects[8]; // (only the addresses of the pipelines and the root signature are used)
+	typedef ID3D12PipelineState* PSO;
+
+	const DebugDrawBatcher::Pipelines ready = { PSO(objects), PSO(objects + 1), PSO(objects + 2), PSO(objects + 3), PSO(objects + 4), PSO(objects + 5), PSO(objects + 6) };
+	DebugDrawBatcher::Pipelines compiling = ready;
+	compiling.pointsNoDepth = nullptr;
+
+	DebugDrawBatcher::Bindings bindings;
+	bindings.signature = reinterpret_cast<ID3D12RootSignature*>(objects + 7);
+	bindings.shapeMeshes = { 0x30000, 1024, 3 * sizeof(float) };
+
+	const float mvp[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	const float color[3] = { 1.0f, 1.0f, 0.0f };
+
+	MemoryBatcher batcher;
+	dd::ContextHandle context = nullptr;
+	dd::initialize(&context, &batcher);
+
+	for (int run = 0; run < 3; ++run) // (counted, recorded, recorded with a pipeline compiling)
+	{
+		for (int i = 0; i < 2 * LINES; ++i)
+		{
+			const float from[3] = { float(i), 0.0f, 1.0f }, to[3] = { float(i), 1.0f, 1.0f };
+			dd::line(context, from, to, color, 0, i % 2 == 0);
+		}
+		for (int i = 0; i < 2 * POINTS; ++i)
+		{
+			const float position[3] = { float(i), 2.0f, 1.0f };
+			dd::point(context, position, color, 2.0f, 0, i % 2 == 0);
+		}
+		for (int i = 0; i < SHAPES; ++i)
+		{
+			const float center[3] = { float(i), 3.0f, 1.0f };
+			dd::sphere(context, center, color, 0.5f, 0, true);
+			dd::box(context, center, color, 1.0f, 1.0f, 1.0f, 0, false);
+		}
+
+		dd::flush(context);
+
+		CHECK(batcher.getBatch(DebugDrawBatcher::BATCH_LINES).size() == 2 * LINES and batcher.getBatch(DebugDrawBatcher::BATCH_LINES_NO_DEPTH).size() == 2 * LINES);
+		CHECK(batcher.getBatch(DebugDrawBatcher::BATCH_POINTS).size() == POINTS and batcher.getBatch(DebugDrawBatcher::BATCH_POINTS_NO_DEPTH).size() == POINTS);
+		CHECK(batcher.getShapeBatch(dd::ShapeSphere, true).size() == SHAPES and batcher.getShapeBatch(dd::ShapeBox, false).size() == SHAPES);
+
+		CommandListCounter commandList;
+		DebugDrawBatcher::FrameStats stats;
+		batcher.recordFrame(run == 0 ? nullptr : &commandList, run == 2 ? compiling : ready, bindings, mvp, 1280, 720, stats);
+
+		CHECK(stats.vertices == 4 * LINES + 2 * POINTS and stats.instances == 2 * SHAPES and stats.glyphs == 0);
+
+		// Viewport, scissor and vertices (3). Lines: pipeline, signature, topology and mvp, then only the pipeline (4 + 1).
+		// Shapes: both instance slots, a pipeline per depth mode, the vertices back (5). Points: pipeline and topology, then
+		// the pipeline (2 + 1), unless it is compiling. The signature, topology and mvp repeated by every draw are filtered.
+		bool dropped = run == 2;
+		CHECK(stats.draws == (dropped ? 5u : 6u));
+		CHECK(stats.stateChanges == (dropped ? 15u : 16u));
+		CHECK(stats.filteredStateChanges == (dropped ? 11u : 14u));
+
+		if (run > 0)
+		{
+			UINT shapeVertices = UINT(dd::getShapeMesh(dd::ShapeSphere, nullptr) + dd::getShapeMesh(dd::ShapeBox, nullptr)) * SHAPES;
+			CHECK(commandList.draws == stats.draws and commandList.stateChanges == stats.stateChanges);
+			CHECK(commandList.vertices == 4 * LINES + (dropped ? 1 : 2) * POINTS + shapeVertices);
+			CHECK(batcher.vertices.size() == stats.vertices * sizeof(dd::DrawVertex) and batcher.instances.size() == stats.instances * sizeof(dd::ShapeInstance));
+		}
+		else CHECK(commandList.draws == 0 and commandList.stateChanges == 0);
+
+		for (int batch = 0; batch < DebugDrawBatcher::MAX_BATCHES; ++batch) CHECK(batcher.getBatch(DebugDrawBatcher::Batch(batch)).empty());
+	}
+
+	dd::shutdown(context);
+}
+
+// 10k spheres and 10k boxes a frame: CPU cost of queueing and flushing them as lines against as instances
+BENCH(DebugDraw_Shapes)
+{
+	const int SHAPES = 10000, FRAMES = 5;
+
+	for (bool instanced : { false, true })
+	{
+		Capture capture(instanced);
+		capture.keep = false;
+
+		dd::ContextHandle context = nullptr;
+		dd::initialize(&context, &capture);
+
+		double bestQueue = 1e30, bestFlush = 1e30;
+		for (int frame = 0; frame < FRAMES; ++frame)
+		{
+			capture.lineCount = capture.shapeInstances = 0;
+
+			Test::Clock::time_point start = Test::Clock::now();
+			for (int i = 0; i < SHAPES; ++i)
+			{
+				const float center[3] = { float(i % 100), float(i / 100), 0.0f }, color[3] = { 0.0f, 1.0f, 0.0f };
+				dd::sphere(context, center, color, 0.4f);
+				dd::box(context, center, color, 0.5f, 0.5f, 0.5f);
+			}
+			double queue = Test::elapsedMs(start);
+
+			start = Test::Clock::now();
+			dd::flush(context);
+			double flush = Test::elapsedMs(start);
+
+			if (queue + flush < bestQueue + bestFlush) {
+				bestQueue = queue;
+				bestFlush = flush;
+			}
+		}
+
+		dd::shutdown(context);
+
+		printf("  %-9s queue %7.2f ms, flush %7.2f ms (%zu line vertices, %zu instances)\n", instanced ? "instances" : "lines", bestQueue, bestFlush,
+			   capture.lineCount, capture.shapeInstances);
+	}
+}
+
+// Flush of the lines and points queues (culling, depth partition and vertex packing) and expiry compaction, at 32k, 256k
+// and 1M lines (and a point every 8 lines)
+BENCH(DebugDraw_Lines)
+{
+	float viewProjection[16];
+	getViewProjection(viewProjection);
+
+	printf("  %s kernels\n", DEBUG_DRAW_USE_SSE ? "SSE" : "scalar");
+
+	for (int lines : { 32 * 1024, 256 * 1024, 1024 * 1024 })
+	{
+		const std::vector<Primitive> primitives = makePrimitives(lines, 3, false);
+
+		std::vector<Primitive> compacted = primitives; // (half of them live on)
+		for (size_t i = 0; i < compacted.size(); ++i) compacted[i].duration = (i * 7919) % 2 * 10;
+
+		Capture capture;
+		capture.keep = false;
+
+		dd::ContextHandle context = nullptr;
+		dd::initialize(&context, &capture);
+
+		double best[2][2] = { { 1e30, 1e30 }, { 1e30, 1e30 } }; // [culled][queue, flush]
+		double bestCompaction = 1e30;
+		size_t vertices[2] = {};
+
+		for (int run = 0; run < 5; ++run)
+		{
+			for (int cull = 0; cull < 2; ++cull)
+			{
+				if (cull) dd::setCullMatrix(context, viewProjection);
+				else dd::disableCulling(context);
+
+				Test::Clock::time_point start = Test::Clock::now();
+				queue(context, primitives);
+				double queued = Test::elapsedMs(start);
+
+				capture.lineCount = capture.pointCount = 0;
+				start = Test::Clock::now();
+				dd::flush(context);
+				double flushed = Test::elapsedMs(start);
+
+				if (queued + flushed < best[cull][0] + best[cull][1]) {
+					best[cull][0] = queued;
+					best[cull][1] = flushed;
+				}
+				vertices[cull] = capture.lineCount + capture.pointCount;
+			}
+
+			// Compaction only (nothing drawn)
+			queue(context, compacted);
+			Test::Clock::time_point start = Test::Clock::now();
+			dd::flush(context, 1, dd::FlushText);
+			bestCompaction = std::min(bestCompaction, Test::elapsedMs(start));
+			dd::clear(context);
+		}
+
+		dd::shutdown(context);
+
+		printf("  %7d lines: queue %6.2f ms, flush %6.2f ms (%.2f ns a line), culled %6.2f ms (%zu of %zu vertices left), compaction %6.2f ms\n", lines,
+			   best[0][0], best[0][1], best[0][1] * 1e6 / lines, best[1][1], vertices[1], vertices[0], bestCompaction);
+	}
+}
+
+// Queueing lines (and a point every 8) in the chunked queues against the fixed arrays they replaced, and the memory each one
+// takes: the fixed arrays always had their maximum (and dropped what went over it), the chunks follow what is queued
+BENCH(DebugDraw_Queues)
+{
+	const int RUNS = 50;
+
+	Capture capture;
+	capture.keep = false;
+
+	for (int lines : { 1000, 32768, 1000000 })
+	{
+		dd::ContextHandle context = nullptr;
+		dd::initialize(&context, &capture);
+
+		double chunked = 1e30, fixed = 1e30;
+		for (int run = 0; run < RUNS; ++run)
+		{
+			Test::Clock::time_point start = Test::Clock::now();
+			for (int i = 0; i < lines; ++i)
+			{
+				const float from[3] = { float(i), 1.0f, 2.0f }, to[3] = { 3.0f, 4.0f, float(i) };
+				dd::line(context, from, to, from, 0, (i & 3) != 0);
+				if ((i & 7) == 0) dd::point(context, from, to, 2.0f, 0, true);
+			}
+			chunked = std::min(chunked, Test::elapsedMs(start));
+			dd::clear(context);
+
+			FixedQueues queues(std::max(lines, int(FixedQueues::MAX_LINES)), std::max(lines / 8 + 1, int(FixedQueues::MAX_POINTS))); // (as big as needed)
+			start = Test::Clock::now();
+			for (int i = 0; i < lines; ++i)
+			{
+				const float from[3] = { float(i), 1.0f, 2.0f }, to[3] = { 3.0f, 4.0f, float(i) };
+				queues.line(from, to, from, 0, (i & 3) != 0);
+				if ((i & 7) == 0) queues.point(from, to, 2.0f, 0, true);
+			}
+			fixed = std::min(fixed, Test::elapsedMs(start));
+			Test::keep(queues.lines[lines / 2].from[0]);
+		}
+
+		for (int i = 0; i < lines; ++i)
+		{
+			const float position[3] = { float(i), 1.0f, 2.0f };
+			dd::line(context, position, position, position);
+			if ((i & 7) == 0) dd::point(context, position, position);
+		}
+		dd::flush(context);
+		size_t bytes = dd::getFrameCounters(context).queueBytes;
+
+		for (uint32_t flush = 0; flush < 2 * DEBUG_DRAW_QUEUE_IDLE_FLUSHES; ++flush) dd::flush(context);
+		size_t idleBytes = dd::getFrameCounters(context).queueBytes;
+		dd::shutdown(context);
+
+		size_t fixedBytes = FixedQueues::MAX_LINES * sizeof(FixedQueues::Line) + FixedQueues::MAX_POINTS * sizeof(FixedQueues::Point);
+		printf("  %7d lines + %6d points: chunks %6.2f ms (%5.1f M/s), fixed arrays %6.2f ms (%5.1f M/s); %7.2f MB (%.2f MB idle), fixed %.2f MB%s\n",
+			   lines, lines / 8, chunked, (lines + lines / 8) / chunked / 1000.0, fixed, (lines + lines / 8) / fixed / 1000.0, bytes / 1048576.0,
+			   idleBytes / 1048576.0, fixedBytes / 1048576.0, lines > FixedQueues::MAX_LINES ? " (over the old maximum)" : "");
+	}
+}
+
+// 5000 projected labels a frame: CPU time of queueing and flushing the text as triangles and as glyph instances, and what
+// goes to the renderer (the upload)
+BENCH(DebugDraw_Labels)
+{
+	const int FRAMES = 100;
+	const std::vector<std::string> labels = makeLabels();
+
+	for (bool instanced : { false, true })
+	{
+		TextCapture capture(instanced);
+		capture.keep = false;
+
+		dd::ContextHandle context = nullptr;
+		dd::initialize(&context, &capture);
+
+		double best = 1e30, total = 0.0;
+		size_t glyphs = 0, bytes = 0;
+
+		for (int frame = 0; frame < FRAMES; ++frame)
+		{
+			capture.glyphs = capture.bytes = 0;
+
+			Test::Clock::time_point start = Test::Clock::now();
+			queueLabels(context, labels, frame);
+			dd::flush(context);
+			double ms = Test::elapsedMs(start);
+
+			best = std::min(best, ms);
+			total += ms;
+			glyphs = capture.glyphs;
+			bytes = capture.bytes;
+		}
+
+		dd::shutdown(context);
+
+		printf("  %-9s %zu glyphs, %7.1f KB to the renderer, best %.3f ms, mean %.3f ms\n", instanced ? "instances" : "triangles", glyphs, bytes / 1024.0,
+			   best, total / FRAMES);
+	}
+}
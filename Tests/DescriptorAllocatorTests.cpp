@@ -0,0 +1,161 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+
+TEST(DescriptorAllocator_Reuse)
+{
+	DescriptorAllocator allocator(4);
+
+	CHECK(allocator.allocate() == 0);
+	CHECK(allocator.allocate() == 1);
+	CHECK(allocator.allocate() == 2);
+	CHECK(allocator.allocate() == 3);
+	CHECK(allocator.allocate() == DescriptorAllocator::INVALID_INDEX);
+	CHECK(allocator.getAllocatedCount() == 4);
+
+	// Last freed, first reused
+	allocator.free(1);
+	allocator.free(3);
+	CHECK(allocator.getAllocatedCount() == 2);
+	CHECK(allocator.allocate() == 3);
+	CHECK(allocator.allocate() == 1);
+	CHECK(allocator.allocate() == DescriptorAllocator::INVALID_INDEX);
+
+	allocator.free(7); // (out of range: ignored)
+	CHECK(allocator.getAllocatedCount() == 4);
+
+	allocator.reset(2);
+	CHECK(allocator.getAllocatedCount() == 0 and allocator.getCapacity() == 2);
+	CHECK(allocator.allocate() == 0);
+}
+
+TEST(DescriptorAllocator_DeferredFree)
+{
+	DescriptorAllocator allocator(3);
+
+	uint32_t a = allocator.allocate(), b = allocator.allocate(), c = allocator.allocate();
+
+	allocator.deferFree(a, 1);
+	allocator.deferFree(b, 2);
+	CHECK(allocator.getPendingFreeCount() == 2);
+	CHECK(allocator.getAllocatedCount() == 3);
+	CHECK(allocator.allocate() == DescriptorAllocator::INVALID_INDEX); // (still in flight)
+
+	allocator.release(1);
+	CHECK(allocator.getPendingFreeCount() == 1);
+	CHECK(allocator.allocate() == a);
+
+	allocator.deferFree(c, 3);
+	allocator.release(5);
+	CHECK(allocator.getPendingFreeCount() == 0 and allocator.getAllocatedCount() == 1);
+}
+
+// Millions of allocate/free pairs, part of them deferred against a simulated fence: an index is never handed out twice
+// while it's live (or waiting for its fence), and the heap never needs more slots than were live at once
+TEST(DescriptorAllocator_Stress)
+{
+	const uint32_t CAPACITY = 4096;
+	const int PAIRS = 2000000;
+
+	DescriptorAllocator allocator(CAPACITY);
+	std::vector<uint8_t> live(CAPACITY, 0);
+	std::vector<uint32_t> handles;
+	std::deque<std::pair<uint64_t, uint32_t>> pending; // (fence value, index), as the allocator keeps them
+	std::mt19937 random(3);
+
+	uint64_t fence = 0;
+	int duplicates = 0, full = 0;
+	uint32_t highest = 0;
+
+	for (int i = 0; i < PAIRS; ++i)
+	{
+		uint32_t index = allocator.allocate();
+		if (index == DescriptorAllocator::INVALID_INDEX) ++full;
+		else {
+			if (live[index]) ++duplicates;
+			live[index] = 1;
+			handles.push_back(index);
+			highest = std::max(highest, index);
+		}
+
+		// Free a random live one, half of the time through the fence
+		if (not handles.empty() and (handles.size() > 1000 or random() % 2 == 0))
+		{
+			size_t pick = random() % handles.size();
+			uint32_t freed = handles[pick];
+			handles[pick] = handles.back();
+			handles.pop_back();
+
+			if (random() % 2) {
+				live[freed] = 0;
+				allocator.free(freed);
+			}
+			else {
+				allocator.deferFree(freed, fence + 1); // (live until the fence is reached)
+				pending.push_back({ fence + 1, freed });
+			}
+		}
+
+		if (i % 100 == 99)
+		{
+			++fence;
+			uint64_t completed = fence > FRAMES_IN_FLIGHT ? fence - FRAMES_IN_FLIGHT : 0;
+
+			allocator.release(completed);
+			while (not pending.empty() and pending.front().first <= completed)
+			{
+				live[pending.front().second] = 0;
+				pending.pop_front();
+			}
+
+			CHECK(allocator.getPendingFreeCount() == pending.size());
+		}
+	}
+
+	CHECK(duplicates == 0);
+	CHECK(full == 0);
+	CHECK(highest < 1200); // (~1000 live, plus the ones waiting for their fence)
+	CHECK(allocator.getAllocatedCount() == handles.size() + pending.size());
+}
+
+BENCH(DescriptorAllocator_Pairs)
+{
+	const int PAIRS = 50000000;
+
+	DescriptorAllocator allocator(SHADER_DESCRIPTORS);
+	std::vector<uint32_t> ring(1024, DescriptorAllocator::INVALID_INDEX);
+	uint64_t sum = 0;
+
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int i = 0; i < PAIRS; ++i)
+	{
+		uint32_t& slot = ring[i & 1023];
+		if (slot != DescriptorAllocator::INVALID_INDEX) allocator.free(slot);
+
+		slot = allocator.allocate();
+		sum += slot;
+	}
+	double immediate = Test::elapsedMs(start);
+
+	start = Test::Clock::now();
+	for (int i = 0; i < PAIRS; ++i)
+	{
+		uint32_t& slot = ring[i & 1023];
+		if (slot != DescriptorAllocator::INVALID_INDEX) allocator.deferFree(slot, uint64_t(i / 1024));
+
+		slot = allocator.allocate();
+		sum += slot;
+
+		if ((i & 1023) == 1023 and i / 1024 >= FRAMES_IN_FLIGHT) allocator.release(uint64_t(i / 1024 - FRAMES_IN_FLIGHT));
+	}
+	double deferred = Test::elapsedMs(start);
+
+	Test::keep(sum);
+	printf("  %d allocate/free pairs: %.1f ms (%.2f ns each), deferred frees: %.1f ms (%.2f ns each)\n", PAIRS, immediate, immediate * 1e6 / PAIRS,
+		   deferred, deferred * 1e6 / PAIRS);
+}
@@ -0,0 +1,123 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "FileWatcher.h"
+#include "FileUtils.h"
+
+#include <set>
+#include <thread>
+
+namespace
+{
+	std::filesystem::path getTestDirectory()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "EngineTests" / "FileWatcher";
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+		std::filesystem::create_directories(directory / "Sub", error);
+		return directory;
+	}
+
+	void writeText(const std::filesystem::path& path, const std::string& text)
+	{
+		FileUtils::writeFile(path, std::vector<uint8_t>(text.begin(), text.end()));
+	}
+
+	// Everything reported during ms, once a frame
+	std::set<std::filesystem::path> pollFor(FileWatcher& watcher, int ms)
+	{
+		std::set<std::filesystem::path> changed;
+		for (Test::Clock::time_point start = Test::Clock::now(); Test::elapsedMs(start) < ms;)
+		{
+			for (const std::filesystem::path& path : watcher.poll()) changed.insert(path);
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		return changed;
+	}
+
+#if defined(_WIN32) || defined(__linux__)
+	const bool NATIVE_WATCHER = true;
+#else
+	const bool NATIVE_WATCHER = false; // (polling behind the same interface)
+#endif
+
+	// A save in 3 writes is one change once settled; nested, new, removed and renamed over files are changes too
+	void checkChanges(FileWatcher::Mode mode)
+	{
+		std::filesystem::path directory = getTestDirectory();
+		writeText(directory / "A.hlsl", "a");
+		writeText(directory / "Sub" / "Include.hlsli", "b");
+
+		FileWatcher watcher(directory, mode, 50, 40);
+		CHECK(watcher.getDirectory() == directory.lexically_normal());
+		CHECK(watcher.isNative() == (mode == FileWatcher::MODE_NATIVE and NATIVE_WATCHER));
+		CHECK(watcher.poll().empty() and pollFor(watcher, 150).empty());
+
+		for (int i = 0; i < 3; ++i)
+		{
+			writeText(directory / "A.hlsl", std::string("a").append(i + 2, 'x'));
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		CHECK(pollFor(watcher, 300) == std::set<std::filesystem::path>{ directory / "A.hlsl" });
+		CHECK(pollFor(watcher, 150).empty());
+
+		writeText(directory / "Sub" / "Include.hlsli", "bb");
+		std::filesystem::create_directories(directory / "New");
+		writeText(directory / "New" / "X.hlsli", "x");
+		std::filesystem::remove(directory / "A.hlsl");
+		CHECK((pollFor(watcher, 400) == std::set<std::filesystem::path>{ directory / "A.hlsl", directory / "New" / "X.hlsli", directory / "Sub" / "Include.hlsli" }));
+
+		writeText(directory / "New" / "X.hlsli", "xy");
+		CHECK(pollFor(watcher, 300) == std::set<std::filesystem::path>{ directory / "New" / "X.hlsli" });
+
+		// (editors write a temporary file and rename it over the old one)
+		writeText(directory / "Sub" / "Include.hlsli.tmp", "ccc");
+		std::filesystem::rename(directory / "Sub" / "Include.hlsli.tmp", directory / "Sub" / "Include.hlsli");
+		CHECK(pollFor(watcher, 300).count(directory / "Sub" / "Include.hlsli") == 1);
+	}
+}
+
+TEST(FileWatcher_Polling)
+{
+	checkChanges(FileWatcher::MODE_POLLING);
+}
+
+// Native notifications where there are (windows and linux): the same changes, new directories watched as they appear
+TEST(FileWatcher_Native)
+{
+	checkChanges(FileWatcher::MODE_NATIVE);
+}
+
+// Time from a save to poll() reporting it, with the engine settings (polling every 500 ms, settled after 100 ms) and with
+// a fast poll, and what a poll costs over 1000 files
+BENCH(FileWatcher_Latency)
+{
+	std::filesystem::path directory = getTestDirectory();
+	for (int i = 0; i < 1000; ++i) writeText(directory / "Sub" / ("File" + std::to_string(i) + ".hlsli"), "x");
+
+	for (unsigned int interval : { 500u, 50u })
+	{
+		FileWatcher watcher(directory, FileWatcher::MODE_POLLING, interval, 100);
+
+		double sum = 0.0;
+		const int SAVES = 5;
+		for (int save = 0; save < SAVES; ++save)
+		{
+			writeText(directory / "Sub" / "File7.hlsli", std::string(save + 2, 'y'));
+			Test::Clock::time_point start = Test::Clock::now();
+			while (watcher.poll().empty()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			sum += Test::elapsedMs(start);
+		}
+
+		printf("  polling every %u ms: reported %.0f ms after a save\n", interval, sum / SAVES);
+	}
+
+	FileWatcher watcher(directory, FileWatcher::MODE_POLLING, 0, 100);
+	const int POLLS = 50;
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int i = 0; i < POLLS; ++i) Test::keep(watcher.poll().size());
+	printf("  a scan of 1000 files: %.2f ms\n", Test::elapsedMs(start) / POLLS);
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,145 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+TEST(FrameArena_Linear)
+{
+	FrameArena arena(4096);
+	arena.beginFrame(1, 0);
+
+	FrameArena::Allocation a = arena.allocate(100, 16);
+	FrameArena::Allocation b = arena.allocate(10, 256);
+	FrameArena::Allocation c = arena.allocate(1, 4);
+
+	CHECK(a.isValid() and a.page == 0 and a.offset == 0);
+	CHECK(b.page == 0 and b.offset == 256);
+	CHECK(c.page == 0 and c.offset == 268);
+	CHECK(arena.getFrameSize() == 269);
+	CHECK(arena.getPageCount() == 1);
+
+	// Bigger than the page: a page of its size
+	FrameArena::Allocation big = arena.allocate(10000, 16);
+	CHECK(big.page == 1 and big.offset == 0 and arena.getPageSize(1) >= 10000);
+}
+
+// A frame that doesn't fit in a page spills to a new one, twice the size: the next frames fit in one
+TEST(FrameArena_Growth)
+{
+	FrameArena arena(1024);
+
+	arena.beginFrame(1, 0);
+	for (int i = 0; i < 5; ++i) CHECK(arena.allocate(256, 16).isValid());
+	CHECK(arena.getPageCount() == 2 and arena.getPageSize(1) == 2048 and arena.getNewPageSize() == 2048);
+
+	arena.beginFrame(2, 0);
+	std::vector<size_t> pages;
+	for (int i = 0; i < 5; ++i) pages.push_back(arena.allocate(256, 16).page);
+	CHECK(std::all_of(pages.begin(), pages.end(), [&pages](size_t page) { return page == pages[0]; }));
+	CHECK(arena.getPageSize(pages[0]) == 2048);
+}
+
+// Pages come back once the fence value of the frames that used them is reached, not before
+TEST(FrameArena_Fence)
+{
+	FrameArena arena(1024);
+
+	arena.beginFrame(1, 0);
+	size_t first = arena.allocate(512, 16).page;
+
+	arena.beginFrame(2, 0);
+	size_t second = arena.allocate(512, 16).page;
+	CHECK(second != first and arena.getFreePageCount() == 0);
+
+	arena.beginFrame(3, 1);
+	CHECK(arena.getFreePageCount() == 1);
+	CHECK(arena.allocate(512, 16).page == first);
+
+	arena.beginFrame(4, 1); // (the GPU is behind: a new page)
+	size_t third = arena.allocate(512, 16).page;
+	CHECK(third != first and third != second and arena.getPageCount() == 3);
+}
+
+// Thousands of frames against a fence that lags 2 or 3 frames, with a spike of big frames in the middle: a page is never
+// handed out while a frame in flight uses it (released ones included), and after the spike the arena trims back to a few
+// pages of the base size
+TEST(FrameArena_SimulatedFence)
+{
+	const size_t PAGE_SIZE = 4096;
+
+	FrameArena arena(PAGE_SIZE);
+	std::map<size_t, uint64_t> lastFrame; // (page: last frame that wrote to it)
+	std::mt19937 random(1);
+
+	uint64_t completed = 0;
+	size_t released = 0, maxPages = 0, peakPageSize = 0;
+	int reused = 0, releasedInUse = 0, invalid = 0;
+
+	for (uint64_t frame = 1; frame <= 6000; ++frame)
+	{
+		uint64_t lag = 2 + (random() % 3 == 0);
+		if (frame > lag) completed = std::max(completed, frame - lag);
+
+		arena.beginFrame(frame, completed);
+
+		for (size_t page : arena.getReleasedPages())
+		{
+			auto used = lastFrame.find(page);
+			if (used != lastFrame.end() and used->second > completed) ++releasedInUse;
+			lastFrame.erase(page);
+			++released;
+		}
+
+		bool spike = frame >= 1000 and frame < 1100;
+		int count = random() % 20;
+
+		for (int i = 0; i < count; ++i)
+		{
+			size_t size = 16 + random() % (spike ? 8000 : 150);
+			FrameArena::Allocation allocation = arena.allocate(size, 16);
+
+			if (not allocation.isValid() or allocation.offset % 16 != 0 or allocation.offset + size > arena.getPageSize(allocation.page)) ++invalid;
+
+			auto used = lastFrame.find(allocation.page);
+			if (used != lastFrame.end() and used->second != frame and used->second > completed) ++reused;
+			lastFrame[allocation.page] = frame;
+		}
+
+		maxPages = std::max(maxPages, arena.getPageCount());
+		peakPageSize = std::max(peakPageSize, arena.getNewPageSize());
+	}
+
+	CHECK(invalid == 0 and reused == 0 and releasedInUse == 0);
+	CHECK(peakPageSize > PAGE_SIZE and released > 0);
+	CHECK(arena.getNewPageSize() == PAGE_SIZE);
+	CHECK(arena.getPageCount() <= MAX_FRAMES_IN_FLIGHT and arena.getPageCount() < maxPages);
+}
+
+// Small allocations (debug draw batches, constants) of a frame: the arena against the GPU that is 2 frames behind
+BENCH(FrameArena_Allocate)
+{
+	const int FRAMES = 10000, ALLOCATIONS = 1000;
+
+	FrameArena arena(256 * 1024);
+	std::mt19937 random(7);
+
+	std::vector<size_t> sizes(ALLOCATIONS);
+	for (size_t& size : sizes) size = 16 + random() % 240;
+
+	size_t sum = 0;
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int frame = 1; frame <= FRAMES; ++frame)
+	{
+		arena.beginFrame(frame, frame > FRAMES_IN_FLIGHT ? frame - FRAMES_IN_FLIGHT : 0);
+		for (size_t size : sizes) sum += arena.allocate(size, 16).offset;
+	}
+	double ms = Test::elapsedMs(start);
+
+	Test::keep(sum);
+	printf("  %d allocations: %.2f ns each, %zu pages of %zu KB\n", FRAMES * ALLOCATIONS, ms * 1e6 / (double(FRAMES) * ALLOCATIONS), arena.getPageCount(),
+		   arena.getNewPageSize() / 1024);
+}
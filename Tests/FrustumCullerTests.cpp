@@ -0,0 +1,203 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+	const float CAMERA[3] = { 1000.0f, 5.0f, -2000.0f }; // (far from the origin: the culling is camera relative)
+
+	// Right handed perspective looking down -Z (60 degrees, aspect 1, near 0.1, far 100), camera relative: no view translation
+	void getPlanes(FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT])
+	{
+		const float zNear = 0.1f, zFar = 100.0f, scale = 1.0f / std::tan(3.14159265f / 6.0f);
+		const float projection[16] = { scale, 0.0f, 0.0f, 0.0f, 0.0f, scale, 0.0f, 0.0f, 0.0f, 0.0f, zFar / (zNear - zFar), -1.0f, 0.0f, 0.0f, zNear * zFar / (zNear - zFar), 0.0f };
+
+		FrustumCuller::extractPlanes(projection, planes);
+	}
+
+	// Distance test in double: visible unless out of a plane by more than the radius
+	bool isSphereVisible(const FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT], float x, float y, float z, float radius)
+	{
+		for (int i = 0; i < FrustumCuller::PLANE_COUNT; ++i)
+		{
+			const FrustumCuller::Plane& plane = planes[i];
+			double distance = plane.a * double(x - CAMERA[0]) + plane.b * double(y - CAMERA[1]) + plane.c * double(z - CAMERA[2]) + plane.d;
+			if (distance < -radius) return false;
+		}
+		return true;
+	}
+
+	void makeBounds(size_t count, std::mt19937& random, FrustumCuller::Spheres& spheres, FrustumCuller::Boxes& boxes)
+	{
+		std::uniform_real_distribution<float> position(-120.0f, 120.0f), radius(0.0f, 5.0f);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			float x = position(random) + CAMERA[0], y = position(random) + CAMERA[1], z = position(random) * 0.5f - 50.0f + CAMERA[2], r = radius(random);
+			if (i % 5 == 0) { // (touching the near plane)
+				x = CAMERA[0];
+				y = CAMERA[1];
+				z = CAMERA[2] - 0.1f - r;
+			}
+
+			spheres.add(x, y, z, r);
+			const float boxMin[3] = { x - r, y - r, z - r }, boxMax[3] = { x + r, y + r, z + r };
+			boxes.add(boxMin, boxMax);
+		}
+	}
+}
+
+TEST(FrustumCuller_Planes)
+{
+	FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT];
+	getPlanes(planes);
+
+	auto inside = [&planes](float x, float y, float z) {
+		return std::all_of(planes, planes + FrustumCuller::PLANE_COUNT, [=](const FrustumCuller::Plane& plane) { return plane.a * x + plane.b * y + plane.c * z + plane.d >= 0.0f; });
+	};
+
+	CHECK(inside(0.0f, 0.0f, -10.0f) and inside(0.0f, 0.0f, -99.0f) and inside(5.0f, 0.0f, -10.0f));
+	CHECK(not inside(0.0f, 0.0f, 10.0f) and not inside(0.0f, 0.0f, -0.05f) and not inside(0.0f, 0.0f, -200.0f) and not inside(20.0f, 0.0f, -10.0f));
+
+	for (const FrustumCuller::Plane& plane : planes) CHECK(std::fabs(std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c) - 1.0f) < 1e-5f);
+}
+
+// SSE and AVX against the distance test in double, for every array size around the vector widths: the visible list is in
+// order, doesn't write past the visible ones, and a box (that contains its sphere) is visible when its sphere is
+TEST(FrustumCuller_Bounds)
+{
+	FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT];
+	getPlanes(planes);
+
+	std::mt19937 random(7);
+	int overruns = 0, mismatches = 0, unordered = 0, missingBoxes = 0;
+
+	for (bool avx : { false, true })
+	{
+		FrustumCuller culler;
+		culler.setUseAVX(avx);
+		culler.setFrustum(planes, CAMERA);
+
+		for (size_t count : { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1000, 1003 })
+		{
+			FrustumCuller::Spheres spheres;
+			FrustumCuller::Boxes boxes;
+			makeBounds(count, random, spheres, boxes);
+
+			std::vector<uint32_t> visibleSpheres(count + 1, UINT32_MAX), visibleBoxes(count + 1, UINT32_MAX);
+			size_t sphereCount = culler.cull(spheres, visibleSpheres.data()), boxCount = culler.cull(boxes, visibleBoxes.data());
+
+			if (visibleSpheres[count] != UINT32_MAX or visibleBoxes[count] != UINT32_MAX) ++overruns;
+
+			// (right on a plane, float and double can disagree: either answer is fine there)
+			size_t next = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				bool culled = not (next < sphereCount and visibleSpheres[next] == i);
+				if (not culled) ++next;
+
+				bool loose = isSphereVisible(planes, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i] + 1e-3f);
+				bool strict = isSphereVisible(planes, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i] - 1e-3f);
+				if ((culled and strict) or (not culled and not loose)) ++mismatches;
+			}
+			if (next != sphereCount) ++unordered;
+
+			for (size_t i = 1; i < boxCount; ++i)
+				if (visibleBoxes[i] <= visibleBoxes[i - 1]) ++unordered;
+
+			for (size_t i = 0; i < sphereCount; ++i)
+				if (not std::binary_search(visibleBoxes.begin(), visibleBoxes.begin() + boxCount, visibleSpheres[i])) ++missingBoxes;
+		}
+	}
+
+	CHECK(overruns == 0 and mismatches == 0 and unordered == 0 and missingBoxes == 0);
+
+	// Both paths give the same list
+	FrustumCuller sse, avx;
+	sse.setUseAVX(false);
+	sse.setFrustum(planes, CAMERA);
+	avx.setFrustum(planes, CAMERA);
+
+	FrustumCuller::Spheres spheres;
+	FrustumCuller::Boxes boxes;
+	makeBounds(100003, random, spheres, boxes);
+
+	std::vector<uint32_t> a(boxes.size()), b(boxes.size());
+	size_t countA = sse.cull(boxes, a.data()), countB = avx.cull(boxes, b.data());
+	CHECK(countA == countB and std::equal(a.begin(), a.begin() + countA, b.begin()));
+}
+
+// 1M spheres and 1M boxes a frame: SSE, AVX and a scalar loop (with an early out per plane)
+BENCH(FrustumCuller_Cull)
+{
+	const size_t BOUNDS = 1000000;
+	const int RUNS = 30;
+
+	FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT];
+	getPlanes(planes);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-120.0f, 120.0f), radius(0.0f, 5.0f);
+
+	FrustumCuller::Spheres spheres;
+	FrustumCuller::Boxes boxes;
+	for (size_t i = 0; i < BOUNDS; ++i)
+	{
+		float x = position(random) + CAMERA[0], y = position(random) + CAMERA[1], z = position(random) + CAMERA[2], r = radius(random);
+		spheres.add(x, y, z, r);
+		const float boxMin[3] = { x - r, y - r, z - r }, boxMax[3] = { x + r, y + r, z + r };
+		boxes.add(boxMin, boxMax);
+	}
+
+	auto cullScalar = [&](bool box, uint32_t* visible) {
+		size_t count = 0;
+		for (size_t i = 0; i < BOUNDS; ++i)
+		{
+			float x = (box ? boxes.centerX[i] : spheres.x[i]) - CAMERA[0];
+			float y = (box ? boxes.centerY[i] : spheres.y[i]) - CAMERA[1];
+			float z = (box ? boxes.centerZ[i] : spheres.z[i]) - CAMERA[2];
+
+			bool inside = true;
+			for (const FrustumCuller::Plane& plane : planes)
+			{
+				float extent = box ? std::fabs(plane.a) * boxes.extentX[i] + std::fabs(plane.b) * boxes.extentY[i] + std::fabs(plane.c) * boxes.extentZ[i]
+								   : spheres.radius[i];
+				if (plane.a * x + plane.b * y + plane.c * z + plane.d < -extent) {
+					inside = false;
+					break;
+				}
+			}
+			if (inside) visible[count++] = uint32_t(i);
+		}
+		return count;
+	};
+
+	std::vector<uint32_t> visible(BOUNDS);
+	const char* names[] = { "scalar", "SSE", "AVX" };
+
+	for (int path = 0; path < (FrustumCuller::hasAVX() ? 3 : 2); ++path)
+	{
+		FrustumCuller culler;
+		culler.setUseAVX(path == 2);
+		culler.setFrustum(planes, CAMERA);
+
+		for (bool box : { false, true })
+		{
+			double best = 1e30;
+			size_t count = 0;
+			for (int run = 0; run < RUNS; ++run)
+			{
+				Test::Clock::time_point start = Test::Clock::now();
+				count = path == 0 ? cullScalar(box, visible.data()) : box ? culler.cull(boxes, visible.data()) : culler.cull(spheres, visible.data());
+				best = std::min(best, Test::elapsedMs(start));
+			}
+
+			printf("  %-6s %-7s %6.3f ms (%.2f ns each, %zu visible)\n", names[path], box ? "boxes" : "spheres", best, best * 1e6 / BOUNDS, count);
+		}
+	}
+}
@@ -0,0 +1,489 @@
+#pragma once
+
+// The d3d12.h types the CPU side of the engine fills in (pipeline and root signature descs, views, indirect arguments), with
+// the names, values and layouts of d3d12.h, so their sizes and offsets can be checked headless. Add the ones new engine
+// code needs. Interfaces only declare the methods the engine calls (tests derive fakes from them).
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+typedef unsigned int UINT;
+typedef int INT;
+typedef int BOOL;
+typedef float FLOAT;
+typedef uint8_t UINT8;
+typedef uint64_t UINT64;
+typedef int32_t LONG;
+typedef size_t SIZE_T;
+typedef const char* LPCSTR;
+typedef uint64_t D3D12_GPU_VIRTUAL_ADDRESS;
+
+#define FALSE 0
+#define TRUE 1
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_D32_FLOAT = 40,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R16_UINT = 57,
+};
+
+struct DXGI_SAMPLE_DESC
+{
+	UINT Count;
+	UINT Quality;
+};
+
+struct D3D12_VERTEX_BUFFER_VIEW
+{
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	UINT StrideInBytes;
+};
+
+struct D3D12_INDEX_BUFFER_VIEW
+{
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	DXGI_FORMAT Format;
+};
+
+struct D3D12_GPU_DESCRIPTOR_HANDLE
+{
+	UINT64 ptr;
+};
+
+struct D3D12_DRAW_INDEXED_ARGUMENTS
+{
+	UINT IndexCountPerInstance;
+	UINT InstanceCount;
+	UINT StartIndexLocation;
+	INT BaseVertexLocation;
+	UINT StartInstanceLocation;
+};
+
+enum D3D12_INDIRECT_ARGUMENT_TYPE
+{
+	D3D12_INDIRECT_ARGUMENT_TYPE_DRAW = 0,
+	D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED,
+	D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH,
+	D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW,
+	D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW,
+	D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT,
+	D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW,
+	D3D12_INDIRECT_ARGUMENT_TYPE_SHADER_RESOURCE_VIEW,
+	D3D12_INDIRECT_ARGUMENT_TYPE_UNORDERED_ACCESS_VIEW,
+};
+
+struct D3D12_INDIRECT_ARGUMENT_DESC
+{
+	D3D12_INDIRECT_ARGUMENT_TYPE Type;
+	union
+	{
+		struct { UINT Slot; } VertexBuffer;
+		struct { UINT RootParameterIndex; UINT DestOffsetIn32BitValues; UINT Num32BitValuesToSet; } Constant;
+		struct { UINT RootParameterIndex; } ConstantBufferView;
+		struct { UINT RootParameterIndex; } ShaderResourceView;
+		struct { UINT RootParameterIndex; } UnorderedAccessView;
+	};
+};
+
+struct D3D12_COMMAND_SIGNATURE_DESC
+{
+	UINT ByteStride;
+	UINT NumArgumentDescs;
+	const D3D12_INDIRECT_ARGUMENT_DESC* pArgumentDescs;
+	UINT NodeMask;
+};
+
+// Pipeline state descs
+
+struct ID3D12RootSignature;
+
+struct D3D12_SHADER_BYTECODE
+{
+	const void* pShaderBytecode;
+	SIZE_T BytecodeLength;
+};
+
+struct D3D12_SO_DECLARATION_ENTRY
+{
+	UINT Stream;
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	UINT8 StartComponent;
+	UINT8 ComponentCount;
+	UINT8 OutputSlot;
+};
+
+struct D3D12_STREAM_OUTPUT_DESC
+{
+	const D3D12_SO_DECLARATION_ENTRY* pSODeclaration;
+	UINT NumEntries;
+	const UINT* pBufferStrides;
+	UINT NumStrides;
+	UINT RasterizedStream;
+};
+
+enum D3D12_BLEND { D3D12_BLEND_ZERO = 1, D3D12_BLEND_ONE = 2, D3D12_BLEND_SRC_ALPHA = 5, D3D12_BLEND_INV_SRC_ALPHA = 6 };
+enum D3D12_BLEND_OP { D3D12_BLEND_OP_ADD = 1 };
+enum D3D12_LOGIC_OP { D3D12_LOGIC_OP_CLEAR = 0, D3D12_LOGIC_OP_NOOP = 4 };
+
+struct D3D12_RENDER_TARGET_BLEND_DESC
+{
+	BOOL BlendEnable;
+	BOOL LogicOpEnable;
+	D3D12_BLEND SrcBlend;
+	D3D12_BLEND DestBlend;
+	D3D12_BLEND_OP BlendOp;
+	D3D12_BLEND SrcBlendAlpha;
+	D3D12_BLEND DestBlendAlpha;
+	D3D12_BLEND_OP BlendOpAlpha;
+	D3D12_LOGIC_OP LogicOp;
+	UINT8 RenderTargetWriteMask;
+};
+
+struct D3D12_BLEND_DESC
+{
+	BOOL AlphaToCoverageEnable;
+	BOOL IndependentBlendEnable;
+	D3D12_RENDER_TARGET_BLEND_DESC RenderTarget[8];
+};
+
+enum D3D12_FILL_MODE { D3D12_FILL_MODE_WIREFRAME = 2, D3D12_FILL_MODE_SOLID = 3 };
+enum D3D12_CULL_MODE { D3D12_CULL_MODE_NONE = 1, D3D12_CULL_MODE_FRONT = 2, D3D12_CULL_MODE_BACK = 3 };
+enum D3D12_CONSERVATIVE_RASTERIZATION_MODE { D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF = 0, D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON = 1 };
+
+struct D3D12_RASTERIZER_DESC
+{
+	D3D12_FILL_MODE FillMode;
+	D3D12_CULL_MODE CullMode;
+	BOOL FrontCounterClockwise;
+	INT DepthBias;
+	FLOAT DepthBiasClamp;
+	FLOAT SlopeScaledDepthBias;
+	BOOL DepthClipEnable;
+	BOOL MultisampleEnable;
+	BOOL AntialiasedLineEnable;
+	UINT ForcedSampleCount;
+	D3D12_CONSERVATIVE_RASTERIZATION_MODE ConservativeRaster;
+};
+
+enum D3D12_DEPTH_WRITE_MASK { D3D12_DEPTH_WRITE_MASK_ZERO = 0, D3D12_DEPTH_WRITE_MASK_ALL = 1 };
+enum D3D12_COMPARISON_FUNC { D3D12_COMPARISON_FUNC_NEVER = 1, D3D12_COMPARISON_FUNC_LESS = 2, D3D12_COMPARISON_FUNC_ALWAYS = 8 };
+enum D3D12_STENCIL_OP { D3D12_STENCIL_OP_KEEP = 1, D3D12_STENCIL_OP_ZERO = 2 };
+
+struct D3D12_DEPTH_STENCILOP_DESC
+{
+	D3D12_STENCIL_OP StencilFailOp;
+	D3D12_STENCIL_OP StencilDepthFailOp;
+	D3D12_STENCIL_OP StencilPassOp;
+	D3D12_COMPARISON_FUNC StencilFunc;
+};
+
+struct D3D12_DEPTH_STENCIL_DESC
+{
+	BOOL DepthEnable;
+	D3D12_DEPTH_WRITE_MASK DepthWriteMask;
+	D3D12_COMPARISON_FUNC DepthFunc;
+	BOOL StencilEnable;
+	UINT8 StencilReadMask;
+	UINT8 StencilWriteMask;
+	D3D12_DEPTH_STENCILOP_DESC FrontFace;
+	D3D12_DEPTH_STENCILOP_DESC BackFace;
+};
+
+enum D3D12_INPUT_CLASSIFICATION { D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA = 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA = 1 };
+
+struct D3D12_INPUT_ELEMENT_DESC
+{
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	DXGI_FORMAT Format;
+	UINT InputSlot;
+	UINT AlignedByteOffset;
+	D3D12_INPUT_CLASSIFICATION InputSlotClass;
+	UINT InstanceDataStepRate;
+};
+
+struct D3D12_INPUT_LAYOUT_DESC
+{
+	const D3D12_INPUT_ELEMENT_DESC* pInputElementDescs;
+	UINT NumElements;
+};
+
+enum D3D12_INDEX_BUFFER_STRIP_CUT_VALUE { D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED = 0 };
+enum D3D12_PRIMITIVE_TOPOLOGY_TYPE { D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT = 1, D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE = 2, D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE = 3 };
+enum D3D12_PIPELINE_STATE_FLAGS { D3D12_PIPELINE_STATE_FLAG_NONE = 0 };
+
+struct D3D12_CACHED_PIPELINE_STATE
+{
+	const void* pCachedBlob;
+	SIZE_T CachedBlobSizeInBytes;
+};
+
+struct D3D12_GRAPHICS_PIPELINE_STATE_DESC
+{
+	ID3D12RootSignature* pRootSignature;
+	D3D12_SHADER_BYTECODE VS;
+	D3D12_SHADER_BYTECODE PS;
+	D3D12_SHADER_BYTECODE DS;
+	D3D12_SHADER_BYTECODE HS;
+	D3D12_SHADER_BYTECODE GS;
+	D3D12_STREAM_OUTPUT_DESC StreamOutput;
+	D3D12_BLEND_DESC BlendState;
+	UINT SampleMask;
+	D3D12_RASTERIZER_DESC RasterizerState;
+	D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+	D3D12_INPUT_LAYOUT_DESC InputLayout;
+	D3D12_INDEX_BUFFER_STRIP_CUT_VALUE IBStripCutValue;
+	D3D12_PRIMITIVE_TOPOLOGY_TYPE PrimitiveTopologyType;
+	UINT NumRenderTargets;
+	DXGI_FORMAT RTVFormats[8];
+	DXGI_FORMAT DSVFormat;
+	DXGI_SAMPLE_DESC SampleDesc;
+	UINT NodeMask;
+	D3D12_CACHED_PIPELINE_STATE CachedPSO;
+	D3D12_PIPELINE_STATE_FLAGS Flags;
+};
+
+struct D3D12_COMPUTE_PIPELINE_STATE_DESC
+{
+	ID3D12RootSignature* pRootSignature;
+	D3D12_SHADER_BYTECODE CS;
+	UINT NodeMask;
+	D3D12_CACHED_PIPELINE_STATE CachedPSO;
+	D3D12_PIPELINE_STATE_FLAGS Flags;
+};
+
+// Root signature descs
+
+enum D3D12_SHADER_VISIBILITY { D3D12_SHADER_VISIBILITY_ALL = 0, D3D12_SHADER_VISIBILITY_VERTEX = 1, D3D12_SHADER_VISIBILITY_PIXEL = 5 };
+
+enum D3D12_ROOT_PARAMETER_TYPE
+{
+	D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE = 0,
+	D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS,
+	D3D12_ROOT_PARAMETER_TYPE_CBV,
+	D3D12_ROOT_PARAMETER_TYPE_SRV,
+	D3D12_ROOT_PARAMETER_TYPE_UAV,
+};
+
+enum D3D12_DESCRIPTOR_RANGE_TYPE { D3D12_DESCRIPTOR_RANGE_TYPE_SRV = 0, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, D3D12_DESCRIPTOR_RANGE_TYPE_CBV, D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER };
+
+enum D3D12_DESCRIPTOR_RANGE_FLAGS
+{
+	D3D12_DESCRIPTOR_RANGE_FLAG_NONE = 0,
+	D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE = 0x1,
+	D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE = 0x2,
+	D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE = 0x4,
+	D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC = 0x8,
+};
+
+enum D3D12_ROOT_DESCRIPTOR_FLAGS
+{
+	D3D12_ROOT_DESCRIPTOR_FLAG_NONE = 0,
+	D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE = 0x2,
+	D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE = 0x4,
+	D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC = 0x8,
+};
+
+// (DEFINE_ENUM_FLAG_OPERATORS of d3d12.h, the ones the engine uses)
+inline D3D12_DESCRIPTOR_RANGE_FLAGS operator|(D3D12_DESCRIPTOR_RANGE_FLAGS a, D3D12_DESCRIPTOR_RANGE_FLAGS b) { return D3D12_DESCRIPTOR_RANGE_FLAGS(unsigned(a) | unsigned(b)); }
+inline D3D12_DESCRIPTOR_RANGE_FLAGS operator&(D3D12_DESCRIPTOR_RANGE_FLAGS a, D3D12_DESCRIPTOR_RANGE_FLAGS b) { return D3D12_DESCRIPTOR_RANGE_FLAGS(unsigned(a) & unsigned(b)); }
+inline D3D12_ROOT_DESCRIPTOR_FLAGS operator|(D3D12_ROOT_DESCRIPTOR_FLAGS a, D3D12_ROOT_DESCRIPTOR_FLAGS b) { return D3D12_ROOT_DESCRIPTOR_FLAGS(unsigned(a) | unsigned(b)); }
+inline D3D12_ROOT_DESCRIPTOR_FLAGS operator&(D3D12_ROOT_DESCRIPTOR_FLAGS a, D3D12_ROOT_DESCRIPTOR_FLAGS b) { return D3D12_ROOT_DESCRIPTOR_FLAGS(unsigned(a) & unsigned(b)); }
+
+enum D3D12_ROOT_SIGNATURE_FLAGS { D3D12_ROOT_SIGNATURE_FLAG_NONE = 0, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT = 0x1 };
+
+#define D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND 0xffffffff
+
+enum D3D12_FILTER
+{
+	D3D12_FILTER_MIN_MAG_MIP_POINT = 0,
+	D3D12_FILTER_MIN_MAG_MIP_LINEAR = 0x15,
+	D3D12_FILTER_ANISOTROPIC = 0x55,
+	D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR = 0x95,
+};
+
+enum D3D12_FILTER_REDUCTION_TYPE { D3D12_FILTER_REDUCTION_TYPE_STANDARD = 0, D3D12_FILTER_REDUCTION_TYPE_COMPARISON = 1 };
+
+#define D3D12_DECODE_FILTER_REDUCTION(D3D12Filter) ((D3D12_FILTER_REDUCTION_TYPE)(((D3D12Filter) >> 7) & 0x3))
+#define D3D12_DECODE_IS_ANISOTROPIC_FILTER(D3D12Filter) (((D3D12Filter) & 0x40) != 0 and (((D3D12Filter) >> 4) & 0x3) == 1 and (((D3D12Filter) >> 2) & 0x3) == 1 and ((D3D12Filter) & 0x3) == 1)
+
+enum D3D12_TEXTURE_ADDRESS_MODE { D3D12_TEXTURE_ADDRESS_MODE_WRAP = 1, D3D12_TEXTURE_ADDRESS_MODE_CLAMP = 3, D3D12_TEXTURE_ADDRESS_MODE_BORDER = 4 };
+enum D3D12_STATIC_BORDER_COLOR { D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK = 0, D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK, D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE };
+
+struct D3D12_STATIC_SAMPLER_DESC
+{
+	D3D12_FILTER Filter;
+	D3D12_TEXTURE_ADDRESS_MODE AddressU;
+	D3D12_TEXTURE_ADDRESS_MODE AddressV;
+	D3D12_TEXTURE_ADDRESS_MODE AddressW;
+	FLOAT MipLODBias;
+	UINT MaxAnisotropy;
+	D3D12_COMPARISON_FUNC ComparisonFunc;
+	D3D12_STATIC_BORDER_COLOR BorderColor;
+	FLOAT MinLOD;
+	FLOAT MaxLOD;
+	UINT ShaderRegister;
+	UINT RegisterSpace;
+	D3D12_SHADER_VISIBILITY ShaderVisibility;
+};
+
+struct D3D12_DESCRIPTOR_RANGE
+{
+	D3D12_DESCRIPTOR_RANGE_TYPE RangeType;
+	UINT NumDescriptors;
+	UINT BaseShaderRegister;
+	UINT RegisterSpace;
+	UINT OffsetInDescriptorsFromTableStart;
+};
+
+struct D3D12_DESCRIPTOR_RANGE1
+{
+	D3D12_DESCRIPTOR_RANGE_TYPE RangeType;
+	UINT NumDescriptors;
+	UINT BaseShaderRegister;
+	UINT RegisterSpace;
+	D3D12_DESCRIPTOR_RANGE_FLAGS Flags;
+	UINT OffsetInDescriptorsFromTableStart;
+};
+
+struct D3D12_ROOT_DESCRIPTOR_TABLE
+{
+	UINT NumDescriptorRanges;
+	const D3D12_DESCRIPTOR_RANGE* pDescriptorRanges;
+};
+
+struct D3D12_ROOT_DESCRIPTOR_TABLE1
+{
+	UINT NumDescriptorRanges;
+	const D3D12_DESCRIPTOR_RANGE1* pDescriptorRanges;
+};
+
+struct D3D12_ROOT_CONSTANTS
+{
+	UINT ShaderRegister;
+	UINT RegisterSpace;
+	UINT Num32BitValues;
+};
+
+struct D3D12_ROOT_DESCRIPTOR
+{
+	UINT ShaderRegister;
+	UINT RegisterSpace;
+};
+
+struct D3D12_ROOT_DESCRIPTOR1
+{
+	UINT ShaderRegister;
+	UINT RegisterSpace;
+	D3D12_ROOT_DESCRIPTOR_FLAGS Flags;
+};
+
+struct D3D12_ROOT_PARAMETER
+{
+	D3D12_ROOT_PARAMETER_TYPE ParameterType;
+	union
+	{
+		D3D12_ROOT_DESCRIPTOR_TABLE DescriptorTable;
+		D3D12_ROOT_CONSTANTS Constants;
+		D3D12_ROOT_DESCRIPTOR Descriptor;
+	};
+	D3D12_SHADER_VISIBILITY ShaderVisibility;
+};
+
+struct D3D12_ROOT_PARAMETER1
+{
+	D3D12_ROOT_PARAMETER_TYPE ParameterType;
+	union
+	{
+		D3D12_ROOT_DESCRIPTOR_TABLE1 DescriptorTable;
+		D3D12_ROOT_CONSTANTS Constants;
+		D3D12_ROOT_DESCRIPTOR1 Descriptor;
+	};
+	D3D12_SHADER_VISIBILITY ShaderVisibility;
+};
+
+struct D3D12_ROOT_SIGNATURE_DESC
+{
+	UINT NumParameters;
+	const D3D12_ROOT_PARAMETER* pParameters;
+	UINT NumStaticSamplers;
+	const D3D12_STATIC_SAMPLER_DESC* pStaticSamplers;
+	D3D12_ROOT_SIGNATURE_FLAGS Flags;
+};
+
+struct D3D12_ROOT_SIGNATURE_DESC1
+{
+	UINT NumParameters;
+	const D3D12_ROOT_PARAMETER1* pParameters;
+	UINT NumStaticSamplers;
+	const D3D12_STATIC_SAMPLER_DESC* pStaticSamplers;
+	D3D12_ROOT_SIGNATURE_FLAGS Flags;
+};
+
+enum D3D_ROOT_SIGNATURE_VERSION { D3D_ROOT_SIGNATURE_VERSION_1 = 0x1, D3D_ROOT_SIGNATURE_VERSION_1_0 = 0x1, D3D_ROOT_SIGNATURE_VERSION_1_1 = 0x2 };
+
+struct D3D12_VERSIONED_ROOT_SIGNATURE_DESC
+{
+	D3D_ROOT_SIGNATURE_VERSION Version;
+	union
+	{
+		D3D12_ROOT_SIGNATURE_DESC Desc_1_0;
+		D3D12_ROOT_SIGNATURE_DESC1 Desc_1_1;
+	};
+};
+
+// Command lists
+
+struct ID3D12PipelineState;
+
+enum D3D_PRIMITIVE_TOPOLOGY
+{
+	D3D_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+	D3D_PRIMITIVE_TOPOLOGY_POINTLIST = 1,
+	D3D_PRIMITIVE_TOPOLOGY_LINELIST = 2,
+	D3D_PRIMITIVE_TOPOLOGY_LINESTRIP = 3,
+	D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4,
+	D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP = 5,
+};
+
+struct D3D12_VIEWPORT
+{
+	FLOAT TopLeftX;
+	FLOAT TopLeftY;
+	FLOAT Width;
+	FLOAT Height;
+	FLOAT MinDepth;
+	FLOAT MaxDepth;
+};
+
+struct D3D12_RECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+};
+
+struct ID3D12GraphicsCommandList
+{
+	virtual void SetPipelineState(ID3D12PipelineState* pPipelineState) = 0;
+	virtual void SetGraphicsRootSignature(ID3D12RootSignature* pRootSignature) = 0;
+	virtual void RSSetViewports(UINT NumViewports, const D3D12_VIEWPORT* pViewports) = 0;
+	virtual void RSSetScissorRects(UINT NumRects, const D3D12_RECT* pRects) = 0;
+	virtual void IASetVertexBuffers(UINT StartSlot, UINT NumViews, const D3D12_VERTEX_BUFFER_VIEW* pViews) = 0;
+	virtual void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY PrimitiveTopology) = 0;
+	virtual void SetGraphicsRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, const void* pSrcData, UINT DestOffsetIn32BitValues) = 0;
+	virtual void SetGraphicsRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor) = 0;
+	virtual void SetGraphicsRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) = 0;
+	virtual void DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+// Globals.h of the headless builds (HEADLESS defined, see Tests/CMakeLists.txt): what the CPU side of the engine takes
+// from the real one, without windows, D3D12, SimpleMath or ImGui. Keep the values in sync with ../../Globals.h.
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+
+#include "D3D12Types.h"
+
+#define LOG(format, ...) log(__FILE__, __LINE__, format, ##__VA_ARGS__);
+
+inline void log(const char file[], int line, const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	printf("  %s(%d) : ", file, line);
+	vprintf(format, ap);
+	printf("\n");
+	va_end(ap);
+}
+
+#define FRAMES_IN_FLIGHT 2
+#define MAX_FRAMES_IN_FLIGHT 4
+#define SHADER_DESCRIPTORS 1000000
+#define UPLOAD_RING_SIZE (64 * 1024 * 1024)
+#define TEXTURE_BUDGET (256 * 1024 * 1024)
+#define TEXTURE_STREAMING_UPLOAD (16 * 1024 * 1024)
+#define TEXTURE_STREAMING_TAIL 64
+
+#define DEBUG_DRAW_EXPLICIT_CONTEXT
+#include "debug_draw.hpp"
+
+inline size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
@@ -0,0 +1,171 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "IndirectDrawBuilder.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	typedef IndirectDrawBuilder::Command Command;
+
+	// Perspective (0.8 rad vertical, far 300) turned by yaw around Y
+	void setFrustum(FrustumCuller& culler, float yaw, const float camera[3])
+	{
+		const float zNear = 0.1f, zFar = 300.0f, scale = 1.0f / std::tan(0.4f);
+		const float projection[16] = { scale, 0.0f, 0.0f, 0.0f, 0.0f, scale, 0.0f, 0.0f, 0.0f, 0.0f, zFar / (zNear - zFar), -1.0f, 0.0f, 0.0f, zNear * zFar / (zNear - zFar), 0.0f };
+		const float c = std::cos(yaw), s = std::sin(yaw);
+		const float view[16] = { c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+		float viewProjection[16] = {};
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				for (int k = 0; k < 4; ++k) viewProjection[i * 4 + j] += view[i * 4 + k] * projection[k * 4 + j];
+
+		FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT];
+		FrustumCuller::extractPlanes(viewProjection, planes);
+		culler.setFrustum(planes, camera);
+	}
+
+	// Objects with their AABBs also in boxes (what FrustumCuller would cull on the CPU)
+	void addObjects(size_t count, std::mt19937& random, IndirectDrawBuilder& builder, FrustumCuller::Boxes& boxes)
+	{
+		std::uniform_real_distribution<float> position(-150.0f, 150.0f), extent(0.1f, 4.0f);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			float boundsMin[3], boundsMax[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float center = position(random) + (axis == 0 ? 1000.0f : 0.0f), e = extent(random);
+				boundsMin[axis] = center - e;
+				boundsMax[axis] = center + e;
+			}
+
+			const float world[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, float(i), 0.0f, 0.0f, 1.0f };
+			D3D12_VERTEX_BUFFER_VIEW vertexBuffer = { 0x10000ull * (i % 7 + 1), 4096, 32 };
+			D3D12_INDEX_BUFFER_VIEW indexBuffer = { 0x20000ull * (i % 7 + 1), 1024, DXGI_FORMAT_R32_UINT };
+
+			builder.add(vertexBuffer, indexBuffer, uint32_t(36 + i % 7), world, boundsMin, boundsMax, uint32_t(i % 13));
+			boxes.add(boundsMin, boundsMax);
+		}
+	}
+}
+
+// The command signature reads Command as laid out, and the structs match Shaders/IndirectCommon.hlsli
+TEST(IndirectDrawBuilder_Layout)
+{
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[IndirectDrawBuilder::ARGUMENT_COUNT];
+	D3D12_COMMAND_SIGNATURE_DESC desc = IndirectDrawBuilder::getCommandSignatureDesc(arguments);
+
+	CHECK(desc.ByteStride == sizeof(Command) and desc.NumArgumentDescs == IndirectDrawBuilder::ARGUMENT_COUNT and desc.pArgumentDescs == arguments and desc.NodeMask == 0);
+	CHECK(arguments[0].Type == D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW and arguments[0].VertexBuffer.Slot == 0 and offsetof(Command, vertexBuffer) == 0);
+	CHECK(arguments[1].Type == D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW and offsetof(Command, indexBuffer) == 16);
+	CHECK(arguments[2].Type == D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT and arguments[2].Constant.RootParameterIndex == IndirectDrawBuilder::OBJECT_INDEX_PARAMETER);
+	CHECK(arguments[2].Constant.Num32BitValuesToSet == 1 and offsetof(Command, objectIndex) == 32);
+	CHECK(arguments[3].Type == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED and offsetof(Command, draw) == 36 and sizeof(Command) == 56);
+
+	// (IndirectObject: world, center, textureIndex, extent, padding)
+	CHECK(offsetof(IndirectDrawBuilder::Object, center) == 64 and offsetof(IndirectDrawBuilder::Object, textureIndex) == 76);
+	CHECK(offsetof(IndirectDrawBuilder::Object, extent) == 80 and sizeof(IndirectDrawBuilder::Object) == 96);
+	CHECK(offsetof(IndirectDrawBuilder::CullConstants, origin) == 96 and offsetof(IndirectDrawBuilder::CullConstants, objectCount) == 108);
+}
+
+// The reference of the culling shader against FrustumCuller over the same AABBs: the same objects (in order, as the
+// reference walks them in order), their commands copied as built, and nothing written past the visible ones
+TEST(IndirectDrawBuilder_Cull)
+{
+	std::mt19937 random(5);
+	const float camera[3] = { 1000.0f, 2.0f, 5.0f };
+	int mismatches = 0, overruns = 0, wrongCommands = 0;
+
+	for (size_t count : { 0, 1, 5, 64, 65, 1000, 20000 })
+	{
+		IndirectDrawBuilder builder;
+		FrustumCuller::Boxes boxes;
+		addObjects(count, random, builder, boxes);
+		CHECK(builder.size() == count and builder.getCommands().size() == count);
+
+		for (int i = 0; i < 6; ++i)
+		{
+			FrustumCuller frustum;
+			setFrustum(frustum, i * 1.1f, camera);
+
+			IndirectDrawBuilder::CullConstants constants = builder.getCullConstants(frustum);
+			CHECK(constants.objectCount == count and memcmp(constants.planes, frustum.getPlanes(), sizeof(constants.planes)) == 0);
+			CHECK(memcmp(constants.origin, camera, sizeof(constants.origin)) == 0);
+
+			std::vector<Command> visible(count + 1);
+			unsigned char guard[sizeof(Command)];
+			memset(guard, 0xab, sizeof(guard));
+			memcpy(&visible[count], guard, sizeof(Command));
+
+			uint32_t visibleCount = builder.cull(constants, visible.data());
+			if (memcmp(&visible[count], guard, sizeof(Command)) != 0) ++overruns;
+
+			std::vector<uint32_t> expected(count);
+			expected.resize(frustum.cull(boxes, expected.data()));
+			if (visibleCount != expected.size()) {
+				++mismatches;
+				continue;
+			}
+
+			for (uint32_t k = 0; k < visibleCount; ++k)
+			{
+				const Command& command = builder.getCommands()[expected[k]];
+				if (visible[k].objectIndex != expected[k] or memcmp(&visible[k], &command, sizeof(Command)) != 0) ++mismatches;
+				if (command.draw.InstanceCount != 1 or command.draw.IndexCountPerInstance != 36 + expected[k] % 7) ++wrongCommands;
+				if (builder.getObjects()[expected[k]].world[12] != float(expected[k]) or builder.getObjects()[expected[k]].textureIndex != expected[k] % 13) ++wrongCommands;
+			}
+		}
+	}
+
+	CHECK(mismatches == 0 and overruns == 0 and wrongCommands == 0);
+}
+
+// Filling the buffers of 100k objects a frame, and the reference cull of them against FrustumCuller
+BENCH(IndirectDrawBuilder_Build)
+{
+	const size_t OBJECTS = 100000;
+	const int RUNS = 10;
+
+	std::mt19937 random(5);
+	IndirectDrawBuilder builder;
+	FrustumCuller::Boxes boxes;
+
+	double build = 1e30;
+	for (int run = 0; run < RUNS; ++run)
+	{
+		builder.clear();
+		boxes.clear();
+		Test::Clock::time_point start = Test::Clock::now();
+		addObjects(OBJECTS, random, builder, boxes);
+		build = std::min(build, Test::elapsedMs(start));
+	}
+
+	const float camera[3] = { 1000.0f, 2.0f, 5.0f };
+	FrustumCuller frustum;
+	setFrustum(frustum, 0.3f, camera);
+	IndirectDrawBuilder::CullConstants constants = builder.getCullConstants(frustum);
+
+	std::vector<Command> visible(OBJECTS);
+	std::vector<uint32_t> indices(OBJECTS);
+	double reference = 1e30, culler = 1e30;
+	uint32_t count = 0;
+	size_t cullerCount = 0;
+	for (int run = 0; run < RUNS; ++run)
+	{
+		Test::Clock::time_point start = Test::Clock::now();
+		count = builder.cull(constants, visible.data());
+		reference = std::min(reference, Test::elapsedMs(start));
+
+		start = Test::Clock::now();
+		cullerCount = frustum.cull(boxes, indices.data());
+		culler = std::min(culler, Test::elapsedMs(start));
+	}
+
+	printf("  %zu objects: add %.2f ms (random bounds included, %.1f MB of objects and commands), reference cull %.2f ms, FrustumCuller %.2f ms (%u / %zu visible)\n",
+		   OBJECTS, build, double(OBJECTS * (sizeof(IndirectDrawBuilder::Object) + sizeof(Command))) / 1048576.0, reference, culler, count, cullerCount);
+}
@@ -0,0 +1,188 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+	// Some work that takes a while and can't be optimized away
+	float spin(int iterations)
+	{
+		float value = 1.0f;
+		for (int i = 0; i < iterations; ++i) value = std::sqrt(value + float(i));
+
+		return value;
+	}
+}
+
+TEST(JobSystem_WorkerCount)
+{
+	JobSystem defaults;
+	CHECK(defaults.getWorkerCount() >= 1);
+	CHECK(defaults.getThreadCount() == defaults.getWorkerCount() + 1);
+
+	JobSystem one(1);
+	CHECK(one.getWorkerCount() == 1);
+}
+
+TEST(JobSystem_Dependencies)
+{
+	JobSystem jobs(4);
+
+	for (int round = 0; round < 200; ++round)
+	{
+		// Fan in: the last job sees all the others done
+		std::atomic<int> count = 0;
+		std::vector<JobSystem::JobHandle> handles;
+		for (int i = 0; i < 100; ++i) handles.push_back(jobs.schedule([&count]() { ++count; }));
+
+		int seen = -1;
+		JobSystem::JobHandle last = jobs.schedule([&count, &seen]() { seen = count; }, handles);
+
+		// Dependencies that are already done, and a chain that has to run in order
+		jobs.wait(last);
+		CHECK(seen == 100);
+
+		std::vector<int> order;
+		JobSystem::JobHandle previous = jobs.schedule([&order]() { order.push_back(0); }, { last });
+		for (int i = 1; i < 20; ++i) previous = jobs.schedule([&order, i]() { order.push_back(i); }, { previous, last });
+
+		jobs.wait(previous);
+		CHECK(order.size() == 20 and std::is_sorted(order.begin(), order.end()));
+	}
+}
+
+// A thread that waits runs jobs meanwhile: with the only worker stuck, wait() has to run the job itself
+TEST(JobSystem_WaitHelps)
+{
+	JobSystem jobs(1);
+
+	std::atomic<bool> started = false, release = false;
+	JobSystem::JobHandle blocker = jobs.schedule([&started, &release]() {
+		started = true;
+		while (not release) std::this_thread::yield();
+	});
+
+	while (not started) std::this_thread::yield();
+
+	unsigned int ranOn = 99;
+	jobs.wait(jobs.schedule([&ranOn]() { ranOn = JobSystem::getThreadIndex(); }));
+	CHECK(ranOn == 0);
+
+	release = true;
+	jobs.wait(blocker);
+
+	// Jobs that wait for the jobs they schedule, nested, on a single worker: the worker helps instead of deadlocking
+	std::atomic<int> leaves = 0;
+	std::function<void(int)> tree = [&](int depth) {
+		if (depth == 0) {
+			++leaves;
+			return;
+		}
+
+		JobSystem::JobHandle left = jobs.schedule([&tree, depth]() { tree(depth - 1); });
+		JobSystem::JobHandle right = jobs.schedule([&tree, depth]() { tree(depth - 1); });
+		jobs.waitAll({ left, right });
+	};
+
+	jobs.wait(jobs.schedule([&tree]() { tree(8); }));
+	CHECK(leaves == 256);
+}
+
+// Several threads building random task graphs at once: every job runs once, after its dependencies
+TEST(JobSystem_Stress)
+{
+	const int THREADS = 4, JOBS = 5000;
+
+	JobSystem jobs(4);
+	std::atomic<int> ran = 0, early = 0, indexErrors = 0;
+
+	auto producer = [&](unsigned seed) {
+		std::mt19937 random(seed);
+		std::vector<JobSystem::JobHandle> handles;
+		std::vector<std::unique_ptr<std::atomic<int>>> runs;
+
+		for (int i = 0; i < JOBS; ++i)
+		{
+			std::vector<JobSystem::JobHandle> dependencies;
+			std::vector<std::atomic<int>*> dependencyRuns;
+			for (int d = 0, count = i > 0 ? random() % 4 : 0; d < count; ++d)
+			{
+				int index = random() % i;
+				dependencies.push_back(handles[index]);
+				dependencyRuns.push_back(runs[index].get());
+			}
+
+			runs.push_back(std::make_unique<std::atomic<int>>(0));
+			std::atomic<int>* own = runs.back().get();
+
+			handles.push_back(jobs.schedule([&, own, dependencyRuns]() {
+				for (std::atomic<int>* dependency : dependencyRuns)
+					if (*dependency != 1) ++early;
+
+				unsigned int index = JobSystem::getThreadIndex();
+				if (index > jobs.getWorkerCount()) ++indexErrors;
+
+				++*own;
+				++ran;
+			}, dependencies));
+		}
+
+		jobs.waitAll(handles);
+
+		for (const std::unique_ptr<std::atomic<int>>& run : runs) CHECK(*run == 1);
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < THREADS; ++i) threads.emplace_back(producer, unsigned(i + 1));
+	for (std::thread& thread : threads) thread.join();
+
+	CHECK(ran == THREADS * JOBS);
+	CHECK(early == 0);
+	CHECK(indexErrors == 0);
+}
+
+// Scaling from 1 to N cores on a fixed amount of work, in jobs of some tens of microseconds and as a graph of dependent
+// batches, as the command list recording uses it. 1 core is the same work run serially, N is N - 1 workers and the caller.
+BENCH(JobSystem_Scaling)
+{
+	const int JOBS = 4096, BATCHES = 64, ITERATIONS = 20000;
+
+	std::vector<float> results(JOBS);
+
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int i = 0; i < JOBS; ++i) results[i] = spin(ITERATIONS);
+	double serial = Test::elapsedMs(start);
+
+	Test::keep(results);
+	printf("   1 core:  %8.1f ms\n", serial);
+
+	unsigned int cores = std::max(2u, std::thread::hardware_concurrency());
+	for (unsigned int threads = 2; threads <= cores; threads = threads < cores ? std::min(cores, threads * 2) : cores + 1)
+	{
+		JobSystem jobs(threads - 1);
+
+		start = Test::Clock::now();
+
+		std::vector<JobSystem::JobHandle> previous;
+		for (int batch = 0; batch < BATCHES; ++batch)
+		{
+			std::vector<JobSystem::JobHandle> handles;
+			for (int i = batch * (JOBS / BATCHES); i < (batch + 1) * (JOBS / BATCHES); ++i)
+				handles.push_back(jobs.schedule([&results, i]() { results[i] = spin(ITERATIONS); }, batch % 8 == 0 ? std::vector<JobSystem::JobHandle>() : previous));
+
+			previous = handles;
+			if (batch % 8 == 7) jobs.waitAll(handles); // (a frame: 8 batches, each one after the previous)
+		}
+		jobs.waitAll(previous);
+
+		double ms = Test::elapsedMs(start);
+
+		Test::keep(results);
+		printf("  %2u cores: %8.1f ms  (%.2fx)\n", threads, ms, serial / ms);
+	}
+}
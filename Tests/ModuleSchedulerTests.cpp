@@ -0,0 +1,247 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "ModuleScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace
+{
+	// Records what runs, when and where (and how many of the mocks run at the same time)
+	struct Trace
+	{
+		std::mutex mutex;
+		std::vector<std::string> events;
+		std::atomic<int> running = 0, maxRunning = 0;
+
+		void enter(const std::string& event)
+		{
+			int now = ++running;
+			int seen = maxRunning;
+			while (now > seen and not maxRunning.compare_exchange_weak(seen, now)) {}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			events.push_back(event);
+		}
+
+		void leave() { --running; }
+
+		size_t find(const std::string& event)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return size_t(std::find(events.begin(), events.end(), event) - events.begin());
+		}
+	};
+
+	class MockModule : public Module
+	{
+	public:
+
+		MockModule(Trace& trace, const char* name, int workMs = 0, bool ok = true) : trace(trace), name(name), workMs(workMs), ok(ok) {}
+
+		// Conflicts with nothing unless told otherwise
+		void setAccessAll(unsigned int reads, unsigned int writes)
+		{
+			for (int phase = 0; phase < MAX_PHASES; ++phase) setAccess(Phase(phase), reads, writes);
+		}
+
+		bool init() override
+		{
+			run("init");
+			return ok;
+		}
+
+		void update() override { run("update"); }
+
+		std::thread::id updateThread;
+
+	private:
+
+		Trace& trace;
+		std::string name;
+		int workMs;
+		bool ok;
+
+		void run(const char* phase)
+		{
+			trace.enter(name + " " + phase);
+			if (workMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(workMs));
+			if (std::string(phase) == "update") updateThread = std::this_thread::get_id();
+			trace.leave();
+		}
+	};
+}
+
+TEST(ModuleScheduler_Order)
+{
+	JobSystem jobs(4);
+	Trace trace;
+
+	// Registration order, except where the dependencies say otherwise (defaults: everything conflicts)
+	MockModule editor(trace, "editor"), d3d12(trace, "d3d12"), input(trace, "input"), camera(trace, "camera");
+	editor.dependsOn(&d3d12);
+	camera.dependsOn(&input, Module::PHASE_UPDATE);
+
+	ModuleScheduler scheduler(&jobs);
+	CHECK(scheduler.build({ &editor, &d3d12, &camera, &input }));
+
+	const std::vector<Module*>& init = scheduler.getOrder(Module::PHASE_INIT);
+	CHECK(init == std::vector<Module*>({ &d3d12, &editor, &camera, &input }));
+
+	const std::vector<Module*>& update = scheduler.getOrder(Module::PHASE_UPDATE);
+	CHECK(update == std::vector<Module*>({ &d3d12, &editor, &input, &camera }));
+
+	CHECK(scheduler.init());
+	CHECK(trace.events == std::vector<std::string>({ "d3d12 init", "editor init", "camera init", "input init" }));
+	CHECK(trace.maxRunning == 1);
+}
+
+TEST(ModuleScheduler_Errors)
+{
+	JobSystem jobs(2);
+	Trace trace;
+
+	MockModule a(trace, "a"), b(trace, "b"), unregistered(trace, "unregistered");
+
+	// Cycles and dependencies on modules the application doesn't have
+	a.dependsOn(&b, Module::PHASE_RENDER);
+	b.dependsOn(&a, Module::PHASE_RENDER);
+
+	ModuleScheduler scheduler(&jobs);
+	CHECK(not scheduler.build({ &a, &b }));
+
+	MockModule c(trace, "c");
+	c.dependsOn(&unregistered);
+	CHECK(not scheduler.build({ &c }));
+}
+
+// Modules whose access doesn't conflict run at the same time, the ones that conflict one after the other, in order
+TEST(ModuleScheduler_Parallel)
+{
+	JobSystem jobs(4);
+
+	{
+		Trace trace;
+		MockModule a(trace, "a", 20), b(trace, "b", 20), c(trace, "c", 20), d(trace, "d", 20);
+		for (MockModule* module : { &a, &b, &c, &d }) module->setAccessAll(Module::ACCESS_CAMERA, Module::ACCESS_NONE); // (readers only)
+
+		ModuleScheduler scheduler(&jobs);
+		CHECK(scheduler.build({ &a, &b, &c, &d }));
+
+		Test::Clock::time_point start = Test::Clock::now();
+		scheduler.run(Module::PHASE_UPDATE);
+
+		CHECK(trace.events.size() == 4);
+		CHECK(trace.maxRunning > 1);
+		CHECK(Test::elapsedMs(start) < 4 * 20.0);
+	}
+
+	{
+		Trace trace;
+		MockModule scene(trace, "scene", 5), culling(trace, "culling", 5), reader(trace, "reader", 5), other(trace, "other", 20);
+		scene.setAccessAll(Module::ACCESS_NONE, Module::ACCESS_SCENE);
+		culling.setAccessAll(Module::ACCESS_SCENE, Module::ACCESS_CULLING); // (reads what scene writes)
+		reader.setAccessAll(Module::ACCESS_CULLING, Module::ACCESS_NONE);
+		other.setAccessAll(Module::ACCESS_INPUT, Module::ACCESS_NONE);
+
+		ModuleScheduler scheduler(&jobs);
+		CHECK(scheduler.build({ &scene, &culling, &reader, &other }));
+		scheduler.run(Module::PHASE_UPDATE);
+
+		CHECK(trace.find("scene update") < trace.find("culling update"));
+		CHECK(trace.find("culling update") < trace.find("reader update"));
+		CHECK(trace.find("other update") < trace.events.size());
+	}
+}
+
+TEST(ModuleScheduler_MainThread)
+{
+	JobSystem jobs(4);
+	Trace trace;
+
+	MockModule window(trace, "window", 1), worker(trace, "worker", 1);
+	window.setAccessAll(Module::ACCESS_NONE, Module::ACCESS_NONE);
+	worker.setAccessAll(Module::ACCESS_NONE, Module::ACCESS_NONE);
+	window.setAccess(Module::PHASE_UPDATE, Module::ACCESS_NONE, Module::ACCESS_NONE, true);
+
+	ModuleScheduler scheduler(&jobs);
+	CHECK(scheduler.build({ &worker, &window }));
+
+	for (int frame = 0; frame < 20; ++frame)
+	{
+		scheduler.run(Module::PHASE_UPDATE);
+		CHECK(window.updateThread == std::this_thread::get_id());
+	}
+}
+
+// A failed init stops the modules that come after it (by dependency or conflicting access), not the others
+TEST(ModuleScheduler_InitFailure)
+{
+	JobSystem jobs(2);
+	Trace trace;
+
+	MockModule device(trace, "device", 0, false), resources(trace, "resources"), input(trace, "input");
+	resources.dependsOn(&device);
+	for (MockModule* module : { &device, &resources, &input }) module->setAccessAll(Module::ACCESS_NONE, Module::ACCESS_NONE);
+
+	ModuleScheduler scheduler(&jobs);
+	CHECK(scheduler.build({ &device, &resources, &input }));
+	CHECK(not scheduler.init());
+
+	CHECK(trace.find("device init") < trace.events.size());
+	CHECK(trace.find("resources init") == trace.events.size());
+	CHECK(trace.find("input init") < trace.events.size());
+}
+
+// CPU cost of a frame for the application's 15 modules: the scheduler overhead with empty phases, and the frame time when
+// every update does 1 ms of work that doesn't conflict (sleeping, as waiting for the GPU or IO) against calling them in order
+BENCH(ModuleScheduler_Frame)
+{
+	const int MODULES = 15, FRAMES = 2000;
+
+	JobSystem jobs;
+	Trace trace;
+
+	std::vector<std::unique_ptr<MockModule>> owned;
+	std::vector<Module*> modules;
+	for (int i = 0; i < MODULES; ++i)
+	{
+		owned.push_back(std::make_unique<MockModule>(trace, "module"));
+		owned.back()->setAccessAll(i % 3 == 0 ? Module::ACCESS_SCENE : Module::ACCESS_NONE, i % 5 == 0 ? Module::ACCESS_CULLING : Module::ACCESS_NONE);
+		modules.push_back(owned.back().get());
+	}
+
+	ModuleScheduler scheduler(&jobs);
+	scheduler.build(modules);
+
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int frame = 0; frame < FRAMES; ++frame)
+		for (int phase = Module::PHASE_UPDATE; phase < Module::MAX_PHASES; ++phase) scheduler.run(Module::Phase(phase));
+
+	printf("  overhead: %.1f us per frame (%d modules, 4 phases)\n", Test::elapsedMs(start) * 1000.0 / FRAMES, MODULES);
+
+	owned.clear();
+	modules.clear();
+	for (int i = 0; i < MODULES; ++i)
+	{
+		owned.push_back(std::make_unique<MockModule>(trace, "module", 1));
+		owned.back()->setAccessAll(Module::ACCESS_CAMERA, Module::ACCESS_NONE);
+		modules.push_back(owned.back().get());
+	}
+
+	scheduler.build(modules);
+
+	start = Test::Clock::now();
+	for (int frame = 0; frame < 20; ++frame)
+		for (Module* module : modules) module->update();
+	double serial = Test::elapsedMs(start) / 20;
+
+	start = Test::Clock::now();
+	for (int frame = 0; frame < 20; ++frame) scheduler.run(Module::PHASE_UPDATE);
+	double scheduled = Test::elapsedMs(start) / 20;
+
+	printf("  update, 1 ms each: %.2f ms in order, %.2f ms scheduled (%u threads)\n", serial, scheduled, jobs.getThreadCount());
+}
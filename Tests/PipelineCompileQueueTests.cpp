@@ -0,0 +1,272 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "PipelineCompileQueue.h"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace
+{
+	struct FakePipeline
+	{
+		int id;
+	};
+
+	typedef std::shared_ptr<FakePipeline> Pipeline;
+	typedef PipelineCompileQueue<Pipeline> Queue;
+
+	// Compiles that take the latency they are given (or until released), fail for negative ids, and count how many run
+	// at once
+	struct FakeCompiler
+	{
+		std::atomic<int> running = 0, maxRunning = 0, compiled = 0;
+		std::atomic<bool> released = true;
+
+		Queue::Compile make(int id, int latencyMs)
+		{
+			return [this, id, latencyMs]() {
+				int now = ++running, seen = maxRunning;
+				while (now > seen and not maxRunning.compare_exchange_weak(seen, now)) {}
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(latencyMs));
+				while (not released) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+				--running;
+				++compiled;
+				return id < 0 ? Pipeline() : std::make_shared<FakePipeline>(FakePipeline{ id });
+			};
+		}
+	};
+
+	Pipeline makePipeline(int id)
+	{
+		return std::make_shared<FakePipeline>(FakePipeline{ id });
+	}
+
+	bool waitForState(const Queue& queue, Queue::Handle handle, Queue::State state)
+	{
+		Test::Clock::time_point start = Test::Clock::now();
+		while (queue.getState(handle) != state)
+		{
+			if (Test::elapsedMs(start) > 5000.0) return false;
+			std::this_thread::yield();
+		}
+		return true;
+	}
+}
+
+// The handle comes back right away, draws get the fallback (or nothing: skipped) until the pipeline is compiled, and
+// failed pipelines keep drawing their fallbacks, down a chain of them
+TEST(PipelineCompileQueue_Fallback)
+{
+	JobSystem jobs(4);
+	FakeCompiler compiler;
+	Queue queue(&jobs, 2);
+
+	Queue::Handle fallback = queue.add(makePipeline(1000));
+	CHECK(queue.isReady(fallback));
+
+	compiler.released = false;
+	Test::Clock::time_point start = Test::Clock::now();
+	Queue::Handle pipeline = queue.request(compiler.make(1, 0), fallback);
+	Queue::Handle noFallback = queue.request(compiler.make(2, 0));
+	CHECK(Test::elapsedMs(start) < 50.0);
+	CHECK(pipeline != 0 and noFallback != 0 and pipeline != noFallback);
+	CHECK(waitForState(queue, pipeline, Queue::STATE_COMPILING));
+
+	Queue::Handle used = 99;
+	Pipeline drawn = queue.get(pipeline, &used);
+	CHECK(drawn and drawn->id == 1000 and used == fallback);
+	CHECK(not queue.get(noFallback, &used) and used == 0);
+
+	compiler.released = true;
+	queue.wait(pipeline);
+	drawn = queue.get(pipeline, &used);
+	CHECK(drawn and drawn->id == 1 and used == pipeline);
+
+	queue.waitAll();
+	CHECK(queue.get(noFallback)->id == 2);
+	CHECK(queue.getState(0) == Queue::STATE_INVALID and queue.getState(12345) == Queue::STATE_INVALID);
+	CHECK(not queue.get(0) and not queue.get(12345));
+
+	// Chains: a failed pipeline draws its fallback, or the fallback of that one
+	Queue::Handle base = queue.add(makePipeline(7));
+	Queue::Handle failed = queue.request(compiler.make(-1, 5), base);
+	Queue::Handle failedOnFailed = queue.request(compiler.make(-2, 1), failed);
+	queue.wait(failed);
+	queue.wait(failedOnFailed);
+	CHECK(queue.getState(failed) == Queue::STATE_FAILED and queue.getState(failedOnFailed) == Queue::STATE_FAILED);
+	CHECK(queue.get(failedOnFailed, &used)->id == 7 and used == base);
+
+	compiler.released = false;
+	Queue::Handle middle = queue.request(compiler.make(8, 0), base);
+	Queue::Handle top = queue.request(compiler.make(9, 0), middle);
+	CHECK(queue.get(top)->id == 7); // (neither is ready: two levels down)
+
+	compiler.released = true;
+	queue.wait(middle);
+	queue.waitAll();
+	CHECK(queue.get(top, &used)->id == 9 and used == top);
+}
+
+// Replacing a pipeline (reloaded shaders) wins over a compile still running for it or queued, and waiting for a queued
+// compile runs it on the waiting thread, without waiting for the ones ahead
+TEST(PipelineCompileQueue_Replace)
+{
+	JobSystem jobs(2);
+	FakeCompiler compiler;
+	Queue queue(&jobs, 1);
+
+	compiler.released = false;
+	Queue::Handle running = queue.request(compiler.make(1, 0));
+	CHECK(waitForState(queue, running, Queue::STATE_COMPILING));
+	Queue::Handle queued = queue.request(compiler.make(2, 0));
+	CHECK(queue.getState(queued) == Queue::STATE_QUEUED and queue.getQueuedCount() == 1);
+
+	queue.replace(running, makePipeline(10));
+	queue.replace(queued, makePipeline(20));
+	CHECK(queue.get(running)->id == 10 and queue.get(queued)->id == 20 and queue.getQueuedCount() == 0);
+
+	compiler.released = true;
+	queue.waitAll();
+	CHECK(queue.get(running)->id == 10 and queue.get(queued)->id == 20); // (the stale compile is dropped)
+	CHECK(compiler.compiled == 1);
+
+	queue.replace(running, makePipeline(11));
+	CHECK(queue.get(running)->id == 11);
+	queue.replace(running, Pipeline());
+	CHECK(queue.getState(running) == Queue::STATE_FAILED and not queue.get(running));
+
+	compiler.released = false;
+	Queue::Handle slow = queue.request(compiler.make(3, 0));
+	CHECK(waitForState(queue, slow, Queue::STATE_COMPILING));
+	FakeCompiler unblocked;
+	Queue::Handle behind = queue.request(unblocked.make(4, 0));
+	queue.wait(behind); // (compiled here: the only job is stuck on slow)
+	CHECK(queue.isReady(behind) and queue.getState(slow) == Queue::STATE_COMPILING);
+	compiler.released = true;
+	queue.waitAll();
+	CHECK(queue.isReady(slow));
+}
+
+// 200 compiles of 0 to 5 ms: every draw gets a pipeline meanwhile, each compiles once and no more than maxCompiling at a
+// time. Then requests from several threads, without a job system, and destroying the queue with compiles in it.
+TEST(PipelineCompileQueue_Latencies)
+{
+	JobSystem jobs(4);
+	std::mt19937 random(7);
+
+	{
+		FakeCompiler compiler;
+		Queue queue(&jobs, 2);
+		Queue::Handle fallback = queue.add(makePipeline(-100));
+
+		const int COUNT = 200;
+		std::vector<Queue::Handle> handles;
+		for (int i = 0; i < COUNT; ++i) handles.push_back(queue.request(compiler.make(i, int(random() % 6)), fallback));
+
+		int wrongDraws = 0;
+		while (compiler.compiled < COUNT)
+		{
+			for (int i = 0; i < COUNT; ++i)
+			{
+				Pipeline drawn = queue.get(handles[i]);
+				if (not drawn or (drawn->id != i and drawn->id != -100)) ++wrongDraws;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(2)); // (a frame)
+		}
+		queue.waitAll();
+
+		int wrong = 0;
+		for (int i = 0; i < COUNT; ++i)
+			if (not queue.isReady(handles[i]) or queue.get(handles[i])->id != i) ++wrong;
+
+		CHECK(wrongDraws == 0 and wrong == 0);
+		CHECK(compiler.compiled == COUNT and compiler.maxRunning >= 1 and compiler.maxRunning <= 2);
+	}
+
+	{
+		FakeCompiler compiler;
+		Queue queue(&jobs, 3);
+		std::vector<Queue::Handle> handles(400);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t)
+			threads.emplace_back([&, t]() {
+				for (int i = t; i < 400; i += 4) handles[i] = queue.request(compiler.make(i, i % 2));
+			});
+		for (std::thread& thread : threads) thread.join();
+		queue.waitAll();
+
+		std::sort(handles.begin(), handles.end());
+		CHECK(std::unique(handles.begin(), handles.end()) == handles.end());
+		CHECK(std::all_of(handles.begin(), handles.end(), [&queue](Queue::Handle handle) { return queue.isReady(handle); }));
+		CHECK(compiler.compiled == 400 and compiler.maxRunning <= 4); // (3 jobs and the thread in waitAll)
+	}
+
+	{
+		FakeCompiler compiler;
+		Queue queue(nullptr);
+		Queue::Handle fallback = queue.add(makePipeline(5));
+		Queue::Handle compiled = queue.request(compiler.make(3, 1), fallback);
+		Queue::Handle failed = queue.request(compiler.make(-3, 1), fallback);
+		CHECK(queue.isReady(compiled) and queue.get(compiled)->id == 3);
+		CHECK(queue.getState(failed) == Queue::STATE_FAILED and queue.get(failed)->id == 5);
+	}
+
+	{
+		FakeCompiler compiler;
+		compiler.released = false;
+		std::thread release;
+		{
+			Queue queue(&jobs, 1);
+			std::vector<Queue::Handle> handles;
+			for (int i = 0; i < 20; ++i) handles.push_back(queue.request(compiler.make(i, 0)));
+			CHECK(waitForState(queue, handles[0], Queue::STATE_COMPILING));
+
+			release = std::thread([&compiler]() {
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				compiler.released = true;
+			});
+		} // (waits for the running compile)
+		release.join();
+		CHECK(compiler.running == 0 and compiler.compiled == 1); // (the queued ones are dropped)
+	}
+}
+
+// What the render thread pays: requesting, and getting the pipeline of 1000 draws a frame while 1000 compiles of 0 to 2 ms
+// go on in the background
+BENCH(PipelineCompileQueue_Get)
+{
+	const int COUNT = 1000;
+
+	JobSystem jobs;
+	FakeCompiler compiler;
+	Queue queue(&jobs);
+	Queue::Handle fallback = queue.add(makePipeline(-1));
+
+	std::mt19937 random(3);
+	std::vector<Queue::Handle> handles;
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int i = 0; i < COUNT; ++i) handles.push_back(queue.request(compiler.make(i, int(random() % 3)), fallback));
+	double requestMs = Test::elapsedMs(start);
+
+	int frames = 0, fallbacks = 0;
+	double getMs = 0.0;
+	start = Test::Clock::now();
+	while (compiler.compiled < COUNT)
+	{
+		Test::Clock::time_point frameStart = Test::Clock::now();
+		for (Queue::Handle handle : handles) fallbacks += queue.get(handle)->id == -1;
+		getMs += Test::elapsedMs(frameStart);
+		++frames;
+	}
+	double compileMs = Test::elapsedMs(start);
+	queue.waitAll();
+
+	printf("  %d requests: %.2f us each, all compiled in %.0f ms (%d at most at once) over %d frames of %d gets, %.0f ns a get, %.0f%% fallback draws\n",
+		   COUNT, requestMs * 1000.0 / COUNT, compileMs, compiler.maxRunning.load(), frames, COUNT, getMs * 1e6 / (double(frames) * COUNT),
+		   100.0 * fallbacks / (double(frames) * COUNT));
+}
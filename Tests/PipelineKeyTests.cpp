@@ -0,0 +1,207 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "PipelineKey.h"
+#include "Hash.h"
+
+#include <cwchar>
+#include <unordered_map>
+
+namespace
+{
+	const uint64_t ROOT_SIGNATURE = 0x1234;
+
+	// (bytecode of a 4 KB vertex shader and a 2 KB pixel shader)
+	std::vector<uint8_t> makeBytecode(size_t size, uint8_t seed)
+	{
+		std::vector<uint8_t> bytecode(size);
+		for (size_t i = 0; i < size; ++i) bytecode[i] = uint8_t(i * seed + 3);
+		return bytecode;
+	}
+
+	// What Exercise4 creates: one opaque render target with depth, back face culling
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC makeDesc(const D3D12_INPUT_ELEMENT_DESC* layout, UINT count, const std::vector<uint8_t>& vs, const std::vector<uint8_t>& ps)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+		desc.VS = { vs.data(), vs.size() };
+		desc.PS = { ps.data(), ps.size() };
+		desc.InputLayout = { layout, count };
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+		desc.SampleDesc = { 1, 0 };
+		desc.SampleMask = UINT32_MAX;
+		desc.RasterizerState = { D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_BACK, FALSE, 0, 0.0f, 0.0f, TRUE, FALSE, FALSE, 0, D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF };
+
+		for (D3D12_RENDER_TARGET_BLEND_DESC& target : desc.BlendState.RenderTarget)
+			target = { FALSE, FALSE, D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD, D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD, D3D12_LOGIC_OP_NOOP, 0xf };
+
+		const D3D12_DEPTH_STENCILOP_DESC keep = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS };
+		desc.DepthStencilState = { TRUE, D3D12_DEPTH_WRITE_MASK_ALL, D3D12_COMPARISON_FUNC_LESS, FALSE, 0xff, 0xff, keep, keep };
+
+		return desc;
+	}
+}
+
+// Descs that create the same pipeline get the same key: other pointers to the same bytecode and semantics, semantics in
+// another case, and what the runtime ignores (blend and stencil state that is off, formats past NumRenderTargets...)
+TEST(PipelineKey_Normalization)
+{
+	std::vector<uint8_t> vs = makeBytecode(4096, 7), ps = makeBytecode(2048, 13), vsCopy = vs, psCopy = ps;
+
+	char position[] = "POSITION", texCoord[] = "TEXCOORD", positionLower[] = "position", texCoordMixed[] = "TexCoord";
+	const D3D12_INPUT_ELEMENT_DESC layout[] = { { position, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+												{ texCoord, 0, DXGI_FORMAT_R32G32_FLOAT, 0, UINT32_MAX, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+	const D3D12_INPUT_ELEMENT_DESC sameLayout[] = { { positionLower, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 7 }, // (no step rate per vertex)
+													{ texCoordMixed, 0, DXGI_FORMAT_R32G32_FLOAT, 0, UINT32_MAX, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC base = makeDesc(layout, 2, vs, ps);
+	PipelineKey key(base, ROOT_SIGNATURE);
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC same = makeDesc(sameLayout, 2, vsCopy, psCopy);
+	same.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(0xdead); // (the id is what counts)
+	same.RTVFormats[3] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	same.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	same.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_CLEAR;
+	same.BlendState.RenderTarget[2].BlendEnable = TRUE; // (no independent blend)
+	same.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_ZERO;
+	same.DepthStencilState.StencilReadMask = 0x0f;
+	same.CachedPSO = { vs.data(), 16 };
+	CHECK(PipelineKey(same, ROOT_SIGNATURE) == key);
+	CHECK(PipelineKey(same, ROOT_SIGNATURE).getData() == key.getData());
+
+	// Without depth test, the depth function and writes don't matter
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC noDepth = base, otherNoDepth = base;
+	noDepth.DepthStencilState.DepthEnable = FALSE;
+	otherNoDepth.DepthStencilState.DepthEnable = FALSE;
+	otherNoDepth.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	otherNoDepth.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	CHECK(PipelineKey(noDepth, ROOT_SIGNATURE) == PipelineKey(otherNoDepth, ROOT_SIGNATURE) and PipelineKey(noDepth, ROOT_SIGNATURE) != key);
+
+	// With independent blend the other render targets count, only the ones in use
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC twoTargets = base;
+	twoTargets.NumRenderTargets = 2;
+	twoTargets.RTVFormats[1] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	twoTargets.BlendState.IndependentBlendEnable = TRUE;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC secondBlends = twoTargets, unusedBlends = twoTargets;
+	secondBlends.BlendState.RenderTarget[1].BlendEnable = TRUE;
+	unusedBlends.BlendState.RenderTarget[5].BlendEnable = TRUE;
+	CHECK(PipelineKey(twoTargets, ROOT_SIGNATURE) != PipelineKey(secondBlends, ROOT_SIGNATURE));
+	CHECK(PipelineKey(twoTargets, ROOT_SIGNATURE) == PipelineKey(unusedBlends, ROOT_SIGNATURE));
+
+	// Compute: the shader by contents, and never the same key as a graphics desc with that shader
+	D3D12_COMPUTE_PIPELINE_STATE_DESC compute = {};
+	compute.CS = { vs.data(), vs.size() };
+	D3D12_COMPUTE_PIPELINE_STATE_DESC computeCopy = compute;
+	computeCopy.CS.pShaderBytecode = vsCopy.data();
+	computeCopy.CachedPSO = { ps.data(), 4 };
+	CHECK(PipelineKey(compute, ROOT_SIGNATURE) == PipelineKey(computeCopy, ROOT_SIGNATURE));
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC vertexOnly = {};
+	vertexOnly.VS = compute.CS;
+	CHECK(PipelineKey(compute, ROOT_SIGNATURE) != PipelineKey(vertexOnly, ROOT_SIGNATURE));
+}
+
+// Anything that changes the pipeline changes the key, so a map of keys deduplicates only the same pipelines
+TEST(PipelineKey_Dedupe)
+{
+	std::vector<uint8_t> vs = makeBytecode(4096, 7), ps = makeBytecode(2048, 13), vsCopy = vs, psCopy = ps, vsChanged = vs;
+	vsChanged[1000] ^= 1;
+
+	char position[] = "POSITION", texCoord[] = "TEXCOORD";
+	const D3D12_INPUT_ELEMENT_DESC layout[] = { { position, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+												{ texCoord, 0, DXGI_FORMAT_R32G32_FLOAT, 0, UINT32_MAX, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+	D3D12_INPUT_ELEMENT_DESC otherFormat[] = { layout[0], layout[1] }, otherIndex[] = { layout[0], layout[1] }, instanced[] = { layout[0], layout[1] };
+	otherFormat[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	otherIndex[1].SemanticIndex = 1;
+	instanced[1].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA;
+	instanced[1].InstanceDataStepRate = 1;
+	D3D12_INPUT_ELEMENT_DESC otherStepRate[] = { instanced[0], instanced[1] };
+	otherStepRate[1].InstanceDataStepRate = 2;
+
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC base = makeDesc(layout, 2, vs, ps);
+	std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC> variants;
+	auto addVariant = [&](auto&& change) {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = base;
+		change(desc);
+		variants.push_back(desc);
+	};
+
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.VS.pShaderBytecode = vsChanged.data(); });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.VS.BytecodeLength -= 4; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { std::swap(desc.VS, desc.PS); });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.PS = {}; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.NumRenderTargets = 2, desc.RTVFormats[1] = DXGI_FORMAT_R8G8B8A8_UNORM; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.DSVFormat = DXGI_FORMAT_UNKNOWN; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.BlendState.RenderTarget[0].BlendEnable = TRUE; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.BlendState.RenderTarget[0].RenderTargetWriteMask = 0x7; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.BlendState.AlphaToCoverageEnable = TRUE; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.RasterizerState.FrontCounterClockwise = TRUE; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.RasterizerState.DepthBias = 1; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.DepthStencilState.StencilEnable = TRUE; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.InputLayout = { otherFormat, 2 }; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.InputLayout = { otherIndex, 2 }; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.InputLayout = { instanced, 2 }; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.InputLayout = { otherStepRate, 2 }; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.InputLayout = { layout, 1 }; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.SampleDesc.Count = 4; });
+	addVariant([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.SampleMask = 1; });
+
+	PipelineKey key(base, ROOT_SIGNATURE);
+	std::unordered_map<PipelineKey, int, PipelineKey::Hasher> pipelines;
+	pipelines.emplace(key, -1);
+
+	int collisions = 0;
+	for (size_t i = 0; i < variants.size(); ++i)
+	{
+		if (not pipelines.emplace(PipelineKey(variants[i], ROOT_SIGNATURE), int(i)).second) {
+			printf("  variant %zu has the key of another one\n", i);
+			++collisions;
+		}
+	}
+	CHECK(collisions == 0 and pipelines.size() == variants.size() + 1);
+	CHECK(PipelineKey(base, ROOT_SIGNATURE + 1) != key);
+
+	// The same desc built again (other copies of the bytecode) finds the first pipeline
+	auto found = pipelines.find(PipelineKey(makeDesc(layout, 2, vsCopy, psCopy), ROOT_SIGNATURE));
+	CHECK(found != pipelines.end() and found->second == -1);
+
+	// The name in the pipeline library is the hash in hex
+	wchar_t name[17];
+	swprintf(name, 17, L"%016llx", (unsigned long long)key.getHash());
+	CHECK(key.getName().size() == 16 and key.getName() == name);
+	CHECK(hashBytes("a", 1) == 0xaf63dc4c8601ec8cull); // (FNV-1a 64)
+}
+
+// Keys of the desc above (6 KB of bytecode to hash), and finding them in a cache of 1000 pipelines
+BENCH(PipelineKey_Hash)
+{
+	const int KEYS = 20000;
+
+	std::vector<uint8_t> vs = makeBytecode(4096, 7), ps = makeBytecode(2048, 13);
+	char position[] = "POSITION", texCoord[] = "TEXCOORD";
+	const D3D12_INPUT_ELEMENT_DESC layout[] = { { position, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+												{ texCoord, 0, DXGI_FORMAT_R32G32_FLOAT, 0, UINT32_MAX, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = makeDesc(layout, 2, vs, ps);
+
+	uint64_t sum = 0;
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int i = 0; i < KEYS; ++i) sum += PipelineKey(desc, ROOT_SIGNATURE + i).getHash();
+	double keyMs = Test::elapsedMs(start);
+
+	std::unordered_map<PipelineKey, int, PipelineKey::Hasher> pipelines;
+	for (int i = 0; i < 1000; ++i) pipelines.emplace(PipelineKey(desc, i), i);
+
+	start = Test::Clock::now();
+	for (int i = 0; i < KEYS; ++i) sum += pipelines.find(PipelineKey(desc, i % 1000))->second;
+	double findMs = Test::elapsedMs(start);
+
+	Test::keep(sum);
+	printf("  %zu byte keys: %.2f us each, %.2f us to make one and find it in 1000 pipelines\n", PipelineKey(desc, 0).getData().size(), keyMs * 1000.0 / KEYS,
+		   findMs * 1000.0 / KEYS);
+}
@@ -0,0 +1,163 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "RingAllocator.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	struct Range
+	{
+		size_t offset, size;
+		uint64_t fenceValue;
+	};
+
+	bool overlaps(const std::vector<Range>& live, size_t offset, size_t size)
+	{
+		for (const Range& range : live)
+			if (offset < range.offset + range.size and range.offset < offset + size) return true;
+
+		return false;
+	}
+}
+
+TEST(RingAllocator_Alignment)
+{
+	RingAllocator ring(1024);
+
+	CHECK(ring.allocate(100, 256) == 0);
+	CHECK(ring.allocate(100, 256) == 256);
+	CHECK(ring.allocate(1, 4) == 356);
+	CHECK(ring.getUsedSize() == 357);
+
+	CHECK(ring.allocate(0, 4) == RingAllocator::INVALID_OFFSET);
+	CHECK(ring.allocate(2048, 4) == RingAllocator::INVALID_OFFSET);
+}
+
+TEST(RingAllocator_WrapAround)
+{
+	RingAllocator ring(1024);
+
+	CHECK(ring.allocate(100, 256) == 0);
+	CHECK(ring.allocate(100, 256) == 256);
+	ring.finishBatch(1);
+
+	CHECK(ring.allocate(600, 256) == RingAllocator::INVALID_OFFSET); // (512 + 600 doesn't fit and [0, tail) is in use)
+	CHECK(ring.allocate(500, 256) == 512);
+	ring.finishBatch(2);
+
+	ring.release(1);
+	CHECK(ring.hasBatchesInFlight() and ring.getOldestFenceValue() == 2);
+
+	// [0, 356) is free again: the next allocation wraps and the end of the ring is wasted until batch 3 is released
+	CHECK(ring.allocate(300, 256) == 0);
+	CHECK(ring.getUsedSize() == 1024 - 356 + 300);
+	ring.finishBatch(3);
+
+	CHECK(ring.allocate(100, 4) == RingAllocator::INVALID_OFFSET); // (only [300, 356) is free)
+
+	ring.release(3);
+	CHECK(not ring.hasBatchesInFlight() and ring.getUsedSize() == 0);
+	CHECK(ring.allocate(1024, 256) == 0); // (empty: starts again from 0)
+}
+
+TEST(RingAllocator_ReleaseInFenceOrder)
+{
+	RingAllocator ring(4096);
+
+	for (uint64_t fence = 1; fence <= 4; ++fence)
+	{
+		CHECK(ring.allocate(1000, 16) != RingAllocator::INVALID_OFFSET);
+		ring.finishBatch(fence);
+	}
+
+	ring.finishBatch(5); // (nothing allocated: no batch)
+	CHECK(ring.allocate(1000, 16) == RingAllocator::INVALID_OFFSET);
+
+	ring.release(2);
+	CHECK(ring.getOldestFenceValue() == 3);
+	CHECK(ring.allocate(1000, 16) != RingAllocator::INVALID_OFFSET);
+
+	ring.release(100);
+	ring.finishBatch(6);
+	ring.release(6);
+	CHECK(ring.getUsedSize() == 0);
+}
+
+// Frames against a simulated GPU that completes them FRAMES_IN_FLIGHT late: allocations never overlap the ones still in
+// flight, stay inside the ring and keep their alignment
+TEST(RingAllocator_SimulatedFence)
+{
+	const size_t CAPACITY = 64 * 1024;
+
+	RingAllocator ring(CAPACITY);
+	std::vector<Range> live;
+	std::mt19937 random(1);
+
+	uint64_t fence = 0, completed = 0;
+	int failed = 0, allocated = 0;
+
+	for (int frame = 0; frame < 2000; ++frame)
+	{
+		int count = 1 + random() % 20;
+		for (int i = 0; i < count; ++i)
+		{
+			size_t size = 1 + random() % 1000;
+			size_t alignment = size_t(1) << (random() % 9);
+
+			size_t offset = ring.allocate(size, alignment);
+			if (offset == RingAllocator::INVALID_OFFSET) {
+				++failed;
+				continue;
+			}
+
+			CHECK(offset % alignment == 0);
+			CHECK(offset + size <= CAPACITY);
+			CHECK(not overlaps(live, offset, size));
+
+			live.push_back({ offset, size, fence + 1 });
+			++allocated;
+		}
+
+		ring.finishBatch(++fence);
+
+		completed = fence > FRAMES_IN_FLIGHT ? fence - FRAMES_IN_FLIGHT : 0;
+		ring.release(completed);
+		live.erase(std::remove_if(live.begin(), live.end(), [completed](const Range& range) { return range.fenceValue <= completed; }), live.end());
+
+		CHECK(ring.getUsedSize() <= CAPACITY);
+	}
+
+	ring.release(fence);
+	CHECK(ring.getUsedSize() == 0);
+	CHECK(allocated > failed * 10); // (most of them fit: it's recycling)
+}
+
+BENCH(RingAllocator_Allocate)
+{
+	const int COUNT = 10000000;
+
+	RingAllocator ring(UPLOAD_RING_SIZE);
+	uint64_t fence = 0;
+	size_t sum = 0;
+
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int i = 0; i < COUNT; ++i)
+	{
+		size_t offset = ring.allocate(64 + (size_t(i) * 7919) % 4096, 256);
+		if (offset == RingAllocator::INVALID_OFFSET) {
+			ring.finishBatch(++fence);
+			ring.release(fence);
+			offset = ring.allocate(64 + (size_t(i) * 7919) % 4096, 256);
+		}
+
+		sum += offset;
+		if (i % 1000 == 999) ring.finishBatch(++fence), ring.release(fence > FRAMES_IN_FLIGHT ? fence - FRAMES_IN_FLIGHT : 0);
+	}
+	double ms = Test::elapsedMs(start);
+
+	Test::keep(sum);
+	printf("  %d allocations in %.1f ms (%.1f ns each)\n", COUNT, ms, ms * 1e6 / COUNT);
+}
@@ -0,0 +1,225 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "RootSignatureDesc.h"
+
+#include <unordered_map>
+
+namespace
+{
+	typedef std::unordered_map<std::vector<uint8_t>, int, RootSignatureDesc::KeyHasher> Registry;
+
+	D3D12_STATIC_SAMPLER_DESC makeSampler(UINT shaderRegister, D3D12_FILTER filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR)
+	{
+		return { filter, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0.0f, 0, D3D12_COMPARISON_FUNC_NEVER,
+				 D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK, 0.0f, 1000.0f, shaderRegister, 0, D3D12_SHADER_VISIBILITY_PIXEL };
+	}
+
+	// What Exercise4 created as 1.0 before the bindless root signature: MVP constants, a texture and a sampler table for
+	// the pixel shader, two static samplers (and a root UAV, so every kind of parameter is there)
+	struct Exercise4Desc
+	{
+		D3D12_DESCRIPTOR_RANGE srv = { D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND };
+		D3D12_DESCRIPTOR_RANGE samplers = { D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND };
+		D3D12_ROOT_PARAMETER parameters[4] = {};
+		D3D12_STATIC_SAMPLER_DESC staticSamplers[2] = { makeSampler(0), makeSampler(1) };
+		D3D12_ROOT_SIGNATURE_DESC desc = { 4, parameters, 2, staticSamplers, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT };
+
+		Exercise4Desc()
+		{
+			parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+			parameters[0].Constants = { 0, 0, 16 };
+			parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			parameters[1].DescriptorTable = { 1, &srv };
+			parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+			parameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			parameters[2].DescriptorTable = { 1, &samplers };
+			parameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+			parameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+			parameters[3].Descriptor = { 0, 0 };
+		}
+
+		Exercise4Desc(const Exercise4Desc&) = delete; // (the desc points into it)
+	};
+
+	// The same root signature written as 1.1 another way: offsets and flags written out (the root UAV left to its default),
+	// static samplers in another order, with fields their filter and address modes never read
+	struct Exercise4Desc1
+	{
+		D3D12_DESCRIPTOR_RANGE1 srv = { D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, 0 };
+		D3D12_DESCRIPTOR_RANGE1 samplers = { D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE, 0 };
+		D3D12_ROOT_PARAMETER1 parameters[4] = {};
+		D3D12_STATIC_SAMPLER_DESC staticSamplers[2] = { makeSampler(1), makeSampler(0) };
+		D3D12_ROOT_SIGNATURE_DESC1 desc = { 4, parameters, 2, staticSamplers, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT };
+
+		Exercise4Desc1()
+		{
+			parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+			parameters[0].Constants = { 0, 0, 16 };
+			parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			parameters[1].DescriptorTable = { 1, &srv };
+			parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+			parameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			parameters[2].DescriptorTable = { 1, &samplers };
+			parameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+			parameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+			parameters[3].Descriptor = { 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE };
+
+			staticSamplers[0].MaxAnisotropy = 16;
+			staticSamplers[0].ComparisonFunc = D3D12_COMPARISON_FUNC_LESS;
+			staticSamplers[0].BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE;
+			staticSamplers[0].MipLODBias = -0.0f;
+		}
+
+		Exercise4Desc1(const Exercise4Desc1&) = delete;
+	};
+
+	const D3D12_DESCRIPTOR_RANGE1& getRange(const RootSignatureDesc& desc, UINT parameter, UINT range = 0)
+	{
+		return desc.getDesc().Desc_1_1.pParameters[parameter].DescriptorTable.pDescriptorRanges[range];
+	}
+}
+
+// 1.0 descs come out as 1.1 with the flags 1.0 implies (or the static ones when asked for), appended offsets resolved
+TEST(RootSignatureDesc_Upgrade)
+{
+	Exercise4Desc source;
+
+	RootSignatureDesc desc(source.desc);
+	const D3D12_ROOT_SIGNATURE_DESC1& desc11 = desc.getDesc().Desc_1_1;
+	CHECK(desc.getDesc().Version == D3D_ROOT_SIGNATURE_VERSION_1_1 and desc11.NumParameters == 4 and desc11.NumStaticSamplers == 2);
+	CHECK(desc11.Flags == D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	CHECK(desc11.pParameters[0].Constants.Num32BitValues == 16 and desc11.pParameters[1].ShaderVisibility == D3D12_SHADER_VISIBILITY_PIXEL);
+	CHECK(getRange(desc, 1).Flags == (D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE));
+	CHECK(getRange(desc, 1).OffsetInDescriptorsFromTableStart == 0);
+	CHECK(getRange(desc, 2).Flags == D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE); // (samplers have no data flags)
+	CHECK(desc11.pParameters[3].Descriptor.Flags == D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE);
+
+	// Static: not the same root signature, UAV data stays volatile
+	RootSignatureDesc staticDesc(source.desc, RootSignatureDesc::UPGRADE_STATIC);
+	CHECK(staticDesc != desc);
+	CHECK(getRange(staticDesc, 1).Flags == D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+	CHECK(getRange(staticDesc, 2).Flags == D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
+	CHECK(staticDesc.getDesc().Desc_1_1.pParameters[3].Descriptor.Flags == D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE);
+
+	// (unbounded ranges stay volatile: bindless tables get written while in use)
+	source.srv.NumDescriptors = UINT_MAX;
+	RootSignatureDesc unbounded(source.desc, RootSignatureDesc::UPGRADE_STATIC);
+	CHECK(getRange(unbounded, 1).Flags == (D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE));
+	source.srv.NumDescriptors = 1;
+
+	// Down to 1.0 for devices without 1.1: the flags dropped, the rest as it was
+	std::vector<D3D12_ROOT_PARAMETER> parameters;
+	std::vector<D3D12_DESCRIPTOR_RANGE> ranges;
+	D3D12_ROOT_SIGNATURE_DESC desc10 = staticDesc.getDesc_1_0(parameters, ranges);
+	CHECK(desc10.NumParameters == 4 and desc10.NumStaticSamplers == 2 and desc10.Flags == source.desc.Flags);
+	CHECK(desc10.pParameters[0].Constants.Num32BitValues == 16 and desc10.pParameters[1].DescriptorTable.NumDescriptorRanges == 1);
+	CHECK(desc10.pParameters[2].DescriptorTable.pDescriptorRanges[0].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER);
+	CHECK(desc10.pParameters[2].DescriptorTable.pDescriptorRanges[0].NumDescriptors == 4);
+	CHECK(RootSignatureDesc(desc10) == desc);
+}
+
+// Descs that create the same root signature share a key, whatever version, sampler order or offset style they were
+// written with, and what the runtime does read keeps them apart
+TEST(RootSignatureDesc_Canonical)
+{
+	Exercise4Desc source;
+	Exercise4Desc1 source1;
+
+	RootSignatureDesc desc(source.desc), desc1(source1.desc);
+	CHECK(desc == desc1 and desc.getHash() == desc1.getHash());
+	CHECK(desc1.getDesc().Desc_1_1.pStaticSamplers[0].ShaderRegister == 0 and desc1.getDesc().Desc_1_1.pStaticSamplers[1].ShaderRegister == 1);
+
+	D3D12_STATIC_SAMPLER_DESC& sampler = source1.staticSamplers[0];
+	sampler.Filter = D3D12_FILTER_ANISOTROPIC; // (now MaxAnisotropy is read)
+	CHECK(RootSignatureDesc(source1.desc) != desc);
+	sampler.Filter = D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR; // (ComparisonFunc)
+	CHECK(RootSignatureDesc(source1.desc) != desc);
+	sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER; // (BorderColor)
+	CHECK(RootSignatureDesc(source1.desc) != desc);
+	sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	CHECK(RootSignatureDesc(source1.desc) == desc);
+
+	source1.parameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	CHECK(RootSignatureDesc(source1.desc) != desc);
+	source1.parameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	source1.parameters[3].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC;
+	CHECK(RootSignatureDesc(source1.desc) != desc);
+	source1.parameters[3].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE; // (the default of UAVs, written out)
+	CHECK(RootSignatureDesc(source1.desc) == desc);
+
+	// Appended ranges after others at the offsets written out, and the default data flags written out
+	D3D12_DESCRIPTOR_RANGE1 appended[3] = { { D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
+											{ D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
+											{ D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 3, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, 10 } };
+	D3D12_DESCRIPTOR_RANGE1 explicitRanges[3] = { appended[0], appended[1], appended[2] };
+	explicitRanges[0].OffsetInDescriptorsFromTableStart = 0;
+	explicitRanges[1].OffsetInDescriptorsFromTableStart = 2;
+	explicitRanges[0].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+	explicitRanges[2].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+
+	D3D12_ROOT_PARAMETER1 table = {};
+	table.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	table.DescriptorTable = { 3, appended };
+	D3D12_ROOT_SIGNATURE_DESC1 tableDesc = { 1, &table, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE };
+
+	RootSignatureDesc appendedDesc(tableDesc);
+	table.DescriptorTable = { 3, explicitRanges };
+	CHECK(RootSignatureDesc(tableDesc) == appendedDesc);
+	CHECK(getRange(appendedDesc, 0, 1).OffsetInDescriptorsFromTableStart == 2 and getRange(appendedDesc, 0, 2).OffsetInDescriptorsFromTableStart == 10);
+	explicitRanges[2].OffsetInDescriptorsFromTableStart = 3;
+	CHECK(RootSignatureDesc(tableDesc) != appendedDesc);
+
+	// Empty ones
+	D3D12_ROOT_SIGNATURE_DESC empty = { 0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT };
+	D3D12_ROOT_SIGNATURE_DESC1 empty1 = { 0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT };
+	CHECK(RootSignatureDesc(empty) == RootSignatureDesc(empty1) and RootSignatureDesc(empty) != desc);
+}
+
+// What ModulePipelines does with the keys: the passes asking for the same root signature get one
+TEST(RootSignatureDesc_Dedupe)
+{
+	Exercise4Desc source;
+	Exercise4Desc1 source1;
+
+	Registry registry;
+	CHECK(registry.emplace(RootSignatureDesc(source.desc).getKey(), 1).second);
+	CHECK(not registry.emplace(RootSignatureDesc(source1.desc).getKey(), 2).second);
+	CHECK(registry.emplace(RootSignatureDesc(source.desc, RootSignatureDesc::UPGRADE_STATIC).getKey(), 3).second);
+	CHECK(registry.size() == 2 and registry.at(RootSignatureDesc(source1.desc).getKey()) == 1);
+
+	// Moved, in a vector that grows: the desc still points to its own arrays
+	std::vector<RootSignatureDesc> descs;
+	for (int i = 0; i < 20; ++i) descs.emplace_back(source.desc);
+
+	int wrong = 0;
+	for (const RootSignatureDesc& desc : descs)
+		if (getRange(desc, 2).NumDescriptors != 4 or registry.at(desc.getKey()) != 1) ++wrong;
+	CHECK(wrong == 0);
+
+	RootSignatureDesc moved(std::move(descs[0]));
+	CHECK(getRange(moved, 1).RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SRV and moved == RootSignatureDesc(source1.desc));
+}
+
+// What a pass pays to get its root signature: canonicalizing and keying the desc, and the lookup
+BENCH(RootSignatureDesc_Key)
+{
+	const int COUNT = 100000;
+
+	Exercise4Desc source;
+	Registry registry;
+	registry.emplace(RootSignatureDesc(source.desc).getKey(), 1);
+
+	int found = 0;
+	Test::Clock::time_point start = Test::Clock::now();
+	for (int i = 0; i < COUNT; ++i)
+	{
+		RootSignatureDesc desc(source.desc, RootSignatureDesc::Upgrade(i & 1));
+		found += registry.count(desc.getKey()) != 0;
+	}
+	double ms = Test::elapsedMs(start);
+
+	Test::keep(found);
+	printf("  %d descs: %.0f ns each (canonical desc, key and lookup), %zu byte keys\n", COUNT, ms * 1e6 / COUNT, RootSignatureDesc(source.desc).getKey().size());
+}
@@ -0,0 +1,287 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace
+{
+	// Perspective (0.8 rad vertical, far 300) turned by yaw around Y
+	void setFrustum(FrustumCuller& culler, float yaw, const float camera[3])
+	{
+		const float zNear = 0.1f, zFar = 300.0f, scale = 1.0f / std::tan(0.4f);
+		const float projection[16] = { scale, 0.0f, 0.0f, 0.0f, 0.0f, scale, 0.0f, 0.0f, 0.0f, 0.0f, zFar / (zNear - zFar), -1.0f, 0.0f, 0.0f, zNear * zFar / (zNear - zFar), 0.0f };
+		const float c = std::cos(yaw), s = std::sin(yaw);
+		const float view[16] = { c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+		float viewProjection[16] = {};
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				for (int k = 0; k < 4; ++k) viewProjection[i * 4 + j] += view[i * 4 + k] * projection[k * 4 + j];
+
+		FrustumCuller::Plane planes[FrustumCuller::PLANE_COUNT];
+		FrustumCuller::extractPlanes(viewProjection, planes);
+		culler.setFrustum(planes, camera);
+	}
+
+	std::vector<SceneBVH::Bounds> makeBounds(size_t count, std::mt19937& random, float spread)
+	{
+		std::uniform_real_distribution<float> position(-spread, spread), extent(0.1f, 2.0f);
+
+		std::vector<SceneBVH::Bounds> bounds(count);
+		for (SceneBVH::Bounds& b : bounds)
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float center = position(random), e = extent(random);
+				b.min[axis] = center - e;
+				b.max[axis] = center + e;
+			}
+		return bounds;
+	}
+
+	// Brute force: every AABB through the flat SIMD culler
+	std::vector<uint32_t> cullAll(const FrustumCuller& culler, const std::vector<SceneBVH::Bounds>& bounds)
+	{
+		FrustumCuller::Boxes boxes;
+		for (const SceneBVH::Bounds& b : bounds) boxes.add(b.min, b.max);
+
+		std::vector<uint32_t> visible(bounds.size());
+		visible.resize(culler.cull(boxes, visible.data()));
+		return visible;
+	}
+
+	// Slab test: where the ray enters the AABB (0 if it starts inside), -1 if it misses it before maxDistance
+	float getEnterDistance(const float origin[3], const float direction[3], const SceneBVH::Bounds& bounds, float maxDistance)
+	{
+		float enter = 0.0f, exit = maxDistance;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float inverse = 1.0f / (std::fabs(direction[axis]) > 1e-30f ? direction[axis] : 1e-30f);
+			float near = (bounds.min[axis] - origin[axis]) * inverse, far = (bounds.max[axis] - origin[axis]) * inverse;
+			if (near > far) std::swap(near, far);
+			enter = std::max(enter, near);
+			exit = std::min(exit, far);
+		}
+		return enter <= exit ? enter : -1.0f;
+	}
+
+	float pickAll(const float origin[3], const float direction[3], const std::vector<SceneBVH::Bounds>& bounds, float maxDistance, bool& hit)
+	{
+		float closest = maxDistance;
+		hit = false;
+		for (const SceneBVH::Bounds& b : bounds)
+		{
+			float distance = getEnterDistance(origin, direction, b, closest);
+			if (distance >= 0.0f and (not hit or distance < closest)) {
+				closest = distance;
+				hit = true;
+			}
+		}
+		return closest;
+	}
+
+	// Cull from 8 directions and 200 rays (some along the axes) against brute force, returns the mismatches
+	int compare(const SceneBVH& bvh, const std::vector<SceneBVH::Bounds>& bounds, std::mt19937& random)
+	{
+		int mismatches = 0;
+
+		size_t nodes = 0;
+		bvh.visit(INT32_MAX, [&nodes](const SceneBVH::Node&, int) { ++nodes; });
+		if (nodes != bvh.getNodeCount() or (not bounds.empty() and nodes > 2 * bounds.size() - 1)) ++mismatches;
+
+		const float camera[3] = { 3.0f, 1.0f, -7.0f };
+		for (int i = 0; i < 8; ++i)
+		{
+			FrustumCuller culler;
+			setFrustum(culler, i * 0.8f, camera);
+
+			std::vector<uint32_t> visible;
+			bvh.cull(culler, visible);
+			std::sort(visible.begin(), visible.end());
+			if (visible != cullAll(culler, bounds)) ++mismatches; // (duplicates included)
+		}
+
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		for (int i = 0; i < 200; ++i)
+		{
+			float origin[3] = { normal(random) * 5.0f, normal(random) * 5.0f, normal(random) * 5.0f }, direction[3] = { normal(random), normal(random), normal(random) };
+			if (i % 10 == 0) direction[1] = 0.0f;
+			if (i % 17 == 0) direction[0] = direction[2] = 0.0f;
+
+			float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+			for (float& d : direction) d /= length;
+
+			uint32_t object = 0;
+			float distance = 0.0f;
+			bool hit = bvh.pick(origin, direction, 1000.0f, object, distance), expectedHit = false;
+			float expected = pickAll(origin, direction, bounds, 1000.0f, expectedHit);
+
+			if (hit != expectedHit or (hit and (distance != expected or getEnterDistance(origin, direction, bounds[object], 1000.0f) != expected))) ++mismatches;
+		}
+
+		return mismatches;
+	}
+
+	void moveBounds(std::vector<SceneBVH::Bounds>& bounds, float offset)
+	{
+		for (SceneBVH::Bounds& b : bounds)
+			for (int axis = 0; axis < 3; ++axis) {
+				b.min[axis] += offset;
+				b.max[axis] += offset;
+			}
+	}
+}
+
+// Cull and pick give what testing every object gives, after a build (serial and in jobs, with 1000 identical boxes that
+// can't be split by SAH) and after a refit
+TEST(SceneBVH_BruteForce)
+{
+	std::mt19937 random(3);
+	JobSystem jobs(3);
+
+	for (size_t count : { 0, 1, 2, 7, 9, 100, 5000, 20000 })
+	{
+		std::vector<SceneBVH::Bounds> bounds = makeBounds(count, random, 40.0f);
+		if (count == 5000) std::fill(bounds.begin(), bounds.begin() + 1000, bounds[0]);
+
+		SceneBVH bvh;
+		bvh.build(bounds.data(), count, count > 100 ? &jobs : nullptr);
+		CHECK(bvh.getObjectCount() == count);
+		CHECK(compare(bvh, bounds, random) == 0);
+
+		moveBounds(bounds, 0.5f);
+		bvh.update(bounds, &jobs);
+		CHECK(not bvh.isRebuilding() and compare(bvh, bounds, random) == 0);
+	}
+}
+
+// Every object moving to a new random place over 50 frames: the refits get worse than REBUILD_RATIO, a background rebuild
+// is swapped in, and the results stay right all along
+TEST(SceneBVH_Rebuild)
+{
+	const size_t COUNT = 20000;
+
+	std::mt19937 random(5);
+	JobSystem jobs(3);
+
+	std::vector<SceneBVH::Bounds> start = makeBounds(COUNT, random, 40.0f), target = makeBounds(COUNT, random, 40.0f);
+	SceneBVH bvh;
+	bvh.update(start, &jobs);
+
+	bool rebuilt = false;
+	float worstRatio = 1.0f;
+	int mismatches = 0;
+
+	for (int frame = 0; frame < 400; ++frame)
+	{
+		float t = std::min(1.0f, frame / 50.0f);
+		std::vector<SceneBVH::Bounds> bounds = start;
+		for (size_t i = 0; i < COUNT; ++i)
+			for (int axis = 0; axis < 3; ++axis) {
+				bounds[i].min[axis] += (target[i].min[axis] - start[i].min[axis]) * t;
+				bounds[i].max[axis] += (target[i].max[axis] - start[i].max[axis]) * t;
+			}
+
+		bool rebuilding = bvh.isRebuilding();
+		bvh.update(bounds, &jobs);
+		worstRatio = std::max(worstRatio, bvh.getCostRatio());
+		if (rebuilding and not bvh.isRebuilding()) rebuilt = true;
+
+		if (frame % 20 == 0) mismatches += compare(bvh, bounds, random);
+		if (frame > 60 and rebuilt and not bvh.isRebuilding()) break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(2)); // (a frame)
+	}
+
+	CHECK(mismatches == 0);
+	CHECK(rebuilt and worstRatio > 1.3f and bvh.getCostRatio() <= 1.3f);
+}
+
+// Build (serial and in jobs) and refit at 10k, 100k and 1M objects, against going once over the bounds; then cull and pick
+// 1M objects against culling every AABB (SIMD) and a ray against every AABB
+BENCH(SceneBVH_Build)
+{
+	std::mt19937 random(3);
+	JobSystem jobs;
+
+	auto best = [](int runs, auto&& function) {
+		double best = 1e30;
+		for (int run = 0; run < runs; ++run)
+		{
+			Test::Clock::time_point start = Test::Clock::now();
+			function();
+			best = std::min(best, Test::elapsedMs(start));
+		}
+		return best;
+	};
+
+	std::vector<SceneBVH::Bounds> bounds;
+	SceneBVH bvh;
+
+	for (size_t count : { 10000, 100000, 1000000 })
+	{
+		bounds = makeBounds(count, random, 500.0f);
+
+		double serial = best(3, [&]() { bvh.build(bounds.data(), count, nullptr); });
+		double parallel = best(3, [&]() { bvh.build(bounds.data(), count, &jobs); });
+		double refit = best(10, [&]() { bvh.refit(bounds.data()); });
+
+		float sum = 0.0f;
+		double loop = best(10, [&]() {
+			for (const SceneBVH::Bounds& b : bounds) sum += b.max[0] - b.min[0];
+		});
+		Test::keep(sum);
+
+		printf("  %7zu objects: build %7.2f ms (%7.2f ms in %u threads), refit %6.3f ms, loop over the bounds %6.3f ms, %zu nodes\n", count, serial,
+			   parallel, jobs.getThreadCount(), refit, loop, bvh.getNodeCount());
+	}
+
+	const float camera[3] = { 0.0f, 0.0f, 0.0f };
+	FrustumCuller culler;
+	setFrustum(culler, 0.3f, camera);
+
+	std::vector<uint32_t> visible;
+	visible.reserve(bounds.size());
+	double bvhCull = best(10, [&]() {
+		visible.clear();
+		bvh.cull(culler, visible);
+	});
+
+	FrustumCuller::Boxes boxes;
+	for (const SceneBVH::Bounds& b : bounds) boxes.add(b.min, b.max);
+	std::vector<uint32_t> flatVisible(bounds.size());
+	size_t flatCount = 0;
+	double flatCull = best(10, [&]() { flatCount = culler.cull(boxes, flatVisible.data()); });
+
+	printf("  cull: BVH %.2f ms, every AABB (SIMD) %.2f ms (%zu / %zu visible)\n", bvhCull, flatCull, visible.size(), flatCount);
+
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	double bvhPick = 0.0, loopPick = 0.0;
+	int hits = 0, loopHits = 0;
+	const int RAYS = 20;
+
+	for (int i = 0; i < RAYS; ++i)
+	{
+		float origin[3] = { 0.0f, 0.0f, 0.0f }, direction[3] = { normal(random), normal(random), normal(random) };
+		float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		for (float& d : direction) d /= length;
+
+		uint32_t object;
+		float distance;
+		Test::Clock::time_point start = Test::Clock::now();
+		hits += bvh.pick(origin, direction, 5000.0f, object, distance);
+		bvhPick += Test::elapsedMs(start);
+
+		bool hit;
+		start = Test::Clock::now();
+		pickAll(origin, direction, bounds, 5000.0f, hit);
+		loopPick += Test::elapsedMs(start);
+		loopHits += hit;
+	}
+
+	printf("  pick: BVH %.4f ms, every AABB %.2f ms (%d / %d hits)\n", bvhPick / RAYS, loopPick / RAYS, hits, loopHits);
+}
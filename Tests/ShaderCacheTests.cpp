@@ -0,0 +1,247 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "ShaderCache.h"
+#include "FileUtils.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	// Compiler that takes latencyMs and fails on sources with "error": the blob is the profile, entry, defines and source,
+	// so a stale blob would show
+	struct FakeCompiler
+	{
+		std::atomic<int> compiles = 0;
+		int latencyMs = 0;
+
+		ShaderCache::Compiler get()
+		{
+			return [this](const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) {
+				++compiles;
+				std::this_thread::sleep_for(std::chrono::milliseconds(latencyMs));
+				if (source.find("error") != std::string::npos) {
+					errors = "syntax error";
+					return false;
+				}
+
+				std::string text = desc.profile + "|" + desc.entry + "|";
+				for (const ShaderCache::Define& define : desc.defines) text += define.name + "=" + define.value + ";";
+				text += source;
+				blob.assign(text.begin(), text.end());
+				return true;
+			};
+		}
+	};
+
+	// Empty Shaders/ and Cache/ directories
+	std::filesystem::path getTestDirectory()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "EngineTests" / "ShaderCache";
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+		std::filesystem::create_directories(directory / "Shaders" / "Common", error);
+		return directory;
+	}
+
+	void writeText(const std::filesystem::path& path, const std::string& text)
+	{
+		FileUtils::writeFile(path, std::vector<uint8_t>(text.begin(), text.end()));
+	}
+
+	// A_VS includes Common.hlsli, that includes Common/Inner.hlsli (and itself); B_PS has a missing include in a comment
+	void writeShaders(const std::filesystem::path& directory)
+	{
+		writeText(directory / "Shaders" / "Common" / "Inner.hlsli", "float inner;\n");
+		writeText(directory / "Shaders" / "Common.hlsli", "#include \"Common/Inner.hlsli\"\n#  include   \"Common.hlsli\"\nfloat common;\n");
+		writeText(directory / "Shaders" / "A_VS.hlsl", "#include \"Common.hlsli\"\nvoid main() {}\n");
+		writeText(directory / "Shaders" / "B_PS.hlsl", "// #include \"Missing.hlsli\" in a comment\nvoid main() {}\n");
+	}
+
+	ShaderCache::Desc makeDesc(const std::filesystem::path& directory, const char* file, const char* profile)
+	{
+		ShaderCache::Desc desc;
+		desc.path = directory / "Shaders" / file;
+		desc.profile = profile;
+		return desc;
+	}
+}
+
+// A shader is compiled once and shared, and compiled again when anything of its key changes: profile, entry point,
+// defines (in any order), compiler id, or a file it includes
+TEST(ShaderCache_Keys)
+{
+	std::filesystem::path directory = getTestDirectory(), cacheDirectory = directory / "Cache";
+	writeShaders(directory);
+	FakeCompiler compiler;
+
+	ShaderCache cache(cacheDirectory, compiler.get(), 1);
+	ShaderCache::Blob a = cache.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0"));
+	CHECK(a and a == cache.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0")) and compiler.compiles == 1);
+
+	std::string errors;
+	std::vector<std::filesystem::path> files;
+	CHECK(cache.get(makeDesc(directory, "B_PS.hlsl", "ps_6_0"), &errors, &files) and compiler.compiles == 2);
+	CHECK(files.size() == 2); // (the include in the comment too: at worst a file too many)
+	CHECK(not cache.get(makeDesc(directory, "Missing.hlsl", "ps_6_0"), &errors) and errors == "source not found");
+
+	ShaderCache::Stats stats = cache.getStats();
+	CHECK(stats.requests == 4 and stats.shared == 1 and stats.compiled == 2 and stats.failed == 1 and stats.loaded == 0);
+
+	cache.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0"), nullptr, &files);
+	CHECK(files.size() == 3); // (the source and both includes, once)
+
+	ShaderCache::Desc desc = makeDesc(directory, "A_VS.hlsl", "vs_6_1");
+	cache.get(desc);
+	CHECK(compiler.compiles == 3);
+	desc.entry = "other";
+	cache.get(desc);
+	CHECK(compiler.compiles == 4);
+	desc.defines = { { "X", "1" }, { "Y", "2" } };
+	cache.get(desc);
+	CHECK(compiler.compiles == 5);
+	desc.defines = { { "Y", "2" }, { "X", "1" } };
+	cache.get(desc);
+	CHECK(compiler.compiles == 5);
+	desc.defines = { { "Y", "3" }, { "X", "1" } };
+	cache.get(desc);
+	CHECK(compiler.compiles == 6);
+
+	ShaderCache otherCompiler(cacheDirectory, compiler.get(), 2);
+	otherCompiler.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0"));
+	CHECK(compiler.compiles == 7);
+
+	writeText(directory / "Shaders" / "Common" / "Inner.hlsli", "float inner2;\n");
+	ShaderCache changed(cacheDirectory, compiler.get(), 1);
+	changed.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0"));
+	CHECK(compiler.compiles == 8 and changed.getStats().loaded == 0);
+
+	// (back as it was: the first blob is still in the directory)
+	writeText(directory / "Shaders" / "Common" / "Inner.hlsli", "float inner;\n");
+	ShaderCache back(cacheDirectory, compiler.get(), 1);
+	back.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0"));
+	CHECK(compiler.compiles == 8 and back.getStats().loaded == 1);
+}
+
+// The next run loads the blobs instead of compiling, embedded sources included; failed compiles and damaged files in the
+// directory are not used
+TEST(ShaderCache_Disk)
+{
+	std::filesystem::path directory = getTestDirectory(), cacheDirectory = directory / "Cache";
+	writeShaders(directory);
+	FakeCompiler compiler;
+
+	{
+		ShaderCache cache(cacheDirectory, compiler.get(), 1);
+		CHECK(cache.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0")) and cache.get(makeDesc(directory, "B_PS.hlsl", "ps_6_0")));
+	}
+	{
+		ShaderCache cache(cacheDirectory, compiler.get(), 1);
+		CHECK(cache.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0")) and cache.get(makeDesc(directory, "B_PS.hlsl", "ps_6_0")));
+		CHECK(compiler.compiles == 2 and cache.getStats().loaded == 2);
+	}
+
+	// Failed compiles aren't kept: the fixed source compiles
+	{
+		ShaderCache cache(cacheDirectory, compiler.get(), 1);
+		writeText(directory / "Shaders" / "C_CS.hlsl", "error\n");
+		std::string errors;
+		CHECK(not cache.get(makeDesc(directory, "C_CS.hlsl", "cs_6_0"), &errors) and errors == "syntax error");
+		writeText(directory / "Shaders" / "C_CS.hlsl", "void main() {}\n");
+		CHECK(cache.get(makeDesc(directory, "C_CS.hlsl", "cs_6_0")));
+	}
+
+	// Cut short or with a byte flipped: compiled again
+	int damaged = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(cacheDirectory))
+	{
+		std::vector<uint8_t> data;
+		FileUtils::readFile(entry.path(), data);
+		if (damaged++ % 2 == 0) data.back() ^= 0x55;
+		else data.resize(data.size() - 3);
+		FileUtils::writeFile(entry.path(), data);
+	}
+	CHECK(damaged == 3);
+	{
+		int compiles = compiler.compiles;
+		ShaderCache cache(cacheDirectory, compiler.get(), 1);
+		ShaderCache::Blob a = cache.get(makeDesc(directory, "A_VS.hlsl", "vs_6_0"));
+		CHECK(a and compiler.compiles == compiles + 1 and cache.getStats().loaded == 0);
+		CHECK(std::string(a->begin(), a->end()) == "vs_6_0|main|#include \"Common.hlsli\"\nvoid main() {}\n");
+	}
+
+	// Embedded sources
+	static const char SOURCE[] = "float4 main() : SV_TARGET { return 1; }";
+	ShaderCache::Desc embedded;
+	embedded.path = "Embedded";
+	embedded.source = SOURCE;
+	embedded.profile = "ps_5_0";
+	{
+		ShaderCache cache(cacheDirectory, compiler.get(), 1);
+		ShaderCache::Blob blob = cache.get(embedded);
+		CHECK(blob and blob == cache.get(embedded));
+	}
+	{
+		ShaderCache cache(cacheDirectory, compiler.get(), 1);
+		CHECK(cache.get(embedded) and cache.getStats().loaded == 1);
+	}
+}
+
+// 8 threads asking for the same 2 shaders at once: each is compiled once, the others wait for it
+TEST(ShaderCache_Threads)
+{
+	std::filesystem::path directory = getTestDirectory();
+	writeShaders(directory);
+	FakeCompiler compiler;
+	compiler.latencyMs = 5;
+
+	ShaderCache cache(directory / "Cache", compiler.get(), 1);
+	std::atomic<int> missing = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; ++t)
+		threads.emplace_back([&]() {
+			for (int i = 0; i < 20; ++i)
+				if (not cache.get(makeDesc(directory, i % 2 ? "A_VS.hlsl" : "B_PS.hlsl", "vs_6_0"))) ++missing;
+		});
+	for (std::thread& thread : threads) thread.join();
+
+	ShaderCache::Stats stats = cache.getStats();
+	CHECK(missing == 0 and compiler.compiles == 2);
+	CHECK(stats.requests == 160 and stats.compiled == 2 and stats.shared == 158);
+}
+
+// Startup with the 9 shaders of Shaders/ (3 KB each, an include), compiles of 20 ms: cold (compiling), warm (from the
+// directory) and a pass asking for them again (shared in memory)
+BENCH(ShaderCache_Startup)
+{
+	std::filesystem::path directory = getTestDirectory(), cacheDirectory = directory / "Cache";
+	writeShaders(directory);
+	FakeCompiler compiler;
+	compiler.latencyMs = 20;
+
+	std::vector<ShaderCache::Desc> descs;
+	for (int i = 0; i < 9; ++i)
+	{
+		std::string name = "S" + std::to_string(i) + "_PS.hlsl";
+		writeText(directory / "Shaders" / name, "#include \"Common.hlsli\"\n" + std::string(3000, char('a' + i)));
+		descs.push_back(makeDesc(directory, name.c_str(), "ps_6_0"));
+	}
+
+	auto start = [&descs](ShaderCache& cache) {
+		Test::Clock::time_point start = Test::Clock::now();
+		for (const ShaderCache::Desc& desc : descs) Test::keep(cache.get(desc)->size());
+		return Test::elapsedMs(start);
+	};
+
+	ShaderCache cold(cacheDirectory, compiler.get(), 1);
+	double coldMs = start(cold);
+	ShaderCache warm(cacheDirectory, compiler.get(), 1);
+	double warmMs = start(warm), sharedMs = start(warm);
+
+	printf("  9 shaders: cold %.1f ms (%d compiles), warm %.3f ms (%.3f ms a shader, %u loaded), shared %.4f ms\n", coldMs, compiler.compiles.load(), warmMs,
+		   warmMs / descs.size(), warm.getStats().loaded, sharedMs);
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
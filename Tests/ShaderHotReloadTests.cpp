@@ -0,0 +1,311 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "ShaderHotReload.h"
+#include "FileWatcher.h"
+#include "FileUtils.h"
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <thread>
+
+namespace
+{
+	typedef std::vector<ShaderHotReload::ShaderId> Shaders;
+	typedef std::vector<ShaderHotReload::PipelineId> Pipelines;
+
+	// The engine side: a source version per shader (the blob changes when it does, a failing shader doesn't compile),
+	// and the pipelines as the versions of the blobs they were built from
+	struct FakeEngine
+	{
+		std::mutex mutex;
+		std::map<uint32_t, int> versions, blobs;
+		std::set<uint32_t> failing;
+		std::map<uint32_t, std::vector<std::filesystem::path>> files;
+		std::map<uint32_t, Shaders> pipelineShaders;
+		std::map<uint32_t, std::string> live, rebuilt;
+		std::atomic<int> compiles = 0, rebuilds = 0;
+		std::atomic<bool> slow = false;
+
+		std::unique_ptr<ShaderHotReload> create(JobSystem* jobSystem)
+		{
+			return std::make_unique<ShaderHotReload>(
+				jobSystem,
+				[this](uint32_t shader, std::vector<std::filesystem::path>& shaderFiles) {
+					if (slow) std::this_thread::sleep_for(std::chrono::milliseconds(30));
+					++compiles;
+
+					std::lock_guard<std::mutex> lock(mutex);
+					shaderFiles = files[shader];
+					if (failing.count(shader)) return ShaderHotReload::COMPILE_FAILED;
+					if (blobs[shader] == versions[shader]) return ShaderHotReload::COMPILE_UNCHANGED;
+
+					blobs[shader] = versions[shader];
+					return ShaderHotReload::COMPILE_CHANGED;
+				},
+				[this](uint32_t pipeline) {
+					++rebuilds;
+					std::lock_guard<std::mutex> lock(mutex);
+					rebuilt[pipeline] = describe(pipeline);
+					return true;
+				},
+				[this](uint32_t pipeline) {
+					std::lock_guard<std::mutex> lock(mutex);
+					live[pipeline] = rebuilt[pipeline];
+				});
+		}
+
+		void setVersion(uint32_t shader, int version)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			versions[shader] = version;
+		}
+
+		std::string getLive(uint32_t pipeline)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return live[pipeline];
+		}
+
+		std::string describe(uint32_t pipeline) // (shader:blob of each, under the mutex)
+		{
+			std::string text;
+			for (uint32_t shader : pipelineShaders[pipeline]) text += std::to_string(shader) + ":" + std::to_string(blobs[shader]) + " ";
+			return text;
+		}
+	};
+
+	// Frames until the reload running is swapped in
+	bool finish(ShaderHotReload& reload)
+	{
+		for (int i = 0; i < 5000 and reload.isReloading(); ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			reload.update({});
+		}
+		return not reload.isReloading();
+	}
+
+	// Shaders 1 = A_VS (includes Common.hlsli), 2 = A_PS (Common.hlsli, Light.hlsli), 3 = B_PS; pipelines 10 = {1, 2},
+	// 11 = {1, 3}, 12 = {3}. Synthetic file events, no files read.
+	void checkReloads(JobSystem* jobSystem)
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "Shaders";
+
+		FakeEngine engine;
+		engine.files[1] = { directory / "A_VS.hlsl", directory / "Common.hlsli" };
+		engine.files[2] = { directory / "A_PS.hlsl", directory / "." / "Common.hlsli", directory / "Sub" / ".." / "Light.hlsli" }; // (normalized)
+		engine.files[3] = { directory / "B_PS.hlsl" };
+		engine.pipelineShaders = { { 10, { 1, 2 } }, { 11, { 1, 3 } }, { 12, { 3 } } };
+
+		std::unique_ptr<ShaderHotReload> reload = engine.create(jobSystem);
+		for (const auto& files : engine.files) reload->setShaderFiles(files.first, files.second);
+		for (const auto& shaders : engine.pipelineShaders) reload->setPipelineShaders(shaders.first, shaders.second);
+
+		CHECK(reload->findShaders({ directory / "Common.hlsli" }) == Shaders({ 1, 2 }));
+		CHECK(reload->findShaders({ directory / "Light.hlsli" }) == Shaders({ 2 }));
+		CHECK(reload->findShaders({ directory / "B_PS.hlsl" }) == Shaders({ 3 }));
+		CHECK(reload->findShaders({ directory / "Other.hlsli" }).empty());
+		CHECK(reload->findPipelines({ 2 }) == Pipelines({ 10 }) and reload->findPipelines({ 1 }) == Pipelines({ 10, 11 }));
+		CHECK(reload->findPipelines({ 3 }) == Pipelines({ 11, 12 }));
+
+		// An include of one shader: only its pipeline
+		engine.setVersion(2, 1);
+		reload->update({ directory / "Light.hlsli" });
+		CHECK(finish(*reload));
+		CHECK(engine.compiles == 1 and engine.rebuilds == 1 and engine.live.size() == 1 and engine.getLive(10) == "1:0 2:1 ");
+
+		// A comment changed: compiled, the same blobs, nothing rebuilt
+		reload->update({ directory / "Common.hlsli" });
+		CHECK(finish(*reload));
+		CHECK(engine.compiles == 3 and engine.rebuilds == 1);
+
+		// A shader of two pipelines: they are swapped in the same frame
+		engine.setVersion(1, 1);
+		engine.slow = true;
+		std::string live10 = engine.getLive(10), live11 = engine.getLive(11);
+		reload->update({ directory / "A_VS.hlsl" });
+		int torn = 0;
+		while (reload->isReloading())
+		{
+			reload->update({});
+			if ((engine.getLive(10) != live10) != (engine.getLive(11) != live11)) ++torn;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		CHECK(torn == 0 and engine.getLive(10) == "1:1 2:1 " and engine.getLive(11) == "1:1 3:0 ");
+		engine.slow = false;
+
+		// A shader that fails: its pipelines keep the old ones, until it's fixed
+		engine.setVersion(3, 1);
+		engine.failing.insert(3);
+		int rebuilds = engine.rebuilds;
+		reload->update({ directory / "B_PS.hlsl" });
+		CHECK(finish(*reload));
+		CHECK(engine.rebuilds == rebuilds and engine.getLive(11) == "1:1 3:0 " and engine.live.count(12) == 0 and reload->getStats().skipped == 2);
+
+		engine.failing.erase(3);
+		reload->update({ directory / "B_PS.hlsl" });
+		CHECK(finish(*reload));
+		CHECK(engine.getLive(11) == "1:1 3:1 " and engine.getLive(12) == "3:1 ");
+
+		// Changes during a reload wait for it and go in one more reload
+		engine.slow = true;
+		engine.setVersion(2, 2);
+		int compiles = engine.compiles;
+		reload->update({ directory / "A_PS.hlsl" });
+		if (jobSystem) CHECK(reload->isReloading());
+		engine.setVersion(2, 3);
+		reload->update({ directory / "A_PS.hlsl" });
+		reload->update({ directory / "Light.hlsli" });
+		reload->update({ directory / "A_PS.hlsl" });
+		CHECK(finish(*reload));
+		if (jobSystem) CHECK(engine.compiles == compiles + 2);
+		CHECK(engine.getLive(10) == "1:1 2:3 ");
+		engine.slow = false;
+
+		// The includes of a shader changed: the graph follows what the compile reports
+		{
+			std::lock_guard<std::mutex> lock(engine.mutex);
+			engine.files[2] = { directory / "A_PS.hlsl", directory / "New.hlsli" };
+		}
+		reload->update({ directory / "A_PS.hlsl" });
+		CHECK(finish(*reload));
+		CHECK(reload->findShaders({ directory / "Light.hlsli" }).empty() and reload->findShaders({ directory / "New.hlsli" }) == Shaders({ 2 }));
+
+		reload->setPipelineShaders(12, { 2 });
+		CHECK(reload->findPipelines({ 3 }) == Pipelines({ 11 }) and reload->findPipelines({ 2 }) == Pipelines({ 10, 12 }));
+
+		// Destroyed during a reload: waits for it, nothing swapped after
+		engine.slow = true;
+		engine.setVersion(1, 9);
+		reload->update({ directory / "A_VS.hlsl" });
+		reload.reset();
+		CHECK(engine.getLive(10) != "1:9 2:3 " or not jobSystem);
+	}
+}
+
+TEST(ShaderHotReload_Inline)
+{
+	checkReloads(nullptr);
+}
+
+TEST(ShaderHotReload_Jobs)
+{
+	JobSystem jobs(4);
+	checkReloads(&jobs);
+}
+
+// Real files: the watcher sees an include edited and the pipeline of the shader including it is swapped, the other one not
+TEST(ShaderHotReload_Watcher)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "EngineTests" / "ShaderHotReload";
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+	std::filesystem::create_directories(directory, error);
+
+	auto write = [](const std::filesystem::path& path, const std::string& text) { FileUtils::writeFile(path, std::vector<uint8_t>(text.begin(), text.end())); };
+	auto read = [](const std::filesystem::path& path) {
+		std::vector<uint8_t> data;
+		FileUtils::readFile(path, data);
+		return std::string(data.begin(), data.end());
+	};
+
+	write(directory / "X.hlsl", "1");
+	write(directory / "Y.hlsl", "1");
+	write(directory / "Common.hlsli", "1");
+	FileWatcher watcher(directory, FileWatcher::MODE_NATIVE, 50, 30);
+
+	JobSystem jobs(2);
+	std::mutex mutex;
+	std::map<uint32_t, std::vector<std::filesystem::path>> files = { { 1, { directory / "X.hlsl", directory / "Common.hlsli" } }, { 2, { directory / "Y.hlsl" } } };
+	std::map<uint32_t, std::string> sources, rebuilt, live;
+	auto getSource = [&](uint32_t shader) {
+		std::string text;
+		for (const std::filesystem::path& path : files[shader]) text += read(path);
+		return text;
+	};
+	for (uint32_t shader : { 1, 2 }) sources[shader] = getSource(shader);
+
+	ShaderHotReload reload(
+		&jobs,
+		[&](uint32_t shader, std::vector<std::filesystem::path>& shaderFiles) {
+			shaderFiles = files[shader];
+			std::string text = getSource(shader);
+			std::lock_guard<std::mutex> lock(mutex);
+			if (text == sources[shader]) return ShaderHotReload::COMPILE_UNCHANGED;
+			sources[shader] = text;
+			return ShaderHotReload::COMPILE_CHANGED;
+		},
+		[&](uint32_t pipeline) {
+			std::lock_guard<std::mutex> lock(mutex);
+			rebuilt[pipeline] = sources[pipeline / 100];
+			return true;
+		},
+		[&](uint32_t pipeline) { live[pipeline] = rebuilt[pipeline]; });
+
+	for (const auto& shaderFiles : files) reload.setShaderFiles(shaderFiles.first, shaderFiles.second);
+	reload.setPipelineShaders(100, { 1 });
+	reload.setPipelineShaders(200, { 2 });
+
+	write(directory / "Common.hlsli", "2");
+	Test::Clock::time_point start = Test::Clock::now();
+	while (live.empty() and Test::elapsedMs(start) < 2000.0)
+	{
+		reload.update(watcher.poll());
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	reload.wait();
+
+	CHECK(live.size() == 1 and live[100] == "12");
+	CHECK(reload.getStats().reloads == 1 and reload.getStats().lastReloadMs < 2000.0);
+
+	std::filesystem::remove_all(directory, error);
+}
+
+// Finding what to rebuild in a graph of 1000 shaders (each including 5 of 50 common files) and 2000 pipelines, and a reload
+// of the ~100 shaders including one of them with instant compiles (the bookkeeping of the reload)
+BENCH(ShaderHotReload_Graph)
+{
+	const std::filesystem::path directory = "/Shaders";
+	const uint32_t SHADERS = 1000, PIPELINES = 2000;
+
+	JobSystem jobs;
+	std::atomic<int> compiles = 0, rebuilds = 0;
+	ShaderHotReload reload(
+		&jobs,
+		[&](uint32_t, std::vector<std::filesystem::path>&) {
+			++compiles;
+			return ShaderHotReload::COMPILE_CHANGED;
+		},
+		[&](uint32_t) {
+			++rebuilds;
+			return true;
+		},
+		[](uint32_t) {});
+
+	Test::Clock::time_point start = Test::Clock::now();
+	for (uint32_t shader = 1; shader <= SHADERS; ++shader)
+	{
+		std::vector<std::filesystem::path> files = { directory / ("Shader" + std::to_string(shader) + ".hlsl") };
+		for (uint32_t i = 0; i < 5; ++i) files.push_back(directory / ("Common" + std::to_string((shader * 7 + i * 11) % 50) + ".hlsli"));
+		reload.setShaderFiles(shader, files);
+	}
+	for (uint32_t pipeline = 1; pipeline <= PIPELINES; ++pipeline) reload.setPipelineShaders(pipeline, { 1 + pipeline % SHADERS, 1 + (pipeline * 13) % SHADERS });
+	double buildMs = Test::elapsedMs(start);
+
+	const int FINDS = 1000;
+	size_t found = 0;
+	start = Test::Clock::now();
+	for (int i = 0; i < FINDS; ++i) found += reload.findPipelines(reload.findShaders({ directory / ("Common" + std::to_string(i % 50) + ".hlsli") })).size();
+	double findMs = Test::elapsedMs(start);
+
+	start = Test::Clock::now();
+	reload.update({ directory / "Common3.hlsli" });
+	reload.wait();
+	double reloadMs = Test::elapsedMs(start);
+
+	printf("  graph of %u shaders, %u pipelines: %.2f ms to build, %.1f us to find the pipelines of a file (%.0f on average), reload of %d shaders and %d "
+		   "pipelines %.2f ms\n",
+		   SHADERS, PIPELINES, buildMs, findMs * 1000.0 / FINDS, double(found) / FINDS, compiles.load(), rebuilds.load(), reloadMs);
+}
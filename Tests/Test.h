@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Headless tests and benchmarks of the CPU side of the engine (no window, device or ImGui: see Headless/Globals.h).
+// TEST(Suite_Name) and BENCH(Suite_Name) register a function, CHECK(condition) reports a failure and carries on.
+// EngineTests [prefix] runs the tests whose name starts with prefix, EngineTests -bench [prefix] the benchmarks.
+namespace Test
+{
+	typedef void (*Function)();
+	typedef std::chrono::steady_clock Clock;
+
+	struct Case
+	{
+		const char* name;
+		Function function;
+		bool bench;
+	};
+
+	std::vector<Case>& getCases();
+
+	struct Registrar
+	{
+		inline Registrar(const char* name, Function function, bool bench) { getCases().push_back({ name, function, bench }); };
+	};
+
+	void fail(const char* file, int line, const char* condition);
+
+	inline double elapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// (keeps the optimizer from dropping the work of a benchmark: the value has to be in memory, and read)
+	template<typename T> inline void keep(const T& value)
+	{
+#ifdef _MSC_VER
+		volatile char first = *reinterpret_cast<const volatile char*>(&value);
+		(void)first;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+	}
+}
+
+#define TEST(name) static void name(); static Test::Registrar name##Registrar(#name, name, false); static void name()
+#define BENCH(name) static void name(); static Test::Registrar name##Registrar(#name, name, true); static void name()
+
+#define CHECK(condition) do { if (not (condition)) Test::fail(__FILE__, __LINE__, #condition); } while (false)
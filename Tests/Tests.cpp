@@ -0,0 +1,55 @@
+#include "Globals.h"
+
+#include "Test.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+	std::atomic<int> failures = 0; // (CHECK from any thread)
+}
+
+std::vector<Test::Case>& Test::getCases()
+{
+	static std::vector<Case> cases;
+	return cases;
+}
+
+void Test::fail(const char* file, int line, const char* condition)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, condition);
+	++failures;
+}
+
+int main(int argc, char* argv[])
+{
+	bool bench = argc > 1 and strcmp(argv[1], "-bench") == 0;
+	const char* prefix = argc > (bench ? 2 : 1) ? argv[bench ? 2 : 1] : "";
+
+	int run = 0, failed = 0;
+	for (const Test::Case& test : Test::getCases())
+	{
+		if (test.bench != bench or strncmp(test.name, prefix, strlen(prefix)) != 0) continue;
+
+		printf("%s\n", test.name);
+		fflush(stdout);
+
+		int before = failures;
+		Test::Clock::time_point start = Test::Clock::now();
+		test.function();
+
+		if (failures != before) ++failed;
+		if (not bench) printf("  %s (%.1f ms)\n", failures == before ? "ok" : "FAILED", Test::elapsedMs(start));
+		++run;
+	}
+
+	if (run == 0) {
+		printf("Nothing matches \"%s\". Usage: EngineTests [-bench] [name prefix]\n", prefix);
+		return 1;
+	}
+
+	printf("%d %s, %d failed\n", run, bench ? "benchmarks" : "tests", failed);
+
+	return failed == 0 ? 0 : 1;
+}
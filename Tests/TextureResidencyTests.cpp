@@ -0,0 +1,175 @@
+#include "Globals.h"
+
+#include "Test.h"
+#include "TextureResidency.h"
+
+#include <random>
+
+namespace
+{
+	// RGBA8 mip chain of a square texture
+	std::vector<uint64_t> getMipSizes(uint32_t size)
+	{
+		std::vector<uint64_t> sizes;
+		for (; size > 1; size /= 2) sizes.push_back(uint64_t(size) * size * 4);
+		sizes.push_back(4);
+		return sizes;
+	}
+
+	// What the resident mips add up to, and whether the changes say what the residency says
+	uint64_t getResidentBytes(const TextureResidency& residency, const std::vector<uint32_t>& textures, const std::vector<uint64_t>& mipSizes)
+	{
+		uint64_t bytes = 0;
+		for (uint32_t texture : textures)
+			for (uint32_t mip = residency.getResidentMip(texture); mip < mipSizes.size(); ++mip) bytes += mipSizes[mip];
+		return bytes;
+	}
+}
+
+TEST(TextureResidency_MipForScreenSize)
+{
+	CHECK(TextureResidency::mipForScreenSize(2048, 2048, 2048.0f, 12) == 0);
+	CHECK(TextureResidency::mipForScreenSize(2048, 2048, 3000.0f, 12) == 0);
+	CHECK(TextureResidency::mipForScreenSize(2048, 2048, 256.0f, 12) == 3);
+	CHECK(TextureResidency::mipForScreenSize(2048, 512, 300.0f, 12) == 2); // (biggest side)
+	CHECK(TextureResidency::mipForScreenSize(2048, 2048, 0.5f, 12) == 11);
+	CHECK(TextureResidency::mipForScreenSize(2048, 2048, 1.0f, 4) == 3);
+}
+
+// The texture that misses most mips loads first, the least recently used one loses its mips first
+TEST(TextureResidency_Priority)
+{
+	const std::vector<uint64_t> mips = { 64, 16, 4, 1 };
+	std::vector<TextureResidency::Change> changes;
+
+	TextureResidency residency(1000);
+	uint32_t a = residency.add(mips, 3), b = residency.add(mips, 3), c = residency.add(mips, 3);
+	CHECK(residency.getUsage() == 3);
+
+	residency.setMaxLoadPerUpdate(1); // (one mip per update)
+	residency.request(a, 0, 1);
+	residency.request(b, 2, 1);
+	residency.update(1, changes);
+	CHECK(changes.size() == 1 and changes[0].texture == a and changes[0].residentMip == 2);
+
+	residency.request(a, 0, 2);
+	residency.request(b, 2, 2);
+	residency.update(2, changes);
+	CHECK(residency.getResidentMip(a) == 1 and residency.getResidentMip(b) == 3);
+
+	// A at mip 2, B and C at mip 1 (C used after B)
+	residency.setMaxLoadPerUpdate(0);
+	residency.request(a, 2, 3);
+	residency.request(b, 1, 3);
+	residency.request(c, 1, 3);
+	residency.update(3, changes);
+	residency.request(c, 1, 4);
+	residency.update(4, changes);
+	CHECK(residency.getResidentMip(a) == 1 and residency.getResidentMip(b) == 1 and residency.getResidentMip(c) == 1);
+
+	// A needs a mip it doesn't have: B goes first (least recently used), C keeps its mips
+	residency.request(a, 2, 5);
+	residency.update(5, changes); // (A is finer than needed now: the first to go)
+	CHECK(residency.getResidentMip(a) == 1);
+	residency.setBudget(residency.getUsage() - 1);
+	residency.request(a, 2, 6);
+	residency.request(c, 1, 6);
+	residency.update(6, changes);
+	CHECK(residency.getResidentMip(a) == 2 and residency.getResidentMip(b) == 1 and residency.getResidentMip(c) == 1);
+
+	residency.setBudget(residency.getUsage() + 15);
+	residency.request(a, 1, 7);
+	residency.update(7, changes);
+	CHECK(residency.getResidentMip(a) == 1 and residency.getResidentMip(b) == 2 and residency.getResidentMip(c) == 1);
+	CHECK(residency.getUsage() <= residency.getBudget());
+
+	// Removing gives the bytes and the id back
+	uint64_t usage = residency.getUsage();
+	residency.remove(b);
+	CHECK(residency.getUsage() == usage - 5);
+	CHECK(residency.add(mips, 3) == b);
+}
+
+// A camera flying over 100 2048x2048 textures (a window of 10 visible, wanting more detail the closer they are), with a
+// 64 MB budget: never over it, the changes are the residency, and lowering the budget evicts down to the tails
+TEST(TextureResidency_Trace)
+{
+	const std::vector<uint64_t> mips = getMipSizes(2048);
+	const uint32_t TAIL = 5; // (64x64)
+
+	TextureResidency residency(64ull << 20);
+	std::vector<uint32_t> textures;
+	for (int i = 0; i < 100; ++i) textures.push_back(residency.add(mips, TAIL));
+
+	std::vector<uint32_t> residentMips(textures.size(), TAIL);
+	std::vector<TextureResidency::Change> changes;
+	int overBudget = 0, wrongChanges = 0, wrongUsage = 0;
+
+	for (uint64_t frame = 1; frame < 500; ++frame)
+	{
+		uint32_t first = uint32_t(frame / 10) % 90;
+		for (uint32_t k = 0; k < 10; ++k) residency.request(textures[first + k], k / 3, frame);
+
+		residency.update(frame, changes);
+
+		for (const TextureResidency::Change& change : changes)
+		{
+			if (change.residentMip == residentMips[change.texture]) ++wrongChanges;
+			residentMips[change.texture] = change.residentMip;
+		}
+
+		for (uint32_t texture : textures)
+			if (residency.getResidentMip(texture) != residentMips[texture]) ++wrongChanges;
+
+		if (residency.getUsage() > residency.getBudget()) ++overBudget;
+		if (residency.getUsage() != getResidentBytes(residency, textures, mips)) ++wrongUsage;
+
+		// The far ones are cheap: they make it even when the close ones don't fit
+		if (frame % 10 == 9) CHECK(residency.getResidentMip(textures[first + 9]) == 3);
+	}
+
+	CHECK(overBudget == 0 and wrongChanges == 0 and wrongUsage == 0);
+
+	// The closest one gets the finest mip (16 MB) once the previous window is gone
+	CHECK(residency.getResidentMip(textures[uint32_t(499 / 10) % 90]) == 0);
+
+	residency.setBudget(8ull << 20);
+	residency.update(500, changes);
+	CHECK(residency.getUsage() <= residency.getBudget());
+
+	residency.setBudget(0);
+	residency.update(501, changes);
+
+	uint64_t tails = 0;
+	for (uint32_t mip = TAIL; mip < mips.size(); ++mip) tails += mips[mip] * textures.size();
+	CHECK(residency.getUsage() == tails);
+}
+
+// update() for 10000 textures with 1000 of them visible (wanting a mip depending on the distance), the window moving every frame
+BENCH(TextureResidency_Update)
+{
+	const std::vector<uint64_t> mips = getMipSizes(2048);
+	const int TEXTURES = 10000, VISIBLE = 1000, FRAMES = 1000;
+
+	TextureResidency residency(1ull << 30);
+	std::vector<uint32_t> textures;
+	for (int i = 0; i < TEXTURES; ++i) textures.push_back(residency.add(mips, 5));
+
+	std::mt19937 random(9);
+	std::vector<TextureResidency::Change> changes;
+	size_t changed = 0;
+
+	Test::Clock::time_point start = Test::Clock::now();
+	for (uint64_t frame = 1; frame <= FRAMES; ++frame)
+	{
+		uint32_t first = uint32_t(frame * 7) % (TEXTURES - VISIBLE);
+		for (uint32_t k = 0; k < VISIBLE; ++k) residency.request(textures[first + k], 1 + (k * 4 / VISIBLE) + random() % 2, frame);
+
+		residency.update(frame, changes);
+		changed += changes.size();
+	}
+	double ms = Test::elapsedMs(start);
+
+	printf("  %d textures, %d visible: %.1f us per frame (requests + update), %.1f changes per frame, %.0f MB resident of %.0f\n", TEXTURES,
+		   VISIBLE, ms * 1000.0 / FRAMES, double(changed) / FRAMES, residency.getUsage() / 1048576.0, residency.getBudget() / 1048576.0);
+}
@@ -0,0 +1,189 @@
+#include "Globals.h"
+
+#include "TextureCooker.h"
+#include "GltfImporter.h"
+#include "JobSystem.h"
+#include "FileUtils.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+namespace
+{
+	const char* CACHE_DIRECTORY = "Cache/Textures";
+
+	typedef std::chrono::steady_clock Clock;
+
+	inline double elapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	inline bool isPowerOfTwo(size_t value) { return value != 0 and (value & (value - 1)) == 0; }
+
+	bool isDDS(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(tolower(c)); });
+		return extension == ".dds";
+	}
+
+	bool isNormalMap(const std::filesystem::path& name)
+	{
+		std::string stem = name.stem().string();
+		std::transform(stem.begin(), stem.end(), stem.begin(), [](char c) { return char(tolower(c)); });
+
+		return stem.find("normal") != std::string::npos or (stem.size() > 2 and stem.compare(stem.size() - 2, 2, "_n") == 0);
+	}
+}
+
+std::filesystem::path TextureCooker::getCachePath(const std::vector<unsigned char>& source)
+{
+	// Hash of the contents and the cooker version: renamed or copied files share their cooked version
+	uint64_t hash = hashBytes(&VERSION, sizeof(VERSION));
+	hash = hashBytes(source.data(), source.size(), hash);
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.dds", (unsigned long long)hash);
+
+	return std::filesystem::path(CACHE_DIRECTORY) / name;
+}
+
+bool TextureCooker::load(const std::filesystem::path& path, JobSystem* jobSystem, ScratchImage& image, Quality quality)
+{
+	if (isDDS(path))
+		return SUCCEEDED(LoadFromDDSFile(path.native().c_str(), DDS_FLAGS_NONE, nullptr, image)); // native().cstr() only on Windows!
+
+	std::vector<unsigned char> source;
+	if (not FileUtils::readFile(path, source)) return false;
+
+	std::filesystem::path cachePath = getCachePath(source);
+
+	std::error_code error;
+	if (std::filesystem::exists(cachePath, error) and SUCCEEDED(LoadFromDDSFile(cachePath.native().c_str(), DDS_FLAGS_NONE, nullptr, image)))
+		return true;
+
+	Timings timings;
+	if (not cook(source, path, jobSystem, quality, image, &timings)) return false;
+
+	Clock::time_point start = Clock::now();
+	if (not save(image, cachePath)) LOG("Texture %s could not be saved to the cache", path.string().c_str()); // (it can still be used)
+	timings.save = elapsedMs(start);
+
+	LOG("Texture %s cooked: decode + mips %.1f ms, compression %.1f ms, save %.1f ms", path.string().c_str(), timings.decode, timings.compress, timings.save);
+
+	return true;
+}
+
+bool TextureCooker::cook(const std::vector<unsigned char>& source, const std::filesystem::path& name, JobSystem* jobSystem, Quality quality,
+						 ScratchImage& cooked, Timings* timings)
+{
+	Clock::time_point start = Clock::now();
+
+	// 1. Decode with the full mip chain (png, jpg, tga... everything stb knows). Colour textures are sRGB, normal maps linear
+	ScratchImage mips;
+	if (not GltfImporter::decodeImage(source.data(), source.size(), mips, not isNormalMap(name))) return false;
+
+	if (timings) timings->decode = elapsedMs(start);
+	start = Clock::now();
+
+	// 2. Compression (some textures stay uncompressed)
+	DXGI_FORMAT format = chooseFormat(mips, name, quality);
+
+	bool ok = true;
+	if (format == DXGI_FORMAT_UNKNOWN) cooked = std::move(mips);
+	else ok = compress(mips, format, jobSystem, cooked);
+
+	if (timings) timings->compress = elapsedMs(start);
+
+	return ok;
+}
+
+bool TextureCooker::save(const ScratchImage& cooked, const std::filesystem::path& path)
+{
+	std::error_code error;
+	std::filesystem::create_directories(path.parent_path(), error);
+
+	// (the temporary name is per thread: two jobs may be cooking the same contents)
+	std::filesystem::path temporary = path;
+	temporary += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	if (FAILED(SaveToDDSFile(cooked.GetImages(), cooked.GetImageCount(), cooked.GetMetadata(), DDS_FLAGS_NONE, temporary.native().c_str())))
+		return false;
+
+	std::filesystem::rename(temporary, path, error);
+	if (not error) return true;
+
+	std::filesystem::remove(temporary, error);
+	return false;
+}
+
+DXGI_FORMAT TextureCooker::chooseFormat(const ScratchImage& image, const std::filesystem::path& name, Quality quality)
+{
+	const TexMetadata& metaData = image.GetMetadata();
+
+	bool srgb = metaData.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	if ((metaData.format != DXGI_FORMAT_R8G8B8A8_UNORM and not srgb) or metaData.dimension != TEX_DIMENSION_TEXTURE2D)
+		return DXGI_FORMAT_UNKNOWN;
+
+	// Block compressed textures can only be created from mips with sizes multiple of 4 (and streaming starts at any mip)
+	if (not isPowerOfTwo(metaData.width) or not isPowerOfTwo(metaData.height) or metaData.width < 4 or metaData.height < 4)
+		return DXGI_FORMAT_UNKNOWN;
+
+	if (isNormalMap(name)) return DXGI_FORMAT_BC5_UNORM; // (x and y, z is rebuilt in the shader)
+
+	// (the sRGB block formats keep the colour space: the blocks are fitted in it and the GPU linearizes the texels)
+	if (quality == QUALITY_HIGH) return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+
+	if (image.IsAlphaAllOpaque()) return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+}
+
+bool TextureCooker::compress(const ScratchImage& image, DXGI_FORMAT format, JobSystem* jobSystem, ScratchImage& compressed)
+{
+	TexMetadata metaData = image.GetMetadata();
+	metaData.format = format;
+
+	if (FAILED(compressed.Initialize(metaData))) return false;
+
+	// Every image is cut in bands of block rows (compressed independently, blocks don't cross them) and each band is a job
+	std::atomic<bool> ok = true;
+	std::vector<JobSystem::JobHandle> jobs;
+
+	for (size_t i = 0; i < image.GetImageCount(); ++i)
+	{
+		const Image& source = image.GetImages()[i];
+		const Image& target = compressed.GetImages()[i]; // (same metadata, so same image order)
+
+		for (size_t row = 0; row < source.height; row += BAND_BLOCK_ROWS * 4)
+		{
+			auto band = [&ok, &source, &target, format, row]() {
+				Image part = source;
+				part.height = std::min(BAND_BLOCK_ROWS * 4, source.height - row);
+				part.pixels = source.pixels + row * source.rowPitch;
+				part.slicePitch = part.height * source.rowPitch;
+
+				ScratchImage blocks;
+				if (FAILED(Compress(part, format, TEX_COMPRESS_DEFAULT, TEX_THRESHOLD_DEFAULT, blocks))) {
+					ok = false;
+					return;
+				}
+
+				const Image* result = blocks.GetImage(0, 0, 0);
+				memcpy(target.pixels + (row / 4) * target.rowPitch, result->pixels, result->slicePitch);
+			};
+
+			if (jobSystem) jobs.push_back(jobSystem->schedule(band));
+			else band();
+		}
+	}
+
+	if (jobSystem) jobSystem->waitAll(jobs);
+
+	return ok;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "DirectXTex.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+class JobSystem;
+
+// Cooks textures for the runtime (no GPU objects here): full mip chain + block compression, saved as DDS in a cache keyed
+// by the hash of the source file contents, so later loads read the DDS and skip decoding, mip generation and compression.
+// Compression is split in bands of block rows that run as parallel jobs. Offline cooking and its benchmark: Tools.exe -cooktextures.
+class TextureCooker
+{
+public:
+
+	static constexpr uint32_t VERSION = 2; // (part of the cache key: change it whenever the cooked output changes)
+
+	enum Quality
+	{
+		QUALITY_FAST, // BC1 (opaque) or BC3 (with alpha)
+		QUALITY_HIGH  // BC7
+	};				  // (sRGB for colour textures; normal maps are linear BC5 with both)
+
+	struct Timings // milliseconds
+	{
+		double decode = 0.0;   // (includes the mips)
+		double compress = 0.0;
+		double save = 0.0;
+	};
+
+	static std::filesystem::path getCachePath(const std::vector<unsigned char>& source);
+
+	// Cooked version of the texture: from the cache, or cooked and saved there (sources that are DDS already are not cooked)
+	static bool load(const std::filesystem::path& path, JobSystem* jobSystem, DirectX::ScratchImage& image, Quality quality = QUALITY_FAST);
+
+	static bool cook(const std::vector<unsigned char>& source, const std::filesystem::path& name, JobSystem* jobSystem, Quality quality,
+					 DirectX::ScratchImage& cooked, Timings* timings = nullptr);
+	static bool save(const DirectX::ScratchImage& cooked, const std::filesystem::path& path); // (through a temporary file)
+
+	static DXGI_FORMAT chooseFormat(const DirectX::ScratchImage& image, const std::filesystem::path& name, Quality quality); // UNKNOWN = leave it uncompressed
+	static bool compress(const DirectX::ScratchImage& image, DXGI_FORMAT format, JobSystem* jobSystem, DirectX::ScratchImage& compressed);
+
+private:
+
+	static constexpr size_t BAND_BLOCK_ROWS = 16; // (64 texel rows per compression job)
+};
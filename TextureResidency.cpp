@@ -0,0 +1,151 @@
+#include "Globals.h"
+
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cmath>
+
+uint32_t TextureResidency::add(const std::vector<uint64_t>& mipSizes, uint32_t tailMip)
+{
+	uint32_t id;
+	if (not freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = uint32_t(textures.size());
+		textures.emplace_back();
+	}
+
+	Texture& texture = textures[id];
+	texture.mipSizes = mipSizes;
+	texture.tailMip = std::min(tailMip, uint32_t(mipSizes.size()) - 1);
+	texture.residentMip = texture.desiredMip = texture.tailMip;
+	texture.lastUsed = 0;
+	texture.alive = true;
+
+	for (uint32_t mip = texture.tailMip; mip < mipSizes.size(); ++mip)
+		usage += mipSizes[mip]; // (the tail is there even if it goes over budget)
+
+	return id;
+}
+
+void TextureResidency::remove(uint32_t texture)
+{
+	Texture& removed = textures[texture];
+
+	for (uint32_t mip = removed.residentMip; mip < removed.mipSizes.size(); ++mip)
+		usage -= removed.mipSizes[mip];
+
+	removed = Texture();
+	freeIds.push_back(texture);
+}
+
+void TextureResidency::request(uint32_t texture, uint32_t mip, uint64_t frame)
+{
+	Texture& requested = textures[texture];
+	mip = std::min(mip, requested.tailMip);
+
+	if (requested.lastUsed != frame) requested.desiredMip = mip; // first request of the frame
+	else requested.desiredMip = std::min(requested.desiredMip, mip);
+
+	requested.lastUsed = frame;
+}
+
+bool TextureResidency::isEvictable(const Texture& texture, uint64_t frame) const
+{
+	// Finer than needed, or not used this frame (the tail stays)
+	return texture.alive and texture.residentMip < texture.tailMip and (texture.residentMip < texture.desiredMip or texture.lastUsed < frame);
+}
+
+TextureResidency::Candidate TextureResidency::loadCandidate(uint32_t texture) const
+{
+	const Texture& candidate = textures[texture];
+	return { (uint64_t(candidate.residentMip - candidate.desiredMip) << 48) | std::min<uint64_t>(candidate.lastUsed, (uint64_t(1) << 48) - 1), texture };
+}
+
+TextureResidency::Candidate TextureResidency::evictionCandidate(uint32_t texture) const
+{
+	const Texture& candidate = textures[texture];
+	return { candidate.residentMip < candidate.desiredMip ? UINT64_MAX : ~candidate.lastUsed, texture };
+}
+
+bool TextureResidency::evictOne(Heap& evictions, uint64_t frame, uint32_t keep)
+{
+	while (not evictions.empty())
+	{
+		uint32_t id = evictions.top().texture;
+		evictions.pop();
+
+		Texture& victim = textures[id];
+		if (id == keep or not isEvictable(victim, frame)) continue; // (stale)
+
+		usage -= victim.mipSizes[victim.residentMip];
+		++victim.residentMip;
+
+		if (isEvictable(victim, frame)) evictions.push(evictionCandidate(id));
+		return true;
+	}
+
+	return false;
+}
+
+void TextureResidency::update(uint64_t frame, std::vector<Change>& changes)
+{
+	changes.clear();
+	std::vector<uint32_t> startMips(textures.size());
+
+	Heap loads, evictions;
+
+	for (uint32_t i = 0; i < textures.size(); ++i)
+	{
+		const Texture& texture = textures[i];
+		startMips[i] = texture.residentMip;
+
+		// (only what was requested this frame is loaded)
+		if (texture.alive and texture.lastUsed == frame and texture.desiredMip < texture.residentMip) loads.push(loadCandidate(i));
+		if (isEvictable(texture, frame)) evictions.push(evictionCandidate(i));
+	}
+
+	uint64_t loaded = 0;
+
+	while (not loads.empty())
+	{
+		uint32_t id = loads.top().texture;
+		loads.pop();
+
+		Texture& texture = textures[id];
+		if (texture.desiredMip >= texture.residentMip) continue; // (stale)
+
+		uint64_t bytes = texture.mipSizes[texture.residentMip - 1];
+		if (maxLoadPerUpdate != 0 and loaded > 0 and loaded + bytes > maxLoadPerUpdate) break;
+
+		// Make room (never taking it from the texture being loaded)
+		while (usage + bytes > budget and evictOne(evictions, frame, id));
+
+		if (usage + bytes > budget) continue; // nothing else can be evicted for it (a smaller mip of another texture may still fit)
+
+		usage += bytes;
+		loaded += bytes;
+		--texture.residentMip;
+
+		if (texture.desiredMip < texture.residentMip) loads.push(loadCandidate(id)); // (one mip at a time, so others get their turn)
+	}
+
+	// Still over budget (e.g. it was lowered): evict without loading anything
+	while (usage > budget and evictOne(evictions, frame, INVALID_TEXTURE));
+
+	for (uint32_t i = 0; i < textures.size(); ++i)
+		if (textures[i].alive and textures[i].residentMip != startMips[i]) changes.push_back({ i, textures[i].residentMip });
+}
+
+uint32_t TextureResidency::mipForScreenSize(uint32_t width, uint32_t height, float screenPixels, uint32_t mipCount)
+{
+	if (mipCount == 0) return 0;
+	if (screenPixels <= 1.0f) return mipCount - 1;
+
+	float texels = float(std::max(width, height));
+	float mip = std::floor(std::log2(std::max(texels / screenPixels, 1.0f)));
+
+	return std::min(uint32_t(mip), mipCount - 1);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <queue>
+#include <vector>
+
+// Decides which mips of the streamed textures are resident (bookkeeping only, no GPU objects here). Every frame the
+// users request the finest mip they need; update() loads finer mips by priority (most missing mips first, then most
+// recently used) and, to stay within the budget, evicts the finest mips of the least recently used textures.
+// Mips are numbered as usual (0 = finest); a texture always has [residentMip, mipCount) resident.
+class TextureResidency
+{
+public:
+
+	static constexpr uint32_t INVALID_TEXTURE = UINT32_MAX;
+
+	struct Change
+	{
+		uint32_t texture;
+		uint32_t residentMip; // new finest resident mip
+	};
+
+	TextureResidency(uint64_t budget = 0) : budget(budget) {}
+
+	uint32_t add(const std::vector<uint64_t>& mipSizes, uint32_t tailMip); // mips from tailMip on are always resident
+	void remove(uint32_t texture);
+
+	void request(uint32_t texture, uint32_t mip, uint64_t frame); // (the finest request of the frame wins)
+	void update(uint64_t frame, std::vector<Change>& changes);	   // one change per texture, at most
+
+	inline void setBudget(uint64_t bytes) { budget = bytes; };
+	inline void setMaxLoadPerUpdate(uint64_t bytes) { maxLoadPerUpdate = bytes; }; // 0 = no limit (otherwise, at least one mip is loaded)
+
+	inline uint64_t getBudget() const { return budget; };
+	inline uint64_t getUsage() const { return usage; };
+	inline uint32_t getResidentMip(uint32_t texture) const { return textures[texture].residentMip; };
+	inline uint32_t getDesiredMip(uint32_t texture) const { return textures[texture].desiredMip; };
+
+	// Mip that gives about one texel per pixel when the texture covers screenPixels (along its biggest side)
+	static uint32_t mipForScreenSize(uint32_t width, uint32_t height, float screenPixels, uint32_t mipCount);
+
+private:
+
+	struct Texture
+	{
+		std::vector<uint64_t> mipSizes;
+		uint32_t tailMip = 0;
+		uint32_t residentMip = 0;
+		uint32_t desiredMip = 0;
+		uint64_t lastUsed = 0; // (frame of desiredMip)
+		bool alive = false;
+	};
+
+	std::vector<Texture> textures;
+	std::vector<uint32_t> freeIds;
+
+	uint64_t budget = 0;
+	uint64_t usage = 0;
+	uint64_t maxLoadPerUpdate = 0;
+
+	struct Candidate
+	{
+		uint64_t key; // (what goes first depends on the heap)
+		uint32_t texture;
+
+		inline bool operator<(const Candidate& other) const { return key < other.key; };
+	};
+
+	typedef std::priority_queue<Candidate> Heap;
+
+	bool isEvictable(const Texture& texture, uint64_t frame) const;
+	Candidate loadCandidate(uint32_t texture) const;	  // (max heap: most missing mips, then most recently used)
+	Candidate evictionCandidate(uint32_t texture) const; // (max heap: finer than needed first, then least recently used)
+
+	bool evictOne(Heap& evictions, uint64_t frame, uint32_t keep); // drops the finest mip of the first texture that can lose it
+};
@@ -0,0 +1,97 @@
+#include "Globals.h"
+
+#include "Tools.h"
+
+#include "GltfImporter.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	const char* MODEL_DIRECTORY = "3rdParty/tinygltf/models";
+	const int RUNS = 5; // (the best one is reported: the first one also pays for the file cache)
+
+	bool isModel(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(tolower(c)); });
+		return extension == ".gltf" or extension == ".glb";
+	}
+
+	bool importBest(const std::filesystem::path& path, JobSystem* jobSystem, GltfImporter::Scene& best)
+	{
+		for (int run = 0; run < RUNS; ++run)
+		{
+			GltfImporter::Scene scene;
+			if (not GltfImporter::import(path, jobSystem, scene)) return false;
+
+			if (run == 0 or scene.timings.total < best.timings.total) best = std::move(scene);
+		}
+
+		return true;
+	}
+}
+
+// Import time of glTF models per stage (tinygltf parse, image decode + mips, primitive conversion), with every core and
+// with a single worker, so the gain of the parallel decode and conversion shows
+int gltfBenchTool(int argc, wchar_t* argv[])
+{
+	std::vector<std::filesystem::path> inputs;
+	if (argc == 0) inputs.push_back(MODEL_DIRECTORY);
+	for (int i = 0; i < argc; ++i) inputs.push_back(argv[i]);
+
+	std::vector<std::filesystem::path> models;
+	for (const std::filesystem::path& input : inputs)
+	{
+		std::error_code error;
+		if (std::filesystem::is_directory(input, error)) {
+			for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(input, error))
+				if (entry.is_regular_file() and isModel(entry.path())) models.push_back(entry.path());
+		}
+		else models.push_back(input);
+	}
+
+	if (models.empty()) {
+		printf("Usage: Tools.exe -gltfbench [models or folders] (default: %s)\n", MODEL_DIRECTORY);
+		return 1;
+	}
+
+	JobSystem parallel;
+	JobSystem single(1);
+	printf("%zu models, best of %d imports, %u threads (1 worker in brackets)\n", models.size(), RUNS, parallel.getThreadCount());
+
+	GltfImporter::Timings sum, singleSum;
+	int imported = 0;
+
+	for (const std::filesystem::path& path : models)
+	{
+		GltfImporter::Scene scene, singleScene;
+		if (not importBest(path, &parallel, scene) or not importBest(path, &single, singleScene)) {
+			printf("  %-40s not imported (the tinygltf models include invalid ones on purpose)\n", path.filename().string().c_str());
+			continue;
+		}
+
+		size_t triangles = 0;
+		for (const GltfImporter::Mesh& mesh : scene.meshes) triangles += mesh.indices.size() / 3;
+
+		const GltfImporter::Timings& t = scene.timings;
+		printf("  %-40s parse %7.2f ms  decode %7.2f ms (%zu images)  convert %7.2f ms (%zu meshes, %zu triangles)  total %7.2f ms (%7.2f ms)\n",
+			   path.filename().string().c_str(), t.parse, t.decode, scene.images.size(), t.convert, scene.meshes.size(), triangles, t.total,
+			   singleScene.timings.total);
+
+		sum.parse += t.parse;
+		sum.decode += t.decode;
+		sum.convert += t.convert;
+		sum.total += t.total;
+		singleSum.total += singleScene.timings.total;
+		++imported;
+	}
+
+	if (imported > 0)
+		printf("Total: parse %.2f ms, decode %.2f ms, convert %.2f ms (added over the jobs), total %.2f ms (%.2f ms with 1 worker, x%.2f)\n",
+			   sum.parse, sum.decode, sum.convert, sum.total, singleSum.total, singleSum.total / std::max(sum.total, 0.001));
+
+	return imported > 0 ? 0 : 1;
+}
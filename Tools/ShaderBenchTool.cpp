@@ -0,0 +1,116 @@
+#include "Globals.h"
+
+#include "Tools.h"
+
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	const char* SHADER_DIRECTORY = "Shaders";
+	const char* CACHE_DIRECTORY = "Cache/Shaders";
+
+	typedef std::chrono::steady_clock Clock;
+
+	inline double elapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+int shaderBenchTool(int argc, wchar_t* argv[])
+{
+	std::vector<std::filesystem::path> inputs;
+	if (argc == 0) inputs.push_back(SHADER_DIRECTORY);
+	for (int i = 0; i < argc; ++i) inputs.push_back(argv[i]);
+
+	std::vector<ShaderCache::Desc> descs;
+	for (const std::filesystem::path& input : inputs)
+	{
+		std::vector<std::filesystem::path> files;
+		std::error_code error;
+
+		if (std::filesystem::is_directory(input, error)) {
+			for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(input, error))
+				if (entry.is_regular_file()) files.push_back(entry.path());
+		}
+		else files.push_back(input);
+
+		for (const std::filesystem::path& file : files)
+		{
+			ShaderCache::Desc desc;
+			desc.path = file;
+			desc.profile = ShaderCompiler::getProfile(file);
+			if (not desc.profile.empty()) descs.push_back(desc);
+		}
+	}
+
+	if (descs.empty()) {
+		printf("Usage: Tools.exe -shaderbench [shaders or folders] (stage from the name as the build does: *VS.hlsl, *PS.hlsl, *CS.hlsl...)\n");
+		return 1;
+	}
+
+	ShaderCompiler compiler;
+	printf("%zu shaders, %s\n", descs.size(), compiler.hasDXC() ? "DXC" : "no DXC (dxcompiler.dll): shader model 6 shaders can't be compiled");
+
+	// A cache of its own, empty for the first run
+	std::filesystem::path directory = std::filesystem::path(CACHE_DIRECTORY) / "Bench";
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	ShaderCache::Compiler compile = [&compiler](const ShaderCache::Desc& desc, const std::string& source, std::vector<uint8_t>& blob, std::string& errors) {
+		return compiler.compile(desc, source, blob, errors);
+	};
+
+	ShaderCache cold(directory, compile, compiler.getId()); // first run
+	ShaderCache warm(directory, compile, compiler.getId()); // next runs: the same directory, nothing in memory yet
+
+	double coldMs = 0.0, diskMs = 0.0, memoryMs = 0.0, prebuiltMs = 0.0;
+	int failed = 0, prebuilt = 0;
+
+	for (const ShaderCache::Desc& desc : descs)
+	{
+		std::string errors;
+		Clock::time_point start = Clock::now();
+		bool ok = cold.get(desc, &errors) != nullptr;
+		double compileMs = elapsedMs(start);
+
+		start = Clock::now();
+		ok = ok and warm.get(desc) != nullptr;
+		double loadMs = elapsedMs(start);
+
+		start = Clock::now();
+		ok = ok and warm.get(desc) != nullptr;
+		double sharedMs = elapsedMs(start);
+
+		// What startup did before: read the build's .cso
+		start = Clock::now();
+		std::vector<uint8_t> blob;
+		bool found = ShaderCompiler::readPrebuilt(desc.path, blob);
+		double readMs = elapsedMs(start);
+
+		if (ok) printf("  %-28s %s  compile %8.2f ms  disk cache %6.3f ms  memory %6.3f ms\n", desc.path.filename().string().c_str(), desc.profile.c_str(), compileMs, loadMs, sharedMs);
+		else printf("  %-28s %s  FAILED %s\n", desc.path.filename().string().c_str(), desc.profile.c_str(), errors.c_str());
+
+		coldMs += compileMs;
+		diskMs += loadMs;
+		memoryMs += sharedMs;
+		failed += ok ? 0 : 1;
+
+		prebuiltMs += found ? readMs : 0.0;
+		prebuilt += found ? 1 : 0;
+	}
+
+	printf("Cold startup (empty cache): %8.2f ms\n", coldMs);
+	printf("Warm startup (disk cache):  %8.2f ms (%.0fx faster)\n", diskMs, diskMs > 0.0 ? coldMs / diskMs : 0.0);
+	printf("Shared (memory):            %8.3f ms\n", memoryMs);
+	if (prebuilt > 0) printf("Reading %d .cso files:      %8.2f ms\n", prebuilt, prebuiltMs);
+	if (failed > 0) printf("%d shaders failed\n", failed);
+
+	std::filesystem::remove_all(directory, error);
+
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include "Globals.h"
+
+#include "Tools.h"
+
+#include "TextureCooker.h"
+#include "JobSystem.h"
+#include "FileUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	inline double elapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	bool isSourceTexture(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(tolower(c)); });
+		return extension == ".png" or extension == ".jpg" or extension == ".jpeg" or extension == ".tga" or extension == ".bmp";
+	}
+
+	const char* formatName(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM: return "BC1";
+		case DXGI_FORMAT_BC3_UNORM: return "BC3";
+		case DXGI_FORMAT_BC5_UNORM: return "BC5";
+		case DXGI_FORMAT_BC7_UNORM: return "BC7";
+		case DXGI_FORMAT_R8G8B8A8_UNORM: return "RGBA8";
+		case DXGI_FORMAT_BC1_UNORM_SRGB: return "BC1 sRGB";
+		case DXGI_FORMAT_BC3_UNORM_SRGB: return "BC3 sRGB";
+		case DXGI_FORMAT_BC7_UNORM_SRGB: return "BC7 sRGB";
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: return "RGBA8 sRGB";
+		default: return "?";
+		}
+	}
+}
+
+// Cooks to the cache and reports the cook throughput and the load speedup (source decode + mips vs loading the cooked DDS)
+int cookTexturesTool(int argc, wchar_t* argv[])
+{
+	TextureCooker::Quality quality = TextureCooker::QUALITY_FAST;
+	std::vector<std::filesystem::path> inputs;
+
+	for (int i = 0; i < argc; ++i)
+	{
+		std::filesystem::path argument = argv[i];
+		std::error_code error;
+
+		if (argument == L"-high") quality = TextureCooker::QUALITY_HIGH;
+		else if (std::filesystem::is_directory(argument, error)) {
+			for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(argument, error))
+				if (entry.is_regular_file() and isSourceTexture(entry.path())) inputs.push_back(entry.path());
+		}
+		else inputs.push_back(argument);
+	}
+
+	if (inputs.empty()) {
+		printf("Usage: Tools.exe -cooktextures [-high] <textures or folders>\n");
+		return 1;
+	}
+
+	JobSystem jobSystem;
+	printf("Cooking %zu textures on %u threads (%s)\n", inputs.size(), jobSystem.getThreadCount(), quality == TextureCooker::QUALITY_HIGH ? "high quality" : "fast");
+
+	double texels = 0.0, cookMs = 0.0, sourceLoadMs = 0.0, cookedLoadMs = 0.0;
+	int failed = 0;
+
+	for (const std::filesystem::path& path : inputs)
+	{
+		// Runtime load without the cache: read + decode + mips (the decode is the first stage of the cook)
+		Clock::time_point start = Clock::now();
+		std::vector<unsigned char> source;
+		bool ok = FileUtils::readFile(path, source);
+		double readMs = elapsedMs(start);
+
+		ScratchImage cooked;
+		TextureCooker::Timings timings;
+		std::filesystem::path cachePath = TextureCooker::getCachePath(source);
+
+		ok = ok and TextureCooker::cook(source, path, &jobSystem, quality, cooked, &timings) and TextureCooker::save(cooked, cachePath);
+
+		// Runtime load with the cache
+		start = Clock::now();
+		ScratchImage loaded;
+		ok = ok and SUCCEEDED(LoadFromDDSFile(cachePath.native().c_str(), DDS_FLAGS_NONE, nullptr, loaded));
+		double loadMs = elapsedMs(start);
+
+		if (not ok) {
+			printf("  %s: FAILED\n", path.string().c_str());
+			++failed;
+			continue;
+		}
+
+		// Throughput in source texels (RGBA8 MB of the whole mip chain) per second of decode + mips + compression
+		const TexMetadata& metaData = cooked.GetMetadata();
+		double megabytes = 0.0;
+		for (size_t mip = 0; mip < metaData.mipLevels; ++mip)
+			megabytes += double(std::max<size_t>(metaData.width >> mip, 1)) * double(std::max<size_t>(metaData.height >> mip, 1)) * 4.0 / (1024.0 * 1024.0);
+
+		double textureCookMs = timings.decode + timings.compress;
+		double textureSourceMs = readMs + timings.decode;
+
+		printf("  %s: %zux%zu %s, cook %.1f ms (%.1f MB/s), load %.2f ms -> %.2f ms (x%.1f)\n", path.string().c_str(), metaData.width, metaData.height,
+			   formatName(metaData.format), textureCookMs, megabytes * 1000.0 / std::max(textureCookMs, 0.001), textureSourceMs, loadMs, textureSourceMs / std::max(loadMs, 0.001));
+
+		texels += megabytes;
+		cookMs += textureCookMs;
+		sourceLoadMs += textureSourceMs;
+		cookedLoadMs += loadMs;
+	}
+
+	if (failed < int(inputs.size()))
+		printf("Total: %.1f MB in %.1f ms (%.1f MB/s), load %.1f ms -> %.1f ms (x%.1f), %d failed\n", texels, cookMs, texels * 1000.0 / std::max(cookMs, 0.001),
+			   sourceLoadMs, cookedLoadMs, sourceLoadMs / std::max(cookedLoadMs, 0.001), failed);
+
+	return failed == 0 ? 0 : 1;
+}
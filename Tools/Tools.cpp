@@ -0,0 +1,23 @@
+// Tools.cpp : Defines the entry point for the console application.
+//
+
+#include "Globals.h"
+
+#include "Tools.h"
+
+#include <cstdio>
+#include <cwchar>
+
+int wmain(int argc, wchar_t* argv[])
+{
+	if (argc > 1 and wcscmp(argv[1], L"-cooktextures") == 0) return cookTexturesTool(argc - 2, argv + 2);
+	if (argc > 1 and wcscmp(argv[1], L"-gltfbench") == 0) return gltfBenchTool(argc - 2, argv + 2);
+	if (argc > 1 and wcscmp(argv[1], L"-shaderbench") == 0) return shaderBenchTool(argc - 2, argv + 2);
+
+	printf("Usage: Tools.exe <tool> <arguments>\n"
+		   "  -cooktextures [-high] <textures or folders>   cooks to Cache/Textures, reports MB/s and the load speedup\n"
+		   "  -gltfbench [models or folders]                import time per stage (parse, decode, convert) of the tinygltf models\n"
+		   "  -shaderbench [shaders or folders]             startup cost of the shaders: empty cache, disk cache, memory, .cso\n");
+
+	return 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Command line tools and benchmarks of the engine systems that don't need a window (Tools.exe <switch> <arguments>).
+// Every entry point returns the process exit code. Paths are relative to the working directory, as in Engine.exe, so run
+// them from the repository root to share the engine caches.
+
+int cookTexturesTool(int argc, wchar_t* argv[]); // -cooktextures [-high] <textures or folders>
+int gltfBenchTool(int argc, wchar_t* argv[]);    // -gltfbench [models or folders]
+int shaderBenchTool(int argc, wchar_t* argv[]);  // -shaderbench [shaders or folders]
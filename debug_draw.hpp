@@ -54,9 +54,13 @@
 //  '__cplusplus' built-in macro constant.
 //
 // DEBUG_DRAW_MAX_*
-//  Sizes of internal intermediate buffers, which are allocated on initialization
-//  by the implementation. If you need to draw more primitives than the sizes of
-//  these buffers, you need to redefine the macros and recompile.
+//  Limits of the internal queues. The queues grow by chunks as primitives are
+//  queued (see DEBUG_DRAW_QUEUE_CHUNK_SIZE), so memory is only taken when needed.
+//  Primitives over the limits are dropped (and counted, see dd::getFrameCounters()).
+//
+// DEBUG_DRAW_QUEUE_CHUNK_SIZE / DEBUG_DRAW_QUEUE_IDLE_FLUSHES
+//  Entries per queue chunk, and flushes after which the chunks a queue
+//  didn't need during them are given back.
 //
 // DEBUG_DRAW_VERTEX_BUFFER_SIZE
 //  Size in dd::DrawVertex elements of the intermediate vertex buffer used
@@ -64,8 +68,14 @@
 //  buffer will reduce the number of calls to dd::RenderInterface when drawing
 //  large sets of debug primitives.
 //
+// DEBUG_DRAW_GLYPH_BUFFER_SIZE
+//  Size in dd::GlyphInstance elements of the intermediate buffer used to batch
+//  text for renderers that draw a glyph per instance (see
+//  RenderInterface::supportsGlyphInstancing()).
+//
 // DEBUG_DRAW_OVERFLOWED(message)
-//  An error handler called if any of the DEBUG_DRAW_MAX_* sizes overflow.
+//  An error handler called if any of the DEBUG_DRAW_MAX_* sizes overflow
+//  (or a queue chunk can't be allocated).
 //  By default it just prints a message to stderr.
 //
 // DEBUG_DRAW_USE_STD_MATH
@@ -112,8 +122,11 @@
 //  MEMORY ALLOCATION
 // -------------------
 // Debug Draw will only perform a couple of memory allocations during startup to decompress
-// the built-in glyph bitmap used for debug text rendering and to allocate the vertex buffers
-// and intermediate draw/batch buffers and context data used internally.
+// the built-in glyph bitmap used for debug text rendering (unless the renderer already has
+// the texture, see RenderInterface::findGlyphTexture()) and to allocate the vertex buffers
+// and intermediate draw/batch buffers and context data used internally. The queues of
+// primitives allocate their chunks when they grow, and free them on dd::flush() after
+// DEBUG_DRAW_QUEUE_IDLE_FLUSHES flushes without needing them.
 //
 // Memory allocation and deallocation for Debug Draw will be done via:
 //
@@ -147,7 +160,8 @@
 //
 // 2D screen-text is in screen-space pixels (from 0,0 in the upper-left
 // corner of the screen to screen_width-1 and screen_height-1).
-// RenderInterface::drawGlyphList() also receives vertexes in screen-space.
+// RenderInterface::drawGlyphList() also receives vertexes in screen-space,
+// and so does RenderInterface::drawGlyphInstances().
 //
 // We make some usage of matrices for things like the projected text labels.
 // Matrix layout used is column-major and vectors multiply as columns.
@@ -180,22 +194,47 @@
 
 //
 // Max elements of each type at any given time.
-// We supply these reasonable defaults, but you can provide your
-// own tunned values to save memory or fit all of your debug data.
-// These are hard constraints. If not enough, change and recompile.
+// The queues only allocate what they use (in chunks), so these
+// are just limits against runaway submissions. These are hard
+// constraints: what goes over them is dropped (and counted).
 //
 #ifndef DEBUG_DRAW_MAX_STRINGS
-    #define DEBUG_DRAW_MAX_STRINGS 512
+    #define DEBUG_DRAW_MAX_STRINGS 16384
 #endif // DEBUG_DRAW_MAX_STRINGS
 
 #ifndef DEBUG_DRAW_MAX_POINTS
-    #define DEBUG_DRAW_MAX_POINTS 8192
+    #define DEBUG_DRAW_MAX_POINTS 1048576
 #endif // DEBUG_DRAW_MAX_POINTS
 
 #ifndef DEBUG_DRAW_MAX_LINES
-    #define DEBUG_DRAW_MAX_LINES 32768
+    #define DEBUG_DRAW_MAX_LINES 4194304
 #endif // DEBUG_DRAW_MAX_LINES
 
+#ifndef DEBUG_DRAW_MAX_SHAPES
+    #define DEBUG_DRAW_MAX_SHAPES 262144
+#endif // DEBUG_DRAW_MAX_SHAPES
+
+//
+// Entries in each chunk of the queues (a multiple of 4 keeps the
+// flush kernels on their 4-wide path) and flushes after which the
+// chunks above the most a queue used during them are freed.
+//
+#ifndef DEBUG_DRAW_QUEUE_CHUNK_SIZE
+    #define DEBUG_DRAW_QUEUE_CHUNK_SIZE 1024
+#endif // DEBUG_DRAW_QUEUE_CHUNK_SIZE
+
+#ifndef DEBUG_DRAW_QUEUE_IDLE_FLUSHES
+    #define DEBUG_DRAW_QUEUE_IDLE_FLUSHES 120
+#endif // DEBUG_DRAW_QUEUE_IDLE_FLUSHES
+
+//
+// Segments of the unit circle mesh used by the instanced shapes.
+// dd::circle() calls with a different 'numSteps' are drawn as lines.
+//
+#ifndef DEBUG_DRAW_CIRCLE_SHAPE_STEPS
+    #define DEBUG_DRAW_CIRCLE_SHAPE_STEPS 32
+#endif // DEBUG_DRAW_CIRCLE_SHAPE_STEPS
+
 //
 // Size in vertexes of a local buffer we use to sort elements
 // drawn with and without depth testing before submitting them to
@@ -209,6 +248,22 @@
     #define DEBUG_DRAW_VERTEX_BUFFER_SIZE 4096
 #endif // DEBUG_DRAW_VERTEX_BUFFER_SIZE
 
+//
+// Same as above for the instanced shapes (see dd::ShapeInstance,
+// about 60 bytes each).
+//
+#ifndef DEBUG_DRAW_SHAPE_BUFFER_SIZE
+    #define DEBUG_DRAW_SHAPE_BUFFER_SIZE 1024
+#endif // DEBUG_DRAW_SHAPE_BUFFER_SIZE
+
+//
+// Same as above for the glyph instances (see dd::GlyphInstance,
+// 16 bytes each).
+//
+#ifndef DEBUG_DRAW_GLYPH_BUFFER_SIZE
+    #define DEBUG_DRAW_GLYPH_BUFFER_SIZE 4096
+#endif // DEBUG_DRAW_GLYPH_BUFFER_SIZE
+
 //
 // This macro is called with an error message if any of the above
 // sizes is overflowed during runtime. In a debug build, you might
@@ -230,6 +285,23 @@
     #define DEBUG_DRAW_USE_STD_MATH 1
 #endif // DEBUG_DRAW_USE_STD_MATH
 
+//
+// The flush kernels of the lines and points queues (frustum culling,
+// depth partition and vertex packing, and the expiry compaction) use
+// SSE intrinsics (up to SSSE3) when this is 1, 4 queue entries at a time.
+// Defaults to 1 on x86/x64 compilers that accept them (the SSSE3 part
+// is checked on the CPU when the compiler doesn't guarantee it, see
+// cpuHasSSSE3()). Define it to zero to use the portable scalar version
+// of the same kernels.
+//
+#ifndef DEBUG_DRAW_USE_SSE
+    #if defined(_M_X64) || defined(_M_IX86) || defined(__SSSE3__)
+        #define DEBUG_DRAW_USE_SSE 1
+    #else // !x86
+        #define DEBUG_DRAW_USE_SSE 0
+    #endif // x86
+#endif // DEBUG_DRAW_USE_SSE
+
 // ========================================================
 // Overridable Debug Draw types:
 // ========================================================
@@ -694,6 +766,59 @@ union DrawVertex
     } glyph;
 };
 
+// ========================================================
+// Instanced shapes:
+// Renderers that can draw instances get a single instance for
+// every sphere(), box(), aabb(), cone() and circle() instead of
+// its lines (see RenderInterface::supportsShapeInstancing()).
+// The shape is stored once as a unit mesh (a line list).
+// ========================================================
+
+enum ShapeType
+{
+    ShapeSphere, // Radius 1, centered at the origin.
+    ShapeBox,    // From -0.5 to +0.5 on every axis.
+    ShapeCone,   // Apex at the origin, base of radius 1 at Z = 1 (only cones with a zero 'apexRadius').
+    ShapeCircle, // Radius 1, centered at the origin, on the XY plane (DEBUG_DRAW_CIRCLE_SHAPE_STEPS segments).
+    ShapeCount
+};
+
+// A point 'p' of the unit mesh is drawn at: origin + p.x * axisX + p.y * axisY + p.z * axisZ
+struct ShapeInstance
+{
+    float axisX[3];
+    float axisY[3];
+    float axisZ[3];
+    float origin[3];
+    float color[3];
+};
+
+// Fills 'positions' (x, y, z per vertex, pairs of vertices per line) with the unit mesh
+// of the shape and returns its vertex count. Pass null to just get the count.
+int getShapeMesh(ShapeType shape, float * positions);
+
+// ========================================================
+// Instanced text:
+// Renderers that can draw instances get a single instance for
+// every character of the debug text instead of its two triangles
+// (see RenderInterface::supportsGlyphInstancing()). The quad and
+// the texture coordinates are rebuilt from the character code.
+// ========================================================
+
+// A glyph covers [x, x + glyphWidth * scaling] x [y, y + glyphHeight * scaling] of the screen.
+struct GlyphInstance
+{
+    float x, y;             // Top-left corner, in screen pixels.
+    std::uint16_t glyph;    // Character code (see dd::getGlyphRects()).
+    std::uint16_t scaling;  // 8.8 fixed point.
+    std::uint8_t color[4];  // RGBA8 (alpha is always 255).
+};
+
+// Fills 'rects' (u0, v0, u1, v1 per character code, in the glyph texture) and 'glyphSize'
+// (width and height of a glyph in pixels, at scaling 1) and returns the number of character
+// codes. Either pointer can be null.
+int getGlyphRects(float * rects, float * glyphSize);
+
 //
 // Opaque handle to a texture object.
 // Used by the debug text drawing functions.
@@ -733,6 +858,14 @@ public:
     virtual GlyphTextureHandle createGlyphTexture(int width, int height, const void * pixels);
     virtual void destroyGlyphTexture(GlyphTextureHandle glyphTex);
 
+    //
+    // Asked by dd::initialize() before the glyph bitmap is decompressed ('bitmapKey' only changes
+    // with the pixels): a renderer that already has the texture (created for another context, or
+    // from a copy of the bitmap it kept) returns it, and createGlyphTexture() is not called.
+    // Returns null by default (the bitmap is always decompressed).
+    //
+    virtual GlyphTextureHandle findGlyphTexture(int width, int height, std::uint32_t bitmapKey);
+
     //
     // Batch drawing methods for the primitives used by the debug renderer.
     // If you don't wish to support a given primitive type, don't override the method.
@@ -741,6 +874,23 @@ public:
     virtual void drawLineList(const DrawVertex * lines, int count, bool depthEnabled);
     virtual void drawGlyphList(const DrawVertex * glyphs, int count, GlyphTextureHandle glyphTex);
 
+    //
+    // Instanced shapes. If supportsShapeInstancing() returns true (it is asked once, by
+    // dd::initialize()) the shapes are queued as instances and handed to drawShapeList()
+    // on the lines flush, after the lines. The unit meshes come from dd::getShapeMesh().
+    // By default, shapes are expanded to lines on the CPU.
+    //
+    virtual bool supportsShapeInstancing();
+    virtual void drawShapeList(ShapeType shape, const ShapeInstance * instances, int count, bool depthEnabled);
+
+    //
+    // Instanced text. If supportsGlyphInstancing() returns true (also asked once, by
+    // dd::initialize()) the text goes to drawGlyphInstances(), a dd::GlyphInstance per
+    // character, instead of drawGlyphList(). By default, glyphs are expanded to triangles.
+    //
+    virtual bool supportsGlyphInstancing();
+    virtual void drawGlyphInstances(const GlyphInstance * glyphs, int count, GlyphTextureHandle glyphTex);
+
     // User defined cleanup. Nothing by default.
     virtual ~RenderInterface() = 0;
 };
@@ -786,6 +936,34 @@ void flush(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,)
            std::int64_t currTimeMillis = 0,
            std::uint32_t flags = FlushAll);
 
+// Frustum used by dd::flush() to cull lines and points. 'vpMatrix' is the view * projection
+// transform, like in dd::projectedText(). Culling is conservative: a line is only dropped when
+// both ends are out of the same plane, for both [-w, w] and [0, w] clip depth ranges.
+// Nothing is culled until this is called, or after dd::disableCulling().
+void setCullMatrix(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddMat4x4_In vpMatrix);
+void disableCulling(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx));
+
+// What happened to each kind of primitive between two dd::flush() calls.
+struct QueueCounters
+{
+    std::uint32_t submitted; // Queued by the dd:: functions.
+    std::uint32_t dropped;   // Over the DEBUG_DRAW_MAX_* limit (or out of memory).
+    std::uint32_t culled;    // Out of the cull frustum on flush (lines and points only).
+    std::uint32_t queued;    // In the queue on flush (submitted plus the ones still alive).
+};
+
+struct FrameCounters
+{
+    QueueCounters lines;     // (shapes drawn as lines count as lines)
+    QueueCounters points;
+    QueueCounters strings;
+    QueueCounters shapes;    // Instanced shapes.
+    std::size_t   queueBytes; // Memory taken by the queues after the flush.
+};
+
+// Counters of the last dd::flush(). Zero if not initialized.
+const FrameCounters & getFrameCounters(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx));
+
 } // namespace dd
 
 // ================== End of header file ==================
@@ -811,6 +989,13 @@ void flush(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,)
     #include <float.h>
 #endif // DEBUG_DRAW_USE_STD_MATH
 
+#if DEBUG_DRAW_USE_SSE
+    #include <tmmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h> // (__cpuid)
+    #endif // _MSC_VER
+#endif // DEBUG_DRAW_USE_SSE
+
 namespace dd
 {
 
@@ -1769,6 +1954,20 @@ static int lzwDecompress(const void * compressedData, int compressedSizeBytes,
 static inline const std::uint8_t * getRawFontBitmapData() { return s_fontMonoid18Bitmap;  }
 static inline const FontCharSet  & getFontCharSet()       { return s_fontMonoid18CharSet; }
 
+// FNV-1a of the compressed bitmap (for RenderInterface::findGlyphTexture()).
+static std::uint32_t getFontBitmapKey()
+{
+    const std::uint8_t * data = getRawFontBitmapData();
+    const std::uint32_t compressedSizeBytes = *reinterpret_cast<const std::uint32_t *>(data);
+
+    std::uint32_t key = 2166136261u;
+    for (std::uint32_t i = 0; i < compressedSizeBytes + 8; ++i) // (+ the two size uint32s)
+    {
+        key = (key ^ data[i]) * 16777619u;
+    }
+    return key;
+}
+
 static std::uint8_t * decompressFontBitmap()
 {
     const std::uint32_t * compressedData = reinterpret_cast<const std::uint32_t *>(getRawFontBitmapData());
@@ -1821,43 +2020,213 @@ struct DebugString
     bool         centered;
 };
 
-struct DebugPoint
+//
+// Points and lines are kept as structures of arrays (one array per
+// component), so the flush kernels load the same component of 4 entries
+// at once, e.g.: lines.values[LineFromX][i] (in a chunk of the queue).
+//
+enum PointComponents
+{
+    PointX, PointY, PointZ,
+    PointR, PointG, PointB,
+    PointSize,
+    PointComponentCount
+};
+
+enum LineComponents
 {
-    std::int64_t expiryDateMillis;
-    ddVec3       position;
-    ddVec3       color;
-    float        size;
-    bool         depthEnabled;
+    LineFromX, LineFromY, LineFromZ,
+    LineToX, LineToY, LineToZ,
+    LineR, LineG, LineB,
+    LineComponentCount
 };
 
-struct DebugLine
+struct DebugShape
 {
     std::int64_t expiryDateMillis;
-    ddVec3       posFrom;
-    ddVec3       posTo;
-    ddVec3       color;
+    ShapeInstance instance;
+    ShapeType    shape;
     bool         depthEnabled;
 };
 
+//
+// The queues are lists of fixed size chunks, allocated when the queue
+// grows into them. Entry 'i' is in chunks[i / QueueChunkSize].
+//
+static const int QueueChunkSize = DEBUG_DRAW_QUEUE_CHUNK_SIZE;
+
+template<int Components>
+struct DebugChunkSoA
+{
+    std::int64_t expiryDateMillis[QueueChunkSize];
+    float        values[Components][QueueChunkSize];
+    std::uint8_t depthEnabled[QueueChunkSize];
+};
+
+template<typename T>
+struct DebugChunk
+{
+    T entries[QueueChunkSize];
+};
+
+template<typename Chunk>
+struct DebugQueue
+{
+    Chunk ** chunks;     // Allocated chunks: [0, chunkCount).
+    int      chunkSlots; // Size of the chunks array.
+    int      chunkCount;
+    int      peakChunks; // Most chunks in use on a flush since the last trim.
+    int      flushes;    // Flushes since the last trim.
+
+    DebugQueue() : chunks(nullptr), chunkSlots(0), chunkCount(0), peakChunks(0), flushes(0) { }
+};
+
+typedef DebugChunkSoA<PointComponentCount> DebugPointChunk;
+typedef DebugChunkSoA<LineComponentCount>  DebugLineChunk;
+
+typedef DebugQueue<DebugPointChunk>          DebugPointQueue;
+typedef DebugQueue<DebugLineChunk>           DebugLineQueue;
+typedef DebugQueue< DebugChunk<DebugString> > DebugStringQueue;
+typedef DebugQueue< DebugChunk<DebugShape> >  DebugShapeQueue;
+
+template<typename T>
+static inline T & queueEntry(DebugQueue< DebugChunk<T> > & queue, const int i)
+{
+    return queue.chunks[i / QueueChunkSize]->entries[i % QueueChunkSize];
+}
+
+// Appends a chunk to the queue. Returns false if out of memory.
+template<typename Chunk>
+static bool addDebugChunk(DebugQueue<Chunk> & queue)
+{
+    if (queue.chunkCount == queue.chunkSlots)
+    {
+        const int slots = (queue.chunkSlots == 0) ? 16 : queue.chunkSlots * 2;
+        Chunk ** const chunks = static_cast<Chunk **>(DD_MALLOC(sizeof(Chunk *) * slots));
+        if (chunks == nullptr)
+        {
+            return false;
+        }
+
+        for (int c = 0; c < queue.chunkCount; ++c)
+        {
+            chunks[c] = queue.chunks[c];
+        }
+        if (queue.chunks != nullptr)
+        {
+            DD_MFREE(queue.chunks);
+        }
+
+        queue.chunks     = chunks;
+        queue.chunkSlots = slots;
+    }
+
+    void * const buffer = DD_MALLOC(sizeof(Chunk));
+    if (buffer == nullptr)
+    {
+        return false;
+    }
+
+    queue.chunks[queue.chunkCount++] = ::new(buffer) Chunk;
+    return true;
+}
+
+// Makes room for entry 'i' (the one after the last), allocating its chunk if needed.
+template<typename Chunk>
+static inline bool growDebugQueue(DebugQueue<Chunk> & queue, const int i)
+{
+    return i < (queue.chunkCount * QueueChunkSize) || addDebugChunk(queue);
+}
+
+// Frees the chunks from 'keepChunks' on (all of them and the chunks array with zero).
+template<typename Chunk>
+static void releaseDebugChunks(DebugQueue<Chunk> & queue, const int keepChunks)
+{
+    while (queue.chunkCount > keepChunks)
+    {
+        Chunk * const chunk = queue.chunks[--queue.chunkCount];
+        chunk->~Chunk();
+        DD_MFREE(chunk);
+    }
+
+    if (queue.chunkCount == 0 && queue.chunks != nullptr)
+    {
+        DD_MFREE(queue.chunks);
+        queue.chunks     = nullptr;
+        queue.chunkSlots = 0;
+    }
+}
+
+// Called on every flush with the entries queued at that time. Returns how many chunks the
+// queue keeps: the most it used in the last DEBUG_DRAW_QUEUE_IDLE_FLUSHES flushes, once
+// every that many flushes (all of the allocated ones otherwise).
+template<typename Chunk>
+static int trimDebugQueue(DebugQueue<Chunk> & queue, const int queuedCount)
+{
+    const int usedChunks = (queuedCount + QueueChunkSize - 1) / QueueChunkSize;
+    if (usedChunks > queue.peakChunks)
+    {
+        queue.peakChunks = usedChunks;
+    }
+
+    if (++queue.flushes < DEBUG_DRAW_QUEUE_IDLE_FLUSHES)
+    {
+        return queue.chunkCount;
+    }
+
+    const int keepChunks = queue.peakChunks;
+    queue.peakChunks = 0;
+    queue.flushes    = 0;
+    return keepChunks;
+}
+
+template<typename Chunk>
+static inline std::size_t debugQueueBytes(const DebugQueue<Chunk> & queue)
+{
+    return (queue.chunkCount * sizeof(Chunk)) + (queue.chunkSlots * sizeof(Chunk *));
+}
+
 struct InternalContext DD_EXPLICIT_CONTEXT_ONLY(: public OpaqueContextType)
 {
     int                vertexBufferUsed;
+    int                depthlessVertsUsed;                          // Lines/points without depth test, in the second half of the vertex buffer.
+    int                shapeBufferUsed;
+    int                glyphBufferUsed;
     int                debugStringsCount;
     int                debugPointsCount;
     int                debugLinesCount;
+    int                debugShapesCount;
+    bool               shapeInstancing;                             // Shapes are queued as instances (RenderInterface::supportsShapeInstancing()).
+    bool               glyphInstancing;                             // Text goes out as glyph instances (RenderInterface::supportsGlyphInstancing()).
+    bool               cullEnabled;                                 // Lines and points are culled against cullMatrix on flush.
+    float              cullMatrix[16];                              // View * projection of dd::setCullMatrix().
+    FrameCounters      counters;                                    // Counting since the last dd::flush().
+    FrameCounters      lastCounters;                                // Of the last dd::flush().
     std::int64_t       currentTimeMillis;                           // Latest time value (in milliseconds) from dd::flush().
     GlyphTextureHandle glyphTexHandle;                              // Our built-in glyph bitmap. If kept null, no text is rendered.
     RenderInterface *  renderInterface;                             // Ref to the external renderer. Can be null for a no-op debug draw.
     DrawVertex         vertexBuffer[DEBUG_DRAW_VERTEX_BUFFER_SIZE]; // Vertex buffer we use to expand the lines/points before calling on RenderInterface.
-    DebugString        debugStrings[DEBUG_DRAW_MAX_STRINGS];        // Debug strings queue (2D screen-space strings + 3D projected labels).
-    DebugPoint         debugPoints[DEBUG_DRAW_MAX_POINTS];          // 3D debug points queue.
-    DebugLine          debugLines[DEBUG_DRAW_MAX_LINES];            // 3D debug lines queue.
+    DebugStringQueue   debugStrings;                                // Debug strings queue (2D screen-space strings + 3D projected labels).
+    DebugPointQueue    debugPoints;                                 // 3D debug points queue.
+    DebugLineQueue     debugLines;                                  // 3D debug lines queue.
+    ShapeInstance      shapeBuffer[DEBUG_DRAW_SHAPE_BUFFER_SIZE];   // Instances of a shape type we gather before calling on RenderInterface.
+    GlyphInstance      glyphBuffer[DEBUG_DRAW_GLYPH_BUFFER_SIZE];   // Glyph instances we gather before calling on RenderInterface.
+    DebugShapeQueue    debugShapes;                                 // Instanced shapes queue.
 
     InternalContext(RenderInterface * renderer)
         : vertexBufferUsed(0)
+        , depthlessVertsUsed(0)
+        , shapeBufferUsed(0)
+        , glyphBufferUsed(0)
         , debugStringsCount(0)
         , debugPointsCount(0)
         , debugLinesCount(0)
+        , debugShapesCount(0)
+        , shapeInstancing(renderer != nullptr && renderer->supportsShapeInstancing())
+        , glyphInstancing(renderer != nullptr && renderer->supportsGlyphInstancing())
+        , cullEnabled(false)
+        , counters()
+        , lastCounters()
         , currentTimeMillis(0)
         , glyphTexHandle(nullptr)
         , renderInterface(renderer)
@@ -2147,9 +2516,18 @@ enum DrawMode
     DrawModeText
 };
 
+// Lines and points are partitioned by depth mode in a single pass: the ones with depth
+// test go to the first half of the vertex buffer, the others to the second half.
+// Text uses the whole buffer (lines and points are always flushed before it).
+static const int HalfVertexBuffer = DEBUG_DRAW_VERTEX_BUFFER_SIZE / 2;
+
 static void flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DrawMode mode, const bool depthEnabled)
 {
-    if (DD_CONTEXT->vertexBufferUsed == 0)
+    const bool secondHalf = (mode != DrawModeText && !depthEnabled);
+    int & used = secondHalf ? DD_CONTEXT->depthlessVertsUsed : DD_CONTEXT->vertexBufferUsed;
+    const DrawVertex * const verts = DD_CONTEXT->vertexBuffer + (secondHalf ? HalfVertexBuffer : 0);
+
+    if (used == 0)
     {
         return;
     }
@@ -2157,69 +2535,128 @@ static void flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const D
     switch (mode)
     {
     case DrawModePoints :
-        DD_CONTEXT->renderInterface->drawPointList(DD_CONTEXT->vertexBuffer,
-                                                   DD_CONTEXT->vertexBufferUsed,
-                                                   depthEnabled);
+        DD_CONTEXT->renderInterface->drawPointList(verts, used, depthEnabled);
         break;
     case DrawModeLines :
-        DD_CONTEXT->renderInterface->drawLineList(DD_CONTEXT->vertexBuffer,
-                                                  DD_CONTEXT->vertexBufferUsed,
-                                                  depthEnabled);
+        DD_CONTEXT->renderInterface->drawLineList(verts, used, depthEnabled);
         break;
     case DrawModeText :
-        DD_CONTEXT->renderInterface->drawGlyphList(DD_CONTEXT->vertexBuffer,
-                                                   DD_CONTEXT->vertexBufferUsed,
-                                                   DD_CONTEXT->glyphTexHandle);
+        DD_CONTEXT->renderInterface->drawGlyphList(verts, used, DD_CONTEXT->glyphTexHandle);
         break;
     } // switch (mode)
 
-    DD_CONTEXT->vertexBufferUsed = 0;
+    used = 0;
 }
 
-static void pushPointVert(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DebugPoint & point)
+// Room for 'count' more line/point verts in the half of the depth mode (flushed first if full).
+static DrawVertex * reserveVerts(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DrawMode mode, const bool depthEnabled, const int count)
 {
-    // Make room for one more vert:
-    if ((DD_CONTEXT->vertexBufferUsed + 1) >= DEBUG_DRAW_VERTEX_BUFFER_SIZE)
+    int & used = depthEnabled ? DD_CONTEXT->vertexBufferUsed : DD_CONTEXT->depthlessVertsUsed;
+    if ((used + count) > HalfVertexBuffer)
     {
-        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModePoints, point.depthEnabled);
+        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) mode, depthEnabled);
     }
 
-    DrawVertex & v = DD_CONTEXT->vertexBuffer[DD_CONTEXT->vertexBufferUsed++];
-    v.point.x      = point.position[X];
-    v.point.y      = point.position[Y];
-    v.point.z      = point.position[Z];
-    v.point.r      = point.color[X];
-    v.point.g      = point.color[Y];
-    v.point.b      = point.color[Z];
-    v.point.size   = point.size;
+    DrawVertex * const verts = DD_CONTEXT->vertexBuffer + (depthEnabled ? 0 : HalfVertexBuffer) + used;
+    used += count;
+    return verts;
+}
+
+static void pushPointVert(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DebugPointChunk & points, const int i)
+{
+    DrawVertex & v = *reserveVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModePoints, points.depthEnabled[i] != 0, 1);
+    v.point.x      = points.values[PointX][i];
+    v.point.y      = points.values[PointY][i];
+    v.point.z      = points.values[PointZ][i];
+    v.point.r      = points.values[PointR][i];
+    v.point.g      = points.values[PointG][i];
+    v.point.b      = points.values[PointB][i];
+    v.point.size   = points.values[PointSize][i];
 }
 
-static void pushLineVert(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DebugLine & line)
+static void pushLineVert(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DebugLineChunk & lines, const int i)
 {
-    // Make room for two more verts:
-    if ((DD_CONTEXT->vertexBufferUsed + 2) >= DEBUG_DRAW_VERTEX_BUFFER_SIZE)
+    DrawVertex * const v = reserveVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeLines, lines.depthEnabled[i] != 0, 2);
+
+    v[0].line.x = lines.values[LineFromX][i];
+    v[0].line.y = lines.values[LineFromY][i];
+    v[0].line.z = lines.values[LineFromZ][i];
+    v[0].line.r = lines.values[LineR][i];
+    v[0].line.g = lines.values[LineG][i];
+    v[0].line.b = lines.values[LineB][i];
+
+    v[1].line.x = lines.values[LineToX][i];
+    v[1].line.y = lines.values[LineToY][i];
+    v[1].line.z = lines.values[LineToZ][i];
+    v[1].line.r = lines.values[LineR][i];
+    v[1].line.g = lines.values[LineG][i];
+    v[1].line.b = lines.values[LineB][i];
+}
+
+// Clip planes a point is out of (one bit per plane), 'm' is the cull matrix.
+static inline int clipOutcode(const float x, const float y, const float z, const float * const m)
+{
+    const float cx = (m[0] * x) + (m[4] * y) + (m[8]  * z) + m[12];
+    const float cy = (m[1] * x) + (m[5] * y) + (m[9]  * z) + m[13];
+    const float cz = (m[2] * x) + (m[6] * y) + (m[10] * z) + m[14];
+    const float cw = (m[3] * x) + (m[7] * y) + (m[11] * z) + m[15];
+
+    return (cx < -cw) | ((cx > cw) << 1) | ((cy < -cw) << 2) | ((cy > cw) << 3) | ((cz < -cw) << 4) | ((cz > cw) << 5);
+}
+
+#if DEBUG_DRAW_USE_SSE
+
+// Same as clipOutcode() for 4 points, one mask per plane. 'm' is the cull matrix broadcast.
+static inline void clipPlanesSSE(__m128 planes[6], const __m128 x, const __m128 y, const __m128 z, const __m128 * const m)
+{
+    const __m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], x), _mm_mul_ps(m[4], y)), _mm_add_ps(_mm_mul_ps(m[8],  z), m[12]));
+    const __m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[1], x), _mm_mul_ps(m[5], y)), _mm_add_ps(_mm_mul_ps(m[9],  z), m[13]));
+    const __m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[2], x), _mm_mul_ps(m[6], y)), _mm_add_ps(_mm_mul_ps(m[10], z), m[14]));
+    const __m128 cw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[3], x), _mm_mul_ps(m[7], y)), _mm_add_ps(_mm_mul_ps(m[11], z), m[15]));
+    const __m128 negW = _mm_sub_ps(_mm_setzero_ps(), cw);
+
+    planes[0] = _mm_cmplt_ps(cx, negW);
+    planes[1] = _mm_cmpgt_ps(cx, cw);
+    planes[2] = _mm_cmplt_ps(cy, negW);
+    planes[3] = _mm_cmpgt_ps(cy, cw);
+    planes[4] = _mm_cmplt_ps(cz, negW);
+    planes[5] = _mm_cmpgt_ps(cz, cw);
+}
+
+static inline void broadcastMatrixSSE(__m128 result[16], const float * const m)
+{
+    for (int i = 0; i < 16; ++i)
     {
-        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeLines, line.depthEnabled);
+        result[i] = _mm_set1_ps(m[i]);
     }
+}
 
-    DrawVertex & v0 = DD_CONTEXT->vertexBuffer[DD_CONTEXT->vertexBufferUsed++];
-    DrawVertex & v1 = DD_CONTEXT->vertexBuffer[DD_CONTEXT->vertexBufferUsed++];
+// Room for a group of 4 entries ('count' verts) in both halves.
+static inline void reserveGroupVerts(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DrawMode mode, const int count)
+{
+    if ((DD_CONTEXT->vertexBufferUsed + count) > HalfVertexBuffer)
+    {
+        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) mode, true);
+    }
+    if ((DD_CONTEXT->depthlessVertsUsed + count) > HalfVertexBuffer)
+    {
+        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) mode, false);
+    }
+}
 
-    v0.line.x = line.posFrom[X];
-    v0.line.y = line.posFrom[Y];
-    v0.line.z = line.posFrom[Z];
-    v0.line.r = line.color[X];
-    v0.line.g = line.color[Y];
-    v0.line.b = line.color[Z];
+// Depth flags of 4 queue entries as 4 bits.
+static inline int bitCount4(const int mask)
+{
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
 
-    v1.line.x = line.posTo[X];
-    v1.line.y = line.posTo[Y];
-    v1.line.z = line.posTo[Z];
-    v1.line.r = line.color[X];
-    v1.line.g = line.color[Y];
-    v1.line.b = line.color[Z];
+static inline int depthMask4(const std::uint8_t * const depthEnabled)
+{
+    return (depthEnabled[0] != 0) | ((depthEnabled[1] != 0) << 1) | ((depthEnabled[2] != 0) << 2) | ((depthEnabled[3] != 0) << 3);
 }
 
+#endif // DEBUG_DRAW_USE_SSE
+
 static void pushGlyphVerts(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const DrawVertex verts[4])
 {
     static const int indexes[6] = { 0, 1, 2, 2, 1, 3 };
@@ -2314,6 +2751,79 @@ static void pushStringGlyphs(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) float
     }
 }
 
+static void flushGlyphInstances(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
+{
+    if (DD_CONTEXT->glyphBufferUsed == 0)
+    {
+        return;
+    }
+
+    DD_CONTEXT->renderInterface->drawGlyphInstances(DD_CONTEXT->glyphBuffer, DD_CONTEXT->glyphBufferUsed, DD_CONTEXT->glyphTexHandle);
+    DD_CONTEXT->glyphBufferUsed = 0;
+}
+
+static inline std::uint8_t packColorChannel(const float value)
+{
+    return static_cast<std::uint8_t>((value <= 0.0f) ? 0.0f : (value >= 1.0f) ? 255.0f : (value * 255.0f + 0.5f));
+}
+
+// Same layout as pushStringGlyphs(), one instance per character (16 bytes instead of 6 vertexes).
+static void pushStringInstances(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) float x, float y,
+                                const char * text, ddVec3_In color, const float scaling)
+{
+    // Invariants for all characters:
+    const float initialX    = x;
+    const float fixedWidth  = static_cast<float>(getFontCharSet().charWidth);
+    const float fixedHeight = static_cast<float>(getFontCharSet().charHeight);
+    const float tabW        = fixedWidth  * 4.0f * scaling; // TAB = 4 spaces.
+    const float chrW        = fixedWidth  * scaling;
+    const float chrH        = fixedHeight * scaling;
+    const float fixedScale  = scaling * 256.0f + 0.5f;
+
+    GlyphInstance glyph;
+    glyph.scaling  = static_cast<std::uint16_t>((fixedScale >= 65535.0f) ? 65535.0f : fixedScale);
+    glyph.color[0] = packColorChannel(color[X]);
+    glyph.color[1] = packColorChannel(color[Y]);
+    glyph.color[2] = packColorChannel(color[Z]);
+    glyph.color[3] = 255;
+
+    for (; *text != '\0'; ++text)
+    {
+        const int charVal = *text;
+        if (charVal < 0 || charVal >= FontCharSet::MaxChars)
+        {
+            continue;
+        }
+        if (charVal == ' ')
+        {
+            x += chrW;
+            continue;
+        }
+        if (charVal == '\t')
+        {
+            x += tabW;
+            continue;
+        }
+        if (charVal == '\n')
+        {
+            y += chrH;
+            x  = initialX;
+            continue;
+        }
+
+        if (DD_CONTEXT->glyphBufferUsed == DEBUG_DRAW_GLYPH_BUFFER_SIZE)
+        {
+            flushGlyphInstances(DD_EXPLICIT_CONTEXT_ONLY(ctx));
+        }
+
+        glyph.x     = x;
+        glyph.y     = y;
+        glyph.glyph = static_cast<std::uint16_t>(charVal);
+        DD_CONTEXT->glyphBuffer[DD_CONTEXT->glyphBufferUsed++] = glyph;
+        x += chrW;
+    }
+}
+
 static float calcTextWidth(const char * text, const float scaling)
 {
     const float fixedWidth = static_cast<float>(getFontCharSet().charWidth);
@@ -2345,25 +2855,33 @@ static void drawDebugStrings(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
         return;
     }
 
-    const DebugString * const debugStrings = DD_CONTEXT->debugStrings;
+    const bool instanced = DD_CONTEXT->glyphInstancing;
 
     for (int i = 0; i < count; ++i)
     {
-        const DebugString & dstr = debugStrings[i];
-        if (dstr.centered)
+        const DebugString & dstr = queueEntry(DD_CONTEXT->debugStrings, i);
+
+        // 3D Labels are centered at the point of origin, e.g. center-aligned. The rest are left-aligned.
+        const float x = dstr.centered ? dstr.posX - calcTextWidth(dstr.text.c_str(), dstr.scaling) * 0.5f : dstr.posX;
+
+        if (instanced)
         {
-            // 3D Labels are centered at the point of origin, e.g. center-aligned.
-            const float offset = calcTextWidth(dstr.text.c_str(), dstr.scaling) * 0.5f;
-            pushStringGlyphs(DD_EXPLICIT_CONTEXT_ONLY(ctx,) dstr.posX - offset, dstr.posY, dstr.text.c_str(), dstr.color, dstr.scaling);
+            pushStringInstances(DD_EXPLICIT_CONTEXT_ONLY(ctx,) x, dstr.posY, dstr.text.c_str(), dstr.color, dstr.scaling);
         }
         else
         {
-            // Left-aligned
-            pushStringGlyphs(DD_EXPLICIT_CONTEXT_ONLY(ctx,) dstr.posX, dstr.posY, dstr.text.c_str(), dstr.color, dstr.scaling);
+            pushStringGlyphs(DD_EXPLICIT_CONTEXT_ONLY(ctx,) x, dstr.posY, dstr.text.c_str(), dstr.color, dstr.scaling);
         }
     }
 
-    flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeText, false);
+    if (instanced)
+    {
+        flushGlyphInstances(DD_EXPLICIT_CONTEXT_ONLY(ctx));
+    }
+    else
+    {
+        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeText, false);
+    }
 }
 
 static void drawDebugPoints(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
@@ -2374,38 +2892,88 @@ static void drawDebugPoints(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
         return;
     }
 
-    const DebugPoint * const debugPoints = DD_CONTEXT->debugPoints;
+    const float * const cullMatrix = DD_CONTEXT->cullEnabled ? DD_CONTEXT->cullMatrix : nullptr;
+    int culled = 0;
 
-    //
-    // First pass, points with depth test ENABLED:
-    //
-    int numDepthlessPoints = 0;
-    for (int i = 0; i < count; ++i)
+    #if DEBUG_DRAW_USE_SSE
+    __m128 m[16];
+    if (cullMatrix != nullptr)
     {
-        const DebugPoint & point = debugPoints[i];
-        if (point.depthEnabled)
-        {
-            pushPointVert(DD_EXPLICIT_CONTEXT_ONLY(ctx,) point);
-        }
-        numDepthlessPoints += !point.depthEnabled;
+        broadcastMatrixSSE(m, cullMatrix);
     }
-    flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModePoints, true);
+    #endif // DEBUG_DRAW_USE_SSE
 
     //
-    // Second pass draws points with depth DISABLED:
+    // One pass per chunk: cull, then pack each visible point into the half of its depth mode.
     //
-    if (numDepthlessPoints > 0)
+    for (int first = 0; first < count; first += QueueChunkSize)
     {
-        for (int i = 0; i < count; ++i)
+        const DebugPointChunk & points = *DD_CONTEXT->debugPoints.chunks[first / QueueChunkSize];
+        const int chunkUsed = (count - first < QueueChunkSize) ? (count - first) : QueueChunkSize;
+        int i = 0;
+
+        #if DEBUG_DRAW_USE_SSE
+        for (; i + 4 <= chunkUsed; i += 4)
         {
-            const DebugPoint & point = debugPoints[i];
-            if (!point.depthEnabled)
+            const __m128 x = _mm_loadu_ps(&points.values[PointX][i]);
+            const __m128 y = _mm_loadu_ps(&points.values[PointY][i]);
+            const __m128 z = _mm_loadu_ps(&points.values[PointZ][i]);
+
+            int visible = 0xF;
+            if (cullMatrix != nullptr)
+            {
+                __m128 planes[6];
+                clipPlanesSSE(planes, x, y, z, m);
+
+                const __m128 outside = _mm_or_ps(_mm_or_ps(_mm_or_ps(planes[0], planes[1]), _mm_or_ps(planes[2], planes[3])), _mm_or_ps(planes[4], planes[5]));
+                visible = ~_mm_movemask_ps(outside) & 0xF;
+                culled += 4 - bitCount4(visible);
+            }
+            if (visible == 0)
             {
-                pushPointVert(DD_EXPLICIT_CONTEXT_ONLY(ctx,) point);
+                continue;
             }
+
+            // Rows of (x, y, z, r), stored with a single unaligned store per vertex:
+            __m128 rows[4] = { x, y, z, _mm_loadu_ps(&points.values[PointR][i]) };
+            _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+
+            // Every lane is written, only the visible ones advance their half (no branches per lane):
+            reserveGroupVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModePoints, 4);
+
+            const int depthMask = depthMask4(&points.depthEnabled[i]);
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const int depth = (depthMask >> lane) & 1;
+                int & used = depth ? DD_CONTEXT->vertexBufferUsed : DD_CONTEXT->depthlessVertsUsed;
+
+                DrawVertex & v = DD_CONTEXT->vertexBuffer[(depth ? 0 : HalfVertexBuffer) + used];
+                _mm_storeu_ps(&v.point.x, rows[lane]);
+                v.point.g    = points.values[PointG][i + lane];
+                v.point.b    = points.values[PointB][i + lane];
+                v.point.size = points.values[PointSize][i + lane];
+
+                used += (visible >> lane) & 1;
+            }
+        }
+        #endif // DEBUG_DRAW_USE_SSE
+
+        for (; i < chunkUsed; ++i)
+        {
+            if (cullMatrix != nullptr && clipOutcode(points.values[PointX][i], points.values[PointY][i], points.values[PointZ][i], cullMatrix) != 0)
+            {
+                ++culled;
+                continue;
+            }
+            pushPointVert(DD_EXPLICIT_CONTEXT_ONLY(ctx,) points, i);
         }
-        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModePoints, false);
     }
+
+    DD_CONTEXT->counters.points.culled += culled;
+
+    // Points with depth test ENABLED first:
+    flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModePoints, true);
+    flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModePoints, false);
 }
 
 static void drawDebugLines(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
@@ -2416,42 +2984,149 @@ static void drawDebugLines(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
         return;
     }
 
-    const DebugLine * const debugLines = DD_CONTEXT->debugLines;
+    const float * const cullMatrix = DD_CONTEXT->cullEnabled ? DD_CONTEXT->cullMatrix : nullptr;
+    int culled = 0;
+
+    #if DEBUG_DRAW_USE_SSE
+    __m128 m[16];
+    if (cullMatrix != nullptr)
+    {
+        broadcastMatrixSSE(m, cullMatrix);
+    }
+    #endif // DEBUG_DRAW_USE_SSE
 
     //
-    // First pass, lines with depth test ENABLED:
+    // One pass per chunk: cull, then pack each visible line into the half of its depth mode.
     //
-    int numDepthlessLines = 0;
-    for (int i = 0; i < count; ++i)
+    for (int first = 0; first < count; first += QueueChunkSize)
     {
-        const DebugLine & line = debugLines[i];
-        if (line.depthEnabled)
+        const DebugLineChunk & lines = *DD_CONTEXT->debugLines.chunks[first / QueueChunkSize];
+        const int chunkUsed = (count - first < QueueChunkSize) ? (count - first) : QueueChunkSize;
+        int i = 0;
+
+        #if DEBUG_DRAW_USE_SSE
+        for (; i + 4 <= chunkUsed; i += 4)
         {
-            pushLineVert(DD_EXPLICIT_CONTEXT_ONLY(ctx,) line);
+            __m128 from[4] = { _mm_loadu_ps(&lines.values[LineFromX][i]), _mm_loadu_ps(&lines.values[LineFromY][i]),
+                               _mm_loadu_ps(&lines.values[LineFromZ][i]), _mm_loadu_ps(&lines.values[LineR][i]) };
+            __m128 to[4]   = { _mm_loadu_ps(&lines.values[LineToX][i]), _mm_loadu_ps(&lines.values[LineToY][i]),
+                               _mm_loadu_ps(&lines.values[LineToZ][i]), from[3] };
+
+            int visible = 0xF;
+            if (cullMatrix != nullptr)
+            {
+                // Culled when both ends are out of the same plane:
+                __m128 planesFrom[6], planesTo[6];
+                clipPlanesSSE(planesFrom, from[0], from[1], from[2], m);
+                clipPlanesSSE(planesTo, to[0], to[1], to[2], m);
+
+                __m128 outside = _mm_and_ps(planesFrom[0], planesTo[0]);
+                for (int plane = 1; plane < 6; ++plane)
+                {
+                    outside = _mm_or_ps(outside, _mm_and_ps(planesFrom[plane], planesTo[plane]));
+                }
+                visible = ~_mm_movemask_ps(outside) & 0xF;
+                culled += 4 - bitCount4(visible);
+            }
+            if (visible == 0)
+            {
+                continue;
+            }
+
+            // Rows of (x, y, z, r), stored with a single unaligned store per vertex:
+            _MM_TRANSPOSE4_PS(from[0], from[1], from[2], from[3]);
+            _MM_TRANSPOSE4_PS(to[0], to[1], to[2], to[3]);
+
+            // Every lane is written, only the visible ones advance their half (no branches per lane):
+            reserveGroupVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeLines, 8);
+
+            const int depthMask = depthMask4(&lines.depthEnabled[i]);
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const int depth = (depthMask >> lane) & 1;
+                int & used = depth ? DD_CONTEXT->vertexBufferUsed : DD_CONTEXT->depthlessVertsUsed;
+
+                DrawVertex * const v = &DD_CONTEXT->vertexBuffer[(depth ? 0 : HalfVertexBuffer) + used];
+                _mm_storeu_ps(&v[0].line.x, from[lane]);
+                _mm_storeu_ps(&v[1].line.x, to[lane]);
+                v[0].line.g = v[1].line.g = lines.values[LineG][i + lane];
+                v[0].line.b = v[1].line.b = lines.values[LineB][i + lane];
+
+                used += ((visible >> lane) & 1) * 2;
+            }
+        }
+        #endif // DEBUG_DRAW_USE_SSE
+
+        for (; i < chunkUsed; ++i)
+        {
+            if (cullMatrix != nullptr)
+            {
+                const int outFrom = clipOutcode(lines.values[LineFromX][i], lines.values[LineFromY][i], lines.values[LineFromZ][i], cullMatrix);
+                const int outTo   = clipOutcode(lines.values[LineToX][i], lines.values[LineToY][i], lines.values[LineToZ][i], cullMatrix);
+                if ((outFrom & outTo) != 0)
+                {
+                    ++culled;
+                    continue;
+                }
+            }
+            pushLineVert(DD_EXPLICIT_CONTEXT_ONLY(ctx,) lines, i);
         }
-        numDepthlessLines += !line.depthEnabled;
     }
+
+    DD_CONTEXT->counters.lines.culled += culled;
+
+    // Lines with depth test ENABLED first:
     flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeLines, true);
+    flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeLines, false);
+}
+
+static void flushDebugShapes(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const ShapeType shape, const bool depthEnabled)
+{
+    if (DD_CONTEXT->shapeBufferUsed == 0)
+    {
+        return;
+    }
+
+    DD_CONTEXT->renderInterface->drawShapeList(shape, DD_CONTEXT->shapeBuffer, DD_CONTEXT->shapeBufferUsed, depthEnabled);
+    DD_CONTEXT->shapeBufferUsed = 0;
+}
+
+static void drawDebugShapes(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
+{
+    const int count = DD_CONTEXT->debugShapesCount;
+    if (count == 0)
+    {
+        return;
+    }
 
     //
-    // Second pass draws lines with depth DISABLED:
+    // One batch per shape type, shapes with depth test ENABLED first:
     //
-    if (numDepthlessLines > 0)
+    for (int pass = 0; pass < 2; ++pass)
     {
-        for (int i = 0; i < count; ++i)
+        const bool depthEnabled = (pass == 0);
+
+        for (int shape = 0; shape < ShapeCount; ++shape)
         {
-            const DebugLine & line = debugLines[i];
-            if (!line.depthEnabled)
+            for (int i = 0; i < count; ++i)
             {
-                pushLineVert(DD_EXPLICIT_CONTEXT_ONLY(ctx,) line);
+                const DebugShape & dshape = queueEntry(DD_CONTEXT->debugShapes, i);
+                if (dshape.shape == shape && dshape.depthEnabled == depthEnabled)
+                {
+                    if (DD_CONTEXT->shapeBufferUsed == DEBUG_DRAW_SHAPE_BUFFER_SIZE)
+                    {
+                        flushDebugShapes(DD_EXPLICIT_CONTEXT_ONLY(ctx,) ShapeType(shape), depthEnabled);
+                    }
+                    DD_CONTEXT->shapeBuffer[DD_CONTEXT->shapeBufferUsed++] = dshape.instance;
+                }
             }
+            flushDebugShapes(DD_EXPLICIT_CONTEXT_ONLY(ctx,) ShapeType(shape), depthEnabled);
         }
-        flushDebugVerts(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DrawModeLines, false);
     }
 }
 
 template<typename T>
-static void clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) T * queue, int & queueCount)
+static void clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) DebugQueue< DebugChunk<T> > & queue, int & queueCount)
 {
     const std::int64_t time = DD_CONTEXT->currentTimeMillis;
     if (time == 0)
@@ -2461,16 +3136,16 @@ static void clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) T * que
     }
 
     int index = 0;
-    T * pElem = queue;
 
     // Concatenate elements that still need to be draw on future frames:
-    for (int i = 0; i < queueCount; ++i, ++pElem)
+    for (int i = 0; i < queueCount; ++i)
     {
-        if (pElem->expiryDateMillis > time)
+        T & elem = queueEntry(queue, i);
+        if (elem.expiryDateMillis > time)
         {
             if (index != i)
             {
-                queue[index] = *pElem;
+                queueEntry(queue, index) = elem;
             }
             ++index;
         }
@@ -2479,6 +3154,180 @@ static void clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) T * que
     queueCount = index;
 }
 
+#if DEBUG_DRAW_USE_SSE
+
+// pshufb (_mm_shuffle_epi8) is SSSE3, the rest of the kernels only need SSE2. It's guaranteed when the
+// compiler targets it; MSVC only promises SSE2 on x86/x64, so the CPU is asked once.
+static bool cpuHasSSSE3()
+{
+    #if defined(__SSSE3__) || defined(__AVX__)
+    return true;
+    #elif defined(_MSC_VER)
+    static const bool ssse3 = []()
+    {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) != 0;
+    }();
+    return ssse3;
+    #else // !MSVC
+    #error "DEBUG_DRAW_USE_SSE needs SSSE3 enabled in the compiler (-mssse3) or DEBUG_DRAW_USE_SSE 0"
+    #endif // SSSE3
+}
+
+// pshufb controls that move the floats of the lanes set in a 4 bit mask to the front, in order.
+static const __m128i * leftPackShuffles()
+{
+    struct Table
+    {
+        __m128i shuffles[16];
+
+        Table()
+        {
+            for (int mask = 0; mask < 16; ++mask)
+            {
+                std::uint8_t bytes[16];
+                int packed = 0;
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    if (mask & (1 << lane))
+                    {
+                        for (int b = 0; b < 4; ++b)
+                        {
+                            bytes[packed * 4 + b] = static_cast<std::uint8_t>(lane * 4 + b);
+                        }
+                        ++packed;
+                    }
+                }
+                for (int b = packed * 4; b < 16; ++b)
+                {
+                    bytes[b] = 0x80; // (zero)
+                }
+                shuffles[mask] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+            }
+        }
+    };
+
+    static const Table table;
+    return table.shuffles;
+}
+
+#endif // DEBUG_DRAW_USE_SSE
+
+template<int Components>
+static inline void copyChunkEntry(DebugChunkSoA<Components> & dest, const int d, const DebugChunkSoA<Components> & src, const int s)
+{
+    for (int c = 0; c < Components; ++c)
+    {
+        dest.values[c][d] = src.values[c][s];
+    }
+    dest.expiryDateMillis[d] = src.expiryDateMillis[s];
+    dest.depthEnabled[d]     = src.depthEnabled[s];
+}
+
+// Same as above for the points and lines queues (structures of arrays): 4 entries at a time,
+// every component array is left-packed with a single shuffle.
+template<int Components>
+static void clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) DebugQueue< DebugChunkSoA<Components> > & queue, int & queueCount)
+{
+    typedef DebugChunkSoA<Components> Chunk;
+
+    const std::int64_t time = DD_CONTEXT->currentTimeMillis;
+    if (time == 0)
+    {
+        queueCount = 0;
+        return;
+    }
+
+    #if DEBUG_DRAW_USE_SSE
+    const __m128i * const shuffles = leftPackShuffles();
+    const bool ssse3 = cpuHasSSSE3(); // (without it everything goes through the scalar loop)
+    #endif // DEBUG_DRAW_USE_SSE
+
+    int index = 0;
+
+    for (int first = 0; first < queueCount; first += QueueChunkSize)
+    {
+        const Chunk & src = *queue.chunks[first / QueueChunkSize];
+        const int chunkUsed = (queueCount - first < QueueChunkSize) ? (queueCount - first) : QueueChunkSize;
+        int i = 0;
+
+        #if DEBUG_DRAW_USE_SSE
+        for (; ssse3 && i + 4 <= chunkUsed; i += 4)
+        {
+            const int keep = (src.expiryDateMillis[i]     > time)        | ((src.expiryDateMillis[i + 1] > time) << 1) |
+                             ((src.expiryDateMillis[i + 2] > time) << 2) | ((src.expiryDateMillis[i + 3] > time) << 3);
+
+            if (keep == 0xF && index == first + i)
+            {
+                index += 4; // Nothing moves.
+                continue;
+            }
+
+            Chunk & dest = *queue.chunks[index / QueueChunkSize];
+            const int d = index % QueueChunkSize;
+
+            if (d + 4 > QueueChunkSize) // (the group would cross into the next chunk, once per chunk at most)
+            {
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    if (keep & (1 << lane))
+                    {
+                        copyChunkEntry(*queue.chunks[index / QueueChunkSize], index % QueueChunkSize, src, i + lane);
+                        ++index;
+                    }
+                }
+                continue;
+            }
+
+            // (the 4 floats stored at 'index' never go past the ones just loaded, since index <= first + i)
+            for (int c = 0; c < Components; ++c)
+            {
+                const __m128i packed = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&src.values[c][i])), shuffles[keep]);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(&dest.values[c][d]), packed);
+            }
+
+            int kept = 0;
+            for (int lane = 0; lane < 4; ++lane) // (written always, kept if the index advances)
+            {
+                dest.expiryDateMillis[d + kept] = src.expiryDateMillis[i + lane];
+                dest.depthEnabled[d + kept]     = src.depthEnabled[i + lane];
+                kept += (keep >> lane) & 1;
+            }
+            index += kept;
+        }
+        #endif // DEBUG_DRAW_USE_SSE
+
+        for (; i < chunkUsed; ++i)
+        {
+            if (src.expiryDateMillis[i] > time)
+            {
+                if (index != first + i)
+                {
+                    copyChunkEntry(*queue.chunks[index / QueueChunkSize], index % QueueChunkSize, src, i);
+                }
+                ++index;
+            }
+        }
+    }
+
+    queueCount = index;
+}
+
+#ifdef DEBUG_DRAW_STR_DEALLOC_FUNC
+// Every string of the chunks from 'firstChunk' on (used or not).
+static void deallocDebugStrings(DebugStringQueue & queue, const int firstChunk)
+{
+    for (int c = firstChunk; c < queue.chunkCount; ++c)
+    {
+        for (int i = 0; i < QueueChunkSize; ++i)
+        {
+            DEBUG_DRAW_STR_DEALLOC_FUNC(queue.chunks[c]->entries[i].text);
+        }
+    }
+}
+#endif // DEBUG_DRAW_STR_DEALLOC_FUNC
+
 static void setupGlyphTexture(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
 {
     if (DD_CONTEXT->renderInterface == nullptr)
@@ -2492,6 +3341,16 @@ static void setupGlyphTexture(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
         DD_CONTEXT->glyphTexHandle = nullptr;
     }
 
+    // The renderer may have it already (no need to decompress the bitmap then):
+    DD_CONTEXT->glyphTexHandle = DD_CONTEXT->renderInterface->findGlyphTexture(
+                                        getFontCharSet().bitmapWidth,
+                                        getFontCharSet().bitmapHeight,
+                                        getFontBitmapKey());
+    if (DD_CONTEXT->glyphTexHandle != nullptr)
+    {
+        return;
+    }
+
     std::uint8_t * decompressedBitmap = decompressFontBitmap();
     if (decompressedBitmap == nullptr)
     {
@@ -2544,19 +3403,21 @@ void shutdown(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
     {
         // If this macro is defined, the user-provided ddStr type
         // needs some extra cleanup before shutdown, so we run for
-        // all entries in the debugStrings[] array.
+        // all entries in the debugStrings chunks.
         //
         // We could call std::string::clear() here, but clear()
         // doesn't deallocate memory in std string, so we might
         // as well let the default destructor do the cleanup,
         // when using the default (AKA std::string) ddStr.
         #ifdef DEBUG_DRAW_STR_DEALLOC_FUNC
-        for (int i = 0; i < DEBUG_DRAW_MAX_STRINGS; ++i)
-        {
-            DEBUG_DRAW_STR_DEALLOC_FUNC(DD_CONTEXT->debugStrings[i].text);
-        }
+        deallocDebugStrings(DD_CONTEXT->debugStrings, 0);
         #endif // DEBUG_DRAW_STR_DEALLOC_FUNC
 
+        releaseDebugChunks(DD_CONTEXT->debugStrings, 0);
+        releaseDebugChunks(DD_CONTEXT->debugPoints,  0);
+        releaseDebugChunks(DD_CONTEXT->debugLines,   0);
+        releaseDebugChunks(DD_CONTEXT->debugShapes,  0);
+
         if (DD_CONTEXT->renderInterface != nullptr && DD_CONTEXT->glyphTexHandle != nullptr)
         {
             DD_CONTEXT->renderInterface->destroyGlyphTexture(DD_CONTEXT->glyphTexHandle);
@@ -2582,34 +3443,92 @@ bool hasPendingDraws(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
     {
         return false;
     }
-    return (DD_CONTEXT->debugStringsCount + DD_CONTEXT->debugPointsCount + DD_CONTEXT->debugLinesCount) > 0;
+    return (DD_CONTEXT->debugStringsCount + DD_CONTEXT->debugPointsCount + DD_CONTEXT->debugLinesCount + DD_CONTEXT->debugShapesCount) > 0;
 }
 
 void flush(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const std::int64_t currTimeMillis, const std::uint32_t flags)
 {
-    if (!hasPendingDraws(DD_EXPLICIT_CONTEXT_ONLY(ctx)))
+    if (!isInitialized(DD_EXPLICIT_CONTEXT_ONLY(ctx)))
     {
         return;
     }
 
-    // Save the last know time value for next dd::line/dd::point calls.
-    DD_CONTEXT->currentTimeMillis = currTimeMillis;
+    FrameCounters & counters = DD_CONTEXT->counters;
+    counters.strings.queued  = DD_CONTEXT->debugStringsCount;
+    counters.points.queued   = DD_CONTEXT->debugPointsCount;
+    counters.lines.queued    = DD_CONTEXT->debugLinesCount;
+    counters.shapes.queued   = DD_CONTEXT->debugShapesCount;
+
+    if (hasPendingDraws(DD_EXPLICIT_CONTEXT_ONLY(ctx)))
+    {
+        // Save the last know time value for next dd::line/dd::point calls.
+        DD_CONTEXT->currentTimeMillis = currTimeMillis;
+
+        // Let the user set common render states.
+        DD_CONTEXT->renderInterface->beginDraw();
+
+        // Issue the render calls:
+        if (flags & FlushLines)  { drawDebugLines(DD_EXPLICIT_CONTEXT_ONLY(ctx)); drawDebugShapes(DD_EXPLICIT_CONTEXT_ONLY(ctx)); }
+        if (flags & FlushPoints) { drawDebugPoints(DD_EXPLICIT_CONTEXT_ONLY(ctx));  }
+        if (flags & FlushText)   { drawDebugStrings(DD_EXPLICIT_CONTEXT_ONLY(ctx)); }
+
+        // And cleanup if needed.
+        DD_CONTEXT->renderInterface->endDraw();
+
+        // Remove all expired objects, regardless of draw flags:
+        clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DD_CONTEXT->debugStrings, DD_CONTEXT->debugStringsCount);
+        clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DD_CONTEXT->debugPoints,  DD_CONTEXT->debugPointsCount);
+        clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DD_CONTEXT->debugLines,   DD_CONTEXT->debugLinesCount);
+        clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DD_CONTEXT->debugShapes,  DD_CONTEXT->debugShapesCount);
+    }
+
+    // Give back the chunks the queues haven't needed lately (idle frames flush too):
+    const int keepStrings = trimDebugQueue(DD_CONTEXT->debugStrings, counters.strings.queued);
+    #ifdef DEBUG_DRAW_STR_DEALLOC_FUNC
+    deallocDebugStrings(DD_CONTEXT->debugStrings, keepStrings);
+    #endif // DEBUG_DRAW_STR_DEALLOC_FUNC
+    releaseDebugChunks(DD_CONTEXT->debugStrings, keepStrings);
+    releaseDebugChunks(DD_CONTEXT->debugPoints,  trimDebugQueue(DD_CONTEXT->debugPoints, counters.points.queued));
+    releaseDebugChunks(DD_CONTEXT->debugLines,   trimDebugQueue(DD_CONTEXT->debugLines,  counters.lines.queued));
+    releaseDebugChunks(DD_CONTEXT->debugShapes,  trimDebugQueue(DD_CONTEXT->debugShapes, counters.shapes.queued));
+
+    counters.queueBytes = debugQueueBytes(DD_CONTEXT->debugStrings) + debugQueueBytes(DD_CONTEXT->debugPoints) +
+                          debugQueueBytes(DD_CONTEXT->debugLines)   + debugQueueBytes(DD_CONTEXT->debugShapes);
 
-    // Let the user set common render states.
-    DD_CONTEXT->renderInterface->beginDraw();
+    DD_CONTEXT->lastCounters = counters;
+    counters = FrameCounters();
+}
 
-    // Issue the render calls:
-    if (flags & FlushLines)  { drawDebugLines(DD_EXPLICIT_CONTEXT_ONLY(ctx));   }
-    if (flags & FlushPoints) { drawDebugPoints(DD_EXPLICIT_CONTEXT_ONLY(ctx));  }
-    if (flags & FlushText)   { drawDebugStrings(DD_EXPLICIT_CONTEXT_ONLY(ctx)); }
+const FrameCounters & getFrameCounters(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
+{
+    if (DD_CONTEXT == nullptr)
+    {
+        static const FrameCounters none = FrameCounters();
+        return none;
+    }
+    return DD_CONTEXT->lastCounters;
+}
 
-    // And cleanup if needed.
-    DD_CONTEXT->renderInterface->endDraw();
+void setCullMatrix(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddMat4x4_In vpMatrix)
+{
+    if (!isInitialized(DD_EXPLICIT_CONTEXT_ONLY(ctx)))
+    {
+        return;
+    }
 
-    // Remove all expired objects, regardless of draw flags:
-    clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DD_CONTEXT->debugStrings, DD_CONTEXT->debugStringsCount);
-    clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DD_CONTEXT->debugPoints,  DD_CONTEXT->debugPointsCount);
-    clearDebugQueue(DD_EXPLICIT_CONTEXT_ONLY(ctx,) DD_CONTEXT->debugLines,   DD_CONTEXT->debugLinesCount);
+    for (int i = 0; i < 16; ++i)
+    {
+        DD_CONTEXT->cullMatrix[i] = vpMatrix[i];
+    }
+    DD_CONTEXT->cullEnabled = true;
+}
+
+void disableCulling(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
+{
+    if (isInitialized(DD_EXPLICIT_CONTEXT_ONLY(ctx)))
+    {
+        DD_CONTEXT->cullEnabled = false;
+    }
 }
 
 void clear(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
@@ -2621,16 +3540,182 @@ void clear(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx))
 
     // Let the user cleanup the debug strings:
     #ifdef DEBUG_DRAW_STR_DEALLOC_FUNC
-    for (int i = 0; i < DEBUG_DRAW_MAX_STRINGS; ++i)
+    deallocDebugStrings(DD_CONTEXT->debugStrings, 0);
+    #endif // DEBUG_DRAW_STR_DEALLOC_FUNC
+
+    DD_CONTEXT->vertexBufferUsed   = 0;
+    DD_CONTEXT->depthlessVertsUsed = 0;
+    DD_CONTEXT->shapeBufferUsed    = 0;
+    DD_CONTEXT->glyphBufferUsed    = 0;
+    DD_CONTEXT->debugStringsCount  = 0;
+    DD_CONTEXT->debugPointsCount   = 0;
+    DD_CONTEXT->debugLinesCount    = 0;
+    DD_CONTEXT->debugShapesCount   = 0;
+}
+
+static inline void shapeCopy(float dest[3], ddVec3_In src) // (ddVec3 may be a user type)
+{
+    dest[X] = src[X];
+    dest[Y] = src[Y];
+    dest[Z] = src[Z];
+}
+
+static void shapeInstance(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const ShapeType shape, ddVec3_In axisX, ddVec3_In axisY,
+                          ddVec3_In axisZ, ddVec3_In origin, ddVec3_In color, const int durationMillis, const bool depthEnabled)
+{
+    if (DD_CONTEXT->debugShapesCount == DEBUG_DRAW_MAX_SHAPES || !growDebugQueue(DD_CONTEXT->debugShapes, DD_CONTEXT->debugShapesCount))
+    {
+        ++DD_CONTEXT->counters.shapes.dropped;
+        DEBUG_DRAW_OVERFLOWED("DEBUG_DRAW_MAX_SHAPES limit reached! Dropping further debug shape draws.");
+        return;
+    }
+
+    ++DD_CONTEXT->counters.shapes.submitted;
+
+    DebugShape & dshape     = queueEntry(DD_CONTEXT->debugShapes, DD_CONTEXT->debugShapesCount++);
+    dshape.expiryDateMillis = DD_CONTEXT->currentTimeMillis + durationMillis;
+    dshape.shape            = shape;
+    dshape.depthEnabled     = depthEnabled;
+
+    shapeCopy(dshape.instance.axisX, axisX);
+    shapeCopy(dshape.instance.axisY, axisY);
+    shapeCopy(dshape.instance.axisZ, axisZ);
+    shapeCopy(dshape.instance.origin, origin);
+    shapeCopy(dshape.instance.color, color);
+}
+
+static void shapeMeshLine(float * positions, int & count, ddVec3_In from, ddVec3_In to)
+{
+    if (positions != nullptr)
     {
-        DEBUG_DRAW_STR_DEALLOC_FUNC(DD_CONTEXT->debugStrings[i].text);
+        shapeCopy(&positions[count * 3], from);
+        shapeCopy(&positions[count * 3 + 3], to);
     }
-    #endif // DEBUG_DRAW_STR_DEALLOC_FUNC
+    count += 2;
+}
+
+int getGlyphRects(float * rects, float * glyphSize)
+{
+    // Same texture coordinates as the vertexes of pushStringGlyphs().
+    const FontCharSet & charSet = getFontCharSet();
+    const float scaleU = static_cast<float>(charSet.bitmapWidth);
+    const float scaleV = static_cast<float>(charSet.bitmapHeight);
+
+    if (rects != nullptr)
+    {
+        for (int c = 0; c < FontCharSet::MaxChars; ++c)
+        {
+            rects[c * 4 + 0] = (charSet.chars[c].x + 0.5f) / scaleU;
+            rects[c * 4 + 1] = (charSet.chars[c].y + 0.5f) / scaleV;
+            rects[c * 4 + 2] = rects[c * 4 + 0] + (charSet.charWidth  / scaleU);
+            rects[c * 4 + 3] = rects[c * 4 + 1] + (charSet.charHeight / scaleV);
+        }
+    }
+
+    if (glyphSize != nullptr)
+    {
+        glyphSize[0] = static_cast<float>(charSet.charWidth);
+        glyphSize[1] = static_cast<float>(charSet.charHeight);
+    }
+
+    return FontCharSet::MaxChars;
+}
+
+int getShapeMesh(const ShapeType shape, float * positions)
+{
+    // Same tessellation as the line expansion of each shape (sphere(), box(), cone() and circle()
+    // with a unit size), so both paths draw the same lines.
+    int count = 0;
+    ddVec3 from, to;
+
+    switch (shape)
+    {
+    case ShapeSphere :
+        {
+            static const int stepSize = 15;
+            ddVec3 cache[360 / stepSize];
+
+            for (int n = 0; n < arrayLength(cache); ++n)
+            {
+                vecSet(cache[n], 0.0f, 0.0f, 1.0f);
+            }
 
-    DD_CONTEXT->vertexBufferUsed  = 0;
-    DD_CONTEXT->debugStringsCount = 0;
-    DD_CONTEXT->debugPointsCount  = 0;
-    DD_CONTEXT->debugLinesCount   = 0;
+            for (int i = stepSize; i <= 360; i += stepSize)
+            {
+                const float s = floatSin(degreesToRadians(i));
+                const float c = floatCos(degreesToRadians(i));
+
+                vecSet(from, 0.0f, s, c);
+
+                for (int n = 0, j = stepSize; j <= 360; j += stepSize, ++n)
+                {
+                    vecSet(to, floatSin(degreesToRadians(j)) * s, floatCos(degreesToRadians(j)) * s, c);
+
+                    shapeMeshLine(positions, count, from, to);
+                    shapeMeshLine(positions, count, from, cache[n]);
+
+                    vecCopy(cache[n], from);
+                    vecCopy(from, to);
+                }
+            }
+        }
+        break;
+    case ShapeBox :
+        {
+            ddVec3 points[8];
+            for (int i = 0; i < arrayLength(points); ++i) // Same corner order as box(center, ...)
+            {
+                vecSet(points[i], (i == 2 || i == 3 || i == 6 || i == 7) ? 0.5f : -0.5f,
+                                  (i < 4) ? 0.5f : -0.5f,
+                                  (i == 0 || i == 3 || i == 4 || i == 7) ? 0.5f : -0.5f);
+            }
+
+            for (int i = 0; i < 4; ++i)
+            {
+                shapeMeshLine(positions, count, points[i], points[(i + 1) & 3]);
+                shapeMeshLine(positions, count, points[4 + i], points[4 + ((i + 1) & 3)]);
+                shapeMeshLine(positions, count, points[i], points[4 + i]);
+            }
+        }
+        break;
+    case ShapeCone :
+        {
+            static const int stepSize = 20;
+            ddVec3 apex;
+            vecSet(apex, 0.0f, 0.0f, 0.0f);
+
+            vecSet(from, 0.0f, 1.0f, 1.0f);
+            for (int i = stepSize; i <= 360; i += stepSize)
+            {
+                vecSet(to, floatSin(degreesToRadians(i)), floatCos(degreesToRadians(i)), 1.0f);
+
+                shapeMeshLine(positions, count, from, to);
+                shapeMeshLine(positions, count, to, apex);
+
+                vecCopy(from, to);
+            }
+        }
+        break;
+    case ShapeCircle :
+        {
+            const float numSteps = DEBUG_DRAW_CIRCLE_SHAPE_STEPS;
+
+            vecSet(from, 0.0f, 1.0f, 0.0f);
+            for (int i = 1; i <= numSteps; ++i)
+            {
+                const float radians = TAU * i / numSteps;
+                vecSet(to, floatSin(radians), floatCos(radians), 0.0f);
+
+                shapeMeshLine(positions, count, from, to);
+                vecCopy(from, to);
+            }
+        }
+        break;
+    default :
+        break;
+    } // switch (shape)
+
+    return count;
 }
 
 void point(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In pos, ddVec3_In color,
@@ -2641,19 +3726,28 @@ void point(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In pos, ddVec3_In
         return;
     }
 
-    if (DD_CONTEXT->debugPointsCount == DEBUG_DRAW_MAX_POINTS)
+    if (DD_CONTEXT->debugPointsCount == DEBUG_DRAW_MAX_POINTS || !growDebugQueue(DD_CONTEXT->debugPoints, DD_CONTEXT->debugPointsCount))
     {
+        ++DD_CONTEXT->counters.points.dropped;
         DEBUG_DRAW_OVERFLOWED("DEBUG_DRAW_MAX_POINTS limit reached! Dropping further debug point draws.");
         return;
     }
 
-    DebugPoint & point     = DD_CONTEXT->debugPoints[DD_CONTEXT->debugPointsCount++];
-    point.expiryDateMillis = DD_CONTEXT->currentTimeMillis + durationMillis;
-    point.depthEnabled     = depthEnabled;
-    point.size             = size;
-
-    vecCopy(point.position, pos);
-    vecCopy(point.color, color);
+    ++DD_CONTEXT->counters.points.submitted;
+
+    const int n = DD_CONTEXT->debugPointsCount++;
+    DebugPointChunk & points = *DD_CONTEXT->debugPoints.chunks[n / QueueChunkSize];
+    const int i = n % QueueChunkSize;
+
+    points.expiryDateMillis[i]  = DD_CONTEXT->currentTimeMillis + durationMillis;
+    points.depthEnabled[i]      = depthEnabled;
+    points.values[PointX][i]    = pos[X];
+    points.values[PointY][i]    = pos[Y];
+    points.values[PointZ][i]    = pos[Z];
+    points.values[PointR][i]    = color[X];
+    points.values[PointG][i]    = color[Y];
+    points.values[PointB][i]    = color[Z];
+    points.values[PointSize][i] = size;
 }
 
 void line(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In from, ddVec3_In to,
@@ -2664,19 +3758,30 @@ void line(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In from, ddVec3_In
         return;
     }
 
-    if (DD_CONTEXT->debugLinesCount == DEBUG_DRAW_MAX_LINES)
+    if (DD_CONTEXT->debugLinesCount == DEBUG_DRAW_MAX_LINES || !growDebugQueue(DD_CONTEXT->debugLines, DD_CONTEXT->debugLinesCount))
     {
+        ++DD_CONTEXT->counters.lines.dropped;
         DEBUG_DRAW_OVERFLOWED("DEBUG_DRAW_MAX_LINES limit reached! Dropping further debug line draws.");
         return;
     }
 
-    DebugLine & line      = DD_CONTEXT->debugLines[DD_CONTEXT->debugLinesCount++];
-    line.expiryDateMillis = DD_CONTEXT->currentTimeMillis + durationMillis;
-    line.depthEnabled     = depthEnabled;
-
-    vecCopy(line.posFrom, from);
-    vecCopy(line.posTo, to);
-    vecCopy(line.color, color);
+    ++DD_CONTEXT->counters.lines.submitted;
+
+    const int n = DD_CONTEXT->debugLinesCount++;
+    DebugLineChunk & lines = *DD_CONTEXT->debugLines.chunks[n / QueueChunkSize];
+    const int i = n % QueueChunkSize;
+
+    lines.expiryDateMillis[i]  = DD_CONTEXT->currentTimeMillis + durationMillis;
+    lines.depthEnabled[i]      = depthEnabled;
+    lines.values[LineFromX][i] = from[X];
+    lines.values[LineFromY][i] = from[Y];
+    lines.values[LineFromZ][i] = from[Z];
+    lines.values[LineToX][i]   = to[X];
+    lines.values[LineToY][i]   = to[Y];
+    lines.values[LineToZ][i]   = to[Z];
+    lines.values[LineR][i]     = color[X];
+    lines.values[LineG][i]     = color[Y];
+    lines.values[LineB][i]     = color[Z];
 }
 
 void screenText(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const char * const str, ddVec3_In pos,
@@ -2692,13 +3797,16 @@ void screenText(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const char * const
         return;
     }
 
-    if (DD_CONTEXT->debugStringsCount == DEBUG_DRAW_MAX_STRINGS)
+    if (DD_CONTEXT->debugStringsCount == DEBUG_DRAW_MAX_STRINGS || !growDebugQueue(DD_CONTEXT->debugStrings, DD_CONTEXT->debugStringsCount))
     {
+        ++DD_CONTEXT->counters.strings.dropped;
         DEBUG_DRAW_OVERFLOWED("DEBUG_DRAW_MAX_STRINGS limit reached! Dropping further debug string draws.");
         return;
     }
 
-    DebugString & dstr    = DD_CONTEXT->debugStrings[DD_CONTEXT->debugStringsCount++];
+    ++DD_CONTEXT->counters.strings.submitted;
+
+    DebugString & dstr    = queueEntry(DD_CONTEXT->debugStrings, DD_CONTEXT->debugStringsCount++);
     dstr.expiryDateMillis = DD_CONTEXT->currentTimeMillis + durationMillis;
     dstr.posX             = pos[X];
     dstr.posY             = pos[Y];
@@ -2722,8 +3830,9 @@ void projectedText(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const char * con
         return;
     }
 
-    if (DD_CONTEXT->debugStringsCount == DEBUG_DRAW_MAX_STRINGS)
+    if (DD_CONTEXT->debugStringsCount == DEBUG_DRAW_MAX_STRINGS || !growDebugQueue(DD_CONTEXT->debugStrings, DD_CONTEXT->debugStringsCount))
     {
+        ++DD_CONTEXT->counters.strings.dropped;
         DEBUG_DRAW_OVERFLOWED("DEBUG_DRAW_MAX_STRINGS limit reached! Dropping further debug string draws.");
         return;
     }
@@ -2749,7 +3858,9 @@ void projectedText(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) const char * con
     // NOTE: This is not renderer agnostic, I think... Should add a #define or something!
     scrY = static_cast<float>(sh) - scrY;
 
-    DebugString & dstr    = DD_CONTEXT->debugStrings[DD_CONTEXT->debugStringsCount++];
+    ++DD_CONTEXT->counters.strings.submitted;
+
+    DebugString & dstr    = queueEntry(DD_CONTEXT->debugStrings, DD_CONTEXT->debugStringsCount++);
     dstr.expiryDateMillis = DD_CONTEXT->currentTimeMillis + durationMillis;
     dstr.posX             = scrX;
     dstr.posY             = scrY;
@@ -2903,6 +4014,13 @@ void circle(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In center, ddVec
 
     vecScale(up, up, radius);
     vecScale(left, left, radius);
+
+    if (DD_CONTEXT->shapeInstancing && numSteps == DEBUG_DRAW_CIRCLE_SHAPE_STEPS)
+    {
+        shapeInstance(DD_EXPLICIT_CONTEXT_ONLY(ctx,) ShapeCircle, left, up, planeNormal, center, color, durationMillis, depthEnabled);
+        return;
+    }
+
     vecAdd(lastPoint, center, up);
 
     for (int i = 1; i <= numSteps; ++i)
@@ -2970,6 +4088,17 @@ void sphere(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In center, ddVec
         return;
     }
 
+    if (DD_CONTEXT->shapeInstancing)
+    {
+        ddVec3 axisX, axisY, axisZ;
+        vecSet(axisX, radius, 0.0f, 0.0f);
+        vecSet(axisY, 0.0f, radius, 0.0f);
+        vecSet(axisZ, 0.0f, 0.0f, radius);
+
+        shapeInstance(DD_EXPLICIT_CONTEXT_ONLY(ctx,) ShapeSphere, axisX, axisY, axisZ, center, color, durationMillis, depthEnabled);
+        return;
+    }
+
     static const int stepSize = 15;
     ddVec3 cache[360 / stepSize];
     ddVec3 radiusVec;
@@ -3028,6 +4157,15 @@ void cone(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In apex, ddVec3_In
     axis[1][Y] = -axis[1][Y];
     axis[1][Z] = -axis[1][Z];
 
+    if (DD_CONTEXT->shapeInstancing && apexRadius == 0.0f)
+    {
+        vecScale(temp1, axis[0], baseRadius);
+        vecScale(temp2, axis[1], baseRadius);
+
+        shapeInstance(DD_EXPLICIT_CONTEXT_ONLY(ctx,) ShapeCone, temp1, temp2, dir, apex, color, durationMillis, depthEnabled);
+        return;
+    }
+
     vecAdd(top, apex, dir);
     vecScale(temp1, axis[1], baseRadius);
     vecAdd(lastP2, top, temp1);
@@ -3097,6 +4235,17 @@ void box(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In center, ddVec3_I
         return;
     }
 
+    if (DD_CONTEXT->shapeInstancing)
+    {
+        ddVec3 axisX, axisY, axisZ;
+        vecSet(axisX, width, 0.0f, 0.0f);
+        vecSet(axisY, 0.0f, height, 0.0f);
+        vecSet(axisZ, 0.0f, 0.0f, depth);
+
+        shapeInstance(DD_EXPLICIT_CONTEXT_ONLY(ctx,) ShapeBox, axisX, axisY, axisZ, center, color, durationMillis, depthEnabled);
+        return;
+    }
+
     const float cx = center[X];
     const float cy = center[Y];
     const float cz = center[Z];
@@ -3131,6 +4280,17 @@ void aabb(DD_EXPLICIT_CONTEXT_ONLY(ContextHandle ctx,) ddVec3_In mins, ddVec3_In
         return;
     }
 
+    if (DD_CONTEXT->shapeInstancing)
+    {
+        ddVec3 center;
+        center[X] = (mins[X] + maxs[X]) * 0.5f;
+        center[Y] = (mins[Y] + maxs[Y]) * 0.5f;
+        center[Z] = (mins[Z] + maxs[Z]) * 0.5f;
+
+        box(DD_EXPLICIT_CONTEXT_ONLY(ctx,) center, color, maxs[X] - mins[X], maxs[Y] - mins[Y], maxs[Z] - mins[Z], durationMillis, depthEnabled);
+        return;
+    }
+
     ddVec3 bb[2];
     ddVec3 points[8];
 
@@ -3279,8 +4439,13 @@ void RenderInterface::endDraw()
 void RenderInterface::drawPointList(const DrawVertex *, int, bool)               { }
 void RenderInterface::drawLineList(const DrawVertex *, int, bool)                { }
 void RenderInterface::drawGlyphList(const DrawVertex *, int, GlyphTextureHandle) { }
+void RenderInterface::drawShapeList(ShapeType, const ShapeInstance *, int, bool) { }
+bool RenderInterface::supportsShapeInstancing()                                  { return false; }
+void RenderInterface::drawGlyphInstances(const GlyphInstance *, int, GlyphTextureHandle) { }
+bool RenderInterface::supportsGlyphInstancing()                                  { return false; }
 void RenderInterface::destroyGlyphTexture(GlyphTextureHandle)                    { }
 GlyphTextureHandle RenderInterface::createGlyphTexture(int, int, const void *)   { return nullptr; }
+GlyphTextureHandle RenderInterface::findGlyphTexture(int, int, std::uint32_t)    { return nullptr; }
 
 } // namespace dd
 